@@ -4,9 +4,23 @@
 #include <cstring> // For std::strncpy
 
 // Define constants for easy modification
+#ifndef MAX_INT_ENTRIES
 #define MAX_INT_ENTRIES 5         // Maximum number of integer entries
+#endif
+#ifndef MAX_STRING_ENTRIES
 #define MAX_STRING_ENTRIES 1000      // Maximum number of string entries
+#endif
+#ifndef MAX_STRING_LENGTH
 #define MAX_STRING_LENGTH 50      // Maximum length of string (including null terminator)
+#endif
+#ifndef MAX_NAME_ID_PAIRS
+#define MAX_NAME_ID_PAIRS 10       // Maximum number of name-ID pairs
+#endif
+
+// Serialized layout (configFlush/firmwareFlush): int and string counts,
+// then the int entries, then the string entries
+#define STRING_ENTRY_SIZE ((MAX_STRING_LENGTH + 3) & ~3) // String value padded to a whole word
+#define INT_ENTRY_SIZE (sizeof(int) + sizeof(int) + sizeof(int)) // Type + ID + value size
 
 enum {
     TYPE_INT,
@@ -49,5 +63,20 @@ struct InitArrayMap {
     size_t stringCount;                    // Count of string entries
 };
 
+// One store in RAM: its entries and name-ID pairs. The config.h and
+// firmware.h functions ending in _r work on the store they are given, the
+// others on the default store of their module.
+struct StoreContext {
+    InitArrayMap map;
+    NameIDPair names[MAX_NAME_ID_PAIRS];
+    int nameCount;
+};
+
+// Default stores behind config.h and firmware.h, and their entries
+extern StoreContext configDefaultStore;
+extern StoreContext firmwareDefaultStore;
+extern InitArrayMap& configArrayMap;
+extern InitArrayMap& firmwareArrayMap;
+
 #endif // INIT_ARRAY_MAP_H
 
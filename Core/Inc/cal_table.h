@@ -0,0 +1,106 @@
+/*
+ * cal_table.h
+ *
+ *  Piecewise-linear calibration tables in the magcal partition. A table
+ *  holds its points together with the slope of every segment, computed
+ *  when the image is built, so evaluation needs no division:
+ *
+ *      CAL_TABLE_UNIFORM      points every step from x0; the segment is
+ *                             found in O(1) with a precomputed reciprocal
+ *                             of step
+ *      CAL_TABLE_BREAKPOINTS  ascending x of any spacing; the segment is
+ *                             found by binary search
+ *
+ *  Slopes are Q32, so a value is y[i] + slope[i] * (x - x[i]) rounded,
+ *  within 1 of util_linear on the same segment. x outside the table takes
+ *  the value of the nearest end point. Evaluation reads the tables where
+ *  they are, memory mapped flash on target.
+ *
+ *  Image layout, little-endian, every table 8 byte aligned:
+ *
+ *      header  magic | table count (16) | 0 (16) | size | CRC-32 of the rest
+ *      table   id (16) | kind | 0 | count (16) | 0 (16) | x0 | step | step reciprocal | 0
+ *              x (32) * count          CAL_TABLE_BREAKPOINTS only
+ *              y (32) * count, padded to 8
+ *              slope (64) * (count - 1)
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef CAL_TABLE_H
+#define CAL_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "flash_partition.h"
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define CAL_IMAGE_MAGIC       0x314C4143U  // "CAL1"
+#define CAL_TABLE_MAX_POINTS  1024
+
+enum CalTableKind : uint8_t {
+    CAL_TABLE_UNIFORM = 1,
+    CAL_TABLE_BREAKPOINTS,
+};
+
+// A table ready to evaluate; the arrays point into the image
+struct CalTable {
+    uint16_t id;
+    CalTableKind kind;
+    uint16_t count;                // Points, at least 2
+    int32_t x0;                    // Uniform: first x
+    uint32_t step;                 // Uniform: distance between points
+    uint32_t stepRecip;            // Uniform: (2^32 - 1) / step
+    const int32_t* x;              // Breakpoints: ascending x
+    const int32_t* y;
+    const int64_t* slope;          // Q32, one per segment
+};
+
+// Image being built
+struct CalImageWriter {
+    uint8_t* image;                // 8 byte aligned
+    size_t capacity;
+    size_t length;
+    uint16_t count;                // Tables added
+};
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Build an image: begin, add tables, which return 1 if the points are not
+// usable or the image is full, and end, which returns the image size.
+// Segments must rise or fall by less than 2^31.
+void calImageBegin(CalImageWriter* writer, uint8_t* image, size_t capacity);
+int calImageAddUniform(CalImageWriter* writer, uint16_t id, int32_t x0, uint32_t step,
+                       const int32_t* y, uint16_t count);
+int calImageAddBreakpoints(CalImageWriter* writer, uint16_t id, const int32_t* x,
+                           const int32_t* y, uint16_t count);
+size_t calImageEnd(CalImageWriter* writer);
+
+// 0 if the image of at most size bytes has a valid header and CRC
+int calImageCheck(const uint8_t* image, size_t size);
+
+// Write an image to a CALIBRATION partition with the FIXED policy
+int calImageFlash(FlashPartitionId id, const uint8_t* image, size_t size);
+
+// Table id of an image, or of a partition holding one. Checks the layout,
+// not the CRC. Returns 1 if there is no such table.
+int calTableOpen(const uint8_t* image, size_t size, uint16_t id, CalTable* table);
+int calTableFind(FlashPartitionId partition, uint16_t id, CalTable* table);
+
+int32_t calTableEval(const CalTable* table, int32_t x);
+
+// Evaluate n samples; breakpoint tables start each search from the segment
+// of the previous sample, as consecutive sensor samples tend to be close
+void calTableEvalBatch(const CalTable* table, const int32_t* x, int32_t* y, size_t n);
+
+#endif // CAL_TABLE_H
@@ -9,28 +9,66 @@
 #define FLASH_SIMULATION_H
 
 #include <flashFile.h>
+#include "store_view.h"
 #include <cstdint>
 #include <vector>
 #include <string>
 
 // Functions to write configuration data with success/error messages
 int configWrite(const char* name, int id, char type, const void* data);
-void configWriteInt(int id, int value);
-void configWriteString(int id, const char* str);
+int configWriteInt(int id, int value);         // 1 if rejected or the store is full
+int configWriteString(int id, const char* str);
+int configUpdateInt(int id, int newValue);
 int configUpdateString(int id, const char* newValue);
 
 // Functions to retrieve configuration data with success/error messages
 int configGetInt(int id);       // Returns success/error message
 const char* configGetString(int id);  // Returns success/error message
+int configLookup(int id, StoreEntryView* entry); // 0 and the value (the int if both), 1 if not found
+
+// Entries in ID order, without copying values; valid until the next write
+StoreRange configRange(int loId, int hiId);          // loId <= id <= hiId
+size_t configForEach(StoreVisitor visitor, void* context); // Returns the number visited
 
 // Flash and load operations with success/error messages
 int flashConfig(uint32_t address);     // Flushes data to flash
 int loadConfig(uint32_t address);      // Loads data from flash
-void processConfigBuffer(uint8_t* bufferPtr, size_t bufferSize);
+int flashConfigRegion(FlashWearRegion* region); // Flushes data to the next page of a wear-leveled region
+int loadConfigRegion(FlashWearRegion* region);  // Loads the newest commit of a wear-leveled region
+int flashConfigPartition(FlashPartitionId id); // Flushes data to a CONFIG partition of flash_partition.h
+int loadConfigPartition(FlashPartitionId id);  // Loads data from a CONFIG partition
+int configFlush(uint32_t* buffer, size_t& bufferSize); // Serializes entries, bufferSize is capacity in/used out
+void configClear();                   // Drops all entries held in memory
+int processConfigBuffer(const uint8_t* bufferPtr, size_t bufferSize); // Merges an image, 1 if truncated
 
 // Handle management
-int configOpen(const char* str);  // Open file, returns success or error message
+int configOpen(const char* str);  // Open file, returns a descriptor or -1
 int configSaveHandles(const char* name, int id);  // Save handle and return status
 int configGetIDFromName(const char* name); // Get ID by name
 
+// Reentrant variants: the same operations on an explicit store, for hosts
+// that keep several (InitArrayMap.h). The functions above work on
+// configDefaultStore.
+void configClear_r(StoreContext* store);
+int configUpdateInt_r(StoreContext* store, int id, int newValue);
+int configUpdateString_r(StoreContext* store, int id, const char* newValue);
+int configWrite_r(StoreContext* store, const char* name, int id, char type, const void* data);
+int configWriteInt_r(StoreContext* store, int id, int value);
+int configWriteString_r(StoreContext* store, int id, const char* str);
+int configFlush_r(StoreContext* store, uint32_t* buffer, size_t& bufferSize);
+int configGetInt_r(StoreContext* store, int id);
+const char* configGetString_r(StoreContext* store, int id);
+int configLookup_r(StoreContext* store, int id, StoreEntryView* entry);
+StoreRange configRange_r(StoreContext* store, int loId, int hiId);
+size_t configForEach_r(StoreContext* store, StoreVisitor visitor, void* context);
+int loadConfig_r(StoreContext* store, uint32_t address);
+int flashConfig_r(StoreContext* store, uint32_t address);
+int flashConfigRegion_r(StoreContext* store, FlashWearRegion* region);
+int loadConfigRegion_r(StoreContext* store, FlashWearRegion* region);
+int flashConfigPartition_r(StoreContext* store, FlashPartitionId id);
+int loadConfigPartition_r(StoreContext* store, FlashPartitionId id);
+int processConfigBuffer_r(StoreContext* store, const uint8_t* bufferPtr, size_t bufferSize);
+int configSaveHandles_r(StoreContext* store, const char* name, int id);
+int configGetIDFromName_r(StoreContext* store, const char* name);
+
 #endif // FLASH_SIMULATION_H
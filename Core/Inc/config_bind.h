@@ -0,0 +1,147 @@
+/*
+ * config_bind.h
+ *
+ *  Binding of a plain struct to config entries, so a module reads and
+ *  writes all of its parameters with one call. The fields are listed once,
+ *  in ascending ID order, and CONFIG_BIND (at global scope) turns the list
+ *  into a table of IDs, offsets and types at compile time:
+ *
+ *      struct RadioSettings {
+ *          int sampleRate;
+ *          int txPower;
+ *          char serverHost[32];
+ *      };
+ *      #define RADIO_SETTINGS_FIELDS(INT, STRING) \
+ *          INT(sampleRate, CONFIG_sample_rate_hz) \
+ *          INT(txPower, CONFIG_tx_power_dbm) \
+ *          STRING(serverHost, CONFIG_server_host)
+ *      CONFIG_BIND(RadioSettings, RADIO_SETTINGS_FIELDS)
+ *
+ *      RadioSettings radio;
+ *      ConfigFieldStatus status = configReadStruct(&radio);
+ *
+ *  INT fields are int members and STRING fields char arrays. The store is
+ *  sorted by ID as well, so both functions walk it once from front to back.
+ *  Fields follow the schema as configGetInt and configWriteInt do: a
+ *  declared parameter without an entry reads as its default.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef CONFIG_BIND_H
+#define CONFIG_BIND_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "InitArrayMap.h"
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define CONFIG_BIND_MAX_FIELDS 32          // Bits of a status mask
+
+struct ConfigField {
+    int id;
+    char type;                             // 'i' or 's'
+    uint16_t offset;                       // Of the member in the struct
+    uint16_t size;                         // Of the member, with the terminator of a string
+};
+
+// Bit n stands for field n of the binding
+struct ConfigFieldStatus {
+    uint32_t missing;      // Read: no entry and no default, member untouched. Write: store full
+    uint32_t outOfRange;   // Read: value outside the schema, or a string longer than the member,
+                           // which gets the default or the truncated string. Write: rejected
+    uint32_t changed;      // Read: member value, write: stored value
+};
+
+// Specialized by CONFIG_BIND
+template <typename T>
+struct ConfigBinding;
+
+template <typename M>
+constexpr ConfigField configBindInt(int id, size_t offset)
+{
+    static_assert(std::is_same<M, int>::value, "CONFIG_BIND: an INT field must be an int member");
+    return {id, 'i', (uint16_t)offset, (uint16_t)sizeof(M)};
+}
+
+template <typename M>
+constexpr ConfigField configBindString(int id, size_t offset)
+{
+    static_assert(std::is_array<M>::value && std::is_same<std::remove_extent_t<M>, char>::value,
+                  "CONFIG_BIND: a STRING field must be a char array member");
+    return {id, 's', (uint16_t)offset, (uint16_t)sizeof(M)};
+}
+
+// IDs that can be stored, in ascending order
+constexpr bool configFieldsValid(const ConfigField* fields, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        if (fields[i].id < 0 || (i > 0 && fields[i].id <= fields[i - 1].id)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#define CONFIG_BIND_INT(member, id) configBindInt<decltype(BoundStruct::member)>((id), offsetof(BoundStruct, member)),
+#define CONFIG_BIND_STRING(member, id) \
+    configBindString<decltype(BoundStruct::member)>((id), offsetof(BoundStruct, member)),
+
+#define CONFIG_BIND(type, FIELDS)                                                                  \
+    template <>                                                                                    \
+    struct ConfigBinding<type> {                                                                   \
+        typedef type BoundStruct;                                                                  \
+        static constexpr ConfigField fields[] = {FIELDS(CONFIG_BIND_INT, CONFIG_BIND_STRING)};     \
+        static constexpr uint32_t count = sizeof(fields) / sizeof(fields[0]);                      \
+        static_assert(count <= CONFIG_BIND_MAX_FIELDS, "CONFIG_BIND: too many fields for a status mask"); \
+        static_assert(configFieldsValid(fields, count), "CONFIG_BIND: field IDs must be >= 0 and ascend"); \
+    };
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Fill the fields of object from the store
+ConfigFieldStatus configReadFields_r(StoreContext* store, void* object, const ConfigField* fields,
+                                     uint32_t count);
+
+// Store the fields of object; accepted fields are stored even if others are
+// not. Only changed entries count as updates in the storage stats.
+ConfigFieldStatus configWriteFields_r(StoreContext* store, const void* object, const ConfigField* fields,
+                                      uint32_t count);
+
+template <typename T>
+inline ConfigFieldStatus configReadStruct_r(StoreContext* store, T* object)
+{
+    return configReadFields_r(store, object, ConfigBinding<T>::fields, ConfigBinding<T>::count);
+}
+
+template <typename T>
+inline ConfigFieldStatus configWriteStruct_r(StoreContext* store, const T* object)
+{
+    return configWriteFields_r(store, object, ConfigBinding<T>::fields, ConfigBinding<T>::count);
+}
+
+// The same on configDefaultStore
+template <typename T>
+inline ConfigFieldStatus configReadStruct(T* object)
+{
+    return configReadStruct_r(&configDefaultStore, object);
+}
+
+template <typename T>
+inline ConfigFieldStatus configWriteStruct(const T* object)
+{
+    return configWriteStruct_r(&configDefaultStore, object);
+}
+
+#endif // CONFIG_BIND_H
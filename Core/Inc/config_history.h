@@ -0,0 +1,85 @@
+/*
+ * config_history.h
+ *
+ *  Config generations in a ROTATE partition. Every commit writes the new
+ *  image in full, as flashConfigPartition would, followed by reverse deltas
+ *  for up to CONFIG_HISTORY_DEPTH - 1 older generations and a trailer:
+ *
+ *      image | delta (G-1) | delta (G-2) | ... | padding | trailer
+ *
+ *  The delta of generation g holds the entries to set and drop to turn
+ *  generation g + 1 into g, so an older generation costs its changed
+ *  entries rather than a full copy. A commit computes one new delta against
+ *  the generation it replaces and copies the older deltas from the previous
+ *  page; the oldest are dropped once the page is full. Loading generation g
+ *  decodes the newest image and applies only the deltas down to g.
+ *
+ *  loadConfigPartition and older firmware read the image and ignore what
+ *  follows it. When loadConfigPartition migrates the newest image of a
+ *  history to the current schema, its write-back is a commit of its own and
+ *  the deltas stay as they were: older generations are rebuilt in the
+ *  schema they were written in and migrated as configHistoryLoad loads them.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef CONFIG_HISTORY_H
+#define CONFIG_HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include "flash_partition.h"
+#include "InitArrayMap.h"
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#ifndef CONFIG_HISTORY_DEPTH
+#define CONFIG_HISTORY_DEPTH 8     // Generations kept, the newest included
+#endif
+
+#define CONFIG_HISTORY_MAGIC   0x31484743U // "CGH1"
+#define CONFIG_HISTORY_NEWEST  0U          // Generation argument: the newest one
+
+struct ConfigGeneration {
+    uint32_t generation;           // Counts up from 1 with every commit
+    uint32_t storedBytes;          // Image size for the newest, delta size for older ones
+    uint32_t changes;              // Entries set or dropped by the delta, 0 for the newest
+};
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Commit the store as a new generation of a CONFIG partition with the
+// ROTATE policy. A store equal to the newest generation writes nothing.
+// Returns 1 if the image does not fit in a page or the flash fails.
+int configHistoryCommit(FlashPartitionId id);
+
+// Generations held by the partition, newest first; returns how many were
+// written to list
+size_t configHistoryList(FlashPartitionId id, ConfigGeneration* list, size_t capacity);
+
+// Whether the newest commit of the partition was made by configHistoryCommit
+bool configHistoryPresent(FlashPartitionId id);
+
+// Replace the entries of the store with a generation; name-ID pairs stay.
+// Returns 1 if the partition does not hold it.
+int configHistoryLoad(FlashPartitionId id, uint32_t generation);
+
+// Load a generation and commit it as the newest, so it survives a reset.
+// The generations after it stay in the history.
+int configHistoryRollback(FlashPartitionId id, uint32_t generation);
+
+// The same on an explicit store; the functions above use configDefaultStore
+int configHistoryCommit_r(StoreContext* store, FlashPartitionId id);
+int configHistoryLoad_r(StoreContext* store, FlashPartitionId id, uint32_t generation);
+int configHistoryRollback_r(StoreContext* store, FlashPartitionId id, uint32_t generation);
+
+#endif // CONFIG_HISTORY_H
@@ -0,0 +1,149 @@
+/*
+ * config_migrate.h
+ *
+ *  Load-time migration of config images across schema versions. An image
+ *  written by configFlush starts with a version entry (CONFIG_VERSION_ID,
+ *  never a stored ID) holding CONFIG_SCHEMA_VERSION; an image without one
+ *  is version 0. The params file lists the transforms that lead from one
+ *  version to the next, oldest first:
+ *
+ *      #define CONFIG_SCHEMA_VERSION 2
+ *      #define CONFIG_MIGRATIONS(RENAME, RETYPE, SPLIT, MERGE, DEFAULT, DROP) \
+ *          RENAME(1, 4048, CONFIG_sample_rate_hz)     version, old id, new id \
+ *          RETYPE(1, CONFIG_baud_rate, 'i')           version, id, new type \
+ *          SPLIT(2, 4100, CONFIG_threshold_low, 0, 12)    version, id, new id, shift, bits \
+ *          MERGE(2, 4101, CONFIG_gain, 4, 3)          version, id, packed id, shift, bits \
+ *          DEFAULT(2, CONFIG_filter_taps, 8)          version, id, value \
+ *          DROP(2, 4100)                              version, id
+ *
+ *  A transform of version v applies to images older than v. Entries pass
+ *  through the transforms in table order as they are decoded, so a chain
+ *  of releases migrates in the same single pass as a normal load:
+ *
+ *      RENAME   the entry moves to the new ID
+ *      RETYPE   an int becomes its decimal string, a decimal string an int;
+ *               a string that is not a number is dropped
+ *      SPLIT    an int entry also yields new id = (value >> shift) & mask
+ *      MERGE    (value & mask) << shift is or-ed into the packed id, which
+ *               is emitted after the last entry
+ *      DEFAULT  value is emitted for id if the image has no entry for it, so
+ *               a changed default does not change older devices
+ *      DROP     the entry is dropped
+ *
+ *  SPLIT and MERGE leave their source entry in place; DROP it after them.
+ *  Migrated entries are then checked against the schema like any other.
+ *  The loadConfig functions write a migrated image back once, with the
+ *  current version, as a new generation on a partition holding a history
+ *  (config_history.h); processConfigBuffer only migrates the store.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef CONFIG_MIGRATE_H
+#define CONFIG_MIGRATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "config_schema.h"
+#include "store_view.h"
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define CONFIG_VERSION_ID  (-1)            // Version entry, every write path rejects negative IDs
+
+#ifndef CONFIG_SCHEMA_VERSION
+#define CONFIG_SCHEMA_VERSION  0           // No version entry is written
+#endif
+
+#ifndef CONFIG_MIGRATIONS
+#define CONFIG_MIGRATIONS(RENAME, RETYPE, SPLIT, MERGE, DEFAULT, DROP)
+#endif
+
+enum ConfigMigrationKind : uint8_t {
+    CONFIG_MIGRATE_RENAME,
+    CONFIG_MIGRATE_RETYPE,
+    CONFIG_MIGRATE_SPLIT,
+    CONFIG_MIGRATE_MERGE,
+    CONFIG_MIGRATE_DEFAULT,
+    CONFIG_MIGRATE_DROP,
+};
+
+struct ConfigMigration {
+    uint32_t version;
+    ConfigMigrationKind kind;
+    int id;                                // Entry the transform applies to
+    int target;                            // RENAME / SPLIT / MERGE: new or packed ID
+    int value;                             // RETYPE: type, SPLIT / MERGE: shift, DEFAULT: value
+    int bits;                              // SPLIT / MERGE
+};
+
+#define CONFIG_MIGRATION_RENAME(version, id, target) {(version), CONFIG_MIGRATE_RENAME, (id), (target), 0, 0},
+#define CONFIG_MIGRATION_RETYPE(version, id, type) {(version), CONFIG_MIGRATE_RETYPE, (id), (id), (type), 0},
+#define CONFIG_MIGRATION_SPLIT(version, id, target, shift, bits) \
+    {(version), CONFIG_MIGRATE_SPLIT, (id), (target), (shift), (bits)},
+#define CONFIG_MIGRATION_MERGE(version, id, target, shift, bits) \
+    {(version), CONFIG_MIGRATE_MERGE, (id), (target), (shift), (bits)},
+#define CONFIG_MIGRATION_DEFAULT(version, id, value) {(version), CONFIG_MIGRATE_DEFAULT, (id), (id), (value), 0},
+#define CONFIG_MIGRATION_DROP(version, id) {(version), CONFIG_MIGRATE_DROP, (id), (id), 0, 0},
+
+// Transforms, followed by an unused terminator so the array is never empty
+inline constexpr ConfigMigration configMigrations[] = {
+    CONFIG_MIGRATIONS(CONFIG_MIGRATION_RENAME, CONFIG_MIGRATION_RETYPE, CONFIG_MIGRATION_SPLIT,
+                      CONFIG_MIGRATION_MERGE, CONFIG_MIGRATION_DEFAULT, CONFIG_MIGRATION_DROP)
+    {0, CONFIG_MIGRATE_DROP, CONFIG_VERSION_ID, CONFIG_VERSION_ID, 0, 0}
+};
+inline constexpr uint32_t configMigrationCount = sizeof(configMigrations) / sizeof(configMigrations[0]) - 1;
+
+// Versions ascending and within the schema version, fields that fit an int
+constexpr bool configMigrationsValid()
+{
+    for (uint32_t i = 0; i < configMigrationCount; ++i) {
+        const ConfigMigration& m = configMigrations[i];
+        if (m.version < 1 || m.version > CONFIG_SCHEMA_VERSION ||
+            (i > 0 && m.version < configMigrations[i - 1].version)) {
+            return false;
+        }
+        if ((m.kind == CONFIG_MIGRATE_SPLIT || m.kind == CONFIG_MIGRATE_MERGE) &&
+            (m.value < 0 || m.bits < 1 || m.value + m.bits > 32)) {
+            return false;
+        }
+        if (m.kind == CONFIG_MIGRATE_RETYPE && m.value != 'i' && m.value != 's') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(configMigrationsValid(),
+              "CONFIG_MIGRATIONS: versions out of order or above CONFIG_SCHEMA_VERSION, or a bad field");
+
+// One migration in progress
+struct ConfigMigrateState {
+    uint32_t imageVersion;
+    bool versionKnown;                     // The first entry has been seen
+    bool migrated;                         // Older than CONFIG_SCHEMA_VERSION, set at the end
+    uint32_t first;                        // First transform newer than the image
+    uint32_t merged[configMigrationCount + 1];     // MERGE: packed value so far
+    bool applied[configMigrationCount + 1];        // MERGE: value present, DEFAULT: id seen
+};
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Migrator for storeLoadImage using state; the version entry is taken out
+// of the image. Once the load is done, state->imageVersion holds the version
+// of the image and state->migrated tells whether it was older.
+StoreMigrator configMigrateBegin(ConfigMigrateState* state);
+
+// Schema version of a configFlush image of size bytes
+uint32_t configImageVersion(const uint8_t* image, size_t size);
+
+#endif // CONFIG_MIGRATE_H
@@ -0,0 +1,169 @@
+/*
+ * config_schema.h
+ *
+ *  Compile-time parameter schema for the config store. The application
+ *  declares each parameter once in CONFIG_PARAMS, normally in the file
+ *  named by CONFIG_PARAMS_FILE:
+ *
+ *      #define CONFIG_PARAMS(INT, STRING) \
+ *          INT(serial, 1, 0, 0, 99999999)      name, id, default, min, max \
+ *          STRING(label, 10, "unnamed")        name, id, default
+ *
+ *  The declarations become constexpr tables in flash. The store only holds
+ *  values that differ from their default, so RAM and every committed image
+ *  only carry overrides; configGetInt/configGetString fall back to the
+ *  default through an id-indexed table. Writes outside [min, max] or of the
+ *  wrong type are rejected. IDs that are not declared behave as before.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef CONFIG_SCHEMA_H
+#define CONFIG_SCHEMA_H
+
+#include <array>
+#include <cstdint>
+#include "InitArrayMap.h"
+
+#ifdef CONFIG_PARAMS_FILE
+#include CONFIG_PARAMS_FILE
+#endif
+
+#ifndef CONFIG_PARAMS
+#define CONFIG_PARAMS(INT, STRING)  // No schema: every ID is stored as written
+#endif
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#ifndef CONFIG_SCHEMA_MAX_SPAN
+#define CONFIG_SCHEMA_MAX_SPAN  1024       // Largest id range of the index table
+#endif
+
+struct ConfigParam {
+    const char* name;
+    int id;
+    char type;                             // 'i' or 's'
+    int defaultValue;
+    int min;
+    int max;
+    const char* defaultString;
+};
+
+// CONFIG_<name> constants for the declared IDs
+#define CONFIG_SCHEMA_ID_INT(name, id, def, min, max) CONFIG_##name = (id),
+#define CONFIG_SCHEMA_ID_STRING(name, id, def) CONFIG_##name = (id),
+enum ConfigParamId : int {
+    CONFIG_PARAMS(CONFIG_SCHEMA_ID_INT, CONFIG_SCHEMA_ID_STRING)
+};
+
+#define CONFIG_SCHEMA_ENTRY_INT(name, id, def, min, max) {#name, (id), 'i', (def), (min), (max), ""},
+#define CONFIG_SCHEMA_ENTRY_STRING(name, id, def) {#name, (id), 's', 0, 0, 0, (def)},
+
+// Declared parameters, followed by an unused terminator so the array is
+// never empty
+inline constexpr ConfigParam configSchema[] = {
+    CONFIG_PARAMS(CONFIG_SCHEMA_ENTRY_INT, CONFIG_SCHEMA_ENTRY_STRING)
+    {nullptr, -1, 0, 0, 0, 0, nullptr}
+};
+inline constexpr int configSchemaCount = sizeof(configSchema) / sizeof(configSchema[0]) - 1;
+
+//-----------------------------------------------------------------------------
+// Index table: configSchemaIndex[id - configSchemaFirstId] is the position
+// of the parameter in configSchema, or -1
+//-----------------------------------------------------------------------------
+
+constexpr int configSchemaBound(bool lowest)
+{
+    int bound = configSchemaCount ? configSchema[0].id : 0;
+    for (int i = 1; i < configSchemaCount; ++i) {
+        int id = configSchema[i].id;
+        bound = lowest ? (id < bound ? id : bound) : (id > bound ? id : bound);
+    }
+    return bound;
+}
+
+inline constexpr int configSchemaFirstId = configSchemaBound(true);
+inline constexpr int configSchemaSpan = configSchemaCount ? configSchemaBound(false) - configSchemaFirstId + 1 : 1;
+
+static_assert(configSchemaSpan <= CONFIG_SCHEMA_MAX_SPAN,
+              "Schema IDs span more than CONFIG_SCHEMA_MAX_SPAN, raise it or pack the IDs");
+
+constexpr std::array<int16_t, configSchemaSpan> configSchemaBuildIndex()
+{
+    std::array<int16_t, configSchemaSpan> index{};
+    for (int i = 0; i < configSchemaSpan; ++i) {
+        index[i] = -1;
+    }
+    for (int i = 0; i < configSchemaCount; ++i) {
+        index[configSchema[i].id - configSchemaFirstId] = (int16_t)i;
+    }
+    return index;
+}
+
+inline constexpr std::array<int16_t, configSchemaSpan> configSchemaIndex = configSchemaBuildIndex();
+
+constexpr bool configSchemaNameEqual(const char* a, const char* b)
+{
+    while (*a && *a == *b) {
+        ++a;
+        ++b;
+    }
+    return *a == *b;
+}
+
+constexpr int configSchemaStringLength(const char* s)
+{
+    int n = 0;
+    while (s[n]) {
+        ++n;
+    }
+    return n;
+}
+
+// Unique IDs and names, defaults that pass their own bounds
+constexpr bool configSchemaValid()
+{
+    for (int i = 0; i < configSchemaCount; ++i) {
+        const ConfigParam& p = configSchema[i];
+        if (p.id < 0 || configSchemaIndex[p.id - configSchemaFirstId] != i) {
+            return false;
+        }
+        if (p.type == 'i' && (p.min > p.max || p.defaultValue < p.min || p.defaultValue > p.max)) {
+            return false;
+        }
+        if (p.type == 's' && configSchemaStringLength(p.defaultString) >= MAX_STRING_LENGTH) {
+            return false;
+        }
+        for (int j = 0; j < i; ++j) {
+            if (configSchemaNameEqual(p.name, configSchema[j].name)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static_assert(configSchemaValid(), "CONFIG_PARAMS: duplicate id or name, or a default out of range");
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Declared parameter for id, or nullptr
+static inline const ConfigParam* configSchemaFind(int id)
+{
+    unsigned offset = (unsigned)(id - configSchemaFirstId);
+    if (offset >= (unsigned)configSchemaSpan || configSchemaIndex[offset] < 0) {
+        return nullptr;
+    }
+    return &configSchema[configSchemaIndex[offset]];
+}
+
+#endif // CONFIG_SCHEMA_H
@@ -30,6 +30,14 @@
 #define RESULT_OK		0	// Standard: 0 is success, 1 and higher are various error results
 #define RESULT_ERR		1	//
 
+// Storage class of the working state of the flash modules (wear regions,
+// scratch buffers, counters). The target runs one device and leaves it
+// empty; host builds running devices on several threads define it as
+// thread_local.
+#ifndef STORAGE_THREAD_LOCAL
+#define STORAGE_THREAD_LOCAL
+#endif
+
 //-----------------------------------------------------------------------------
 //
 // Interface Function Prototypes
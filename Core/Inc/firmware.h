@@ -9,6 +9,7 @@
 #define FIRMWARE_H
 
 #include <flashFile.h>
+#include "store_view.h"
 #include <InitArrayMap.h>
 #include <cstdint>
 #include <vector>
@@ -16,23 +17,60 @@
 
 // Functions to write firmware data with success/error messages
 int firmwareWrite(const char* name, int id, char type, const void* data);
-void firmwareWriteInt(int id, int value);
-void firmwareWriteString(int id, const char* str);
+int firmwareWriteInt(int id, int value);         // 1 if rejected or the store is full
+int firmwareWriteString(int id, const char* str);
+int firmwareUpdateInt(int id, int newValue);
 int firmwareUpdateString(int id, const char* newValue);
 
 // Functions to retrieve firmware data with success/error messages
 int firmwareGetInt(int id);       // Returns success/error message
 const char* firmwareGetString(int id);  // Returns success/error message
+int firmwareLookup(int id, StoreEntryView* entry); // 0 and the value (the int if both), 1 if not found
+
+// Entries in ID order, without copying values; valid until the next write
+StoreRange firmwareRange(int loId, int hiId);          // loId <= id <= hiId
+size_t firmwareForEach(StoreVisitor visitor, void* context); // Returns the number visited
 
 // Flash and load operations with success/error messages
 int flashFirmware(uint32_t address);     // Flushes data to flash
 int loadFirmware(uint32_t address);      // Loads data from flash
-void processFirmwareBuffer(uint8_t* bufferPtr, size_t bufferSize);
+int flashFirmwareRegion(FlashWearRegion* region); // Flushes data to the next page of a wear-leveled region
+int loadFirmwareRegion(FlashWearRegion* region);  // Loads the newest commit of a wear-leveled region
+int flashFirmwarePartition(FlashPartitionId id); // Flushes data to a FIRMWARE partition of flash_partition.h
+int loadFirmwarePartition(FlashPartitionId id);  // Loads data from a FIRMWARE partition
+int firmwareFlush(uint32_t* buffer, size_t& bufferSize); // Serializes entries, bufferSize is capacity in/used out
+void firmwareClear();                   // Drops all entries held in memory
+int processFirmwareBuffer(const uint8_t* bufferPtr, size_t bufferSize); // Merges an image, 1 if truncated
 
 // Handle management
-int firmwareOpen(const char* str);  // Open file, returns success or error message
+int firmwareOpen(const char* str);  // Open file, returns a descriptor or -1
 int firmwareSaveHandles(const char* name, int id);  // Save handle and return status
 int firmwareGetIDFromName(const char* name); // Get ID by name
 
+// Reentrant variants: the same operations on an explicit store, for hosts
+// that keep several (InitArrayMap.h). The functions above work on
+// firmwareDefaultStore.
+void firmwareClear_r(StoreContext* store);
+int firmwareUpdateInt_r(StoreContext* store, int id, int newValue);
+int firmwareUpdateString_r(StoreContext* store, int id, const char* newValue);
+int firmwareWrite_r(StoreContext* store, const char* name, int id, char type, const void* data);
+int firmwareWriteInt_r(StoreContext* store, int id, int value);
+int firmwareWriteString_r(StoreContext* store, int id, const char* str);
+int firmwareFlush_r(StoreContext* store, uint32_t* buffer, size_t& bufferSize);
+int firmwareGetInt_r(StoreContext* store, int id);
+const char* firmwareGetString_r(StoreContext* store, int id);
+int firmwareLookup_r(StoreContext* store, int id, StoreEntryView* entry);
+StoreRange firmwareRange_r(StoreContext* store, int loId, int hiId);
+size_t firmwareForEach_r(StoreContext* store, StoreVisitor visitor, void* context);
+int loadFirmware_r(StoreContext* store, uint32_t address);
+int flashFirmware_r(StoreContext* store, uint32_t address);
+int flashFirmwareRegion_r(StoreContext* store, FlashWearRegion* region);
+int loadFirmwareRegion_r(StoreContext* store, FlashWearRegion* region);
+int flashFirmwarePartition_r(StoreContext* store, FlashPartitionId id);
+int loadFirmwarePartition_r(StoreContext* store, FlashPartitionId id);
+int processFirmwareBuffer_r(StoreContext* store, const uint8_t* bufferPtr, size_t bufferSize);
+int firmwareSaveHandles_r(StoreContext* store, const char* name, int id);
+int firmwareGetIDFromName_r(StoreContext* store, const char* name);
+
 #endif // FIRMWARE_H
 
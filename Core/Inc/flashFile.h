@@ -10,14 +10,66 @@
 
 #include <cstddef>
 #include <cstdint>
+#include "flash_wear.h"
+#include "flash_partition.h"
+#include "flash_fs.h"
 
-// Function to load data from flash, returning raw data to be processed
+// Stored image header, written when compression is enabled. Images without
+// it are the plain configFlush/firmwareFlush layout and still load.
+#define FILE_IMAGE_MAGIC       0x474D4946U // "FIMG"
+#define FILE_IMAGE_METHOD_RAW  0           // Serialized store follows as is
+#define FILE_IMAGE_METHOD_LZ   1           // lz_compress output follows
+
+struct FileImageHeader {
+    uint32_t magic;
+    uint32_t method;
+    uint32_t rawSize;                      // Serialized store size
+    uint32_t storedSize;                   // Bytes following the header
+    uint32_t crc;                          // util_crc32 of the serialized store
+};
+
+// Largest encoded image: a serialized store of BUFFER_SIZE bytes behind its
+// header, padded to a quadword
+#ifndef FILE_IMAGE_BUFFER_SIZE
+#define FILE_IMAGE_BUFFER_SIZE \
+    ((BUFFER_SIZE + sizeof(FileImageHeader) + FLASH_QUADWORD_SIZE - 1) & ~(size_t)(FLASH_QUADWORD_SIZE - 1))
+#endif
+
+// Function to load data from flash, returning raw data to be processed.
+// size is the capacity in words; compressed images are expanded into data.
 int readAndLoadFlashData(uint8_t* data, size_t& size, uint32_t addr);
 
-// Function to open a file by its handle
+// Store images with a header and compress them when that makes them smaller
+void fileSetCompression(bool enable);
+bool fileGetCompression(void);
+
+// Image as fileWrite stores it: data itself, or the header and payload in an
+// internal buffer when compression is enabled (valid until the next call)
+int fileEncodeImage(uint32_t* data, size_t size, uint32_t*& image, size_t& imageSize);
+
+// Expand a headered image of at most available bytes into data; size is
+// capacity in, bytes out. Returns 1 for a bad header, payload or CRC.
+int fileDecodeBuffer(const uint8_t* image, uint32_t available, uint8_t* data, size_t& size);
+
+// Open a file of the flash filesystem by name; returns a descriptor or -1
 int fileOpen(const char* handle);
+int fileClose(int fd);
+
+// The same on an explicit volume (flash_fs.h)
+int fileOpen_r(FsVolume* volume, const char* handle);
+int fileClose_r(FsVolume* volume, int fd);
 
 // Function to write data to flash, passing buffer and size
 int fileWrite(uint32_t* data, size_t size, uint32_t addr);
 
+// Wear-leveled variants: write to the next page of the region / read the
+// newest commit back, size is capacity in and bytes loaded out
+int fileWriteRegion(FlashWearRegion* region, uint32_t* data, size_t size);
+int readAndLoadRegionData(uint8_t* data, size_t& size, FlashWearRegion* region);
+
+// Partition variants: FIXED partitions are rewritten in place, ROTATE ones go
+// through their wear region. size is capacity in and bytes loaded out.
+int fileWritePartition(FlashPartitionId id, uint32_t* data, size_t size);
+int readAndLoadPartitionData(uint8_t* data, size_t& size, FlashPartitionId id);
+
 #endif // FLASHFILE_H
@@ -0,0 +1,98 @@
+/*
+ * flash_digest.h
+ *
+ *  Per-page digests of the fwimage partition, so boot validation does not
+ *  have to read and hash the whole image. Every page programmed through
+ *  flash_pageEraseWriteVerify or fwImage gets its digest recorded; fwImage
+ *  also records the image size and an image digest derived from the page
+ *  digests. Validation then trusts the table, spot-checks a few pages or
+ *  sweeps them all:
+ *
+ *      FLASH_DIGEST_TABLE  page digests present and consistent with the
+ *                          image digest; reads only the table
+ *      FLASH_DIGEST_SPOT   the same, then rehashes spotPages pages from a
+ *                          cursor that moves on with every boot, so the
+ *                          whole image is swept every few boots
+ *      FLASH_DIGEST_FULL   the same, then rehashes every page
+ *
+ *  The table is a log in the two pages of the fwdigest partition: a
+ *  quadword per record, appended without erasing. A full log is compacted
+ *  into the other page, whose header is programmed last, so a reset during
+ *  compaction leaves the old page in charge.
+ *
+ *      header  magic | sequence | 0 | check
+ *      record  type (8) | 0 (8) | page (16) | digest | value | check
+ *
+ *  Pages are hashed with FLASH_DIGEST_PAGE, a word-wise software hash
+ *  unless the target maps it onto its CRC unit.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef FLASH_DIGEST_H
+#define FLASH_DIGEST_H
+
+#include <cstddef>
+#include <cstdint>
+#include "flash_partition.h"
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define FLASH_DIGEST_MAGIC  0x31474450U  // "PDG1"
+#define FLASH_DIGEST_PAGES  (flash_partition(FLASH_PARTITION_fwimage).pageCount)
+
+// Digest of size bytes of flash. A target can stream the page through its
+// CRC unit instead, e.g. HAL_CRC_Calculate on a configured handle.
+#ifndef FLASH_DIGEST_PAGE
+#define FLASH_DIGEST_PAGE(data, size) flash_digestHash((data), (size))
+#endif
+
+enum FlashDigestMode : uint8_t {
+    FLASH_DIGEST_TABLE,
+    FLASH_DIGEST_SPOT,
+    FLASH_DIGEST_FULL,
+};
+
+struct FlashDigestReport {
+    uint32_t imageSize;            // Recorded by fwImageFinish, 0 if none
+    uint32_t imageDigest;
+    uint32_t pagesChecked;         // Pages rehashed
+    uint32_t bytesRead;            // Table and pages
+    int32_t failedPage;            // First page of the image that failed, -1 if none
+};
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Word-wise hash of size bytes, four independent lanes per quadword
+uint32_t flash_digestHash(const uint8_t* data, uint32_t size);
+
+// Record the digest of the page at pageAddress as it is in flash now. Pages
+// outside the fwimage partition are ignored. Returns 1 if the log cannot be
+// written.
+int flash_digestRecordPage(uint32_t pageAddress);
+
+// An image starting at address (the start of the fwimage partition, others
+// are ignored) is being written: validation fails until it is finished
+int flash_digestBeginImage(uint32_t address);
+
+// The image of size bytes at address is complete: record its last page,
+// any page without a digest, and the image digest
+int flash_digestFinishImage(uint32_t address, uint32_t size);
+
+// Validate the recorded image; spotPages is used by FLASH_DIGEST_SPOT.
+// Returns 0 if valid, 1 if there is no complete image or a check failed.
+int flash_digestValidate(FlashDigestMode mode, uint32_t spotPages, FlashDigestReport* report);
+
+// Drop the table held in RAM; the next call reads it from flash again
+void flash_digestForget(void);
+
+#endif // FLASH_DIGEST_H
@@ -0,0 +1,130 @@
+/*
+ * flash_fs.h
+ *
+ *  Minimal flash filesystem. A volume is a run of pages in one bank: the
+ *  first two hold the directory as a wear-leveled region, the rest are
+ *  handed out to files as contiguous page extents. Files are written
+ *  sequentially; full quadwords are programmed as data arrives and the
+ *  last partial quadword is kept in the directory entry until more data
+ *  completes it. The directory is committed on close and flash_fsSync.
+ *  fileOpen mounts the fs partition of flash_partition.h.
+ *
+ *  The functions ending in _r work on the FsVolume they are given, so a
+ *  host can mount one volume per simulated device; the others use
+ *  fsDefaultVolume.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef FLASH_FS_H
+#define FLASH_FS_H
+
+#include <cstddef>
+#include <cstdint>
+#include "flash_wear.h"
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#ifndef FLASH_FS_MAX_FILES
+#define FLASH_FS_MAX_FILES     32
+#endif
+#ifndef FLASH_FS_MAX_OPEN
+#define FLASH_FS_MAX_OPEN      8           // Descriptors 0..FLASH_FS_MAX_OPEN-1
+#endif
+#define FLASH_FS_NAME_LENGTH   24          // Including the terminator
+#define FLASH_FS_DIR_PAGES     2           // Directory region at the start of the volume
+
+// flash_fsOpen flags
+#define FLASH_FS_READ          0x01
+#define FLASH_FS_WRITE         0x02        // Append at the end of the file
+#define FLASH_FS_CREATE        0x04        // Create with the given capacity if missing
+#define FLASH_FS_TRUNCATE      0x08        // Erase the extent and start empty
+
+// flash_fsSeek origins
+#define FLASH_FS_SEEK_SET      0
+#define FLASH_FS_SEEK_CUR      1
+#define FLASH_FS_SEEK_END      2
+
+struct FsEntry {
+    char name[FLASH_FS_NAME_LENGTH];
+    uint16_t firstPage;                      // Volume relative, 0 = unused slot
+    uint16_t pageCount;
+    uint32_t size;
+    uint8_t tail[16];                        // Bytes past the last programmed quadword
+};
+
+struct FsDirectory {
+    uint32_t magic;
+    uint32_t reserved;
+    FsEntry entries[FLASH_FS_MAX_FILES];
+};
+
+struct FsOpenFile {
+    bool inUse;
+    uint8_t flags;
+    uint16_t entry;
+    uint32_t position;
+};
+
+// A mounted volume and its open files
+struct FsVolume {
+    bool mounted;
+    bool dirty;                              // Directory differs from flash
+    uint32_t bank;
+    uint32_t firstPage;
+    uint32_t pageCount;
+    FlashWearRegion dirRegion;
+    FsDirectory dir;
+    FsOpenFile files[FLASH_FS_MAX_OPEN];     // Indexed by descriptor
+};
+
+extern FsVolume fsDefaultVolume;
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Read the directory of the volume. An empty directory is a valid, empty
+// volume, so no separate format step is needed. Returns 0 for success.
+int flash_fsMount(uint32_t bank, uint32_t firstPage, uint32_t pageCount);
+bool flash_fsMounted(void);
+
+// Returns a descriptor >= 0, or -1 if the file does not exist (without
+// FLASH_FS_CREATE), is already open for writing or there is no room.
+// capacity (bytes, rounded up to pages, 0 = one page) only applies on create.
+int flash_fsOpen(const char* name, int flags, uint32_t capacity);
+int flash_fsClose(int fd);
+
+// Return the number of bytes transferred, or -1 for an invalid descriptor
+// or a flash error. Writes always append; a file cannot grow past its extent.
+// A reader whose file is truncated under it reads nothing until it seeks.
+int flash_fsRead(int fd, void* data, uint32_t size);
+int flash_fsWrite(int fd, const void* data, uint32_t size);
+
+// Move the read position; returns the new position or -1
+int32_t flash_fsSeek(int fd, int32_t offset, int whence);
+
+int32_t flash_fsSize(int fd);
+int flash_fsRemove(const char* name);       // File must not be open
+int flash_fsSync(void);                      // Commit the directory
+
+// Reentrant variants on an explicit volume
+int flash_fsMount_r(FsVolume* volume, uint32_t bank, uint32_t firstPage, uint32_t pageCount);
+bool flash_fsMounted_r(FsVolume* volume);
+int flash_fsOpen_r(FsVolume* volume, const char* name, int flags, uint32_t capacity);
+int flash_fsClose_r(FsVolume* volume, int fd);
+int flash_fsRead_r(FsVolume* volume, int fd, void* data, uint32_t size);
+int flash_fsWrite_r(FsVolume* volume, int fd, const void* data, uint32_t size);
+int32_t flash_fsSeek_r(FsVolume* volume, int fd, int32_t offset, int whence);
+int32_t flash_fsSize_r(FsVolume* volume, int fd);
+int flash_fsRemove_r(FsVolume* volume, const char* name);
+int flash_fsSync_r(FsVolume* volume);
+
+#endif // FLASH_FS_H
@@ -0,0 +1,143 @@
+/*
+ * flash_log.h
+ *
+ *  Diagnostics of the storage layer without formatting on the device. A
+ *  message is recorded as its ID and up to FLASH_LOG_ARGS raw 32-bit
+ *  arguments in a RAM ring; the text is only put together by the host
+ *  ("host logdump"), from the format strings of FLASH_LOG_MESSAGES. The
+ *  formats are never referenced by target code, so they do not take flash.
+ *
+ *  Recording claims a slot with an atomic increment of the head, so it is
+ *  safe from interrupts and threads, and writes the message word last with
+ *  the low bits of the sequence, so the decoder can tell a slot that was
+ *  being written when the snapshot was taken. Like flash_trace, the ring
+ *  only uses 32-bit fields.
+ *
+ *  Formats take %u, %d and %x conversions (with flags and widths) only.
+ *  Add messages at the end: the ring header carries a hash of the formats
+ *  and the decoder warns when it was built from a different list.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <cstdint>
+#include "storage_stats.h"
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define FLASH_LOG_MAGIC   0x31474C46U  // "FLG1", located by the decoder
+#ifndef FLASH_LOG_SIZE
+#define FLASH_LOG_SIZE    64           // Messages kept, power of two
+#endif
+#ifndef FLASH_LOG_ENABLE
+#define FLASH_LOG_ENABLE  1
+#endif
+#define FLASH_LOG_ARGS    4
+
+static_assert((FLASH_LOG_SIZE & (FLASH_LOG_SIZE - 1)) == 0, "FLASH_LOG_SIZE must be a power of two");
+
+// name, format
+#define FLASH_LOG_MESSAGES(MSG)                                                                 \
+    MSG(UNLOCK_FAILED,       "flash unlock failed, HAL status %u")                             \
+    MSG(ERASE_FAILED,        "erase of bank %u page %u failed, HAL status %u")                 \
+    MSG(PROGRAM_FAILED,      "program of 0x%08x failed, HAL status %u")                        \
+    MSG(VERIFY_FAILED,       "verify of page 0x%08x failed, %u bytes written")                 \
+    MSG(WEAR_COMMIT_INVALID, "wear region bank %u page %u: commit %u fails its CRC, using older") \
+    MSG(WEAR_COMMIT_FAILED,  "wear region bank %u page %u: commit %u of %u bytes failed")      \
+    MSG(STORE_IMAGE_INVALID, "store image of %u bytes invalid at byte %u, entry %u of %u")     \
+    MSG(FW_IMAGE_CRC,        "fwImage CRC 0x%08x over %u bytes, expected 0x%08x")              \
+    MSG(FW_IMAGE_FAILED,     "fwImage failed after %u of %u bytes")                            \
+    MSG(DIGEST_MISSING,      "boot validation: no digest of fwimage page %u")                  \
+    MSG(DIGEST_MISMATCH,     "boot validation: fwimage page %u hashes to 0x%08x, recorded 0x%08x") \
+    MSG(DIGEST_COMPACTED,    "digest log compacted into page %u, sequence %u")                 \
+    MSG(CONFIG_MIGRATED,     "config image of schema version %u migrated to %u")              \
+    MSG(CONFIG_IMAGE_NEWER,  "config image of schema version %u is newer than %u, not migrated") \
+    MSG(CONFIG_MIGRATE_DROPPED, "config migration to version %u: entry %u is not a number, dropped")
+
+#define FLASH_LOG_ID(name, format) FLASH_LOG_##name,
+enum FlashLogId : uint16_t {
+    FLASH_LOG_NONE,
+    FLASH_LOG_MESSAGES(FLASH_LOG_ID)
+    FLASH_LOG_COUNT
+};
+
+// Formats by ID, for the decoder
+#define FLASH_LOG_FORMAT(name, format) format,
+inline constexpr const char* flashLogFormats[FLASH_LOG_COUNT] = {
+    "",
+    FLASH_LOG_MESSAGES(FLASH_LOG_FORMAT)
+};
+
+// FNV-1a over every format, identifies the message list
+constexpr uint32_t flashLogTableId()
+{
+    uint32_t hash = 0x811C9DC5U;
+    for (int i = 1; i < FLASH_LOG_COUNT; ++i) {
+        for (const char* c = flashLogFormats[i]; ; ++c) {
+            hash = (hash ^ (uint8_t)*c) * 0x01000193U;
+            if (!*c) {
+                break;
+            }
+        }
+    }
+    return hash;
+}
+
+struct FlashLogEntry {
+    uint32_t timestamp;          // storageStatsCycles()
+    uint32_t args[FLASH_LOG_ARGS];
+    uint32_t word;               // FlashLogId | sequence << 16, written last
+};
+
+struct FlashLogRing {
+    uint32_t magic;
+    uint32_t mask;               // FLASH_LOG_SIZE - 1
+    uint32_t head;               // Messages recorded since start-up, wraps
+    uint32_t cyclesPerSecond;    // Timestamp unit, 0 until the first store op
+    uint32_t tableId;            // flashLogTableId() of the firmware
+    FlashLogEntry entries[FLASH_LOG_SIZE];
+};
+
+extern STORAGE_THREAD_LOCAL FlashLogRing flashLog;
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Record one message; arguments past those of its format are ignored
+static inline void flash_log(FlashLogId id, uint32_t a0 = 0, uint32_t a1 = 0, uint32_t a2 = 0,
+                             uint32_t a3 = 0)
+{
+#if FLASH_LOG_ENABLE
+    uint32_t seq = __atomic_fetch_add(&flashLog.head, 1U, __ATOMIC_RELAXED);
+    FlashLogEntry& entry = flashLog.entries[seq & (FLASH_LOG_SIZE - 1)];
+    entry.timestamp = storageStatsCycles();
+    entry.args[0] = a0;
+    entry.args[1] = a1;
+    entry.args[2] = a2;
+    entry.args[3] = a3;
+    __atomic_store_n(&entry.word, (uint32_t)id | (seq << 16), __ATOMIC_RELEASE);
+#else
+    (void)id;
+    (void)a0;
+    (void)a1;
+    (void)a2;
+    (void)a3;
+#endif
+}
+
+// Record the timestamp unit, known only at run time on target
+void flash_logStart(void);
+void flash_logClear(void);
+
+#endif // FLASH_LOG_H
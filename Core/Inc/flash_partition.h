@@ -0,0 +1,189 @@
+/*
+ * flash_partition.h
+ *
+ *  Partition table: every flash region a store, the filesystem or an image
+ *  writer uses, declared once with its bank, page range, purpose and wear
+ *  policy. The application may replace the default table through the file
+ *  named by FLASH_PARTITIONS_FILE:
+ *
+ *      #define FLASH_PARTITIONS(PART) \
+ *          PART(user, FLASH_BANK_2, 127, 1, CONFIG, FIXED)   name, bank, first page, pages, purpose, policy
+ *
+ *  fileOpen mounts the fs partition and flash_digest.h keeps the page
+ *  digests of fwimage in fwdigest, so a replacement table must keep them.
+ *  The table is checked at compile time: pages inside their bank, unique
+ *  names, no two partitions sharing a page, page counts the policy can use.
+ *  Partitions are referred to as FLASH_PARTITION_<name>; their address, bank
+ *  and page are constants, so committing to one skips findPageAndBank and
+ *  flash_getPageAddress.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef FLASH_PARTITION_H
+#define FLASH_PARTITION_H
+
+#include <cstdint>
+#include "flash_program.h"
+#include "flash_wear.h"
+
+#ifdef FLASH_PARTITIONS_FILE
+#include FLASH_PARTITIONS_FILE
+#endif
+
+// Default layout. Bank 1 holds the application; bank 2 pages 0..47 are free.
+#ifndef FLASH_PARTITIONS
+#define FLASH_PARTITIONS(PART) \
+    PART(code,     FLASH_BANK_1,      0,                 FLASH_PAGE_NB, CODE,        READONLY) \
+    PART(firmware, FLASH_BANK_2,      48,                8,             FIRMWARE,    ROTATE)   \
+    PART(config,   FLASH_BANK_2,      56,                8,             CONFIG,      ROTATE)   \
+    PART(fwimage,  FLASH_BANK_2,      64,                30,            FW_IMAGE,    STREAM)   \
+    PART(fwdigest, FLASH_BANK_2,      94,                2,             FW_DIGEST,   STREAM)   \
+    PART(fs,       FLASH_BANK_2,      96,                30,            FILESYSTEM,  STREAM)   \
+    PART(magcal,   FLASH_MAGCAL_BANK, FLASH_MAGCAL_PAGE, 1,             CALIBRATION, FIXED)    \
+    PART(user,     FLASH_USER_BANK,   FLASH_USER_PAGE,   1,             CONFIG,      FIXED)
+#endif
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+enum FlashPartitionPurpose : uint8_t {
+    FLASH_PURPOSE_CODE,                    // Application, never written by the stores
+    FLASH_PURPOSE_CONFIG,                  // configFlush images
+    FLASH_PURPOSE_FIRMWARE,                // firmwareFlush images
+    FLASH_PURPOSE_FW_IMAGE,                // fwImage staging area
+    FLASH_PURPOSE_FW_DIGEST,               // flash_digest log of the fwimage page digests
+    FLASH_PURPOSE_FILESYSTEM,              // flash_fs volume
+    FLASH_PURPOSE_CALIBRATION,             // Magnetometer calibration
+};
+
+enum FlashWearPolicy : uint8_t {
+    FLASH_POLICY_READONLY,                 // Not erased or programmed
+    FLASH_POLICY_FIXED,                    // One page, erased and rewritten in place
+    FLASH_POLICY_ROTATE,                   // flash_wear region, commits rotate across the pages
+    FLASH_POLICY_STREAM,                   // Appended to by its owner, erased ahead
+};
+
+struct FlashPartition {
+    const char* name;
+    uint32_t bank;                         // FLASH_BANK_1 / FLASH_BANK_2
+    uint32_t firstPage;
+    uint32_t pageCount;
+    FlashPartitionPurpose purpose;
+    FlashWearPolicy policy;
+    uint32_t address;                      // First byte of firstPage
+    uint32_t size;                         // pageCount pages
+};
+
+// FLASH_PARTITION_<name> indexes flashPartitions
+#define FLASH_PARTITION_ID(name, bank, first, count, purpose, policy) FLASH_PARTITION_##name,
+enum FlashPartitionId : int {
+    FLASH_PARTITIONS(FLASH_PARTITION_ID)
+    FLASH_PARTITION_COUNT
+};
+
+#define FLASH_PARTITION_ENTRY(name, bank, first, count, purpose, policy)       \
+    {#name, (bank), (first), (count), FLASH_PURPOSE_##purpose, FLASH_POLICY_##policy, \
+     FLASH_BASE + ((bank) - 1) * FLASH_BANK_SIZE + (first) * FLASH_PAGE_SIZE,   \
+     (count) * FLASH_PAGE_SIZE},
+
+inline constexpr FlashPartition flashPartitions[FLASH_PARTITION_COUNT] = {
+    FLASH_PARTITIONS(FLASH_PARTITION_ENTRY)
+};
+
+//-----------------------------------------------------------------------------
+// Compile-time checks
+//-----------------------------------------------------------------------------
+
+constexpr bool flashPartitionNameEqual(const char* a, const char* b)
+{
+    while (*a && *a == *b) {
+        ++a;
+        ++b;
+    }
+    return *a == *b;
+}
+
+// Bank and page range valid, page count usable by the policy, names unique
+constexpr bool flashPartitionsValid()
+{
+    for (int i = 0; i < FLASH_PARTITION_COUNT; ++i) {
+        const FlashPartition& p = flashPartitions[i];
+        if ((p.bank != FLASH_BANK_1 && p.bank != FLASH_BANK_2) || p.pageCount == 0 ||
+            p.firstPage + p.pageCount > FLASH_PAGE_NB) {
+            return false;
+        }
+        if ((p.policy == FLASH_POLICY_FIXED && p.pageCount != 1) ||
+            (p.policy == FLASH_POLICY_ROTATE && p.pageCount > FLASH_WEAR_MAX_PAGES)) {
+            return false;
+        }
+        for (int j = 0; j < i; ++j) {
+            if (flashPartitionNameEqual(p.name, flashPartitions[j].name)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// No page belongs to two partitions
+constexpr bool flashPartitionsDisjoint()
+{
+    for (int i = 0; i < FLASH_PARTITION_COUNT; ++i) {
+        const FlashPartition& a = flashPartitions[i];
+        for (int j = 0; j < i; ++j) {
+            const FlashPartition& b = flashPartitions[j];
+            if (a.bank == b.bank && a.firstPage < b.firstPage + b.pageCount &&
+                b.firstPage < a.firstPage + a.pageCount) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static_assert(flashPartitionsValid(),
+              "FLASH_PARTITIONS: bad bank or page range, page count unusable by the policy, or duplicate name");
+static_assert(flashPartitionsDisjoint(), "FLASH_PARTITIONS: two partitions share a page");
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+constexpr const FlashPartition& flash_partition(FlashPartitionId id)
+{
+    return flashPartitions[id];
+}
+
+// Partition by name for tools and the console, FLASH_PARTITION_COUNT if unknown
+static inline FlashPartitionId flash_partitionFind(const char* name)
+{
+    int i = 0;
+    while (i < FLASH_PARTITION_COUNT && !flashPartitionNameEqual(name, flashPartitions[i].name)) {
+        ++i;
+    }
+    return (FlashPartitionId)i;
+}
+
+// Partition holding address, FLASH_PARTITION_COUNT if none does
+FlashPartitionId flash_partitionOf(uint32_t address);
+
+// Wear region of a ROTATE partition, mounted on first use; nullptr for other
+// policies or if the mount fails
+FlashWearRegion* flash_partitionRegion(FlashPartitionId id);
+
+// Erase every page of a writable partition and forget its mounted region
+int flash_partitionErase(FlashPartitionId id);
+
+// Forget every mounted region and the page digest table, so the next use
+// reads them from flash again; for a host switching the simulated device
+// under the running thread
+void flash_partitionForget(void);
+
+#endif // FLASH_PARTITION_H
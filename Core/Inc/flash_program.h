@@ -11,6 +11,7 @@
 #include "defs.h"
 #include "util.h"
 #include "main.h"
+#include <stdbool.h>
 
 //-----------------------------------------------------------------------------
 //
@@ -24,13 +25,27 @@
 #define FLASH_USER_PAGE    127
 #define FLASH_USER_BANK    FLASH_BANK_2
 
+#define FLASH_QUADWORD_SIZE 16 // Smallest programmable unit, ECC granularity
+
+// Pointer to flash contents. Flash is memory mapped on target; the host
+// HAL shim overrides this to read through the flash simulator.
+#ifndef FLASH_MAP
+#define FLASH_MAP(addr)    ((__IO uint8_t*)(addr))
+#endif
+
+// Code the linker script copies to RAM at startup (.RamFunc, part of .data),
+// so it keeps running while its own flash bank is erased or programmed
+#ifndef FLASH_RAMFUNC
+#define FLASH_RAMFUNC __attribute__((section(".RamFunc"), noinline))
+#endif
+
 //-----------------------------------------------------------------------------
 //
 // Public Functions
 //
 //-----------------------------------------------------------------------------
 
-uint32_t flash_write(uint32_t StartSectorAddress, uint32_t word,
+uint32_t flash_write(uint32_t StartSectorAddress, uint32_t *word,
 uint16_t numberofwords);
 int flash_read(uint32_t StartSectorAddress, uint32_t *RxBuf,
 uint16_t numberofwords);
@@ -38,6 +53,21 @@ uint32_t flash_getPage(uint32_t Address);
 uint32_t flash_getBank(uint32_t Address);
 uint32_t flash_checkProgram(uint32_t StartAddress, uint32_t len, UINT8 *data);
 uint32_t flash_getPageAddress(uint32_t bank, uint32_t page);
+void findPageAndBank(uint32_t address, uint32_t *bank, uint32_t *page);
+int flash_pageErase(uint32_t bank, uint32_t page);
+int flash_pageEraseWriteVerifyPage(uint32_t *data, uint32_t size, uint32_t bank, uint32_t page,
+                                   uint32_t address); // address is that of the page
+int flash_programQuadwords(uint32_t address, const uint8_t *data, uint32_t size); // All-0xFF quadwords stay erased
+int flash_pageEraseStart(uint32_t bank, uint32_t page); // Erase in the background
+bool flash_eraseBusy(void);
+int flash_eraseFinish(void);                            // Wait, lock, report the result
+
+// Read-while-write: an erase or program stalls instruction fetches from its
+// own bank only. Operations on the bank executing code run from RAM with
+// interrupts masked; operations on the other bank run alongside the code.
+uint32_t flash_codeBank(void);
+void flash_setRamProgramming(bool enable);             // Default on
+bool flash_getRamProgramming(void);
 
 #endif
 
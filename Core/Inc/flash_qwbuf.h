@@ -0,0 +1,66 @@
+/*
+ * flash_qwbuf.h
+ *
+ *  Quadword write-coalescing buffer. Byte-granular writes at any address of
+ *  an erased area are gathered in RAM, one slot per quadword. A quadword is
+ *  programmed once, either when all 16 bytes have been written or when it is
+ *  flushed, in which case the bytes never written keep the erased value.
+ *  Whole quadwords that arrive in one write go straight to flash. A flushed
+ *  quadword cannot be written again until its page is erased, unless it
+ *  held nothing but the erased value and so was left unprogrammed.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef FLASH_QWBUF_H
+#define FLASH_QWBUF_H
+
+#include <cstddef>
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#ifndef FLASH_QWBUF_SLOTS
+#define FLASH_QWBUF_SLOTS      4           // Partial quadwords kept at once
+#endif
+#define FLASH_QWBUF_FREE       0xFFFFFFFFU // Slot address of an unused slot
+
+struct FlashQwSlot {
+    uint32_t address;                        // Quadword address, or FLASH_QWBUF_FREE
+    uint32_t age;                            // Last use, the oldest slot is evicted
+    uint16_t filled;                         // Bit per byte written
+    alignas(4) uint8_t data[16];             // FLASH_QUADWORD_SIZE
+};
+
+struct FlashQwBuffer {
+    uint32_t clock;
+    uint32_t programmed;                     // Quadwords programmed through the buffer
+    uint32_t padded;                         // Of those, programmed partially filled
+    FlashQwSlot slots[FLASH_QWBUF_SLOTS];
+};
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+void flash_qwbufInit(FlashQwBuffer* buf);
+
+// Write size bytes at any address. Completed quadwords are programmed; if no
+// slot is free for a new partial quadword, the oldest slot is flushed. Returns
+// 1 on a flash error or if a quadword that is already programmed is touched.
+int flash_qwbufWrite(FlashQwBuffer* buf, uint32_t address, const void* data, uint32_t size);
+
+// Program every partial quadword, padded with the erased value
+int flash_qwbufFlush(FlashQwBuffer* buf);
+
+// Bytes written but not yet in flash
+uint32_t flash_qwbufPending(const FlashQwBuffer* buf);
+
+#endif // FLASH_QWBUF_H
@@ -0,0 +1,97 @@
+/*
+ * flash_trace.h
+ *
+ *  Fixed-size trace ring of flash and store events. An event is a timestamp
+ *  and one packed word (type | arg << 8); recording is an atomic increment
+ *  of the head plus two stores, so it is safe from interrupts and threads.
+ *  The ring only uses 32-bit fields so a RAM snapshot taken on target can
+ *  be decoded on the host ("host tracedump").
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef FLASH_TRACE_H
+#define FLASH_TRACE_H
+
+#include <cstdint>
+#include "storage_stats.h"
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define FLASH_TRACE_MAGIC   0x46545231U  // "FTR1", located by the decoder
+#ifndef FLASH_TRACE_SIZE
+#define FLASH_TRACE_SIZE    256          // Events kept, power of two
+#endif
+#ifndef FLASH_TRACE_ENABLE
+#define FLASH_TRACE_ENABLE  1
+#endif
+
+static_assert((FLASH_TRACE_SIZE & (FLASH_TRACE_SIZE - 1)) == 0,
+              "FLASH_TRACE_SIZE must be a power of two");
+
+#define FLASH_TRACE_ERROR   0x800000U    // Set in arg when the operation failed
+
+enum FlashTraceType {
+    FLASH_TRACE_UNLOCK = 1,      // arg: HAL status
+    FLASH_TRACE_LOCK,            // arg: HAL status
+    FLASH_TRACE_ERASE,           // arg: bank << 8 | page
+    FLASH_TRACE_PROGRAM,         // arg: quadword index from FLASH_BASE
+    FLASH_TRACE_VERIFY,          // arg: 0 match, FLASH_TRACE_ERROR mismatch
+    FLASH_TRACE_STORE_BEGIN,     // arg: FlashTraceOp
+    FLASH_TRACE_STORE_END,       // arg: FlashTraceOp, FLASH_TRACE_ERROR on failure
+};
+
+enum FlashTraceOp {
+    FLASH_TRACE_OP_FLASH_CONFIG = 1,
+    FLASH_TRACE_OP_LOAD_CONFIG,
+    FLASH_TRACE_OP_FLASH_FIRMWARE,
+    FLASH_TRACE_OP_LOAD_FIRMWARE,
+    FLASH_TRACE_OP_FW_IMAGE,
+    FLASH_TRACE_OP_COUNT
+};
+
+struct FlashTraceEvent {
+    uint32_t timestamp;          // storageStatsCycles()
+    uint32_t word;               // type | arg << 8
+};
+
+struct FlashTraceRing {
+    uint32_t magic;
+    uint32_t mask;               // FLASH_TRACE_SIZE - 1
+    uint32_t head;               // Events recorded since start-up, wraps
+    uint32_t cyclesPerSecond;    // Timestamp unit, 0 until the first store op
+    FlashTraceEvent events[FLASH_TRACE_SIZE];
+};
+
+extern STORAGE_THREAD_LOCAL FlashTraceRing flashTrace;
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Record one event. The slot is claimed before it is written, so a snapshot
+// taken mid-record may show the newest event with stale contents.
+static inline void flash_trace(uint32_t type, uint32_t arg)
+{
+#if FLASH_TRACE_ENABLE
+    uint32_t slot = __atomic_fetch_add(&flashTrace.head, 1U, __ATOMIC_RELAXED) & (FLASH_TRACE_SIZE - 1);
+    flashTrace.events[slot].timestamp = storageStatsCycles();
+    flashTrace.events[slot].word = type | (arg << 8);
+#else
+    (void)type;
+    (void)arg;
+#endif
+}
+
+void flash_traceBegin(uint32_t op);
+void flash_traceEnd(uint32_t op, int result);
+void flash_traceClear(void);
+
+#endif // FLASH_TRACE_H
@@ -0,0 +1,66 @@
+/*
+ * flash_wear.h
+ *
+ *  Wear-leveled region: commits rotate across a run of pages in one bank.
+ *  Each page starts with a commit header (magic, sequence, length, CRC)
+ *  followed by a wear record holding the page's erase count. The header is
+ *  programmed last, so a page only becomes valid once its payload is in
+ *  flash and the previous commit stays readable until then.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef FLASH_WEAR_H
+#define FLASH_WEAR_H
+
+#include <cstddef>
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define FLASH_WEAR_MAX_PAGES     16          // Pages a single region may span
+#define FLASH_WEAR_HEADER_SIZE   32          // Commit header + wear record
+#define FLASH_WEAR_NONE          0xFFFFFFFFU // No valid commit in the region
+
+struct FlashWearRegion {
+    uint32_t bank;                           // FLASH_BANK_1 / FLASH_BANK_2
+    uint32_t firstPage;
+    uint32_t pageCount;
+    uint32_t newestIndex;                    // Page holding the newest commit
+    uint32_t sequence;                       // Sequence number of that commit
+    uint32_t length;                         // Payload length of that commit
+    uint32_t eraseCount[FLASH_WEAR_MAX_PAGES];
+};
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Describe the region and locate the newest valid commit by reading only the
+// headers of each page. Returns 0 on success, including an empty region.
+int flash_wearMount(FlashWearRegion* region, uint32_t bank, uint32_t firstPage, uint32_t pageCount);
+
+// Write data to the next page of the rotation and make it the newest commit
+int flash_wearCommit(FlashWearRegion* region, const uint8_t* data, uint32_t size);
+
+// Copy the newest payload into data; size is capacity in, bytes copied out
+int flash_wearRead(const FlashWearRegion* region, uint8_t* data, size_t& size);
+
+// Flash address of the newest payload, 0 if the region is empty
+uint32_t flash_wearPayloadAddress(const FlashWearRegion* region);
+
+// Check a copy of a region page, e.g. from a flash dump: 0 for a valid
+// commit, 1 if the page holds no commit, 2 if its payload fails the CRC
+int flash_wearCheckPage(const uint8_t* page, uint32_t* sequence, uint32_t* length);
+
+uint32_t flash_wearGetEraseCount(const FlashWearRegion* region, uint32_t index);
+uint32_t flash_wearCapacity(void);           // Largest payload per commit
+
+#endif // FLASH_WEAR_H
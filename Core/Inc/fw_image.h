@@ -0,0 +1,74 @@
+/*
+ * fw_image.h
+ *
+ *  Streaming firmware image writer. Chunks of any size are staged in a RAM
+ *  FIFO and programmed a quadword at a time; the next page is erased in the
+ *  background while data for the current one is still arriving, so a write
+ *  call only blocks on an erase when the FIFO is full. Every programmed run
+ *  is verified before more data is accepted.
+ *
+ *  In differential mode each page is compared with the current flash
+ *  contents while its data arrives. A page that turns out identical is
+ *  neither erased nor programmed; the first differing quadword starts the
+ *  erase of that page. The FIFO holds an undecided page, so it must be at
+ *  least a page in size.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef FW_IMAGE_H
+#define FW_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#ifndef FW_IMAGE_STAGE_SIZE
+#define FW_IMAGE_STAGE_SIZE 8192   // RAM FIFO, power of two multiple of a quadword
+#endif
+
+// Page aligned flash area receiving the image; may cross into bank 2
+struct FwImageRegion {
+    uint32_t address;
+    uint32_t size;
+};
+
+struct FwImageStatus {
+    uint32_t received;             // Bytes accepted by fwImageWrite
+    uint32_t programmed;           // Bytes programmed and verified
+    uint32_t pagesErased;          // Pages written (erased and programmed)
+    uint32_t pagesSkipped;         // Differential mode: pages already in flash
+    uint32_t eraseWaits;           // Write calls that had to wait for an erase
+    uint32_t crc;                  // util_crc32 of the bytes received so far
+};
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Start an image of totalSize bytes and erase its first page. Returns 1 if
+// the region is not page aligned or too small.
+int fwImageBegin(const FwImageRegion* region, uint32_t totalSize);
+
+// Same, but only pages that differ from the current flash contents are
+// erased and programmed. Returns 1 if the FIFO is smaller than a page.
+int fwImageBeginDifferential(const FwImageRegion* region, uint32_t totalSize);
+
+// Append a chunk; returns 1 on a flash error or past totalSize
+int fwImageWrite(const uint8_t* chunk, uint32_t size);
+
+// Program the final partial quadword, wait for the flash and verify the
+// whole image against the running CRC. Returns 0 if the image is in flash.
+int fwImageFinish(void);
+
+void fwImageGetStatus(FwImageStatus* status);
+
+#endif // FW_IMAGE_H
@@ -0,0 +1,51 @@
+/*
+ * lz.h
+ *
+ *  Small LZ77 codec for stored images. Byte oriented sequences of
+ *  [token][literal length...][literals][offset:2][match length...], where
+ *  the token holds the literal length and the match length - LZ_MIN_MATCH
+ *  in its two nibbles, 15 meaning more length bytes follow. Matches reach
+ *  back at most LZ_WINDOW bytes. The compressor needs a hash table of
+ *  2^LZ_HASH_BITS halfwords on the stack; the decompressor only needs the
+ *  output buffer and checks every length and offset against both buffers.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef LZ_H
+#define LZ_H
+
+#include <cstddef>
+#include <cstdint>
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#ifndef LZ_HASH_BITS
+#define LZ_HASH_BITS   9           // 1 KB of stack while compressing
+#endif
+#ifndef LZ_WINDOW
+#define LZ_WINDOW      4096        // Furthest back a match may reach
+#endif
+#define LZ_MIN_MATCH   4
+#define LZ_MAX_INPUT   0xFFFFU     // Positions are kept as halfwords
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Compress src into dst. Returns the compressed size, or 0 if it would not
+// fit in dstCapacity or src is larger than LZ_MAX_INPUT.
+uint32_t lz_compress(const uint8_t* src, uint32_t srcSize, uint8_t* dst, uint32_t dstCapacity);
+
+// Decompress src into dst. Returns the decompressed size, or 0 if the input
+// is malformed or the output would not fit in dstCapacity.
+uint32_t lz_decompress(const uint8_t* src, uint32_t srcSize, uint8_t* dst, uint32_t dstCapacity);
+
+#endif // LZ_H
@@ -0,0 +1,158 @@
+/*
+ * serial_protocol.h
+ *
+ *  Binary request/response protocol over the config and firmware stores.
+ *  One frame carries a whole batch: many IDs to read, many values to
+ *  write, many names to resolve, or a dump of the store from an ID on.
+ *  Little-endian, no alignment:
+ *
+ *      sync 0xA5 | command | sequence | status | payload length (16) | payload | CRC-32
+ *
+ *  The CRC is util_crc32 over everything before it. Responses echo the
+ *  command with SERIAL_RESPONSE set and the sequence, and carry a status.
+ *  Every payload starts with the store and a count:
+ *
+ *      GET       request  store | count | id (32) * count
+ *                response store | count | record * count
+ *      SET       request  store | count | record * count
+ *                response store | count | result (8) * count, 0 if stored
+ *      RESOLVE   request  store | count | (length | name | 0) * count
+ *                response store | count | id (32) * count, -1 if unknown
+ *      DUMP      request  store | 1 | first id (32)
+ *                response store | count | more | next id (32) | record * count
+ *
+ *      record    id (32) | type | int (32)              TYPE_INT
+ *                id (32) | type | length | text | 0     TYPE_STRING
+ *                id (32) | type                         SERIAL_TYPE_NONE, unknown ID
+ *
+ *  A response holds as many answers as fit in the frame; the client asks
+ *  again for the rest (GET, RESOLVE) or continues from next id (DUMP).
+ *  An int and a string sharing an ID may both be sent again on a DUMP cut
+ *  between them.
+ *
+ *  The device decodes and encodes in place in its receive buffer, so it
+ *  needs one frame of RAM. The protocol does not know the link: a
+ *  SerialTransport moves whole frames, and serialFrameLength tells a byte
+ *  stream transport how long the frame it is receiving is.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef SERIAL_PROTOCOL_H
+#define SERIAL_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include "store_view.h"
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#ifndef SERIAL_FRAME_SIZE
+#define SERIAL_FRAME_SIZE 1024     // Largest frame, header and CRC included
+#endif
+
+#define SERIAL_SYNC               0xA5U
+#define SERIAL_HEADER_SIZE        6U
+#define SERIAL_CRC_SIZE           4U
+#define SERIAL_RESPONSE           0x80U  // Set in the command of a response
+#define SERIAL_TYPE_NONE          0xFFU  // Record type of an unknown ID
+
+// IDs whose int records fill a GET response; answers are larger than
+// questions, so a GET frame packed with IDs comes back partly answered
+#define SERIAL_GET_MAX_INTS ((SERIAL_FRAME_SIZE - SERIAL_HEADER_SIZE - 3U - SERIAL_CRC_SIZE) / 9U)
+
+enum SerialCommand : uint8_t {
+    SERIAL_CMD_GET = 1,
+    SERIAL_CMD_SET,
+    SERIAL_CMD_RESOLVE,
+    SERIAL_CMD_DUMP,
+};
+
+enum SerialStore : uint8_t {
+    SERIAL_STORE_CONFIG,
+    SERIAL_STORE_FIRMWARE,
+};
+
+enum SerialStatus : uint8_t {
+    SERIAL_STATUS_OK,
+    SERIAL_STATUS_BAD_FRAME,       // Length or CRC wrong
+    SERIAL_STATUS_BAD_COMMAND,
+    SERIAL_STATUS_BAD_STORE,
+    SERIAL_STATUS_BAD_PAYLOAD,     // Records do not add up to the payload
+};
+
+// Moves whole frames; both return 0 on success. receive stores the frame
+// length in *size.
+struct SerialTransport {
+    int (*send)(void* context, const uint8_t* frame, size_t size);
+    int (*receive)(void* context, uint8_t* frame, size_t capacity, size_t* size);
+    void* context;
+};
+
+// Request being encoded by the client
+struct SerialWriter {
+    uint8_t* frame;
+    size_t capacity;
+    size_t length;                 // Bytes written so far
+    uint16_t count;                // Items added
+};
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Length of the frame whose header is at frame (SERIAL_HEADER_SIZE bytes),
+// 0 if the header is not valid
+size_t serialFrameLength(const uint8_t* frame);
+
+//-----------------------------------------------------------------------------
+// Device
+//-----------------------------------------------------------------------------
+
+// Answer the request of length bytes in frame, writing the response over
+// it. Returns the response length, 0 if there is no header to answer.
+size_t serialHandleFrame(uint8_t* frame, size_t length, size_t capacity);
+
+// Receive one request, answer it and send the response. Returns 1 if
+// nothing was received or the response could not be sent.
+int serialPoll(const SerialTransport* transport, uint8_t* frame, size_t capacity);
+
+//-----------------------------------------------------------------------------
+// Client
+//-----------------------------------------------------------------------------
+
+// Start a request; then add the items of the command, which return 1 once
+// the frame is full, and finish with serialEnd
+void serialBegin(SerialWriter* writer, uint8_t* frame, size_t capacity,
+                 SerialCommand command, uint8_t sequence, SerialStore store);
+int serialAddId(SerialWriter* writer, int id);                    // GET, DUMP
+int serialAddInt(SerialWriter* writer, int id, int value);        // SET
+int serialAddString(SerialWriter* writer, int id, const char* value); // SET
+int serialAddName(SerialWriter* writer, const char* name);        // RESOLVE
+size_t serialEnd(SerialWriter* writer);                           // Returns the frame length
+
+// Send the request of length bytes in frame and receive the response into
+// it. Returns 0 if the response matches the request and its status is OK.
+int serialTransact(const SerialTransport* transport, uint8_t* frame, size_t length,
+                   size_t capacity, size_t* responseLength);
+
+// Records of a GET or DUMP response, in order; text points into the frame
+// and is NUL terminated. Returns the number visited, -1 if malformed.
+int serialDecodeEntries(const uint8_t* frame, size_t length, StoreVisitor visitor, void* context);
+
+// DUMP response: 1 and the ID to continue from, 0 if the dump is complete
+int serialDumpMore(const uint8_t* frame, int* nextId);
+
+// SET and RESOLVE responses: number of results and result index (0 or 1
+// for SET, the ID or -1 for RESOLVE)
+size_t serialResultCount(const uint8_t* frame);
+int serialResult(const uint8_t* frame, size_t index);
+
+#endif // SERIAL_PROTOCOL_H
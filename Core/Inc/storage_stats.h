@@ -0,0 +1,67 @@
+/*
+ * storage_stats.h
+ *
+ *  Always-on counters for the config/firmware stores and the flash layer.
+ *  Counters are plain increments on a global; timings use the DWT cycle
+ *  counter on target and steady_clock nanoseconds on the host.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef STORAGE_STATS_H
+#define STORAGE_STATS_H
+
+#include <cstdint>
+#include "defs.h"
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define STORAGE_STATS_HOT_IDS 8    // Most frequently written IDs tracked
+
+struct StorageTiming {
+    uint32_t count;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+};
+
+struct StorageStats {
+    uint32_t gets;                 // configGet*/firmwareGet* calls
+    uint32_t misses;               // ... of which found no entry
+    uint32_t updates;              // Entries written or updated in RAM
+    uint32_t commits;              // flashConfig/flashFirmware calls (any mode)
+    uint32_t skippedCommits;       // Commits whose image already matched flash
+    uint32_t pagesErased;
+    uint32_t quadwordsProgrammed;
+    uint32_t verifyFailures;
+    StorageTiming flashConfig;
+    StorageTiming flashFirmware;
+    StorageTiming loadConfig;
+    StorageTiming loadFirmware;
+    uint32_t cyclesPerSecond;      // Unit of the *Cycles fields
+    int hotIds[STORAGE_STATS_HOT_IDS];        // Approximate top writers, -1 = unused
+    uint32_t hotCounts[STORAGE_STATS_HOT_IDS];
+};
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+void storageGetStats(StorageStats* stats);
+void storageResetStats(void);
+
+// Recording interface for the storage modules
+extern STORAGE_THREAD_LOCAL StorageStats storageCounters;
+
+uint32_t storageStatsCycles(void);
+uint32_t storageStatsCyclesPerSecond(void);
+void storageStatsTiming(StorageTiming* timing, uint32_t startCycles);
+void storageStatsUpdate(int id);
+
+#endif // STORAGE_STATS_H
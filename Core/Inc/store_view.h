@@ -0,0 +1,263 @@
+/*
+ * store_view.h
+ *
+ *  Ordered access to an InitArrayMap. The config and firmware stores keep
+ *  intArray and stringArray sorted by ID, so lookups are binary searches and
+ *  a range of IDs is a contiguous run of each array. StoreRange walks both
+ *  runs merged in ID order (an int before a string of the same ID) and
+ *  yields StoreEntryView values that point into the store instead of
+ *  copying it. A range stays valid until the store is written.
+ *
+ *      for (const StoreEntryView& e : configRange(100, 199)) { ... }
+ *
+ *  storeLoadImage fills a store from a configFlush/firmwareFlush image in
+ *  one pass: entries are appended as they are decoded and the arrays are
+ *  sorted once at the end, so an image written in ID order loads in linear
+ *  time whatever its size. A StoreMigrator sees every decoded entry before
+ *  it is loaded and can rewrite it into other entries on the way.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef STORE_VIEW_H
+#define STORE_VIEW_H
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "InitArrayMap.h"
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+struct StoreEntryView {
+    int id;
+    int type;                              // TYPE_INT / TYPE_STRING
+    int value;                             // TYPE_INT only
+    const char* text;                      // TYPE_STRING only, the stored value
+    size_t length;                         // TYPE_STRING only, strlen(text)
+};
+
+// Visitor of configForEach/firmwareForEach; return false to stop early
+typedef bool (*StoreVisitor)(const StoreEntryView& entry, void* context);
+
+struct StoreIterator {
+    const InitArrayMap* map;
+    size_t intIndex;
+    size_t stringIndex;
+    size_t intEnd;
+    size_t stringEnd;
+
+    // The int entry comes next (not past its run, and its ID is lowest)
+    bool intNext() const {
+        return intIndex < intEnd && (stringIndex >= stringEnd ||
+                                     map->intArray[intIndex].id <= map->stringArray[stringIndex].id);
+    }
+
+    StoreEntryView operator*() const {
+        if (intNext()) {
+            const IntEntry& e = map->intArray[intIndex];
+            return {e.id, TYPE_INT, e.value, nullptr, 0};
+        }
+        const StringEntry& e = map->stringArray[stringIndex];
+        return {e.id, TYPE_STRING, 0, e.value, std::strlen(e.value)};
+    }
+
+    StoreIterator& operator++() {
+        if (intNext()) {
+            ++intIndex;
+        } else {
+            ++stringIndex;
+        }
+        return *this;
+    }
+
+    bool operator!=(const StoreIterator& other) const {
+        return intIndex != other.intIndex || stringIndex != other.stringIndex;
+    }
+};
+
+struct StoreRange {
+    StoreIterator first;
+    StoreIterator last;
+
+    StoreIterator begin() const { return first; }
+    StoreIterator end() const { return last; }
+    size_t count() const {
+        return (last.intIndex - first.intIndex) + (last.stringIndex - first.stringIndex);
+    }
+};
+
+// Load in progress, entries go in with storeLoadEmit
+struct StoreLoader;
+
+// Rewrites decoded entries while an image loads. entry returns false to
+// have the entry loaded as decoded, or true if it emitted what replaces it
+// (possibly nothing); finish runs after the last entry.
+struct StoreMigrator {
+    bool (*entry)(void* context, const StoreEntryView& entry, StoreLoader* loader);
+    void (*finish)(void* context, StoreLoader* loader);
+    void* context;
+};
+
+// What storeLoadImage takes from an image; a null rule takes every entry
+struct StoreLoadRules {
+    bool (*accept)(const StoreEntryView& entry);   // Decoded entry may replace the stored one
+    bool (*keep)(const StoreEntryView& entry);     // Entry left for its ID stays in the store
+    size_t maxInts;                                // Capacity of the store
+    size_t maxStrings;
+    const StoreMigrator* migrator;                 // nullptr: entries load as decoded
+};
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Position of the first int / string entry at or after first whose ID is
+// not below id. Steps doubling from first bound the search, so an entry
+// close to first is found in a few compares.
+static inline size_t storeLowerBoundIntFrom(const InitArrayMap& map, size_t first, int id)
+{
+    size_t lo = first, hi = first, step = 1;
+    while (hi < map.intCount && map.intArray[hi].id < id) {
+        lo = hi + 1;
+        hi = lo + step;
+        step *= 2;
+    }
+    hi = hi < map.intCount ? hi : map.intCount;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (map.intArray[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static inline size_t storeLowerBoundStringFrom(const InitArrayMap& map, size_t first, int id)
+{
+    size_t lo = first, hi = first, step = 1;
+    while (hi < map.stringCount && map.stringArray[hi].id < id) {
+        lo = hi + 1;
+        hi = lo + step;
+        step *= 2;
+    }
+    hi = hi < map.stringCount ? hi : map.stringCount;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (map.stringArray[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Position of the first int / string entry whose ID is not below id
+static inline size_t storeLowerBoundInt(const InitArrayMap& map, int id)
+{
+    size_t lo = 0, hi = map.intCount;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (map.intArray[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static inline size_t storeLowerBoundString(const InitArrayMap& map, int id)
+{
+    size_t lo = 0, hi = map.stringCount;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (map.stringArray[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Index of the entry with id, or -1
+static inline int storeFindInt(const InitArrayMap& map, int id)
+{
+    size_t i = storeLowerBoundInt(map, id);
+    return i < map.intCount && map.intArray[i].id == id ? (int)i : -1;
+}
+
+static inline int storeFindString(const InitArrayMap& map, int id)
+{
+    size_t i = storeLowerBoundString(map, id);
+    return i < map.stringCount && map.stringArray[i].id == id ? (int)i : -1;
+}
+
+// Insert at position, shifting the entries after it; the caller checks capacity
+static inline void storeInsertInt(InitArrayMap& map, size_t position, int id, int value)
+{
+    std::memmove(&map.intArray[position + 1], &map.intArray[position],
+                 (map.intCount - position) * sizeof(IntEntry));
+    map.intArray[position] = IntEntry(id, value);
+    map.intCount++;
+}
+
+static inline void storeInsertString(InitArrayMap& map, size_t position, int id, const char* value)
+{
+    std::memmove(&map.stringArray[position + 1], &map.stringArray[position],
+                 (map.stringCount - position) * sizeof(StringEntry));
+    map.stringArray[position] = StringEntry(id, value);
+    map.stringCount++;
+}
+
+// Entries with loId <= id <= hiId
+static inline StoreRange storeRange(const InitArrayMap& map, int loId, int hiId)
+{
+    StoreRange range;
+    range.first = {&map, storeLowerBoundInt(map, loId), storeLowerBoundString(map, loId), 0, 0};
+    range.last = range.first;
+    if (loId <= hiId) {
+        range.last.intIndex = hiId == INT_MAX ? map.intCount : storeLowerBoundInt(map, hiId + 1);
+        range.last.stringIndex = hiId == INT_MAX ? map.stringCount : storeLowerBoundString(map, hiId + 1);
+    }
+    range.first.intEnd = range.last.intEnd = range.last.intIndex;
+    range.first.stringEnd = range.last.stringEnd = range.last.stringIndex;
+    return range;
+}
+
+// Visit the entries of range in ID order; returns the number visited
+static inline size_t storeForEach(const StoreRange& range, StoreVisitor visitor, void* context)
+{
+    size_t visited = 0;
+    for (StoreIterator it = range.begin(); it != range.end(); ++it) {
+        ++visited;
+        if (!visitor(*it, context)) {
+            break;
+        }
+    }
+    return visited;
+}
+
+// Load an image of size bytes into map, reading nothing past its end. An
+// entry of the image replaces the stored entry of its ID, and a later entry
+// an earlier one. Once the store is full only stored IDs are updated.
+// Returns 1 if the image is truncated or holds an unknown entry type; the
+// entries before that point are loaded.
+int storeLoadImage(InitArrayMap& map, const uint8_t* image, size_t size, const StoreLoadRules& rules);
+
+// Load entry as if it had been decoded from the image, for a StoreMigrator
+void storeLoadEmit(StoreLoader* loader, const StoreEntryView& entry);
+
+#endif // STORE_VIEW_H
@@ -25,6 +25,7 @@
 void util_memcpy(UINT8* dest, UINT8* src, UINT32 len);
 void util_memset(UINT8* dest, UINT8 val, UINT32 len);
 UINT32 util_memcmp(UINT8* loc1, UINT8* loc2, UINT32 len);
+UINT32 util_crc32(UINT32 crc, const UINT8* data, UINT32 len);
 INT32 util_max(INT32 num1, INT32 num2);
 INT32 util_min(INT32 num1, INT32 num2);
 INT32 util_bound(INT32 num, INT32 min, INT32 max);
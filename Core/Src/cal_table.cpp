@@ -0,0 +1,360 @@
+/*
+ * cal_table.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "cal_table.h"
+#include "flash_program.h"
+#include "util.h"
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+//
+// Local Definitions
+//
+//-----------------------------------------------------------------------------
+
+struct CalImageHeader {
+    uint32_t magic;
+    uint16_t count;
+    uint16_t reserved;
+    uint32_t size;                 // Header included
+    uint32_t crc;                  // util_crc32 of the bytes after the header
+};
+
+struct CalTableRecord {
+    uint16_t id;
+    uint8_t kind;
+    uint8_t reserved;
+    uint16_t count;
+    uint16_t reserved2;
+    int32_t x0;
+    uint32_t step;
+    uint32_t stepRecip;
+    uint32_t reserved3;
+};
+
+static_assert(sizeof(CalImageHeader) == 16, "Image header is 16 bytes");
+static_assert(sizeof(CalTableRecord) % 8 == 0, "Table arrays start 8 byte aligned");
+
+//-----------------------------------------------------------------------------
+//
+// Local Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+static inline size_t align8(size_t n)
+{
+    return (n + 7) & ~(size_t)7;
+}
+
+// Bytes of a table record and its arrays
+static size_t tableLength(uint8_t kind, uint16_t count)
+{
+    size_t length = sizeof(CalTableRecord) + (size_t)count * sizeof(int32_t);
+
+    if (kind == CAL_TABLE_BREAKPOINTS) {
+        length += (size_t)count * sizeof(int32_t);
+    }
+    return align8(length) + ((size_t)count - 1) * sizeof(int64_t);
+}
+
+// (dy << 32) / dx rounded to nearest; dx > 0, |dy| < 2^31
+static int64_t slopeQ32(int64_t dy, int64_t dx)
+{
+    int64_t num = dy * ((int64_t)1 << 32);
+
+    return (num >= 0) ? (num + dx / 2) / dx : -((-num + dx / 2) / dx);
+}
+
+static inline int32_t segmentValue(const CalTable* table, uint32_t i, int64_t dx)
+{
+    return table->y[i] + (int32_t)((table->slope[i] * dx + ((int64_t)1 << 31)) >> 32);
+}
+
+static int addTable(CalImageWriter* writer, uint16_t id, CalTableKind kind, int32_t x0, uint32_t step,
+                    const int32_t* x, const int32_t* y, uint16_t count)
+{
+    if (count < 2 || count > CAL_TABLE_MAX_POINTS ||
+        writer->length + tableLength(kind, count) > writer->capacity) {
+        return 1;
+    }
+
+    // x strictly ascending, steps within what a slope can carry
+    for (uint16_t i = 0; i + 1 < count; ++i) {
+        int64_t dy = (int64_t)y[i + 1] - y[i];
+
+        if (dy <= INT32_MIN || dy > INT32_MAX) {
+            return 1;
+        }
+        if (kind == CAL_TABLE_BREAKPOINTS && x[i + 1] <= x[i]) {
+            return 1;
+        }
+    }
+    if (kind == CAL_TABLE_UNIFORM &&
+        (step == 0 || (int64_t)x0 + (int64_t)step * (count - 1) > INT32_MAX)) {
+        return 1;
+    }
+
+    uint8_t* out = writer->image + writer->length;
+    CalTableRecord record = {};
+    record.id = id;
+    record.kind = kind;
+    record.count = count;
+    record.x0 = (kind == CAL_TABLE_UNIFORM) ? x0 : x[0];
+    record.step = step;
+    record.stepRecip = (kind == CAL_TABLE_UNIFORM) ? 0xFFFFFFFFU / step : 0;
+    std::memcpy(out, &record, sizeof(record));
+    out += sizeof(record);
+
+    if (kind == CAL_TABLE_BREAKPOINTS) {
+        std::memcpy(out, x, (size_t)count * sizeof(int32_t));
+        out += (size_t)count * sizeof(int32_t);
+    }
+    std::memcpy(out, y, (size_t)count * sizeof(int32_t));
+    out += (size_t)count * sizeof(int32_t);
+    while ((size_t)(out - writer->image) & 7) {
+        *out++ = 0;
+    }
+
+    for (uint16_t i = 0; i + 1 < count; ++i) {
+        int64_t dx = (kind == CAL_TABLE_UNIFORM) ? (int64_t)step : (int64_t)x[i + 1] - x[i];
+        int64_t slope = slopeQ32((int64_t)y[i + 1] - y[i], dx);
+        std::memcpy(out, &slope, sizeof(slope));
+        out += sizeof(slope);
+    }
+
+    writer->length = (size_t)(out - writer->image);
+    writer->count++;
+    return 0;
+}
+
+static int32_t evalUniform(const CalTable* table, int32_t x)
+{
+    uint32_t last = (uint32_t)table->count - 1;
+
+    if (x <= table->x0) {
+        return table->y[0];
+    }
+
+    uint32_t offset = (uint32_t)x - (uint32_t)table->x0;
+    if (offset >= table->step * last) {
+        return table->y[last];
+    }
+
+    // The reciprocal rounds down, so the estimate is at most two segments short
+    uint32_t i = (uint32_t)(((uint64_t)offset * table->stepRecip) >> 32);
+    uint32_t start = i * table->step;
+    while (offset - start >= table->step) {
+        ++i;
+        start += table->step;
+    }
+    return segmentValue(table, i, offset - start);
+}
+
+// Segment of x, x[0] < x < x[count - 1]
+static uint32_t findSegment(const CalTable* table, int32_t x)
+{
+    uint32_t lo = 0;
+    uint32_t hi = (uint32_t)table->count - 1;
+
+    while (hi - lo > 1) {
+        uint32_t mid = (lo + hi) / 2;
+        if (table->x[mid] <= x) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static int32_t evalBreakpoints(const CalTable* table, int32_t x)
+{
+    uint32_t last = (uint32_t)table->count - 1;
+
+    if (x <= table->x[0]) {
+        return table->y[0];
+    }
+    if (x >= table->x[last]) {
+        return table->y[last];
+    }
+
+    uint32_t i = findSegment(table, x);
+    return segmentValue(table, i, (int64_t)x - table->x[i]);
+}
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+void calImageBegin(CalImageWriter* writer, uint8_t* image, size_t capacity)
+{
+    writer->image = image;
+    writer->capacity = capacity;
+    writer->length = sizeof(CalImageHeader);
+    writer->count = 0;
+}
+
+int calImageAddUniform(CalImageWriter* writer, uint16_t id, int32_t x0, uint32_t step,
+                       const int32_t* y, uint16_t count)
+{
+    return addTable(writer, id, CAL_TABLE_UNIFORM, x0, step, nullptr, y, count);
+}
+
+int calImageAddBreakpoints(CalImageWriter* writer, uint16_t id, const int32_t* x,
+                           const int32_t* y, uint16_t count)
+{
+    return addTable(writer, id, CAL_TABLE_BREAKPOINTS, 0, 0, x, y, count);
+}
+
+size_t calImageEnd(CalImageWriter* writer)
+{
+    CalImageHeader header = {};
+
+    if (writer->capacity < sizeof(header)) {
+        return 0;
+    }
+    header.magic = CAL_IMAGE_MAGIC;
+    header.count = writer->count;
+    header.size = (uint32_t)writer->length;
+    header.crc = util_crc32(0, writer->image + sizeof(header), header.size - sizeof(header));
+    std::memcpy(writer->image, &header, sizeof(header));
+    return writer->length;
+}
+
+int calImageCheck(const uint8_t* image, size_t size)
+{
+    CalImageHeader header;
+
+    if (size < sizeof(header)) {
+        return 1;
+    }
+    std::memcpy(&header, image, sizeof(header));
+    if (header.magic != CAL_IMAGE_MAGIC || header.size < sizeof(header) || header.size > size) {
+        return 1;
+    }
+    return util_crc32(0, image + sizeof(header), header.size - sizeof(header)) == header.crc ? 0 : 1;
+}
+
+int calImageFlash(FlashPartitionId id, const uint8_t* image, size_t size)
+{
+    const FlashPartition& p = flash_partition(id);
+
+    if (p.purpose != FLASH_PURPOSE_CALIBRATION || p.policy != FLASH_POLICY_FIXED ||
+        size > p.size || ((uintptr_t)image & 3) != 0 || calImageCheck(image, size) != 0) {
+        return 1;
+    }
+
+    // Bank, page and address are table constants
+    return flash_pageEraseWriteVerifyPage((uint32_t*)image, (uint32_t)size, p.bank, p.firstPage,
+                                          p.address) == 0 ? 0 : 1;
+}
+
+int calTableOpen(const uint8_t* image, size_t size, uint16_t id, CalTable* table)
+{
+    CalImageHeader header;
+    size_t offset = sizeof(header);
+
+    // The arrays are read in place
+    if (size < sizeof(header) || ((uintptr_t)image & 7) != 0) {
+        return 1;
+    }
+    std::memcpy(&header, image, sizeof(header));
+    if (header.magic != CAL_IMAGE_MAGIC || header.size > size) {
+        return 1;
+    }
+
+    for (uint16_t n = 0; n < header.count; ++n) {
+        CalTableRecord record;
+
+        if (offset + sizeof(record) > header.size) {
+            return 1;
+        }
+        std::memcpy(&record, image + offset, sizeof(record));
+        if (record.count < 2 || record.count > CAL_TABLE_MAX_POINTS ||
+            (record.kind != CAL_TABLE_UNIFORM && record.kind != CAL_TABLE_BREAKPOINTS) ||
+            (record.kind == CAL_TABLE_UNIFORM &&
+             (record.step == 0 || record.stepRecip != 0xFFFFFFFFU / record.step ||
+              (int64_t)record.x0 + (int64_t)record.step * (record.count - 1) > INT32_MAX))) {
+            return 1;
+        }
+
+        size_t length = tableLength(record.kind, record.count);
+        if (offset + length > header.size) {
+            return 1;
+        }
+        if (record.id == id) {
+            const uint8_t* arrays = image + offset + sizeof(record);
+            size_t xBytes = (record.kind == CAL_TABLE_BREAKPOINTS) ? record.count * sizeof(int32_t) : 0;
+
+            table->id = record.id;
+            table->kind = (CalTableKind)record.kind;
+            table->count = record.count;
+            table->x0 = record.x0;
+            table->step = record.step;
+            table->stepRecip = record.stepRecip;
+            table->x = xBytes ? (const int32_t*)arrays : nullptr;
+            table->y = (const int32_t*)(arrays + xBytes);
+            table->slope = (const int64_t*)(arrays +
+                align8(sizeof(record) + xBytes + record.count * sizeof(int32_t)) - sizeof(record));
+            return 0;
+        }
+        offset += length;
+    }
+    return 1;
+}
+
+int calTableFind(FlashPartitionId partition, uint16_t id, CalTable* table)
+{
+    const FlashPartition& p = flash_partition(partition);
+
+    if (p.purpose != FLASH_PURPOSE_CALIBRATION) {
+        return 1;
+    }
+    return calTableOpen((const uint8_t*)FLASH_MAP(p.address), p.size, id, table);
+}
+
+int32_t calTableEval(const CalTable* table, int32_t x)
+{
+    return (table->kind == CAL_TABLE_UNIFORM) ? evalUniform(table, x) : evalBreakpoints(table, x);
+}
+
+void calTableEvalBatch(const CalTable* table, const int32_t* x, int32_t* y, size_t n)
+{
+    if (table->kind == CAL_TABLE_UNIFORM) {
+        for (size_t k = 0; k < n; ++k) {
+            y[k] = evalUniform(table, x[k]);
+        }
+        return;
+    }
+
+    const int32_t* xs = table->x;
+    uint32_t last = (uint32_t)table->count - 1;
+    uint32_t i = 0;
+
+    for (size_t k = 0; k < n; ++k) {
+        int32_t v = x[k];
+
+        if (v <= xs[0]) {
+            y[k] = table->y[0];
+            continue;
+        }
+        if (v >= xs[last]) {
+            y[k] = table->y[last];
+            continue;
+        }
+
+        // Same segment as the previous sample, or a neighbour, before searching
+        if (v < xs[i]) {
+            i = (i > 0 && v >= xs[i - 1]) ? i - 1 : findSegment(table, v);
+        } else if (v >= xs[i + 1]) {
+            i = (i + 2 <= last && v < xs[i + 2]) ? i + 1 : findSegment(table, v);
+        }
+        y[k] = segmentValue(table, i, (int64_t)v - xs[i]);
+    }
+}
@@ -7,266 +7,678 @@
 
 #include "config.h"
 #include "InitArrayMap.h"
+#include "config_schema.h"
+#include "config_migrate.h"
+#include "config_bind.h"
+#include "config_history.h"
+#include "store_view.h"
+#include "storage_stats.h"
+#include "flash_trace.h"
 #include <cstring>
-#include <iostream>
 
 // Define potential constants that might need to be changed
+#ifndef MAX_INT_COUNT
 #define MAX_INT_COUNT 5            // Maximum number of integers in config
+#endif
+#ifndef MAX_STRING_COUNT
 #define MAX_STRING_COUNT 5         // Maximum number of strings in config
+#endif
+#ifndef BUFFER_SIZE
 #define BUFFER_SIZE 256            // Default buffer size for loading and flushing
-#define STRING_ENTRY_SIZE 20       // Size of each string entry
-#define INT_ENTRY_SIZE (sizeof(int) + sizeof(int) + sizeof(int)) // Type + ID + value size
-#define MAX_NAME_ID_PAIRS 10       // Maximum number of name-ID pairs
+#endif
 
-NameIDPair configNameIDStorage[MAX_NAME_ID_PAIRS];
-int configNameIDCount = 0;
+StoreContext configDefaultStore = {};
+InitArrayMap& configArrayMap = configDefaultStore.map;
 
-InitArrayMap configArrayMap = {{}, 0, {}, 0};
+// Function to drop all entries and name-ID pairs held in memory
+void configClear_r(StoreContext* store) {
+    store->map.intCount = 0;
+    store->map.stringCount = 0;
+    store->nameCount = 0;
+}
 
-// Function to update an integer value based on ID
-int configUpdateInt(int id, int newValue) {
-    if (id < 0) return 1; // Invalid ID
+//-----------------------------------------------------------------------------
+// Entry storage, sorted by ID. IDs declared in the schema keep an entry only
+// while their value differs from the default, and only accept values the
+// schema allows.
+//-----------------------------------------------------------------------------
+
+// Entry the schema allows: undeclared IDs take any value
+static bool configSchemaAccepts(const StoreEntryView& entry) {
+    const ConfigParam* param = configSchemaFind(entry.id);
+    if (!param) {
+        return true;
+    }
+    if (entry.type == TYPE_INT) {
+        return param->type == 'i' && entry.value >= param->min && entry.value <= param->max;
+    }
+    return param->type == 's' && entry.length < MAX_STRING_LENGTH;
+}
 
-    bool updated = false;
-    for (size_t i = 0; i < configArrayMap.intCount; ++i) {
-        if (configArrayMap.intArray[i].id == id) {
-            configArrayMap.intArray[i].value = newValue;
-            updated = true;
-            break;
+// Entry that differs from its default, so the store has to hold it
+static bool configSchemaOverrides(const StoreEntryView& entry) {
+    const ConfigParam* param = configSchemaFind(entry.id);
+    if (!param) {
+        return true;
+    }
+    if (entry.type == TYPE_INT) {
+        return entry.value != param->defaultValue;
+    }
+    return std::strcmp(entry.text, param->defaultString) != 0;
+}
+
+// Store an accepted entry at i, the lower bound of its ID; 1 if the store
+// is full. changed tells whether the store differs afterwards.
+static int configStoreIntAt(StoreContext* store, size_t i, const StoreEntryView& entry, bool* changed) {
+    bool isDefault = !configSchemaOverrides(entry);
+    bool found = i < store->map.intCount && store->map.intArray[i].id == entry.id;
+
+    *changed = found || !isDefault;
+    if (found && isDefault) {
+        // Back at the default: drop the override, keeping the order of the rest
+        std::memmove(&store->map.intArray[i], &store->map.intArray[i + 1],
+                     (store->map.intCount - i - 1) * sizeof(IntEntry));
+        store->map.intCount--;
+    } else if (found) {
+        *changed = store->map.intArray[i].value != entry.value;
+        store->map.intArray[i].value = entry.value;
+    } else if (!isDefault) {
+        if (store->map.intCount >= MAX_INT_COUNT) {
+            *changed = false;
+            return 1; // Store full
+        }
+        storeInsertInt(store->map, i, entry.id, entry.value);
+    }
+    return 0;
+}
+
+static int configStoreStringAt(StoreContext* store, size_t i, const StoreEntryView& entry, bool* changed) {
+    bool isDefault = !configSchemaOverrides(entry);
+    bool found = i < store->map.stringCount && store->map.stringArray[i].id == entry.id;
+
+    *changed = found || !isDefault;
+    if (found && isDefault) {
+        std::memmove(&store->map.stringArray[i], &store->map.stringArray[i + 1],
+                     (store->map.stringCount - i - 1) * sizeof(StringEntry));
+        store->map.stringCount--;
+    } else if (found) {
+        *changed = std::strcmp(store->map.stringArray[i].value, entry.text) != 0;
+        std::strncpy(store->map.stringArray[i].value, entry.text, MAX_STRING_LENGTH - 1);
+        store->map.stringArray[i].value[MAX_STRING_LENGTH - 1] = '\0';
+    } else if (!isDefault) {
+        if (store->map.stringCount >= MAX_STRING_COUNT) {
+            *changed = false;
+            return 1; // Store full
         }
+        storeInsertString(store->map, i, entry.id, entry.text);
+    }
+    return 0;
+}
+
+static int configStoreInt(StoreContext* store, int id, int value) {
+    StoreEntryView entry = {id, TYPE_INT, value, nullptr, 0};
+    if (id < 0 || !configSchemaAccepts(entry)) {
+        return 1; // Invalid ID (CONFIG_VERSION_ID among them) or rejected by the schema
+    }
+    bool changed;
+    return configStoreIntAt(store, storeLowerBoundInt(store->map, id), entry, &changed);
+}
+
+static int configStoreString(StoreContext* store, int id, const char* str) {
+    StoreEntryView entry = {id, TYPE_STRING, 0, str, std::strlen(str)};
+    if (id < 0 || !configSchemaAccepts(entry)) {
+        return 1; // Invalid ID (CONFIG_VERSION_ID among them) or rejected by the schema
     }
+    bool changed;
+    return configStoreStringAt(store, storeLowerBoundString(store->map, id), entry, &changed);
+}
+
+// Function to update an integer value based on ID
+int configUpdateInt_r(StoreContext* store, int id, int newValue) {
+    if (id < 0) return 1; // Invalid ID
 
-    return updated ? 0 : 1; // Return 0 for success, 1 for ID not found
+    // Only existing entries, or declared parameters that are at their default
+    if ((!configSchemaFind(id) && storeFindInt(store->map, id) < 0) || configStoreInt(store, id, newValue) != 0) {
+        return 1;
+    }
+    storageStatsUpdate(id);
+    return 0;
 }
 
 // Function to update a string value based on ID
-int configUpdateString(int id, const char* newValue) {
+int configUpdateString_r(StoreContext* store, int id, const char* newValue) {
     if (id < 0 || !newValue) return 1; // Invalid ID or value
 
-    bool updated = false;
-    for (size_t i = 0; i < configArrayMap.stringCount; ++i) {
-        if (configArrayMap.stringArray[i].id == id) {
-            std::strncpy(configArrayMap.stringArray[i].value, newValue, MAX_STRING_LENGTH - 1);
-            configArrayMap.stringArray[i].value[MAX_STRING_LENGTH - 1] = '\0';  // Ensure null termination
-            updated = true;
-            break;
-        }
+    if ((!configSchemaFind(id) && storeFindString(store->map, id) < 0) || configStoreString(store, id, newValue) != 0) {
+        return 1;
     }
-
-    return updated ? 0 : 1; // Return 0 for success, 1 for ID not found
+    storageStatsUpdate(id);
+    return 0;
 }
 
-int configWrite(const char* name, int id, char type, const void* data) {
+int configWrite_r(StoreContext* store, const char* name, int id, char type, const void* data) {
     if (id < 0 || !data) return 1; // Invalid ID or data
 
-    int handleResult = configSaveHandles(name, id);
+    int handleResult = configSaveHandles_r(store, name, id);
     if (handleResult != 0) {
         return handleResult;  // Return the error if saving the handle fails
     }
 
+    int result;
     switch (type) {
         case 'i':
-            configWriteInt(id, *static_cast<const int*>(data));
-            return 0; // Success
+            result = configStoreInt(store, id, *static_cast<const int*>(data));
+            break;
         case 's':
-            configWriteString(id, static_cast<const char*>(data));
-            return 0; // Success
+            result = configStoreString(store, id, static_cast<const char*>(data));
+            break;
         default:
             return 1; // Unknown data type
     }
+    if (result == 0) {
+        storageStatsUpdate(id);
+    }
+    return result; // 1 if the schema rejects the value or the store is full
 }
 
-void configWriteInt(int id, int value) {
-    bool replaced = false;
-    for (size_t i = 0; i < configArrayMap.intCount; ++i) {
-        if (configArrayMap.intArray[i].id == id) {
-            configArrayMap.intArray[i].value = value;
-            replaced = true;
-            break;
-        }
-    }
-    if (!replaced && configArrayMap.intCount < MAX_INT_COUNT) {
-        configArrayMap.intArray[configArrayMap.intCount++] = IntEntry(id, value);
+int configWriteInt_r(StoreContext* store, int id, int value) {
+    if (configStoreInt(store, id, value) != 0) {
+        return 1;
     }
+    storageStatsUpdate(id);
+    return 0;
 }
 
-void configWriteString(int id, const char* str) {
-    bool replaced = false;
-    for (size_t i = 0; i < configArrayMap.stringCount; ++i) {
-        if (configArrayMap.stringArray[i].id == id) {
-            std::strncpy(configArrayMap.stringArray[i].value, str, MAX_STRING_LENGTH - 1);
-            configArrayMap.stringArray[i].value[MAX_STRING_LENGTH - 1] = '\0';
-            replaced = true;
-            break;
-        }
-    }
-    if (!replaced && configArrayMap.stringCount < MAX_STRING_COUNT) {
-        configArrayMap.stringArray[configArrayMap.stringCount++] = StringEntry(id, str);
+int configWriteString_r(StoreContext* store, int id, const char* str) {
+    if (configStoreString(store, id, str) != 0) {
+        return 1;
     }
+    storageStatsUpdate(id);
+    return 0;
 }
 
-int configFlush(uint32_t* buffer, size_t& bufferSize) {
-    size_t intArraySize = configArrayMap.intCount * INT_ENTRY_SIZE;
-    size_t stringArraySize = configArrayMap.stringCount * (sizeof(int) + sizeof(int) + MAX_STRING_LENGTH); // Type + ID + value
-    bufferSize = intArraySize + stringArraySize + 2 * sizeof(uint32_t); // Handle + int and string counts
+int configFlush_r(StoreContext* store, uint32_t* buffer, size_t& bufferSize) {
+    const size_t versionEntries = CONFIG_SCHEMA_VERSION > 0 ? 1 : 0;  // Leads the int entries
+    size_t intArraySize = (store->map.intCount + versionEntries) * INT_ENTRY_SIZE;
+    size_t stringArraySize = store->map.stringCount * (sizeof(int) + sizeof(int) + STRING_ENTRY_SIZE); // Type + ID + value
+    size_t requiredSize = intArraySize + stringArraySize + 2 * sizeof(uint32_t); // Handle + int and string counts
+    if (requiredSize > bufferSize) {
+        return 1; // Buffer too small for the current entries
+    }
+    bufferSize = requiredSize;
 
     uint32_t* bufferPtr = buffer;
 
     // Store the number of int and string entries
-    *bufferPtr++ = configArrayMap.intCount;
-    *bufferPtr++ = configArrayMap.stringCount;
+    *bufferPtr++ = store->map.intCount + versionEntries;
+    *bufferPtr++ = store->map.stringCount;
+
+    // Schema version, lowest ID so it comes first
+    if (versionEntries) {
+        *bufferPtr++ = TYPE_INT;
+        *bufferPtr++ = (uint32_t)CONFIG_VERSION_ID;
+        *bufferPtr++ = CONFIG_SCHEMA_VERSION;
+    }
 
     // Copy int entries
-    for (size_t i = 0; i < configArrayMap.intCount; ++i) {
-        std::memcpy(bufferPtr, &configArrayMap.intArray[i].type, sizeof(int));
+    for (size_t i = 0; i < store->map.intCount; ++i) {
+        std::memcpy(bufferPtr, &store->map.intArray[i].type, sizeof(int));
         bufferPtr += 1;
-        std::memcpy(bufferPtr, &configArrayMap.intArray[i].id, sizeof(int));
+        std::memcpy(bufferPtr, &store->map.intArray[i].id, sizeof(int));
         bufferPtr += 1;
-        std::memcpy(bufferPtr, &configArrayMap.intArray[i].value, sizeof(int));
+        std::memcpy(bufferPtr, &store->map.intArray[i].value, sizeof(int));
         bufferPtr += 1;
     }
 
     // Copy string entries
-    for (size_t i = 0; i < configArrayMap.stringCount; ++i) {
-        std::memcpy(bufferPtr, &configArrayMap.stringArray[i].type, sizeof(int));
+    for (size_t i = 0; i < store->map.stringCount; ++i) {
+        std::memcpy(bufferPtr, &store->map.stringArray[i].type, sizeof(int));
         bufferPtr += 1;
-        std::memcpy(bufferPtr, &configArrayMap.stringArray[i].id, sizeof(int));
+        std::memcpy(bufferPtr, &store->map.stringArray[i].id, sizeof(int));
         bufferPtr += 1;
-        std::memcpy(bufferPtr, configArrayMap.stringArray[i].value, MAX_STRING_LENGTH);
-        bufferPtr += MAX_STRING_LENGTH / 4;
+        std::memset(bufferPtr, 0, STRING_ENTRY_SIZE);
+        std::memcpy(bufferPtr, store->map.stringArray[i].value, MAX_STRING_LENGTH);
+        bufferPtr += STRING_ENTRY_SIZE / 4;
     }
 
     return 0; // Return success
 }
 
-int configGetInt(int id) {
-    for (size_t i = 0; i < configArrayMap.intCount; ++i) {
-        if (configArrayMap.intArray[i].id == id && configArrayMap.intArray[i].type == 0) {
-            return configArrayMap.intArray[i].value;
-        }
+int configGetInt_r(StoreContext* store, int id) {
+    storageCounters.gets++;
+    int i = storeFindInt(store->map, id);
+    if (i >= 0) {
+        return store->map.intArray[i].value;
+    }
+    const ConfigParam* param = configSchemaFind(id);
+    if (param && param->type == 'i') {
+        return param->defaultValue; // No override stored
     }
+    storageCounters.misses++;
     return -1; // Return -1 if not found
 }
 
-const char* configGetString(int id) {
-    for (size_t i = 0; i < configArrayMap.stringCount; ++i) {
-        if (configArrayMap.stringArray[i].id == id && configArrayMap.stringArray[i].type == 1) {
-            return configArrayMap.stringArray[i].value;
-        }
+const char* configGetString_r(StoreContext* store, int id) {
+    storageCounters.gets++;
+    int i = storeFindString(store->map, id);
+    if (i >= 0) {
+        return store->map.stringArray[i].value;
+    }
+    const ConfigParam* param = configSchemaFind(id);
+    if (param && param->type == 's') {
+        return param->defaultString; // No override stored
     }
+    storageCounters.misses++;
     return nullptr; // Return nullptr if not found
 }
 
-int loadConfig(uint32_t address) {
+int configLookup_r(StoreContext* store, int id, StoreEntryView* entry) {
+    storageCounters.gets++;
+    int i = storeFindInt(store->map, id);
+    if (i >= 0) {
+        *entry = {id, TYPE_INT, store->map.intArray[i].value, nullptr, 0};
+        return 0;
+    }
+    i = storeFindString(store->map, id);
+    if (i >= 0) {
+        const char* value = store->map.stringArray[i].value;
+        *entry = {id, TYPE_STRING, 0, value, std::strlen(value)};
+        return 0;
+    }
+    const ConfigParam* param = configSchemaFind(id);
+    if (param && param->type == 'i') {
+        *entry = {id, TYPE_INT, param->defaultValue, nullptr, 0};
+        return 0;
+    }
+    if (param) {
+        *entry = {id, TYPE_STRING, 0, param->defaultString, std::strlen(param->defaultString)};
+        return 0;
+    }
+    storageCounters.misses++;
+    return 1;
+}
+
+StoreRange configRange_r(StoreContext* store, int loId, int hiId) {
+    return storeRange(store->map, loId, hiId);
+}
+
+size_t configForEach_r(StoreContext* store, StoreVisitor visitor, void* context) {
+    return storeForEach(storeRange(store->map, INT_MIN, INT_MAX), visitor, context);
+}
+
+//-----------------------------------------------------------------------------
+// Struct binding (config_bind.h). Fields ascend by ID like the store, so
+// each lookup searches only the entries after the previous field's.
+//-----------------------------------------------------------------------------
+
+ConfigFieldStatus configReadFields_r(StoreContext* store, void* object, const ConfigField* fields,
+                                     uint32_t count) {
+    ConfigFieldStatus status = {0, 0, 0};
+    uint8_t* base = static_cast<uint8_t*>(object);
+    size_t intIndex = 0;
+    size_t stringIndex = 0;
+
+    storageCounters.gets += count;
+    for (uint32_t n = 0; n < count; ++n) {
+        const ConfigField& field = fields[n];
+        uint32_t bit = 1U << n;
+        StoreEntryView entry = {field.id, TYPE_INT, 0, nullptr, 0};
+        bool have = false;
+
+        if (field.type == 'i') {
+            intIndex = storeLowerBoundIntFrom(store->map, intIndex, field.id);
+            if (intIndex < store->map.intCount && store->map.intArray[intIndex].id == field.id) {
+                entry.value = store->map.intArray[intIndex].value;
+                have = configSchemaAccepts(entry);
+                status.outOfRange |= have ? 0 : bit;
+            }
+            const ConfigParam* param = have ? nullptr : configSchemaFind(field.id);
+            if (param && param->type == 'i') {
+                entry.value = param->defaultValue;
+                have = true;
+            }
+        } else {
+            stringIndex = storeLowerBoundStringFrom(store->map, stringIndex, field.id);
+            entry.type = TYPE_STRING;
+            if (stringIndex < store->map.stringCount && store->map.stringArray[stringIndex].id == field.id) {
+                entry.text = store->map.stringArray[stringIndex].value;
+                have = true;
+            }
+            const ConfigParam* param = have ? nullptr : configSchemaFind(field.id);
+            if (param && param->type == 's') {
+                entry.text = param->defaultString;
+                have = true;
+            }
+        }
+        if (!have) {
+            status.missing |= (status.outOfRange & bit) ? 0 : bit;
+            storageCounters.misses++;
+            continue;
+        }
+
+        if (field.type == 'i') {
+            int* member = reinterpret_cast<int*>(base + field.offset);
+            status.changed |= *member != entry.value ? bit : 0;
+            *member = entry.value;
+        } else {
+            char* member = reinterpret_cast<char*>(base + field.offset);
+            size_t length = std::strlen(entry.text);
+            if (length >= field.size) {
+                length = field.size - 1; // Truncated to the member
+                status.outOfRange |= bit;
+            }
+            if (std::strncmp(member, entry.text, length) != 0 || member[length] != '\0') {
+                status.changed |= bit;
+            }
+            std::memcpy(member, entry.text, length);
+            member[length] = '\0';
+        }
+    }
+    return status;
+}
+
+ConfigFieldStatus configWriteFields_r(StoreContext* store, const void* object, const ConfigField* fields,
+                                      uint32_t count) {
+    ConfigFieldStatus status = {0, 0, 0};
+    const uint8_t* base = static_cast<const uint8_t*>(object);
+    size_t intIndex = 0;
+    size_t stringIndex = 0;
+
+    for (uint32_t n = 0; n < count; ++n) {
+        const ConfigField& field = fields[n];
+        uint32_t bit = 1U << n;
+        bool changed = false;
+        int result;
+
+        if (field.type == 'i') {
+            StoreEntryView entry = {field.id, TYPE_INT, 0, nullptr, 0};
+            std::memcpy(&entry.value, base + field.offset, sizeof(int));
+            intIndex = storeLowerBoundIntFrom(store->map, intIndex, field.id);
+            if (!configSchemaAccepts(entry)) {
+                status.outOfRange |= bit;
+                continue;
+            }
+            result = configStoreIntAt(store, intIndex, entry, &changed);
+        } else {
+            const char* text = reinterpret_cast<const char*>(base + field.offset);
+            const void* end = std::memchr(text, '\0', field.size);
+            StoreEntryView entry = {field.id, TYPE_STRING, 0, text, end ? (size_t)((const char*)end - text) : 0};
+            stringIndex = storeLowerBoundStringFrom(store->map, stringIndex, field.id);
+            if (!end || !configSchemaAccepts(entry)) {
+                status.outOfRange |= bit; // Unterminated, too long or not a string parameter
+                continue;
+            }
+            result = configStoreStringAt(store, stringIndex, entry, &changed);
+        }
+        status.missing |= result != 0 ? bit : 0;
+        if (changed) {
+            status.changed |= bit;
+            storageStatsUpdate(field.id);
+        }
+    }
+    return status;
+}
+
+// Merge an image, migrating it from the schema version it was written with.
+// migrated is set if a complete image was migrated and wants writing back.
+static int configLoadImage(StoreContext* store, const uint8_t* bufferPtr, size_t bufferSize, bool* migrated) {
+    ConfigMigrateState state;
+    StoreMigrator migrator = configMigrateBegin(&state);
+    const StoreLoadRules rules = {configSchemaAccepts, configSchemaOverrides,
+                                  MAX_INT_COUNT, MAX_STRING_COUNT, &migrator};
+    int result = storeLoadImage(store->map, bufferPtr, bufferSize, rules);
+    *migrated = result == 0 && state.migrated;
+    return result;
+}
+
+int loadConfig_r(StoreContext* store, uint32_t address) {
+    uint32_t startCycles = storageStatsCycles();
+    flash_traceBegin(FLASH_TRACE_OP_LOAD_CONFIG);
     uint8_t byteBuffer[BUFFER_SIZE];  // Allocate a buffer for raw data
     size_t numberOfWords = BUFFER_SIZE / sizeof(uint32_t);
+    bool migrated = false;
 
     int result = readAndLoadFlashData(byteBuffer, numberOfWords, address);
-    if (result != 0) {
-        return result;  // Return the error code
+    if (result == 0) {
+        result = configLoadImage(store, byteBuffer, BUFFER_SIZE, &migrated);
     }
 
-    processConfigBuffer(byteBuffer, BUFFER_SIZE);
-    return 0; // Success
+    flash_traceEnd(FLASH_TRACE_OP_LOAD_CONFIG, result);
+    storageStatsTiming(&storageCounters.loadConfig, startCycles);
+    if (migrated) {
+        result = flashConfig_r(store, address);  // Once, now at the current version
+    }
+    return result;  // Return success or the error code
 }
 
-int flashConfig(uint32_t address) {
+int flashConfig_r(StoreContext* store, uint32_t address) {
+    uint32_t startCycles = storageStatsCycles();
+    flash_traceBegin(FLASH_TRACE_OP_FLASH_CONFIG);
     size_t bufferSize = BUFFER_SIZE;
     uint32_t buffer[BUFFER_SIZE / sizeof(uint32_t)];  // Statically allocate the buffer
 
-    configFlush(buffer, bufferSize);  // Flush config data to the buffer
+    int result = 1;  // Entries do not fit in the buffer unless the flush succeeds
+    if (configFlush_r(store, buffer, bufferSize) == 0) {  // Flush config data to the buffer
+        result = fileWrite(buffer, bufferSize, address);
+    }
 
-    int result = fileWrite(buffer, bufferSize, address);
+    storageCounters.commits++;
+    flash_traceEnd(FLASH_TRACE_OP_FLASH_CONFIG, result);
+    storageStatsTiming(&storageCounters.flashConfig, startCycles);
     return result;  // Return success or failure code
 }
 
-void processConfigBuffer(uint8_t* bufferPtr, size_t bufferSize) {
-    uint32_t intCount = 0;
-    uint32_t stringCount = 0;
-    std::memcpy(&intCount, bufferPtr, sizeof(uint32_t));
-    bufferPtr += sizeof(uint32_t);
-    std::memcpy(&stringCount, bufferPtr, sizeof(uint32_t));
-    bufferPtr += sizeof(uint32_t);
-
-    for (size_t i = 0; i < intCount + stringCount && bufferPtr < bufferPtr + bufferSize; ++i) {
-        int type = 0;
-        std::memcpy(&type, bufferPtr, sizeof(int));
-        bufferPtr += sizeof(int);
-
-        int id = 0;
-        std::memcpy(&id, bufferPtr, sizeof(int));
-        bufferPtr += sizeof(int);
-
-        if (type == 0) { // It's an integer
-            int value = 0;
-            std::memcpy(&value, bufferPtr, sizeof(int));
-            bufferPtr += sizeof(int);
-
-            bool replaced = false;
-            for (size_t j = 0; j < configArrayMap.intCount; ++j) {
-                if (configArrayMap.intArray[j].id == id) {
-                    configArrayMap.intArray[j].value = value;
-                    replaced = true;
-                    break;
-                }
-            }
-            if (!replaced && configArrayMap.intCount < MAX_INT_COUNT) {
-                configArrayMap.intArray[configArrayMap.intCount++] = IntEntry(id, value);
-            }
-        } else if (type == 1) { // It's a string
-            char value[MAX_STRING_LENGTH] = {0};
-            std::memcpy(value, bufferPtr, STRING_ENTRY_SIZE);
-            bufferPtr += STRING_ENTRY_SIZE;
-
-            bool replaced = false;
-            for (size_t j = 0; j < configArrayMap.stringCount; ++j) {
-                if (configArrayMap.stringArray[j].id == id) {
-                    std::strncpy(configArrayMap.stringArray[j].value, value, MAX_STRING_LENGTH - 1);
-                    configArrayMap.stringArray[j].value[MAX_STRING_LENGTH - 1] = '\0';
-                    replaced = true;
-                    break;
-                }
-            }
-            if (!replaced && configArrayMap.stringCount < MAX_STRING_COUNT) {
-                configArrayMap.stringArray[configArrayMap.stringCount++] = StringEntry(id, value);
-            }
-        }
+int flashConfigRegion_r(StoreContext* store, FlashWearRegion* region) {
+    uint32_t startCycles = storageStatsCycles();
+    flash_traceBegin(FLASH_TRACE_OP_FLASH_CONFIG);
+    size_t bufferSize = BUFFER_SIZE;
+    uint32_t buffer[BUFFER_SIZE / sizeof(uint32_t)];  // Statically allocate the buffer
+
+    int result = 1;  // Entries do not fit in the buffer unless the flush succeeds
+    if (configFlush_r(store, buffer, bufferSize) == 0) {  // Flush config data to the buffer
+        result = fileWriteRegion(region, buffer, bufferSize);
+    }
+
+    storageCounters.commits++;
+    flash_traceEnd(FLASH_TRACE_OP_FLASH_CONFIG, result);
+    storageStatsTiming(&storageCounters.flashConfig, startCycles);
+    return result;  // Return success or failure code
+}
+
+int loadConfigRegion_r(StoreContext* store, FlashWearRegion* region) {
+    uint32_t startCycles = storageStatsCycles();
+    flash_traceBegin(FLASH_TRACE_OP_LOAD_CONFIG);
+    uint8_t byteBuffer[BUFFER_SIZE];  // Allocate a buffer for raw data
+    size_t size = BUFFER_SIZE;
+    bool migrated = false;
+
+    int result = readAndLoadRegionData(byteBuffer, size, region);
+    if (result == 0) {
+        result = configLoadImage(store, byteBuffer, size, &migrated);
+    }
+
+    flash_traceEnd(FLASH_TRACE_OP_LOAD_CONFIG, result);
+    storageStatsTiming(&storageCounters.loadConfig, startCycles);
+    if (migrated) {
+        result = flashConfigRegion_r(store, region);  // Once, now at the current version
+    }
+    return result;  // Return success or the error code
+}
+
+int flashConfigPartition_r(StoreContext* store, FlashPartitionId id) {
+    uint32_t startCycles = storageStatsCycles();
+    flash_traceBegin(FLASH_TRACE_OP_FLASH_CONFIG);
+    size_t bufferSize = BUFFER_SIZE;
+    uint32_t buffer[BUFFER_SIZE / sizeof(uint32_t)];  // Statically allocate the buffer
+
+    int result = 1;  // Wrong partition, or entries do not fit in the buffer
+    if (flash_partition(id).purpose == FLASH_PURPOSE_CONFIG && configFlush_r(store, buffer, bufferSize) == 0) {
+        result = fileWritePartition(id, buffer, bufferSize);
+    }
+
+    storageCounters.commits++;
+    flash_traceEnd(FLASH_TRACE_OP_FLASH_CONFIG, result);
+    storageStatsTiming(&storageCounters.flashConfig, startCycles);
+    return result;  // Return success or failure code
+}
+
+int loadConfigPartition_r(StoreContext* store, FlashPartitionId id) {
+    uint32_t startCycles = storageStatsCycles();
+    flash_traceBegin(FLASH_TRACE_OP_LOAD_CONFIG);
+    uint8_t byteBuffer[BUFFER_SIZE];  // Allocate a buffer for raw data
+    size_t size = BUFFER_SIZE;
+    bool migrated = false;
+    bool history = false;
+
+    int result = 1;
+    if (flash_partition(id).purpose == FLASH_PURPOSE_CONFIG) {
+        history = configHistoryPresent(id);
+        result = readAndLoadPartitionData(byteBuffer, size, id);
+    }
+    if (result == 0) {
+        result = configLoadImage(store, byteBuffer, size, &migrated);
     }
+
+    flash_traceEnd(FLASH_TRACE_OP_LOAD_CONFIG, result);
+    storageStatsTiming(&storageCounters.loadConfig, startCycles);
+    if (migrated) {
+        // Once, now at the current version; a history keeps its generations
+        result = history ? configHistoryCommit_r(store, id) : flashConfigPartition_r(store, id);
+    }
+    return result;  // Return success or the error code
+}
+
+// Values the schema rejects keep their default; defaults drop the override
+int processConfigBuffer_r(StoreContext* store, const uint8_t* bufferPtr, size_t bufferSize) {
+    bool migrated;
+    return configLoadImage(store, bufferPtr, bufferSize, &migrated);
 }
 
 // configOpen: Relays the result from fileOpen
 int configOpen(const char* str) {
-    return fileOpen(str);  // Directly return the code from fileOpen
+    return fileOpen(str);  // Descriptor from fileOpen, or -1
 }
 
 // Function to save name-ID pairs for config and return a success or error message
-int configSaveHandles(const char* name, int id) {
+int configSaveHandles_r(StoreContext* store, const char* name, int id) {
     if (!name || id < 0) return 1; // Invalid name or ID
 
-    for (int i = 0; i < configNameIDCount; ++i) {
-        if (std::strcmp(configNameIDStorage[i].name, name) == 0) {
-            configNameIDStorage[i].id = id;
+    for (int i = 0; i < store->nameCount; ++i) {
+        if (std::strcmp(store->names[i].name, name) == 0) {
+            store->names[i].id = id;
             return 0; // Success: ID updated for existing config name
         }
     }
 
-    if (configNameIDCount < MAX_NAME_ID_PAIRS) {
-        std::strncpy(configNameIDStorage[configNameIDCount].name, name, MAX_STRING_LENGTH - 1);
-        configNameIDStorage[configNameIDCount].name[MAX_STRING_LENGTH - 1] = '\0';
-        configNameIDStorage[configNameIDCount].id = id;
-        ++configNameIDCount;
+    if (store->nameCount < MAX_NAME_ID_PAIRS) {
+        std::strncpy(store->names[store->nameCount].name, name, MAX_STRING_LENGTH - 1);
+        store->names[store->nameCount].name[MAX_STRING_LENGTH - 1] = '\0';
+        store->names[store->nameCount].id = id;
+        ++store->nameCount;
         return 0; // Success: name-ID pair saved for config
     }
 
     return 1; // Error: config name-ID storage is full
 }
 
-int configGetIDFromName(const char* name) {
-    for (int i = 0; i < configNameIDCount; ++i) {
-        if (std::strcmp(configNameIDStorage[i].name, name) == 0) {
-            return configNameIDStorage[i].id;
+int configGetIDFromName_r(StoreContext* store, const char* name) {
+    for (int i = 0; i < store->nameCount; ++i) {
+        if (std::strcmp(store->names[i].name, name) == 0) {
+            return store->names[i].id;
+        }
+    }
+    for (int i = 0; i < configSchemaCount; ++i) {
+        if (std::strcmp(configSchema[i].name, name) == 0) {
+            return configSchema[i].id; // Declared in the schema
         }
     }
     return -1;  // Return -1 to indicate failure
 }
 
+//-----------------------------------------------------------------------------
+// Default store, behind the functions without a context argument
+//-----------------------------------------------------------------------------
+
+void configClear() {
+    configClear_r(&configDefaultStore);
+}
+
+int configUpdateInt(int id, int newValue) {
+    return configUpdateInt_r(&configDefaultStore, id, newValue);
+}
+
+int configUpdateString(int id, const char* newValue) {
+    return configUpdateString_r(&configDefaultStore, id, newValue);
+}
+
+int configWrite(const char* name, int id, char type, const void* data) {
+    return configWrite_r(&configDefaultStore, name, id, type, data);
+}
+
+int configWriteInt(int id, int value) {
+    return configWriteInt_r(&configDefaultStore, id, value);
+}
+
+int configWriteString(int id, const char* str) {
+    return configWriteString_r(&configDefaultStore, id, str);
+}
+
+int configFlush(uint32_t* buffer, size_t& bufferSize) {
+    return configFlush_r(&configDefaultStore, buffer, bufferSize);
+}
+
+int configGetInt(int id) {
+    return configGetInt_r(&configDefaultStore, id);
+}
+
+const char* configGetString(int id) {
+    return configGetString_r(&configDefaultStore, id);
+}
+
+int configLookup(int id, StoreEntryView* entry) {
+    return configLookup_r(&configDefaultStore, id, entry);
+}
+
+StoreRange configRange(int loId, int hiId) {
+    return configRange_r(&configDefaultStore, loId, hiId);
+}
+
+size_t configForEach(StoreVisitor visitor, void* context) {
+    return configForEach_r(&configDefaultStore, visitor, context);
+}
+
+int loadConfig(uint32_t address) {
+    return loadConfig_r(&configDefaultStore, address);
+}
+
+int flashConfig(uint32_t address) {
+    return flashConfig_r(&configDefaultStore, address);
+}
+
+int flashConfigRegion(FlashWearRegion* region) {
+    return flashConfigRegion_r(&configDefaultStore, region);
+}
+
+int loadConfigRegion(FlashWearRegion* region) {
+    return loadConfigRegion_r(&configDefaultStore, region);
+}
+
+int flashConfigPartition(FlashPartitionId id) {
+    return flashConfigPartition_r(&configDefaultStore, id);
+}
+
+int loadConfigPartition(FlashPartitionId id) {
+    return loadConfigPartition_r(&configDefaultStore, id);
+}
+
+int processConfigBuffer(const uint8_t* bufferPtr, size_t bufferSize) {
+    return processConfigBuffer_r(&configDefaultStore, bufferPtr, bufferSize);
+}
+
+int configSaveHandles(const char* name, int id) {
+    return configSaveHandles_r(&configDefaultStore, name, id);
+}
+
+int configGetIDFromName(const char* name) {
+    return configGetIDFromName_r(&configDefaultStore, name);
+}
@@ -0,0 +1,559 @@
+/*
+ * config_history.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "config_history.h"
+#include "config.h"
+#include "InitArrayMap.h"
+#include "flashFile.h"
+#include "flash_wear.h"
+#include "storage_stats.h"
+#include "flash_trace.h"
+#include "defs.h"
+#include <cstring>
+
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE 256            // Must match the buffer used by flashConfig
+#endif
+
+//-----------------------------------------------------------------------------
+//
+// Local Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define HISTORY_OP_DROP      0x80U                           // With TYPE_INT/TYPE_STRING: drop the entry
+#define HISTORY_STRING_SIZE  (2 * sizeof(int) + STRING_ENTRY_SIZE) // Serialized string entry
+#define HISTORY_PAGE_SIZE    (FLASH_PAGE_SIZE - FLASH_WEAR_HEADER_SIZE)
+#define HISTORY_ALIGN(n)     (((n) + 3U) & ~3U)
+
+//-----------------------------------------------------------------------------
+//
+// Local Datatypes
+//
+//-----------------------------------------------------------------------------
+
+// Last 16 bytes of a commit
+struct HistoryTrailer {
+    uint32_t magic;
+    uint32_t generation;
+    uint32_t imageSize;            // Image at the start of the commit
+    uint32_t deltaCount;           // Deltas following it, newest first
+};
+
+// Precedes the operations of a delta
+struct HistoryDeltaHeader {
+    uint32_t generation;           // Generation the delta restores
+    uint32_t size;                 // Bytes of operations
+    uint32_t changes;              // Number of operations
+};
+
+// Serialized store (configFlush layout) being read
+struct HistoryImage {
+    const uint8_t* ints;
+    const uint8_t* strings;
+    uint32_t intCount;
+    uint32_t stringCount;
+};
+
+// Bytes being appended to a bounded buffer
+struct HistoryWriter {
+    uint8_t* p;
+    uint8_t* end;
+    uint32_t changes;
+    bool overflow;
+};
+
+// One delta operation: op, id, then the int value or length and text
+struct HistoryOp {
+    uint8_t op;
+    int id;
+    int value;
+    const char* text;
+    uint8_t length;
+};
+
+//-----------------------------------------------------------------------------
+//
+// Local Variables
+//
+//-----------------------------------------------------------------------------
+
+STORAGE_THREAD_LOCAL static uint8_t historyPage[HISTORY_PAGE_SIZE];                // Commit being built
+STORAGE_THREAD_LOCAL static uint32_t historyImage[2][BUFFER_SIZE / sizeof(uint32_t)]; // Serialized stores
+
+//-----------------------------------------------------------------------------
+//
+// Local Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+static int entryId(const uint8_t* entry)
+{
+    int id;
+    std::memcpy(&id, entry + sizeof(int), sizeof(id));
+    return id;
+}
+
+static int entryValue(const uint8_t* entry)
+{
+    int value;
+    std::memcpy(&value, entry + 2 * sizeof(int), sizeof(value));
+    return value;
+}
+
+static const char* entryText(const uint8_t* entry)
+{
+    return reinterpret_cast<const char*>(entry + 2 * sizeof(int));
+}
+
+static int historyParse(const uint8_t* data, size_t size, HistoryImage* image)
+{
+    uint32_t counts[2];
+    if (size < sizeof(counts)) {
+        return 1;
+    }
+    std::memcpy(counts, data, sizeof(counts));
+    if ((uint64_t)counts[0] * INT_ENTRY_SIZE + (uint64_t)counts[1] * HISTORY_STRING_SIZE > size - sizeof(counts)) {
+        return 1;
+    }
+    image->intCount = counts[0];
+    image->stringCount = counts[1];
+    image->ints = data + sizeof(counts);
+    image->strings = image->ints + counts[0] * INT_ENTRY_SIZE;
+    return 0;
+}
+
+// Deltas are merges, so they need the IDs in ascending order as configFlush
+// writes them
+static bool historySorted(const uint8_t* entries, uint32_t count, size_t stride)
+{
+    for (uint32_t i = 1; i < count; ++i) {
+        if (entryId(entries + i * stride) <= entryId(entries + (i - 1) * stride)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void historyPut(HistoryWriter* w, const void* data, size_t size)
+{
+    if (w->overflow || size > (size_t)(w->end - w->p)) {
+        w->overflow = true;
+        return;
+    }
+    std::memcpy(w->p, data, size);
+    w->p += size;
+}
+
+static void historyPutOp(HistoryWriter* w, uint8_t op, int id)
+{
+    historyPut(w, &op, 1);
+    historyPut(w, &id, sizeof(id));
+    w->changes++;
+}
+
+static void historyPutString(HistoryWriter* w, const char* text)
+{
+    uint8_t length = (uint8_t)strnlen(text, MAX_STRING_LENGTH - 1);
+    historyPut(w, &length, 1);
+    historyPut(w, text, length);
+}
+
+// Operation at p; returns its size, 0 if malformed
+static size_t historyReadOp(const uint8_t* p, const uint8_t* end, HistoryOp* op)
+{
+    size_t size = 1 + sizeof(int);
+    if ((size_t)(end - p) < size) {
+        return 0;
+    }
+    op->op = p[0];
+    std::memcpy(&op->id, p + 1, sizeof(int));
+    if (op->op == TYPE_INT) {
+        if ((size_t)(end - p) < size + sizeof(int)) {
+            return 0;
+        }
+        std::memcpy(&op->value, p + size, sizeof(int));
+        size += sizeof(int);
+    } else if (op->op == TYPE_STRING) {
+        if ((size_t)(end - p) < size + 1 || (size_t)(end - p) < size + 1 + p[size] ||
+            p[size] >= MAX_STRING_LENGTH) {
+            return 0;
+        }
+        op->length = p[size];
+        op->text = reinterpret_cast<const char*>(p + size + 1);
+        size += 1 + op->length;
+    } else if (op->op != (TYPE_INT | HISTORY_OP_DROP) && op->op != (TYPE_STRING | HISTORY_OP_DROP)) {
+        return 0;
+    }
+    return size;
+}
+
+// Operations turning newer into older: set what older holds differently,
+// drop what only newer holds
+static void historyDiff(const HistoryImage& newer, const HistoryImage& older, HistoryWriter* w)
+{
+    uint32_t i = 0, j = 0;
+    while (i < newer.intCount || j < older.intCount) {
+        const uint8_t* a = i < newer.intCount ? newer.ints + i * INT_ENTRY_SIZE : nullptr;
+        const uint8_t* b = j < older.intCount ? older.ints + j * INT_ENTRY_SIZE : nullptr;
+        if (!b || (a && entryId(a) < entryId(b))) {
+            historyPutOp(w, TYPE_INT | HISTORY_OP_DROP, entryId(a));
+            i++;
+            continue;
+        }
+        if (!a || entryId(b) < entryId(a) || entryValue(a) != entryValue(b)) {
+            int value = entryValue(b);
+            historyPutOp(w, TYPE_INT, entryId(b));
+            historyPut(w, &value, sizeof(value));
+        }
+        i += a && entryId(a) == entryId(b);
+        j++;
+    }
+
+    i = 0;
+    j = 0;
+    while (i < newer.stringCount || j < older.stringCount) {
+        const uint8_t* a = i < newer.stringCount ? newer.strings + i * HISTORY_STRING_SIZE : nullptr;
+        const uint8_t* b = j < older.stringCount ? older.strings + j * HISTORY_STRING_SIZE : nullptr;
+        if (!b || (a && entryId(a) < entryId(b))) {
+            historyPutOp(w, TYPE_STRING | HISTORY_OP_DROP, entryId(a));
+            i++;
+            continue;
+        }
+        if (!a || entryId(b) < entryId(a) || std::strncmp(entryText(a), entryText(b), MAX_STRING_LENGTH) != 0) {
+            historyPutOp(w, TYPE_STRING, entryId(b));
+            historyPutString(w, entryText(b));
+        }
+        i += a && entryId(a) == entryId(b);
+        j++;
+    }
+}
+
+// Apply the operations of a delta to base, writing the serialized result to
+// out. Returns 1 if the delta is malformed or the result does not fit.
+static int historyApply(const HistoryImage& base, const uint8_t* ops, size_t size,
+                        uint8_t* out, size_t capacity, size_t& outSize)
+{
+    const uint8_t* end = ops + size;
+    uint32_t counts[2] = {0, 0};
+    HistoryWriter w = {out + sizeof(counts), out + capacity, 0, false};
+    HistoryOp op;
+    size_t opSize = historyReadOp(ops, end, &op);
+
+    // Ints, then strings, each merged with the operations of their type
+    for (int type = TYPE_INT; type <= TYPE_STRING; ++type) {
+        const uint8_t* entries = type == TYPE_INT ? base.ints : base.strings;
+        uint32_t count = type == TYPE_INT ? base.intCount : base.stringCount;
+        size_t stride = type == TYPE_INT ? INT_ENTRY_SIZE : HISTORY_STRING_SIZE;
+        uint32_t i = 0;
+
+        while (true) {
+            bool haveOp = opSize && (int)(op.op & ~HISTORY_OP_DROP) == type;
+            const uint8_t* e = i < count ? entries + i * stride : nullptr;
+            if (!haveOp && !e) {
+                break;
+            }
+            if (!haveOp || (e && entryId(e) < op.id)) {
+                historyPut(&w, e, stride); // Unchanged
+                counts[type]++;
+                i++;
+                continue;
+            }
+            i += e && entryId(e) == op.id; // Replaced or dropped
+            if (!(op.op & HISTORY_OP_DROP)) {
+                int header[2] = {type, op.id};
+                historyPut(&w, header, sizeof(header));
+                if (type == TYPE_INT) {
+                    historyPut(&w, &op.value, sizeof(op.value));
+                } else if (!w.overflow && (size_t)(w.end - w.p) >= STRING_ENTRY_SIZE) {
+                    std::memset(w.p, 0, STRING_ENTRY_SIZE);
+                    std::memcpy(w.p, op.text, op.length);
+                    w.p += STRING_ENTRY_SIZE;
+                } else {
+                    w.overflow = true;
+                }
+                counts[type]++;
+            }
+            ops += opSize;
+            opSize = historyReadOp(ops, end, &op);
+        }
+    }
+
+    if (ops != end || w.overflow) {
+        return 1; // Operations left over or malformed, or out of room
+    }
+    std::memcpy(out, counts, sizeof(counts));
+    outSize = w.p - out;
+    return 0;
+}
+
+// Newest commit of a CONFIG ROTATE partition with its trailer; returns 1 if
+// the partition is empty or the commit was not made by configHistoryCommit
+static int historyNewest(FlashPartitionId id, const uint8_t** payload, uint32_t* length,
+                         HistoryTrailer* trailer)
+{
+    const FlashPartition& p = flash_partition(id);
+    if (p.purpose != FLASH_PURPOSE_CONFIG || p.policy != FLASH_POLICY_ROTATE) {
+        return 1;
+    }
+    FlashWearRegion* region = flash_partitionRegion(id);
+    uint32_t address = region ? flash_wearPayloadAddress(region) : 0;
+    if (address == 0 || region->length < sizeof(HistoryTrailer)) {
+        return 1;
+    }
+
+    *payload = (const uint8_t*)FLASH_MAP(address);
+    *length = region->length;
+    std::memcpy(trailer, *payload + *length - sizeof(HistoryTrailer), sizeof(HistoryTrailer));
+    if (trailer->magic != CONFIG_HISTORY_MAGIC || trailer->generation == CONFIG_HISTORY_NEWEST ||
+        trailer->imageSize > *length - sizeof(HistoryTrailer)) {
+        return 1;
+    }
+    return 0;
+}
+
+// Serialized store of the image at the start of a commit, expanded if it
+// was written compressed; size is capacity in, bytes out
+static int historyDecodeImage(const uint8_t* payload, const HistoryTrailer& trailer, uint8_t* data, size_t& size)
+{
+    uint32_t magic;
+    std::memcpy(&magic, payload, sizeof(magic));
+    if (trailer.imageSize >= sizeof(magic) && magic == FILE_IMAGE_MAGIC) {
+        return fileDecodeBuffer(payload, trailer.imageSize, data, size);
+    }
+    if (trailer.imageSize > size) {
+        return 1;
+    }
+    std::memcpy(data, payload, trailer.imageSize);
+    size = trailer.imageSize;
+    return 0;
+}
+
+// Delta at p inside [p, end); returns its size, 0 if it does not fit
+static size_t historyReadDelta(const uint8_t* p, const uint8_t* end, HistoryDeltaHeader* header)
+{
+    if ((size_t)(end - p) < sizeof(*header)) {
+        return 0;
+    }
+    std::memcpy(header, p, sizeof(*header));
+    if (header->size > (size_t)(end - p) - sizeof(*header)) {
+        return 0;
+    }
+    return sizeof(*header) + header->size;
+}
+
+// Build the commit of the store in historyPage; returns its length, 0 if the
+// store does not fit or equals the newest generation (*unchanged)
+static size_t historyBuild(StoreContext* store, FlashPartitionId id, bool* unchanged)
+{
+    size_t newerSize = BUFFER_SIZE;
+    uint32_t* image;
+    size_t imageSize;
+    HistoryTrailer trailer = {CONFIG_HISTORY_MAGIC, 1, 0, 0};
+
+    *unchanged = false;
+    if (configFlush_r(store, historyImage[0], newerSize) != 0 ||
+        fileEncodeImage(historyImage[0], newerSize, image, imageSize) != 0 ||
+        HISTORY_ALIGN(imageSize) + sizeof(trailer) > sizeof(historyPage)) {
+        return 0;
+    }
+    std::memcpy(historyPage, image, imageSize);
+    std::memset(historyPage + imageSize, 0xFF, HISTORY_ALIGN(imageSize) - imageSize);
+    trailer.imageSize = imageSize;
+    HistoryWriter w = {historyPage + HISTORY_ALIGN(imageSize), historyPage + sizeof(historyPage) - sizeof(trailer), 0, false};
+
+    const uint8_t* previous;
+    uint32_t previousLength;
+    HistoryTrailer last;
+    size_t olderSize = BUFFER_SIZE;
+    HistoryImage newer, older;
+    bool havePrevious = historyNewest(id, &previous, &previousLength, &last) == 0;
+    if (havePrevious) {
+        trailer.generation = last.generation + 1; // Counts on even if the history restarts
+    }
+    if (havePrevious &&
+        historyDecodeImage(previous, last, (uint8_t*)historyImage[1], olderSize) == 0 &&
+        historyParse((const uint8_t*)historyImage[0], newerSize, &newer) == 0 &&
+        historyParse((const uint8_t*)historyImage[1], olderSize, &older) == 0 &&
+        historySorted(newer.ints, newer.intCount, INT_ENTRY_SIZE) &&
+        historySorted(newer.strings, newer.stringCount, HISTORY_STRING_SIZE) &&
+        historySorted(older.ints, older.intCount, INT_ENTRY_SIZE) &&
+        historySorted(older.strings, older.stringCount, HISTORY_STRING_SIZE)) {
+        // The delta back to the generation being replaced
+        uint8_t* start = w.p;
+        HistoryDeltaHeader header = {last.generation, 0, 0};
+        historyPut(&w, &header, sizeof(header));
+        historyDiff(newer, older, &w);
+        if (!w.overflow && w.changes == 0) {
+            *unchanged = true;
+            return 0;
+        }
+        if (w.overflow || CONFIG_HISTORY_DEPTH < 2) {
+            w.p = start; // No room for history: it restarts here
+        } else {
+            header.size = (uint32_t)(w.p - start - sizeof(header));
+            header.changes = w.changes;
+            std::memcpy(start, &header, sizeof(header));
+            trailer.deltaCount = 1;
+
+            // Older deltas move over unchanged while they fit
+            const uint8_t* d = previous + HISTORY_ALIGN(last.imageSize);
+            const uint8_t* end = previous + previousLength - sizeof(last);
+            for (uint32_t k = 0; k < last.deltaCount && trailer.deltaCount < CONFIG_HISTORY_DEPTH - 1; ++k) {
+                size_t n = historyReadDelta(d, end, &header);
+                if (n == 0 || n > (size_t)(w.end - w.p)) {
+                    break;
+                }
+                std::memcpy(w.p, d, n);
+                w.p += n;
+                d += n;
+                trailer.deltaCount++;
+            }
+        }
+    }
+
+    size_t length = HISTORY_ALIGN(w.p - historyPage);
+    std::memset(w.p, 0xFF, historyPage + length - w.p);
+    std::memcpy(historyPage + length, &trailer, sizeof(trailer));
+    return length + sizeof(trailer);
+}
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+int configHistoryCommit_r(StoreContext* store, FlashPartitionId id)
+{
+    uint32_t startCycles = storageStatsCycles();
+    flash_traceBegin(FLASH_TRACE_OP_FLASH_CONFIG);
+    const FlashPartition& p = flash_partition(id);
+    bool unchanged = false;
+    int result = 1;
+
+    if (p.purpose == FLASH_PURPOSE_CONFIG && p.policy == FLASH_POLICY_ROTATE) {
+        FlashWearRegion* region = flash_partitionRegion(id);
+        size_t length = region ? historyBuild(store, id, &unchanged) : 0;
+        if (unchanged) {
+            storageCounters.skippedCommits++;
+            result = 0;
+        } else if (length) {
+            result = flash_wearCommit(region, historyPage, (uint32_t)length) == 0 ? 0 : 1;
+        }
+    }
+
+    storageCounters.commits++;
+    flash_traceEnd(FLASH_TRACE_OP_FLASH_CONFIG, result);
+    storageStatsTiming(&storageCounters.flashConfig, startCycles);
+    return result;
+}
+
+size_t configHistoryList(FlashPartitionId id, ConfigGeneration* list, size_t capacity)
+{
+    const uint8_t* payload;
+    uint32_t length;
+    HistoryTrailer trailer;
+    HistoryDeltaHeader header;
+
+    if (capacity == 0 || historyNewest(id, &payload, &length, &trailer) != 0) {
+        return 0;
+    }
+    list[0] = {trailer.generation, trailer.imageSize, 0};
+    size_t count = 1;
+
+    const uint8_t* d = payload + HISTORY_ALIGN(trailer.imageSize);
+    const uint8_t* end = payload + length - sizeof(trailer);
+    for (uint32_t k = 0; k < trailer.deltaCount && count < capacity; ++k) {
+        size_t n = historyReadDelta(d, end, &header);
+        if (n == 0) {
+            break;
+        }
+        list[count++] = {header.generation, header.size, header.changes};
+        d += n;
+    }
+    return count;
+}
+
+bool configHistoryPresent(FlashPartitionId id)
+{
+    const uint8_t* payload;
+    uint32_t length;
+    HistoryTrailer trailer;
+    return historyNewest(id, &payload, &length, &trailer) == 0;
+}
+
+int configHistoryLoad_r(StoreContext* store, FlashPartitionId id, uint32_t generation)
+{
+    uint32_t startCycles = storageStatsCycles();
+    flash_traceBegin(FLASH_TRACE_OP_LOAD_CONFIG);
+    const uint8_t* payload;
+    uint32_t length;
+    HistoryTrailer trailer;
+    size_t size = BUFFER_SIZE;
+    int current = 0;
+    int result = 1;
+
+    if (historyNewest(id, &payload, &length, &trailer) == 0 &&
+        historyDecodeImage(payload, trailer, (uint8_t*)historyImage[0], size) == 0) {
+        uint32_t reached = trailer.generation;
+        if (generation == CONFIG_HISTORY_NEWEST) {
+            generation = trailer.generation;
+        }
+
+        // Only the deltas between the newest and the requested generation
+        const uint8_t* d = payload + HISTORY_ALIGN(trailer.imageSize);
+        const uint8_t* end = payload + length - sizeof(trailer);
+        HistoryDeltaHeader header;
+        HistoryImage base;
+        for (uint32_t k = 0; k < trailer.deltaCount && reached != generation; ++k) {
+            size_t n = historyReadDelta(d, end, &header);
+            if (n == 0 || historyParse((const uint8_t*)historyImage[current], size, &base) != 0 ||
+                historyApply(base, d + sizeof(header), header.size,
+                             (uint8_t*)historyImage[current ^ 1], BUFFER_SIZE, size) != 0) {
+                break;
+            }
+            current ^= 1;
+            reached = header.generation;
+            d += n;
+        }
+
+        if (reached == generation) {
+            // Entries only; name-ID pairs stay
+            store->map.intCount = 0;
+            store->map.stringCount = 0;
+            result = processConfigBuffer_r(store, (const uint8_t*)historyImage[current], size);
+        }
+    }
+
+    flash_traceEnd(FLASH_TRACE_OP_LOAD_CONFIG, result);
+    storageStatsTiming(&storageCounters.loadConfig, startCycles);
+    return result;
+}
+
+int configHistoryRollback_r(StoreContext* store, FlashPartitionId id, uint32_t generation)
+{
+    if (configHistoryLoad_r(store, id, generation) != 0) {
+        return 1;
+    }
+    return configHistoryCommit_r(store, id);
+}
+
+int configHistoryCommit(FlashPartitionId id)
+{
+    return configHistoryCommit_r(&configDefaultStore, id);
+}
+
+int configHistoryLoad(FlashPartitionId id, uint32_t generation)
+{
+    return configHistoryLoad_r(&configDefaultStore, id, generation);
+}
+
+int configHistoryRollback(FlashPartitionId id, uint32_t generation)
+{
+    return configHistoryRollback_r(&configDefaultStore, id, generation);
+}
@@ -0,0 +1,217 @@
+/*
+ * config_migrate.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "config_migrate.h"
+#include "flash_log.h"
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+//
+// Local Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+static uint32_t fieldMask(int bits)
+{
+    return bits >= 32 ? 0xFFFFFFFFU : (1U << bits) - 1;
+}
+
+// Decimal text of an int, as snprintf %d would write it
+static const char* formatInt(int value, char* text)
+{
+    char digits[12];
+    uint32_t magnitude = value < 0 ? 0U - (uint32_t)value : (uint32_t)value;
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    char* p = text;
+    if (value < 0) {
+        *p++ = '-';
+    }
+    while (n) {
+        *p++ = digits[--n];
+    }
+    *p = '\0';
+    return text;
+}
+
+// Whole text as a decimal int; false if it is not one or does not fit
+static bool parseInt(const char* text, int* value)
+{
+    bool negative = *text == '-';
+    int64_t magnitude = 0;
+
+    text += (*text == '-' || *text == '+') ? 1 : 0;
+    if (!*text) {
+        return false;
+    }
+    for (; *text; ++text) {
+        if (*text < '0' || *text > '9') {
+            return false;
+        }
+        magnitude = magnitude * 10 + (*text - '0');
+        if (magnitude > (int64_t)INT32_MAX + 1) {
+            return false;
+        }
+    }
+    if (!negative && magnitude > INT32_MAX) {
+        return false;
+    }
+    *value = (int)(negative ? -magnitude : magnitude);
+    return true;
+}
+
+// First MERGE into the packed ID of transform i, whose value collects them all
+static uint32_t mergeSlot(uint32_t i)
+{
+    const ConfigMigration& m = configMigrations[i];
+    for (uint32_t j = 0; j < i; ++j) {
+        const ConfigMigration& n = configMigrations[j];
+        if (n.kind == CONFIG_MIGRATE_MERGE && n.version == m.version && n.target == m.target) {
+            return j;
+        }
+    }
+    return i;
+}
+
+// The image version is known: skip the transforms it already has
+static void migrateVersion(ConfigMigrateState* state, uint32_t version)
+{
+    state->versionKnown = true;
+    state->imageVersion = version;
+    while (state->first < configMigrationCount && configMigrations[state->first].version <= version) {
+        state->first++;
+    }
+}
+
+// Pass entry through transforms from index i on and load what comes out
+static void migrateEntry(ConfigMigrateState* state, StoreEntryView entry, uint32_t i, StoreLoader* loader)
+{
+    char text[MAX_STRING_LENGTH];
+
+    for (; i < configMigrationCount; ++i) {
+        const ConfigMigration& m = configMigrations[i];
+        if (m.id != entry.id) {
+            continue;
+        }
+
+        switch (m.kind) {
+        case CONFIG_MIGRATE_RENAME:
+            entry.id = m.target;
+            break;
+        case CONFIG_MIGRATE_RETYPE:
+            if (m.value == 's' && entry.type == TYPE_INT) {
+                entry.type = TYPE_STRING;
+                entry.text = formatInt(entry.value, text);
+                entry.length = std::strlen(text);
+                entry.value = 0;
+            } else if (m.value == 'i' && entry.type == TYPE_STRING) {
+                if (!parseInt(entry.text, &entry.value)) {
+                    flash_log(FLASH_LOG_CONFIG_MIGRATE_DROPPED, m.version, (uint32_t)entry.id);
+                    return;
+                }
+                entry.type = TYPE_INT;
+                entry.text = nullptr;
+                entry.length = 0;
+            }
+            break;
+        case CONFIG_MIGRATE_SPLIT:
+            if (entry.type == TYPE_INT) {
+                int field = (int)(((uint32_t)entry.value >> m.value) & fieldMask(m.bits));
+                migrateEntry(state, {m.target, TYPE_INT, field, nullptr, 0}, i + 1, loader);
+            }
+            break;
+        case CONFIG_MIGRATE_MERGE:
+            if (entry.type == TYPE_INT) {
+                uint32_t slot = mergeSlot(i);
+                state->merged[slot] |= ((uint32_t)entry.value & fieldMask(m.bits)) << m.value;
+                state->applied[slot] = true;
+            }
+            break;
+        case CONFIG_MIGRATE_DEFAULT:
+            state->applied[i] = true;
+            break;
+        case CONFIG_MIGRATE_DROP:
+            return;
+        }
+    }
+    storeLoadEmit(loader, entry);
+}
+
+static bool migrateDecoded(void* context, const StoreEntryView& entry, StoreLoader* loader)
+{
+    ConfigMigrateState* state = static_cast<ConfigMigrateState*>(context);
+
+    // The version entry comes first in any image that has one
+    if (!state->versionKnown) {
+        bool marked = entry.id == CONFIG_VERSION_ID && entry.type == TYPE_INT;
+        migrateVersion(state, marked ? (uint32_t)entry.value : 0);
+    }
+    if (entry.id == CONFIG_VERSION_ID) {
+        return true;
+    }
+    // Entries no transform names load as decoded, as a current image does
+    for (uint32_t i = state->first; i < configMigrationCount; ++i) {
+        if (configMigrations[i].id == entry.id) {
+            migrateEntry(state, entry, i, loader);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Packed fields and defaults once every entry has been seen
+static void migrateFinish(void* context, StoreLoader* loader)
+{
+    ConfigMigrateState* state = static_cast<ConfigMigrateState*>(context);
+
+    if (!state->versionKnown) {
+        migrateVersion(state, 0); // No entries at all
+    }
+    for (uint32_t i = state->first; i < configMigrationCount; ++i) {
+        const ConfigMigration& m = configMigrations[i];
+        if (m.kind == CONFIG_MIGRATE_MERGE && state->applied[i]) {
+            migrateEntry(state, {m.target, TYPE_INT, (int)state->merged[i], nullptr, 0}, i + 1, loader);
+        } else if (m.kind == CONFIG_MIGRATE_DEFAULT && !state->applied[i]) {
+            migrateEntry(state, {m.id, TYPE_INT, m.value, nullptr, 0}, i + 1, loader);
+        }
+    }
+    if (state->imageVersion > CONFIG_SCHEMA_VERSION) {
+        flash_log(FLASH_LOG_CONFIG_IMAGE_NEWER, state->imageVersion, CONFIG_SCHEMA_VERSION);
+    } else if (state->imageVersion != CONFIG_SCHEMA_VERSION) {
+        state->migrated = true;
+        flash_log(FLASH_LOG_CONFIG_MIGRATED, state->imageVersion, CONFIG_SCHEMA_VERSION);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+StoreMigrator configMigrateBegin(ConfigMigrateState* state)
+{
+    std::memset(state, 0, sizeof(*state));
+    return {migrateDecoded, migrateFinish, state};
+}
+
+uint32_t configImageVersion(const uint8_t* image, size_t size)
+{
+    uint32_t intCount;
+    int entry[3];                          // Type, ID, value
+
+    if (size < sizeof(intCount) + sizeof(uint32_t) + sizeof(entry)) {
+        return 0;
+    }
+    std::memcpy(&intCount, image, sizeof(intCount));
+    std::memcpy(entry, image + 2 * sizeof(uint32_t), sizeof(entry));
+    return (intCount && entry[0] == TYPE_INT && entry[1] == CONFIG_VERSION_ID) ? (uint32_t)entry[2] : 0;
+}
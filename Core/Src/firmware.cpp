@@ -7,232 +7,338 @@
 
 #include "firmware.h"
 #include "InitArrayMap.h"
+#include "store_view.h"
+#include "storage_stats.h"
+#include "flash_trace.h"
 #include <cstring>
-#include <iostream>
 #include "flashFile.h"
 
 // Define potential constants that might need to be changed
+#ifndef MAX_INT_COUNT
 #define MAX_INT_COUNT 5            // Maximum number of integers in firmware
+#endif
+#ifndef MAX_STRING_COUNT
 #define MAX_STRING_COUNT 5         // Maximum number of strings in firmware
+#endif
+#ifndef BUFFER_SIZE
 #define BUFFER_SIZE 256            // Default buffer size for loading and flushing
-#define STRING_ENTRY_SIZE 20       // Size of each string entry
-#define INT_ENTRY_SIZE (sizeof(int) + sizeof(int) + sizeof(int)) // Type + ID + value size
+#endif
 
-#define MAX_NAME_ID_PAIRS 10       // Maximum number of name-ID pairs
+StoreContext firmwareDefaultStore = {};
+InitArrayMap& firmwareArrayMap = firmwareDefaultStore.map;
 
-NameIDPair firmwareNameIDStorage[MAX_NAME_ID_PAIRS];
-int firmwareNameIDCount = 0;
-
-InitArrayMap firmwareArrayMap = {{}, 0, {}, 0};
+// Function to drop all entries and name-ID pairs held in memory
+void firmwareClear_r(StoreContext* store) {
+    store->map.intCount = 0;
+    store->map.stringCount = 0;
+    store->nameCount = 0;
+}
 
 // Function to update an integer value based on ID
-int firmwareUpdateInt(int id, int newValue) {
+int firmwareUpdateInt_r(StoreContext* store, int id, int newValue) {
     if (id < 0) return 1; // Invalid ID
 
-    bool updated = false;
-    for (size_t i = 0; i < firmwareArrayMap.intCount; ++i) {
-        if (firmwareArrayMap.intArray[i].id == id) {
-            firmwareArrayMap.intArray[i].value = newValue;
-            updated = true;
-            break;
-        }
+    int i = storeFindInt(store->map, id);
+    bool updated = i >= 0;
+    if (updated) {
+        store->map.intArray[i].value = newValue;
     }
 
+    if (updated) {
+        storageStatsUpdate(id);
+    }
     return updated ? 0 : 1; // Return 0 for success, 1 for ID not found
 }
 
 // Function to update a string value based on ID
-int firmwareUpdateString(int id, const char* newValue) {
+int firmwareUpdateString_r(StoreContext* store, int id, const char* newValue) {
     if (id < 0 || !newValue) return 1; // Invalid ID or value
 
-    bool updated = false;
-    for (size_t i = 0; i < firmwareArrayMap.stringCount; ++i) {
-        if (firmwareArrayMap.stringArray[i].id == id) {
-            std::strncpy(firmwareArrayMap.stringArray[i].value, newValue, MAX_STRING_LENGTH - 1);
-            firmwareArrayMap.stringArray[i].value[MAX_STRING_LENGTH - 1] = '\0';  // Ensure null termination
-            updated = true;
-            break;
-        }
+    int i = storeFindString(store->map, id);
+    bool updated = i >= 0;
+    if (updated) {
+        std::strncpy(store->map.stringArray[i].value, newValue, MAX_STRING_LENGTH - 1);
+        store->map.stringArray[i].value[MAX_STRING_LENGTH - 1] = '\0';  // Ensure null termination
     }
 
+    if (updated) {
+        storageStatsUpdate(id);
+    }
     return updated ? 0 : 1; // Return 0 for success, 1 for ID not found
 }
 
-int firmwareWrite(const char* name, int id, char type, const void* data) {
+int firmwareWrite_r(StoreContext* store, const char* name, int id, char type, const void* data) {
     if (id < 0 || !data) return 1; // Invalid ID or data
 
-    int handleResult = firmwareSaveHandles(name, id);
+    int handleResult = firmwareSaveHandles_r(store, name, id);
     if (handleResult != 0) {
         return handleResult;  // Return the error if saving the handle fails
     }
     switch (type) {
         case 'i':
-            firmwareWriteInt(id, *static_cast<const int*>(data));
-            return 0; // Success
+            return firmwareWriteInt_r(store, id, *static_cast<const int*>(data)); // 1 if the store is full
         case 's':
-            firmwareWriteString(id, static_cast<const char*>(data));
-            return 0; // Success
+            return firmwareWriteString_r(store, id, static_cast<const char*>(data));
         default:
             return 1; // Unknown data type
     }
 }
 
-void firmwareWriteInt(int id, int value) {
-    bool replaced = false;
-    for (size_t i = 0; i < firmwareArrayMap.intCount; ++i) {
-        if (firmwareArrayMap.intArray[i].id == id) {
-            firmwareArrayMap.intArray[i].value = value;
-            replaced = true;
-            break;
-        }
+//-----------------------------------------------------------------------------
+// Entry storage, sorted by ID. Returns 1 when a new entry does not fit.
+//-----------------------------------------------------------------------------
+
+static int firmwareStoreInt(StoreContext* store, int id, int value) {
+    size_t i = storeLowerBoundInt(store->map, id);
+    if (i < store->map.intCount && store->map.intArray[i].id == id) {
+        store->map.intArray[i].value = value;
+    } else if (store->map.intCount < MAX_INT_COUNT) {
+        storeInsertInt(store->map, i, id, value);
+    } else {
+        return 1;
     }
-    if (!replaced && firmwareArrayMap.intCount < MAX_INT_COUNT) {
-        firmwareArrayMap.intArray[firmwareArrayMap.intCount++] = IntEntry(id, value);
+    return 0;
+}
+
+static int firmwareStoreString(StoreContext* store, int id, const char* str) {
+    size_t i = storeLowerBoundString(store->map, id);
+    if (i < store->map.stringCount && store->map.stringArray[i].id == id) {
+        std::strncpy(store->map.stringArray[i].value, str, MAX_STRING_LENGTH - 1);
+        store->map.stringArray[i].value[MAX_STRING_LENGTH - 1] = '\0';
+    } else if (store->map.stringCount < MAX_STRING_COUNT) {
+        storeInsertString(store->map, i, id, str);
+    } else {
+        return 1;
     }
+    return 0;
 }
 
-void firmwareWriteString(int id, const char* str) {
-    bool replaced = false;
-    for (size_t i = 0; i < firmwareArrayMap.stringCount; ++i) {
-        if (firmwareArrayMap.stringArray[i].id == id) {
-            std::strncpy(firmwareArrayMap.stringArray[i].value, str, MAX_STRING_LENGTH - 1);
-            firmwareArrayMap.stringArray[i].value[MAX_STRING_LENGTH - 1] = '\0';
-            replaced = true;
-            break;
-        }
+int firmwareWriteInt_r(StoreContext* store, int id, int value) {
+    if (firmwareStoreInt(store, id, value) != 0) {
+        return 1;
     }
-    if (!replaced && firmwareArrayMap.stringCount < MAX_STRING_COUNT) {
-        firmwareArrayMap.stringArray[firmwareArrayMap.stringCount++] = StringEntry(id, str);
+    storageStatsUpdate(id);
+    return 0;
+}
+
+int firmwareWriteString_r(StoreContext* store, int id, const char* str) {
+    if (firmwareStoreString(store, id, str) != 0) {
+        return 1;
     }
+    storageStatsUpdate(id);
+    return 0;
 }
 
-void firmwareFlush(uint32_t* buffer, size_t& bufferSize) {
-    size_t intArraySize = firmwareArrayMap.intCount * INT_ENTRY_SIZE;
-    size_t stringArraySize = firmwareArrayMap.stringCount * (sizeof(int) + sizeof(int) + MAX_STRING_LENGTH); // Type + ID + value
-    bufferSize = intArraySize + stringArraySize + 2 * sizeof(uint32_t); // Handle + int and string counts
+int firmwareFlush_r(StoreContext* store, uint32_t* buffer, size_t& bufferSize) {
+    size_t intArraySize = store->map.intCount * INT_ENTRY_SIZE;
+    size_t stringArraySize = store->map.stringCount * (sizeof(int) + sizeof(int) + STRING_ENTRY_SIZE); // Type + ID + value
+    size_t requiredSize = intArraySize + stringArraySize + 2 * sizeof(uint32_t); // Handle + int and string counts
+    if (requiredSize > bufferSize) {
+        return 1; // Buffer too small for the current entries
+    }
+    bufferSize = requiredSize;
 
     uint32_t* bufferPtr = buffer;
 
-    *bufferPtr++ = firmwareArrayMap.intCount;
-    *bufferPtr++ = firmwareArrayMap.stringCount;
+    *bufferPtr++ = store->map.intCount;
+    *bufferPtr++ = store->map.stringCount;
 
-    for (size_t i = 0; i < firmwareArrayMap.intCount; ++i) {
-        std::memcpy(bufferPtr, &firmwareArrayMap.intArray[i].type, sizeof(int));
+    for (size_t i = 0; i < store->map.intCount; ++i) {
+        std::memcpy(bufferPtr, &store->map.intArray[i].type, sizeof(int));
         bufferPtr += 1;
-        std::memcpy(bufferPtr, &firmwareArrayMap.intArray[i].id, sizeof(int));
+        std::memcpy(bufferPtr, &store->map.intArray[i].id, sizeof(int));
         bufferPtr += 1;
-        std::memcpy(bufferPtr, &firmwareArrayMap.intArray[i].value, sizeof(int));
+        std::memcpy(bufferPtr, &store->map.intArray[i].value, sizeof(int));
         bufferPtr += 1;
     }
 
-    for (size_t i = 0; i < firmwareArrayMap.stringCount; ++i) {
-        std::memcpy(bufferPtr, &firmwareArrayMap.stringArray[i].type, sizeof(int));
+    for (size_t i = 0; i < store->map.stringCount; ++i) {
+        std::memcpy(bufferPtr, &store->map.stringArray[i].type, sizeof(int));
         bufferPtr += 1;
-        std::memcpy(bufferPtr, &firmwareArrayMap.stringArray[i].id, sizeof(int));
+        std::memcpy(bufferPtr, &store->map.stringArray[i].id, sizeof(int));
         bufferPtr += 1;
-        std::memcpy(bufferPtr, firmwareArrayMap.stringArray[i].value, MAX_STRING_LENGTH);
-        bufferPtr += MAX_STRING_LENGTH / 4;
+        std::memset(bufferPtr, 0, STRING_ENTRY_SIZE);
+        std::memcpy(bufferPtr, store->map.stringArray[i].value, MAX_STRING_LENGTH);
+        bufferPtr += STRING_ENTRY_SIZE / 4;
     }
+
+    return 0; // Return success
 }
 
-int loadFirmware(uint32_t address) {
-    uint8_t byteBuffer[BUFFER_SIZE];  // Statically allocate buffer for raw data
+int firmwareGetInt_r(StoreContext* store, int id) {
+    storageCounters.gets++;
+    int i = storeFindInt(store->map, id);
+    if (i >= 0) {
+        return store->map.intArray[i].value;
+    }
+    storageCounters.misses++;
+    return -1; // Return -1 if not found
+}
+
+const char* firmwareGetString_r(StoreContext* store, int id) {
+    storageCounters.gets++;
+    int i = storeFindString(store->map, id);
+    if (i >= 0) {
+        return store->map.stringArray[i].value;
+    }
+    storageCounters.misses++;
+    return nullptr; // Return nullptr if not found
+}
+
+int firmwareLookup_r(StoreContext* store, int id, StoreEntryView* entry) {
+    storageCounters.gets++;
+    int i = storeFindInt(store->map, id);
+    if (i >= 0) {
+        *entry = {id, TYPE_INT, store->map.intArray[i].value, nullptr, 0};
+        return 0;
+    }
+    i = storeFindString(store->map, id);
+    if (i >= 0) {
+        const char* value = store->map.stringArray[i].value;
+        *entry = {id, TYPE_STRING, 0, value, std::strlen(value)};
+        return 0;
+    }
+    storageCounters.misses++;
+    return 1;
+}
+
+StoreRange firmwareRange_r(StoreContext* store, int loId, int hiId) {
+    return storeRange(store->map, loId, hiId);
+}
+
+size_t firmwareForEach_r(StoreContext* store, StoreVisitor visitor, void* context) {
+    return storeForEach(storeRange(store->map, INT_MIN, INT_MAX), visitor, context);
+}
+
+int loadFirmware_r(StoreContext* store, uint32_t address) {
+    uint32_t startCycles = storageStatsCycles();
+    flash_traceBegin(FLASH_TRACE_OP_LOAD_FIRMWARE);
+    uint8_t byteBuffer[BUFFER_SIZE];  // Allocate a buffer for raw data
     size_t numberOfWords = BUFFER_SIZE / sizeof(uint32_t);
 
     int result = readAndLoadFlashData(byteBuffer, numberOfWords, address);
-    if (result != 0) {
-        return result;  // Return the error code
+    if (result == 0) {
+        result = processFirmwareBuffer_r(store, byteBuffer, BUFFER_SIZE);
     }
 
-    processFirmwareBuffer(byteBuffer, BUFFER_SIZE);
-    return 0; // Success
+    flash_traceEnd(FLASH_TRACE_OP_LOAD_FIRMWARE, result);
+    storageStatsTiming(&storageCounters.loadFirmware, startCycles);
+    return result;  // Return success or the error code
 }
 
-int flashFirmware(uint32_t address) {
+int flashFirmware_r(StoreContext* store, uint32_t address) {
+    uint32_t startCycles = storageStatsCycles();
+    flash_traceBegin(FLASH_TRACE_OP_FLASH_FIRMWARE);
     size_t bufferSize = BUFFER_SIZE;
-    uint32_t buffer[BUFFER_SIZE / sizeof(uint32_t)];  // Statically allocate buffer
+    uint32_t buffer[BUFFER_SIZE / sizeof(uint32_t)];  // Statically allocate the buffer
 
-    firmwareFlush(buffer, bufferSize);  // Flush firmware data to the buffer
+    int result = 1;  // Entries do not fit in the buffer unless the flush succeeds
+    if (firmwareFlush_r(store, buffer, bufferSize) == 0) {  // Flush firmware data to the buffer
+        result = fileWrite(buffer, bufferSize, address);
+    }
 
-    int result = fileWrite(buffer, bufferSize, address);
+    storageCounters.commits++;
+    flash_traceEnd(FLASH_TRACE_OP_FLASH_FIRMWARE, result);
+    storageStatsTiming(&storageCounters.flashFirmware, startCycles);
     return result;  // Return success or failure code
 }
 
-void processFirmwareBuffer(uint8_t* bufferPtr, size_t bufferSize) {
-    uint32_t intCount = 0;
-    uint32_t stringCount = 0;
-    std::memcpy(&intCount, bufferPtr, sizeof(uint32_t));
-    bufferPtr += sizeof(uint32_t);
-    std::memcpy(&stringCount, bufferPtr, sizeof(uint32_t));
-    bufferPtr += sizeof(uint32_t);
-
-    for (size_t i = 0; i < intCount + stringCount && bufferPtr < bufferPtr + bufferSize; ++i) {
-        int type = 0;
-        std::memcpy(&type, bufferPtr, sizeof(int));
-        bufferPtr += sizeof(int);
-
-        int id = 0;
-        std::memcpy(&id, bufferPtr, sizeof(int));
-        bufferPtr += sizeof(int);
-
-        if (type == 0) { // It's an integer
-            int value = 0;
-            std::memcpy(&value, bufferPtr, sizeof(int));
-            bufferPtr += sizeof(int);
-
-            bool replaced = false;
-            for (size_t j = 0; j < firmwareArrayMap.intCount; ++j) {
-                if (firmwareArrayMap.intArray[j].id == id) {
-                    firmwareArrayMap.intArray[j].value = value;
-                    replaced = true;
-                    break;
-                }
-            }
-            if (!replaced && firmwareArrayMap.intCount < MAX_INT_COUNT) {
-                firmwareArrayMap.intArray[firmwareArrayMap.intCount++] = IntEntry(id, value);
-            }
-        } else if (type == 1) { // It's a string
-            char value[MAX_STRING_LENGTH] = {0};
-            std::memcpy(value, bufferPtr, STRING_ENTRY_SIZE);
-            bufferPtr += STRING_ENTRY_SIZE;
-
-            bool replaced = false;
-            for (size_t j = 0; j < firmwareArrayMap.stringCount; ++j) {
-                if (firmwareArrayMap.stringArray[j].id == id) {
-                    std::strncpy(firmwareArrayMap.stringArray[j].value, value, MAX_STRING_LENGTH - 1);
-                    firmwareArrayMap.stringArray[j].value[MAX_STRING_LENGTH - 1] = '\0';
-                    replaced = true;
-                    break;
-                }
-            }
-            if (!replaced && firmwareArrayMap.stringCount < MAX_STRING_COUNT) {
-                firmwareArrayMap.stringArray[firmwareArrayMap.stringCount++] = StringEntry(id, value);
-            }
-        }
+int flashFirmwareRegion_r(StoreContext* store, FlashWearRegion* region) {
+    uint32_t startCycles = storageStatsCycles();
+    flash_traceBegin(FLASH_TRACE_OP_FLASH_FIRMWARE);
+    size_t bufferSize = BUFFER_SIZE;
+    uint32_t buffer[BUFFER_SIZE / sizeof(uint32_t)];  // Statically allocate the buffer
+
+    int result = 1;  // Entries do not fit in the buffer unless the flush succeeds
+    if (firmwareFlush_r(store, buffer, bufferSize) == 0) {  // Flush firmware data to the buffer
+        result = fileWriteRegion(region, buffer, bufferSize);
+    }
+
+    storageCounters.commits++;
+    flash_traceEnd(FLASH_TRACE_OP_FLASH_FIRMWARE, result);
+    storageStatsTiming(&storageCounters.flashFirmware, startCycles);
+    return result;  // Return success or failure code
+}
+
+int loadFirmwareRegion_r(StoreContext* store, FlashWearRegion* region) {
+    uint32_t startCycles = storageStatsCycles();
+    flash_traceBegin(FLASH_TRACE_OP_LOAD_FIRMWARE);
+    uint8_t byteBuffer[BUFFER_SIZE];  // Allocate a buffer for raw data
+    size_t size = BUFFER_SIZE;
+
+    int result = readAndLoadRegionData(byteBuffer, size, region);
+    if (result == 0) {
+        result = processFirmwareBuffer_r(store, byteBuffer, size);
+    }
+
+    flash_traceEnd(FLASH_TRACE_OP_LOAD_FIRMWARE, result);
+    storageStatsTiming(&storageCounters.loadFirmware, startCycles);
+    return result;  // Return success or the error code
+}
+
+int flashFirmwarePartition_r(StoreContext* store, FlashPartitionId id) {
+    uint32_t startCycles = storageStatsCycles();
+    flash_traceBegin(FLASH_TRACE_OP_FLASH_FIRMWARE);
+    size_t bufferSize = BUFFER_SIZE;
+    uint32_t buffer[BUFFER_SIZE / sizeof(uint32_t)];  // Statically allocate the buffer
+
+    int result = 1;  // Wrong partition, or entries do not fit in the buffer
+    if (flash_partition(id).purpose == FLASH_PURPOSE_FIRMWARE && firmwareFlush_r(store, buffer, bufferSize) == 0) {
+        result = fileWritePartition(id, buffer, bufferSize);
+    }
+
+    storageCounters.commits++;
+    flash_traceEnd(FLASH_TRACE_OP_FLASH_FIRMWARE, result);
+    storageStatsTiming(&storageCounters.flashFirmware, startCycles);
+    return result;  // Return success or failure code
+}
+
+int loadFirmwarePartition_r(StoreContext* store, FlashPartitionId id) {
+    uint32_t startCycles = storageStatsCycles();
+    flash_traceBegin(FLASH_TRACE_OP_LOAD_FIRMWARE);
+    uint8_t byteBuffer[BUFFER_SIZE];  // Allocate a buffer for raw data
+    size_t size = BUFFER_SIZE;
+
+    int result = 1;
+    if (flash_partition(id).purpose == FLASH_PURPOSE_FIRMWARE) {
+        result = readAndLoadPartitionData(byteBuffer, size, id);
     }
+    if (result == 0) {
+        result = processFirmwareBuffer_r(store, byteBuffer, size);
+    }
+
+    flash_traceEnd(FLASH_TRACE_OP_LOAD_FIRMWARE, result);
+    storageStatsTiming(&storageCounters.loadFirmware, startCycles);
+    return result;  // Return success or the error code
+}
+
+int processFirmwareBuffer_r(StoreContext* store, const uint8_t* bufferPtr, size_t bufferSize) {
+    static const StoreLoadRules rules = {nullptr, nullptr, MAX_INT_COUNT, MAX_STRING_COUNT,
+                                         nullptr};
+    return storeLoadImage(store->map, bufferPtr, bufferSize, rules);
 }
 
 // firmwareOpen: Relays the result from fileOpen
 int firmwareOpen(const char* str) {
-    return fileOpen(str);  // Directly return the code from fileOpen
+    return fileOpen(str);  // Descriptor from fileOpen, or -1
 }
 
 // Function to save name-ID pairs for firmware and return a success or error message
-int firmwareSaveHandles(const char* name, int id) {
+int firmwareSaveHandles_r(StoreContext* store, const char* name, int id) {
     if (!name || id < 0) return 1; // Invalid name or ID
 
-    for (int i = 0; i < firmwareNameIDCount; ++i) {
-        if (std::strcmp(firmwareNameIDStorage[i].name, name) == 0) {
-            firmwareNameIDStorage[i].id = id;
+    for (int i = 0; i < store->nameCount; ++i) {
+        if (std::strcmp(store->names[i].name, name) == 0) {
+            store->names[i].id = id;
             return 0; // Success: ID updated for existing firmware name
         }
     }
 
-    if (firmwareNameIDCount < MAX_NAME_ID_PAIRS) {
-        std::strncpy(firmwareNameIDStorage[firmwareNameIDCount].name, name, MAX_STRING_LENGTH - 1);
-        firmwareNameIDStorage[firmwareNameIDCount].name[MAX_STRING_LENGTH - 1] = '\0';
-        firmwareNameIDStorage[firmwareNameIDCount].id = id;
-        ++firmwareNameIDCount;
+    if (store->nameCount < MAX_NAME_ID_PAIRS) {
+        std::strncpy(store->names[store->nameCount].name, name, MAX_STRING_LENGTH - 1);
+        store->names[store->nameCount].name[MAX_STRING_LENGTH - 1] = '\0';
+        store->names[store->nameCount].id = id;
+        ++store->nameCount;
         return 0; // Success: name-ID pair saved for firmware
     }
 
@@ -240,12 +346,99 @@ int firmwareSaveHandles(const char* name, int id) {
 }
 
 // Function to get ID from name
-int firmwareGetIDFromName(const char* name) {
-    for (int i = 0; i < firmwareNameIDCount; ++i) {
-        if (std::strcmp(firmwareNameIDStorage[i].name, name) == 0) {
-            return firmwareNameIDStorage[i].id;
+int firmwareGetIDFromName_r(StoreContext* store, const char* name) {
+    for (int i = 0; i < store->nameCount; ++i) {
+        if (std::strcmp(store->names[i].name, name) == 0) {
+            return store->names[i].id;
         }
     }
     return -1; // Return -1 to indicate failure
 }
 
+//-----------------------------------------------------------------------------
+// Default store, behind the functions without a context argument
+//-----------------------------------------------------------------------------
+
+void firmwareClear() {
+    firmwareClear_r(&firmwareDefaultStore);
+}
+
+int firmwareUpdateInt(int id, int newValue) {
+    return firmwareUpdateInt_r(&firmwareDefaultStore, id, newValue);
+}
+
+int firmwareUpdateString(int id, const char* newValue) {
+    return firmwareUpdateString_r(&firmwareDefaultStore, id, newValue);
+}
+
+int firmwareWrite(const char* name, int id, char type, const void* data) {
+    return firmwareWrite_r(&firmwareDefaultStore, name, id, type, data);
+}
+
+int firmwareWriteInt(int id, int value) {
+    return firmwareWriteInt_r(&firmwareDefaultStore, id, value);
+}
+
+int firmwareWriteString(int id, const char* str) {
+    return firmwareWriteString_r(&firmwareDefaultStore, id, str);
+}
+
+int firmwareFlush(uint32_t* buffer, size_t& bufferSize) {
+    return firmwareFlush_r(&firmwareDefaultStore, buffer, bufferSize);
+}
+
+int firmwareGetInt(int id) {
+    return firmwareGetInt_r(&firmwareDefaultStore, id);
+}
+
+const char* firmwareGetString(int id) {
+    return firmwareGetString_r(&firmwareDefaultStore, id);
+}
+
+int firmwareLookup(int id, StoreEntryView* entry) {
+    return firmwareLookup_r(&firmwareDefaultStore, id, entry);
+}
+
+StoreRange firmwareRange(int loId, int hiId) {
+    return firmwareRange_r(&firmwareDefaultStore, loId, hiId);
+}
+
+size_t firmwareForEach(StoreVisitor visitor, void* context) {
+    return firmwareForEach_r(&firmwareDefaultStore, visitor, context);
+}
+
+int loadFirmware(uint32_t address) {
+    return loadFirmware_r(&firmwareDefaultStore, address);
+}
+
+int flashFirmware(uint32_t address) {
+    return flashFirmware_r(&firmwareDefaultStore, address);
+}
+
+int flashFirmwareRegion(FlashWearRegion* region) {
+    return flashFirmwareRegion_r(&firmwareDefaultStore, region);
+}
+
+int loadFirmwareRegion(FlashWearRegion* region) {
+    return loadFirmwareRegion_r(&firmwareDefaultStore, region);
+}
+
+int flashFirmwarePartition(FlashPartitionId id) {
+    return flashFirmwarePartition_r(&firmwareDefaultStore, id);
+}
+
+int loadFirmwarePartition(FlashPartitionId id) {
+    return loadFirmwarePartition_r(&firmwareDefaultStore, id);
+}
+
+int processFirmwareBuffer(const uint8_t* bufferPtr, size_t bufferSize) {
+    return processFirmwareBuffer_r(&firmwareDefaultStore, bufferPtr, bufferSize);
+}
+
+int firmwareSaveHandles(const char* name, int id) {
+    return firmwareSaveHandles_r(&firmwareDefaultStore, name, id);
+}
+
+int firmwareGetIDFromName(const char* name) {
+    return firmwareGetIDFromName_r(&firmwareDefaultStore, name);
+}
@@ -12,63 +12,234 @@
 #include "main.h"
 #include <string>
 #include "util.h"
-#include <iostream>
-#include "debug.h"
 #include <stdio.h>
 #include <cstring>
 #include <vector>
 #include "firmware.h"
+#include "lz.h"
+#include "flash_fs.h"
 
-// Define constants for easy modification
-#define MAX_SAVED_HANDLES 10        // Maximum number of saved handles
-#define MAX_HANDLE_NAME_LENGTH 20   // Maximum length of handle name (including null terminator)
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE 256            // Must match the buffer used by flashConfig
+#endif
 
-// Array to store saved handles
-char savedHandles[MAX_SAVED_HANDLES][MAX_HANDLE_NAME_LENGTH];
-int savedHandlesCount = 0;
+static_assert(flash_partition(FLASH_PARTITION_fs).pageCount > FLASH_FS_DIR_PAGES,
+              "fs partition must hold the directory and at least one data page");
+
+// Image encoding
+STORAGE_THREAD_LOCAL static bool compressionEnabled = false;
+STORAGE_THREAD_LOCAL static uint32_t imageBuffer[FILE_IMAGE_BUFFER_SIZE / sizeof(uint32_t)];
+
+//-----------------------------------------------------------------------------
+// Wrap a serialized store in an image header, compressed if that is smaller.
+// Without compression the store is written as is.
+//-----------------------------------------------------------------------------
+
+int fileEncodeImage(uint32_t* data, size_t size, uint32_t*& image, size_t& imageSize)
+{
+    FileImageHeader header;
+    uint8_t* out = reinterpret_cast<uint8_t*>(imageBuffer);
+    uint32_t capacity = sizeof(imageBuffer) - sizeof(header);
+
+    if (!compressionEnabled) {
+        image = data;
+        imageSize = size;
+        return 0;
+    }
+
+    header.magic = FILE_IMAGE_MAGIC;
+    header.rawSize = size;
+    header.crc = util_crc32(0, reinterpret_cast<uint8_t*>(data), size);
+    header.method = FILE_IMAGE_METHOD_LZ;
+    header.storedSize = lz_compress(reinterpret_cast<uint8_t*>(data), size, out + sizeof(header),
+                                    capacity < size ? capacity : (uint32_t)size - 1);
+    if (header.storedSize == 0) {
+        if (size > capacity) {
+            return 1;
+        }
+        header.method = FILE_IMAGE_METHOD_RAW;
+        header.storedSize = size;
+        std::memcpy(out + sizeof(header), data, size);
+    }
+    std::memcpy(out, &header, sizeof(header));
+
+    // Pad the last quadword with the erased value
+    imageSize = sizeof(header) + header.storedSize;
+    size_t padded = (imageSize + FLASH_QUADWORD_SIZE - 1) & ~(size_t)(FLASH_QUADWORD_SIZE - 1);
+    if (padded > sizeof(imageBuffer) || padded > FLASH_PAGE_SIZE) {
+        return 1;
+    }
+    std::memset(out + imageSize, 0xFF, padded - imageSize);
+    imageSize = padded;
+    image = imageBuffer;
+    return 0;
+}
+
+static bool fileHasImageHeader(uint32_t addr)
+{
+    uint32_t magic;
+    std::memcpy(&magic, (const void*)FLASH_MAP(addr), sizeof(magic));
+    return magic == FILE_IMAGE_MAGIC;
+}
+
+int fileDecodeBuffer(const uint8_t* image, uint32_t available, uint8_t* data, size_t& size)
+{
+    FileImageHeader header;
+    if (available < sizeof(header)) {
+        return 1;
+    }
+    std::memcpy(&header, image, sizeof(header));
+    const uint8_t* stored = image + sizeof(header);
+
+    if (header.magic != FILE_IMAGE_MAGIC || header.rawSize > size ||
+        header.storedSize > available - sizeof(header)) {
+        return 1;
+    }
+    if (header.method == FILE_IMAGE_METHOD_RAW && header.storedSize == header.rawSize) {
+        std::memcpy(data, stored, header.rawSize);
+    } else if (header.method != FILE_IMAGE_METHOD_LZ ||
+               lz_decompress(stored, header.storedSize, data, header.rawSize) != header.rawSize) {
+        return 1;
+    }
+    if (util_crc32(0, data, header.rawSize) != header.crc) {
+        return 1;
+    }
+    size = header.rawSize;
+    return 0;
+}
+
+// Expand the image at addr into data; size is capacity in, bytes out
+static int fileDecodeImage(uint32_t addr, uint8_t* data, size_t& size)
+{
+    // The image never extends past the end of its page
+    uint32_t available = FLASH_PAGE_SIZE - (addr % FLASH_PAGE_SIZE);
+    return fileDecodeBuffer((const uint8_t*)FLASH_MAP(addr), available, data, size);
+}
+
+void fileSetCompression(bool enable)
+{
+    compressionEnabled = enable;
+}
+
+bool fileGetCompression(void)
+{
+    return compressionEnabled;
+}
 
 int readAndLoadFlashData(uint8_t* data, size_t& size, uint32_t addr)
 {
     int result;
 
+    if (fileHasImageHeader(addr)) {
+        size_t capacity = size * sizeof(uint32_t);
+        return fileDecodeImage(addr, data, capacity);
+    }
+
     // Use the provided address instead of hardcoded addresses
     result = flash_read(addr, reinterpret_cast<uint32_t*>(data), size);
     return (result == 0) ? 0 : 1;  // Return 0 for success, 1 for failure
 }
 
-// Implementation of the fileOpen function with numeric return
-int fileOpen(const char* handle) {
-    bool inUse = false;
-    for (int i = 0; i < savedHandlesCount; ++i) {
-        if (std::strcmp(savedHandles[i], handle) == 0) {
-            inUse = true;
-            break;
-        }
+// Open a file of the fs partition for reading and appending, creating it
+// if needed. Returns a descriptor for the flash_fs functions or -1.
+int fileOpen_r(FsVolume* volume, const char* handle) {
+    const FlashPartition& partition = flash_partition(FLASH_PARTITION_fs);
+    if (!flash_fsMounted_r(volume) &&
+        flash_fsMount_r(volume, partition.bank, partition.firstPage, partition.pageCount) != 0) {
+        return -1;
     }
+    return flash_fsOpen_r(volume, handle, FLASH_FS_READ | FLASH_FS_WRITE | FLASH_FS_CREATE, 0);
+}
 
-    if (inUse) {
-        return 1;  // Handle is already in use
-    }
+int fileClose_r(FsVolume* volume, int fd) {
+    return flash_fsClose_r(volume, fd);
+}
 
-    if (std::strcmp(handle, "config.bin") == 0 || std::strcmp(handle, "firmware.bin") == 0) {
-        if (savedHandlesCount < MAX_SAVED_HANDLES) {
-            std::strncpy(savedHandles[savedHandlesCount], handle, MAX_HANDLE_NAME_LENGTH - 1);
-            savedHandles[savedHandlesCount][MAX_HANDLE_NAME_LENGTH - 1] = '\0';  // Ensure null-termination
-            ++savedHandlesCount;
-            return 0;  // Handle opened successfully
-        }
-        return 1;  // Max handles reached
-    }
+int fileOpen(const char* handle) {
+    return fileOpen_r(&fsDefaultVolume, handle);
+}
 
-    return 1;  // Unknown handle
+int fileClose(int fd) {
+    return fileClose_r(&fsDefaultVolume, fd);
 }
 
 int fileWrite(uint32_t* data, size_t size, uint32_t addr) {
     int result;
+    uint32_t* image;
+    size_t imageSize;
+
+    if (fileEncodeImage(data, size, image, imageSize) != 0) {
+        return 1;
+    }
 
     // Use the provided address instead of hardcoded addresses
-    result = flash_pageEraseWriteVerify(data, size, addr);
+    result = flash_pageEraseWriteVerify(image, imageSize, addr);
+    return (result == 0) ? 0 : 1;  // Return 0 for success, 1 for failure
+}
+
+
+
+int fileWriteRegion(FlashWearRegion* region, uint32_t* data, size_t size) {
+    int result;
+    uint32_t* image;
+    size_t imageSize;
+
+    if (fileEncodeImage(data, size, image, imageSize) != 0) {
+        return 1;
+    }
+
+    // Rotate the commit onto the next page of the region
+    result = flash_wearCommit(region, reinterpret_cast<uint8_t*>(image), imageSize);
+    return (result == 0) ? 0 : 1;  // Return 0 for success, 1 for failure
+}
+
+int readAndLoadRegionData(uint8_t* data, size_t& size, FlashWearRegion* region) {
+    int result;
+    uint32_t payload = flash_wearPayloadAddress(region);
+
+    if (payload && fileHasImageHeader(payload)) {
+        return fileDecodeImage(payload, data, size);
+    }
+
+    result = flash_wearRead(region, data, size);
     return (result == 0) ? 0 : 1;  // Return 0 for success, 1 for failure
 }
 
+int fileWritePartition(FlashPartitionId id, uint32_t* data, size_t size) {
+    const FlashPartition& p = flash_partition(id);
+    uint32_t* image;
+    size_t imageSize;
+
+    if (p.policy == FLASH_POLICY_ROTATE) {
+        FlashWearRegion* region = flash_partitionRegion(id);
+        return region ? fileWriteRegion(region, data, size) : 1;
+    }
+    if (p.policy != FLASH_POLICY_FIXED || fileEncodeImage(data, size, image, imageSize) != 0) {
+        return 1;
+    }
+
+    // Bank, page and address are table constants
+    return flash_pageEraseWriteVerifyPage(image, imageSize, p.bank, p.firstPage, p.address) == 0 ? 0 : 1;
+}
+
+int readAndLoadPartitionData(uint8_t* data, size_t& size, FlashPartitionId id) {
+    const FlashPartition& p = flash_partition(id);
 
+    if (p.policy == FLASH_POLICY_ROTATE) {
+        FlashWearRegion* region = flash_partitionRegion(id);
+        return region ? readAndLoadRegionData(data, size, region) : 1;
+    }
+    if (p.policy != FLASH_POLICY_FIXED) {
+        return 1;
+    }
+    if (fileHasImageHeader(p.address)) {
+        return fileDecodeImage(p.address, data, size);
+    }
+
+    // Plain image: the whole page, as far as it fits
+    if (size > FLASH_PAGE_SIZE) {
+        size = FLASH_PAGE_SIZE;
+    }
+    std::memcpy(data, (const void*)FLASH_MAP(p.address), size);
+    return 0;
+}
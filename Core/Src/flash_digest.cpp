@@ -0,0 +1,373 @@
+/*
+ * flash_digest.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "flash_digest.h"
+#include "flash_program.h"
+#include "flash_log.h"
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+//
+// Local Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define DIGEST_LOG_PAGES       2
+#define DIGEST_RECORD_PAGE     1   // page, digest
+#define DIGEST_RECORD_IMAGE    2   // value = image size (0 while one is written), digest
+#define DIGEST_RECORD_CURSOR   3   // value = next page FLASH_DIGEST_SPOT checks
+
+#define DIGEST_PRIME1  0x9E3779B1U
+#define DIGEST_PRIME2  0x85EBCA77U
+#define DIGEST_PRIME3  0xC2B2AE3DU
+
+struct DigestRecord {
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t page;
+    uint32_t digest;
+    uint32_t value;
+    uint32_t check;                // flash_digestHash of the fields before it
+};
+
+struct DigestHeader {
+    uint32_t magic;
+    uint32_t sequence;             // The valid page with the highest one holds the log
+    uint32_t reserved;
+    uint32_t check;
+};
+
+static_assert(sizeof(DigestRecord) == FLASH_QUADWORD_SIZE, "A record is one quadword");
+static_assert(sizeof(DigestHeader) == FLASH_QUADWORD_SIZE, "The header is one quadword");
+static_assert(flash_partition(FLASH_PARTITION_fwdigest).pageCount == DIGEST_LOG_PAGES,
+              "fwdigest partition must have two pages");
+static_assert(FLASH_DIGEST_PAGES + 2 < FLASH_PAGE_SIZE / FLASH_QUADWORD_SIZE,
+              "A compacted table must fit in a log page");
+
+// Table as read from the log
+struct DigestTable {
+    bool mounted;
+    uint32_t sequence;             // 0: no valid log page yet
+    uint32_t logPage;              // Page of the partition holding the log
+    uint32_t logNext;              // Offset of the next free quadword in it
+    uint32_t imageSize;
+    uint32_t imageDigest;
+    uint32_t cursor;
+    uint32_t digests[FLASH_DIGEST_PAGES];
+    bool known[FLASH_DIGEST_PAGES];
+};
+
+STORAGE_THREAD_LOCAL static DigestTable digestTable;
+
+//-----------------------------------------------------------------------------
+//
+// Local Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+static inline uint32_t rotl(uint32_t x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+static uint32_t logAddress(uint32_t page, uint32_t offset)
+{
+    return flash_partition(FLASH_PARTITION_fwdigest).address + page * FLASH_PAGE_SIZE + offset;
+}
+
+static const uint8_t* flashBytes(uint32_t address)
+{
+    return (const uint8_t*)FLASH_MAP(address);
+}
+
+static uint32_t fieldsCheck(const void* quadword)
+{
+    return flash_digestHash((const uint8_t*)quadword, FLASH_QUADWORD_SIZE - sizeof(uint32_t));
+}
+
+// Image digest: the page digests of the image and its size
+static uint32_t imageDigest(uint32_t size)
+{
+    uint32_t pages = (size + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
+    return flash_digestHash((const uint8_t*)digestTable.digests, pages * sizeof(uint32_t)) ^
+           (size * DIGEST_PRIME1);
+}
+
+static void digestApply(const DigestRecord& record)
+{
+    if (record.type == DIGEST_RECORD_PAGE && record.page < FLASH_DIGEST_PAGES) {
+        digestTable.digests[record.page] = record.digest;
+        digestTable.known[record.page] = true;
+    } else if (record.type == DIGEST_RECORD_IMAGE) {
+        digestTable.imageSize = record.value;
+        digestTable.imageDigest = record.digest;
+    } else if (record.type == DIGEST_RECORD_CURSOR) {
+        digestTable.cursor = record.value;
+    }
+}
+
+static bool quadwordErased(const uint8_t* p)
+{
+    for (uint32_t i = 0; i < FLASH_QUADWORD_SIZE; ++i) {
+        if (p[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Read the log of the valid page with the highest sequence. Records that
+// fail their check (a reset while programming) are skipped.
+static void digestMount(void)
+{
+    if (digestTable.mounted) {
+        return;
+    }
+    std::memset(&digestTable, 0, sizeof(digestTable));
+    digestTable.mounted = true;
+
+    for (uint32_t page = 0; page < DIGEST_LOG_PAGES; ++page) {
+        DigestHeader header;
+        std::memcpy(&header, flashBytes(logAddress(page, 0)), sizeof(header));
+        if (header.magic == FLASH_DIGEST_MAGIC && header.check == fieldsCheck(&header) &&
+            header.sequence > digestTable.sequence) {
+            digestTable.sequence = header.sequence;
+            digestTable.logPage = page;
+        }
+    }
+    if (digestTable.sequence == 0) {
+        return;
+    }
+
+    uint32_t offset = sizeof(DigestHeader);
+    while (offset < FLASH_PAGE_SIZE) {
+        const uint8_t* p = flashBytes(logAddress(digestTable.logPage, offset));
+        if (quadwordErased(p)) {
+            break;
+        }
+        DigestRecord record;
+        std::memcpy(&record, p, sizeof(record));
+        if (record.check == fieldsCheck(&record)) {
+            digestApply(record);
+        }
+        offset += FLASH_QUADWORD_SIZE;
+    }
+    digestTable.logNext = offset;
+}
+
+static int programRecord(uint32_t page, uint32_t offset, DigestRecord record)
+{
+    record.reserved = 0;
+    record.check = fieldsCheck(&record);
+    return flash_programQuadwords(logAddress(page, offset), (const uint8_t*)&record, sizeof(record));
+}
+
+// Write the table compacted into the other log page, header last
+static int digestCompact(void)
+{
+    uint32_t page = digestTable.sequence == 0 ? 0 : (digestTable.logPage + 1) % DIGEST_LOG_PAGES;
+    const FlashPartition& log = flash_partition(FLASH_PARTITION_fwdigest);
+    if (flash_pageErase(log.bank, log.firstPage + page) != 0) {
+        return 1;
+    }
+
+    uint32_t offset = sizeof(DigestHeader);
+    int failures = 0;
+    for (uint32_t i = 0; i < FLASH_DIGEST_PAGES; ++i) {
+        if (digestTable.known[i]) {
+            failures += programRecord(page, offset, {DIGEST_RECORD_PAGE, 0, (uint16_t)i, digestTable.digests[i], 0, 0});
+            offset += FLASH_QUADWORD_SIZE;
+        }
+    }
+    failures += programRecord(page, offset, {DIGEST_RECORD_IMAGE, 0, 0, digestTable.imageDigest,
+                                             digestTable.imageSize, 0});
+    offset += FLASH_QUADWORD_SIZE;
+    failures += programRecord(page, offset, {DIGEST_RECORD_CURSOR, 0, 0, 0, digestTable.cursor, 0});
+    offset += FLASH_QUADWORD_SIZE;
+
+    DigestHeader header = {FLASH_DIGEST_MAGIC, digestTable.sequence + 1, 0, 0};
+    header.check = fieldsCheck(&header);
+    failures += flash_programQuadwords(logAddress(page, 0), (const uint8_t*)&header, sizeof(header));
+    if (failures) {
+        return 1;
+    }
+    digestTable.sequence++;
+    digestTable.logPage = page;
+    digestTable.logNext = offset;
+    flash_log(FLASH_LOG_DIGEST_COMPACTED, page, digestTable.sequence);
+    return 0;
+}
+
+static int digestAppend(const DigestRecord& record)
+{
+    digestMount();
+    if ((digestTable.sequence == 0 || digestTable.logNext >= FLASH_PAGE_SIZE) && digestCompact() != 0) {
+        flash_digestForget();
+        return 1;
+    }
+    if (programRecord(digestTable.logPage, digestTable.logNext, record) != 0) {
+        flash_digestForget();
+        return 1;
+    }
+    digestTable.logNext += FLASH_QUADWORD_SIZE;
+    digestApply(record);
+    return 0;
+}
+
+static uint32_t hashPage(uint32_t index)
+{
+    uint32_t address = flash_partition(FLASH_PARTITION_fwimage).address + index * FLASH_PAGE_SIZE;
+    return FLASH_DIGEST_PAGE(flashBytes(address), FLASH_PAGE_SIZE);
+}
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+// Four lanes of xxHash32 rounds over whole quadwords, byte rounds for the tail
+uint32_t flash_digestHash(const uint8_t* data, uint32_t size)
+{
+    uint32_t lane[4] = {DIGEST_PRIME1 + DIGEST_PRIME2, DIGEST_PRIME2, 0, 0U - DIGEST_PRIME1};
+    uint32_t i = 0;
+
+    for (; i + FLASH_QUADWORD_SIZE <= size; i += FLASH_QUADWORD_SIZE) {
+        uint32_t word[4];
+        std::memcpy(word, data + i, sizeof(word));
+        for (int k = 0; k < 4; ++k) {
+            lane[k] = rotl(lane[k] + word[k] * DIGEST_PRIME2, 13) * DIGEST_PRIME1;
+        }
+    }
+
+    uint32_t h = rotl(lane[0], 1) + rotl(lane[1], 7) + rotl(lane[2], 12) + rotl(lane[3], 18) + size;
+    for (; i < size; ++i) {
+        h = rotl(h + data[i] * DIGEST_PRIME3, 11) * DIGEST_PRIME1;
+    }
+    h ^= h >> 15;
+    h *= DIGEST_PRIME2;
+    h ^= h >> 13;
+    h *= DIGEST_PRIME3;
+    h ^= h >> 16;
+    return h;
+}
+
+int flash_digestRecordPage(uint32_t pageAddress)
+{
+    const FlashPartition& image = flash_partition(FLASH_PARTITION_fwimage);
+    if (pageAddress < image.address || pageAddress - image.address >= image.size ||
+        pageAddress % FLASH_PAGE_SIZE) {
+        return 0;
+    }
+    uint32_t index = (pageAddress - image.address) / FLASH_PAGE_SIZE;
+    uint32_t digest = hashPage(index);
+
+    digestMount();
+    if (digestTable.known[index] && digestTable.digests[index] == digest) {
+        return 0;
+    }
+    return digestAppend({DIGEST_RECORD_PAGE, 0, (uint16_t)index, digest, 0, 0});
+}
+
+int flash_digestBeginImage(uint32_t address)
+{
+    if (address != flash_partition(FLASH_PARTITION_fwimage).address) {
+        return 0;
+    }
+    digestMount();
+    if (digestTable.sequence != 0 && digestTable.imageSize == 0) {
+        return 0; // Already marked incomplete
+    }
+    return digestAppend({DIGEST_RECORD_IMAGE, 0, 0, 0, 0, 0});
+}
+
+int flash_digestFinishImage(uint32_t address, uint32_t size)
+{
+    const FlashPartition& image = flash_partition(FLASH_PARTITION_fwimage);
+    if (address != image.address) {
+        return 0;
+    }
+    if (size == 0 || size > image.size) {
+        return 1;
+    }
+
+    // Pages are recorded as programming completes them; the last one is
+    // partial, and pages left in place by a differential update may never
+    // have been recorded
+    uint32_t pages = (size + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
+    digestMount();
+    for (uint32_t i = 0; i < pages; ++i) {
+        if ((i == pages - 1 || !digestTable.known[i]) &&
+            flash_digestRecordPage(image.address + i * FLASH_PAGE_SIZE) != 0) {
+            return 1;
+        }
+    }
+
+    uint32_t digest = imageDigest(size);
+    if (digestTable.imageSize == size && digestTable.imageDigest == digest) {
+        return 0;
+    }
+    return digestAppend({DIGEST_RECORD_IMAGE, 0, 0, digest, size, 0});
+}
+
+int flash_digestValidate(FlashDigestMode mode, uint32_t spotPages, FlashDigestReport* report)
+{
+    bool mounted = digestTable.mounted;
+    digestMount();
+
+    std::memset(report, 0, sizeof(*report));
+    report->imageSize = digestTable.imageSize;
+    report->imageDigest = digestTable.imageDigest;
+    report->bytesRead = mounted ? 0 : digestTable.logNext;
+    report->failedPage = -1;
+    if (digestTable.imageSize == 0) {
+        return 1;
+    }
+
+    uint32_t pages = (digestTable.imageSize + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
+    for (uint32_t i = 0; i < pages; ++i) {
+        if (!digestTable.known[i]) {
+            flash_log(FLASH_LOG_DIGEST_MISSING, i);
+            report->failedPage = (int32_t)i;
+            return 1;
+        }
+    }
+    if (imageDigest(digestTable.imageSize) != digestTable.imageDigest) {
+        return 1; // Written after the image was recorded
+    }
+
+    uint32_t first = 0;
+    uint32_t count = 0;
+    if (mode == FLASH_DIGEST_FULL) {
+        count = pages;
+    } else if (mode == FLASH_DIGEST_SPOT) {
+        first = digestTable.cursor % pages;
+        count = spotPages < pages ? spotPages : pages;
+    }
+    for (uint32_t n = 0; n < count; ++n) {
+        uint32_t i = (first + n) % pages;
+        report->pagesChecked++;
+        report->bytesRead += FLASH_PAGE_SIZE;
+        uint32_t digest = hashPage(i);
+        if (digest != digestTable.digests[i]) {
+            flash_log(FLASH_LOG_DIGEST_MISMATCH, i, digest, digestTable.digests[i]);
+            report->failedPage = (int32_t)i;
+            return 1;
+        }
+    }
+
+    // The next boot continues where this one stopped
+    if (mode == FLASH_DIGEST_SPOT && count) {
+        return digestAppend({DIGEST_RECORD_CURSOR, 0, 0, 0, (first + count) % pages, 0});
+    }
+    return 0;
+}
+
+void flash_digestForget(void)
+{
+    digestTable.mounted = false;
+}
@@ -0,0 +1,444 @@
+/*
+ * flash_fs.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "flash_fs.h"
+#include "flash_program.h"
+#include "flash_wear.h"
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+//
+// Local Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define FS_DIR_MAGIC  0x46534431U  // "FSD1"
+
+static_assert(sizeof(FsEntry::tail) == FLASH_QUADWORD_SIZE, "Tail must hold one quadword");
+static_assert(sizeof(FsDirectory) <= FLASH_PAGE_SIZE - FLASH_WEAR_HEADER_SIZE,
+              "Directory must fit in one wear-leveled page");
+
+FsVolume fsDefaultVolume;
+
+//-----------------------------------------------------------------------------
+//
+// Local Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+static FsOpenFile* fsFile(FsVolume* volume, int fd)
+{
+    if (fd < 0 || fd >= FLASH_FS_MAX_OPEN || !volume->files[fd].inUse) {
+        return nullptr;
+    }
+    return &volume->files[fd];
+}
+
+static int fsFind(FsVolume* volume, const char* name)
+{
+    for (int i = 0; i < FLASH_FS_MAX_FILES; ++i) {
+        const FsEntry& e = volume->dir.entries[i];
+        if (e.firstPage && std::strncmp(e.name, name, FLASH_FS_NAME_LENGTH) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static uint32_t fsDataAddress(FsVolume* volume, const FsEntry& e)
+{
+    return flash_getPageAddress(volume->bank, volume->firstPage + e.firstPage);
+}
+
+// First fit over the data pages; returns the volume relative page or 0
+static uint32_t fsAllocate(FsVolume* volume, uint32_t pages)
+{
+    uint32_t start = FLASH_FS_DIR_PAGES;
+    bool moved = true;
+
+    while (moved && start + pages <= volume->pageCount) {
+        moved = false;
+        for (const FsEntry& e : volume->dir.entries) {
+            if (e.firstPage && start < (uint32_t)e.firstPage + e.pageCount &&
+                e.firstPage < start + pages) {
+                start = e.firstPage + e.pageCount;
+                moved = true;
+            }
+        }
+    }
+    return start + pages <= volume->pageCount ? start : 0;
+}
+
+static int fsErase(FsVolume* volume, FsEntry& e)
+{
+    for (uint32_t i = 0; i < e.pageCount; ++i) {
+        if (flash_pageErase(volume->bank, volume->firstPage + e.firstPage + i) != 0) {
+            return 1;
+        }
+    }
+    e.size = 0;
+    std::memset(e.tail, 0xFF, sizeof(e.tail));
+    volume->dirty = true;
+    return 0;
+}
+
+static bool fsErasedQuadword(const uint8_t* qw)
+{
+    for (uint32_t i = 0; i < FLASH_QUADWORD_SIZE; ++i) {
+        if (qw[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Quadwords programmed after the last directory commit belong to the file,
+// as only whole quadwords of written data are ever programmed. Take them in
+// so the next append does not program them twice. flash_programQuadwords
+// leaves all-0xFF quadwords erased, so what reads erased never was
+// programmed; flash_fsWrite commits the size of a file that ends in them.
+static void fsRecover(FsVolume* volume, FsEntry& e)
+{
+    uint32_t programmedEnd = e.size & ~(FLASH_QUADWORD_SIZE - 1);
+    uint32_t end = e.pageCount * FLASH_PAGE_SIZE;
+    const uint8_t* data = (const uint8_t*)FLASH_MAP(fsDataAddress(volume, e));
+
+    while (end > programmedEnd && fsErasedQuadword(data + end - FLASH_QUADWORD_SIZE)) {
+        end -= FLASH_QUADWORD_SIZE;
+    }
+    if (end > programmedEnd) {
+        e.size = end;
+        std::memset(e.tail, 0xFF, sizeof(e.tail));
+        volume->dirty = true;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+int flash_fsMount_r(FsVolume* volume, uint32_t bank, uint32_t firstPage, uint32_t pageCount)
+{
+    std::memset(volume, 0, sizeof(*volume));
+    if (pageCount <= FLASH_FS_DIR_PAGES || pageCount > 0xFFFF ||
+        flash_wearMount(&volume->dirRegion, bank, firstPage, FLASH_FS_DIR_PAGES) != 0) {
+        return 1;
+    }
+
+    volume->bank = bank;
+    volume->firstPage = firstPage;
+    volume->pageCount = pageCount;
+    volume->dir.magic = FS_DIR_MAGIC;
+
+    size_t size = sizeof(volume->dir);
+    if (flash_wearRead(&volume->dirRegion, (uint8_t*)&volume->dir, size) == 0) {
+        if (size != sizeof(volume->dir) || volume->dir.magic != FS_DIR_MAGIC) {
+            return 1; // Not a directory of this layout
+        }
+        // Drop entries that do not describe an extent of this volume
+        for (FsEntry& e : volume->dir.entries) {
+            if (e.firstPage < FLASH_FS_DIR_PAGES || e.pageCount == 0 ||
+                e.firstPage + e.pageCount > pageCount || e.size > e.pageCount * FLASH_PAGE_SIZE) {
+                std::memset(&e, 0, sizeof(e));
+            }
+            e.name[FLASH_FS_NAME_LENGTH - 1] = '\0';
+        }
+    }
+
+    volume->mounted = true;
+    return 0;
+}
+
+bool flash_fsMounted_r(FsVolume* volume)
+{
+    return volume->mounted;
+}
+
+int flash_fsOpen_r(FsVolume* volume, const char* name, int flags, uint32_t capacity)
+{
+    if (!volume->mounted || !name || !name[0] || std::strlen(name) >= FLASH_FS_NAME_LENGTH) {
+        return -1;
+    }
+
+    int fd = 0;
+    while (fd < FLASH_FS_MAX_OPEN && volume->files[fd].inUse) {
+        ++fd;
+    }
+    if (fd == FLASH_FS_MAX_OPEN) {
+        return -1;
+    }
+
+    int index = fsFind(volume, name);
+    bool created = false;
+    if (index < 0) {
+        if (!(flags & FLASH_FS_CREATE)) {
+            return -1;
+        }
+        uint32_t pages = capacity ? (capacity + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE : 1;
+        uint32_t start = fsAllocate(volume, pages);
+        index = 0;
+        while (index < FLASH_FS_MAX_FILES && volume->dir.entries[index].firstPage) {
+            ++index;
+        }
+        if (start == 0 || index == FLASH_FS_MAX_FILES) {
+            return -1;
+        }
+        FsEntry& e = volume->dir.entries[index];
+        std::strncpy(e.name, name, FLASH_FS_NAME_LENGTH - 1);
+        e.firstPage = (uint16_t)start;
+        e.pageCount = (uint16_t)pages;
+        created = true;
+    }
+
+    FsEntry& e = volume->dir.entries[index];
+    if (flags & FLASH_FS_WRITE) {
+        for (const FsOpenFile& f : volume->files) {
+            if (f.inUse && f.entry == index && (f.flags & FLASH_FS_WRITE)) {
+                return -1; // One writer per file
+            }
+        }
+    }
+
+    if (created || ((flags & FLASH_FS_TRUNCATE) && (flags & FLASH_FS_WRITE))) {
+        if (fsErase(volume, e) != 0) {
+            if (created) {
+                std::memset(&e, 0, sizeof(e));
+            }
+            return -1;
+        }
+        if (flash_fsSync_r(volume) != 0) {
+            return -1;
+        }
+    } else if (flags & FLASH_FS_WRITE) {
+        fsRecover(volume, e);
+    }
+
+    FsOpenFile& f = volume->files[fd];
+    f.inUse = true;
+    f.flags = (uint8_t)flags;
+    f.entry = (uint16_t)index;
+    f.position = 0;
+    return fd;
+}
+
+int flash_fsClose_r(FsVolume* volume, int fd)
+{
+    FsOpenFile* f = fsFile(volume, fd);
+    if (!f) {
+        return -1;
+    }
+    f->inUse = false;
+    return flash_fsSync_r(volume) == 0 ? 0 : -1;
+}
+
+int flash_fsRead_r(FsVolume* volume, int fd, void* data, uint32_t size)
+{
+    FsOpenFile* f = fsFile(volume, fd);
+    if (!f || !(f->flags & FLASH_FS_READ)) {
+        return -1;
+    }
+
+    const FsEntry& e = volume->dir.entries[f->entry];
+    uint32_t programmedEnd = e.size & ~(FLASH_QUADWORD_SIZE - 1);
+    uint8_t* out = (uint8_t*)data;
+    uint32_t done = 0;
+
+    // A truncate under an open reader leaves its position past the end
+    if (f->position >= e.size) {
+        return 0;
+    }
+    if (size > e.size - f->position) {
+        size = e.size - f->position;
+    }
+    if (f->position < programmedEnd) {
+        uint32_t n = programmedEnd - f->position < size ? programmedEnd - f->position : size;
+        std::memcpy(out, (const void*)FLASH_MAP(fsDataAddress(volume, e) + f->position), n);
+        done = n;
+    }
+    if (done < size) {
+        std::memcpy(out + done, e.tail + (f->position + done - programmedEnd), size - done);
+        done = size;
+    }
+    f->position += done;
+    return (int)done;
+}
+
+int flash_fsWrite_r(FsVolume* volume, int fd, const void* data, uint32_t size)
+{
+    FsOpenFile* f = fsFile(volume, fd);
+    if (!f || !(f->flags & FLASH_FS_WRITE)) {
+        return -1;
+    }
+
+    FsEntry& e = volume->dir.entries[f->entry];
+    const uint8_t* in = (const uint8_t*)data;
+    uint32_t capacity = e.pageCount * FLASH_PAGE_SIZE;
+    uint32_t address = fsDataAddress(volume, e);
+    uint32_t programmedStart = e.size & ~(FLASH_QUADWORD_SIZE - 1);
+    uint32_t done = 0;
+
+    if (size > capacity - e.size) {
+        size = capacity - e.size;
+    }
+    while (done < size) {
+        uint32_t fill = e.size % FLASH_QUADWORD_SIZE;
+        uint32_t base = e.size - fill;
+
+        // Whole quadwords straight from the caller when the tail is empty
+        if (fill == 0 && size - done >= FLASH_QUADWORD_SIZE) {
+            uint32_t run = (size - done) & ~(FLASH_QUADWORD_SIZE - 1);
+            if (flash_programQuadwords(address + base, in + done, run) != 0) {
+                return -1;
+            }
+            e.size += run;
+            done += run;
+            continue;
+        }
+
+        uint32_t n = FLASH_QUADWORD_SIZE - fill;
+        if (n > size - done) {
+            n = size - done;
+        }
+        std::memcpy(e.tail + fill, in + done, n);
+        e.size += n;
+        done += n;
+        if (fill + n == FLASH_QUADWORD_SIZE) {
+            if (flash_programQuadwords(address + base, e.tail, FLASH_QUADWORD_SIZE) != 0) {
+                return -1;
+            }
+            std::memset(e.tail, 0xFF, sizeof(e.tail));
+        }
+    }
+
+    volume->dirty = true;
+
+    // Trailing all-0xFF quadwords stay erased, so a remount could not tell
+    // them from free space: commit the size that covers them
+    uint32_t programmedEnd = e.size & ~(FLASH_QUADWORD_SIZE - 1);
+    if (programmedEnd > programmedStart &&
+        fsErasedQuadword((const uint8_t*)FLASH_MAP(address + programmedEnd - FLASH_QUADWORD_SIZE)) &&
+        flash_fsSync_r(volume) != 0) {
+        return -1;
+    }
+    return (int)done;
+}
+
+int32_t flash_fsSeek_r(FsVolume* volume, int fd, int32_t offset, int whence)
+{
+    FsOpenFile* f = fsFile(volume, fd);
+    if (!f) {
+        return -1;
+    }
+
+    int64_t base = 0;
+    if (whence == FLASH_FS_SEEK_CUR) {
+        base = f->position;
+    } else if (whence == FLASH_FS_SEEK_END) {
+        base = volume->dir.entries[f->entry].size;
+    } else if (whence != FLASH_FS_SEEK_SET) {
+        return -1;
+    }
+    int64_t position = base + offset;
+    if (position < 0 || position > volume->dir.entries[f->entry].size) {
+        return -1;
+    }
+    f->position = (uint32_t)position;
+    return (int32_t)position;
+}
+
+int32_t flash_fsSize_r(FsVolume* volume, int fd)
+{
+    FsOpenFile* f = fsFile(volume, fd);
+    return f ? (int32_t)volume->dir.entries[f->entry].size : -1;
+}
+
+int flash_fsRemove_r(FsVolume* volume, const char* name)
+{
+    int index = volume->mounted && name ? fsFind(volume, name) : -1;
+    if (index < 0) {
+        return 1;
+    }
+    for (const FsOpenFile& f : volume->files) {
+        if (f.inUse && f.entry == index) {
+            return 1;
+        }
+    }
+    std::memset(&volume->dir.entries[index], 0, sizeof(FsEntry));
+    volume->dirty = true;
+    return flash_fsSync_r(volume);
+}
+
+int flash_fsSync_r(FsVolume* volume)
+{
+    if (!volume->mounted) {
+        return 1;
+    }
+    if (!volume->dirty) {
+        return 0;
+    }
+    if (flash_wearCommit(&volume->dirRegion, (const uint8_t*)&volume->dir, sizeof(volume->dir)) != 0) {
+        return 1;
+    }
+    volume->dirty = false;
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Default volume
+//-----------------------------------------------------------------------------
+
+int flash_fsMount(uint32_t bank, uint32_t firstPage, uint32_t pageCount)
+{
+    return flash_fsMount_r(&fsDefaultVolume, bank, firstPage, pageCount);
+}
+
+bool flash_fsMounted(void)
+{
+    return flash_fsMounted_r(&fsDefaultVolume);
+}
+
+int flash_fsOpen(const char* name, int flags, uint32_t capacity)
+{
+    return flash_fsOpen_r(&fsDefaultVolume, name, flags, capacity);
+}
+
+int flash_fsClose(int fd)
+{
+    return flash_fsClose_r(&fsDefaultVolume, fd);
+}
+
+int flash_fsRead(int fd, void* data, uint32_t size)
+{
+    return flash_fsRead_r(&fsDefaultVolume, fd, data, size);
+}
+
+int flash_fsWrite(int fd, const void* data, uint32_t size)
+{
+    return flash_fsWrite_r(&fsDefaultVolume, fd, data, size);
+}
+
+int32_t flash_fsSeek(int fd, int32_t offset, int whence)
+{
+    return flash_fsSeek_r(&fsDefaultVolume, fd, offset, whence);
+}
+
+int32_t flash_fsSize(int fd)
+{
+    return flash_fsSize_r(&fsDefaultVolume, fd);
+}
+
+int flash_fsRemove(const char* name)
+{
+    return flash_fsRemove_r(&fsDefaultVolume, name);
+}
+
+int flash_fsSync(void)
+{
+    return flash_fsSync_r(&fsDefaultVolume);
+}
@@ -0,0 +1,32 @@
+/*
+ * flash_log.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "flash_log.h"
+#include <cstring>
+
+STORAGE_THREAD_LOCAL FlashLogRing flashLog = {FLASH_LOG_MAGIC, FLASH_LOG_SIZE - 1, 0, 0, flashLogTableId(), {}};
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+void flash_logStart(void)
+{
+#if FLASH_LOG_ENABLE
+    if (flashLog.cyclesPerSecond == 0) {
+        flashLog.cyclesPerSecond = storageStatsCyclesPerSecond();
+    }
+#endif
+}
+
+void flash_logClear(void)
+{
+    std::memset(flashLog.entries, 0, sizeof(flashLog.entries));
+    flashLog.head = 0;
+}
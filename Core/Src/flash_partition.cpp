@@ -0,0 +1,69 @@
+/*
+ * flash_partition.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "flash_partition.h"
+#include "flash_program.h"
+#include "flash_digest.h"
+
+// Mounted wear regions of the ROTATE partitions
+STORAGE_THREAD_LOCAL static FlashWearRegion partitionRegions[FLASH_PARTITION_COUNT];
+STORAGE_THREAD_LOCAL static bool partitionMounted[FLASH_PARTITION_COUNT];
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+FlashPartitionId flash_partitionOf(uint32_t address)
+{
+    int i = 0;
+    while (i < FLASH_PARTITION_COUNT &&
+           (address < flashPartitions[i].address ||
+            address - flashPartitions[i].address >= flashPartitions[i].size)) {
+        ++i;
+    }
+    return (FlashPartitionId)i;
+}
+
+FlashWearRegion* flash_partitionRegion(FlashPartitionId id)
+{
+    if ((unsigned)id >= FLASH_PARTITION_COUNT || flashPartitions[id].policy != FLASH_POLICY_ROTATE) {
+        return nullptr;
+    }
+    if (!partitionMounted[id]) {
+        const FlashPartition& p = flashPartitions[id];
+        if (flash_wearMount(&partitionRegions[id], p.bank, p.firstPage, p.pageCount) != 0) {
+            return nullptr;
+        }
+        partitionMounted[id] = true;
+    }
+    return &partitionRegions[id];
+}
+
+void flash_partitionForget(void)
+{
+    for (int i = 0; i < FLASH_PARTITION_COUNT; ++i) {
+        partitionMounted[i] = false;
+    }
+    flash_digestForget();
+}
+
+int flash_partitionErase(FlashPartitionId id)
+{
+    if ((unsigned)id >= FLASH_PARTITION_COUNT || flashPartitions[id].policy == FLASH_POLICY_READONLY) {
+        return 1;
+    }
+    const FlashPartition& p = flashPartitions[id];
+    partitionMounted[id] = false;
+    for (uint32_t i = 0; i < p.pageCount; ++i) {
+        if (flash_pageErase(p.bank, p.firstPage + i) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -12,12 +12,179 @@
 #include "main.h"
 #include <string>
 #include "util.h"
-#include <iostream>
-#include "debug.h"  // Ensure this file contains the declaration of debug_msg
 #include <stdio.h>
 #include <cstring> // For std::memcpy
 #include <vector>
 #include "stm32u5xx_hal.h"
+#include "storage_stats.h"
+#include "flash_trace.h"
+#include "flash_log.h"
+#include "flash_digest.h"
+
+// The host shim tells the simulator while the RAM routines run
+#ifndef FLASH_RAM_EXEC
+#define FLASH_RAM_EXEC(running)
+#endif
+
+STORAGE_THREAD_LOCAL static bool ramProgramming = true;
+
+//-----------------------------------------------------------------------------
+// Erase and program routines for the bank executing code. On target they
+// drive the controller registers directly: nothing they call may live in
+// flash, and interrupts stay masked because the vector table and handlers
+// do. Both wait for the operation to end before returning to flash code.
+//-----------------------------------------------------------------------------
+
+#ifdef FLASH_NSCR_PER
+
+#define FLASH_RAM_ERRORS (FLASH_NSSR_OPERR | FLASH_NSSR_PROGERR | FLASH_NSSR_WRPERR | \
+                          FLASH_NSSR_PGAERR | FLASH_NSSR_SIZERR | FLASH_NSSR_PGSERR)
+
+FLASH_RAMFUNC static HAL_StatusTypeDef flashRamWait(void)
+{
+    while (FLASH->NSSR & (FLASH_NSSR_BSY | FLASH_NSSR_WDW)) {
+    }
+    uint32_t errors = FLASH->NSSR & FLASH_RAM_ERRORS;
+    FLASH->NSSR = errors | FLASH_NSSR_EOP;  // Write 1 to clear
+    return errors ? HAL_ERROR : HAL_OK;
+}
+
+FLASH_RAMFUNC static HAL_StatusTypeDef flashRamErase(uint32_t bank, uint32_t page)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    flashRamWait();
+    FLASH->NSCR = FLASH_NSCR_PER | (page << FLASH_NSCR_PNB_Pos) | (bank == FLASH_BANK_2 ? FLASH_NSCR_BKER : 0);
+    FLASH->NSCR |= FLASH_NSCR_STRT;
+    HAL_StatusTypeDef status = flashRamWait();
+    FLASH->NSCR &= ~(FLASH_NSCR_PER | FLASH_NSCR_PNB | FLASH_NSCR_BKER);
+    __set_PRIMASK(primask);
+    return status;
+}
+
+FLASH_RAMFUNC static HAL_StatusTypeDef flashRamProgram(uint32_t address, const uint32_t* word)
+{
+    __IO uint32_t* dest = (__IO uint32_t*)address;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    flashRamWait();
+    FLASH->NSCR |= FLASH_NSCR_PG;
+    dest[0] = word[0];
+    dest[1] = word[1];
+    dest[2] = word[2];
+    dest[3] = word[3];
+    HAL_StatusTypeDef status = flashRamWait();
+    FLASH->NSCR &= ~FLASH_NSCR_PG;
+    __set_PRIMASK(primask);
+    return status;
+}
+
+#else // Host shim: the simulator accounts the time as spent running from RAM
+
+static HAL_StatusTypeDef flashRamErase(uint32_t bank, uint32_t page)
+{
+    uint32_t PageError;
+    FLASH_EraseInitTypeDef EraseInitStruct;
+
+    EraseInitStruct.TypeErase = FLASH_TYPEERASE_PAGES;
+    EraseInitStruct.Banks = bank;
+    EraseInitStruct.Page = page;
+    EraseInitStruct.NbPages = 1;
+    FLASH_RAM_EXEC(true);
+    HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&EraseInitStruct, &PageError);
+    FLASH_RAM_EXEC(false);
+    return status;
+}
+
+static HAL_StatusTypeDef flashRamProgram(uint32_t address, const uint32_t* word)
+{
+    FLASH_RAM_EXEC(true);
+    HAL_StatusTypeDef status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_QUADWORD, address, (uintptr_t)word);
+    FLASH_RAM_EXEC(false);
+    return status;
+}
+
+#endif
+
+// Operations on the bank executing code take the RAM routines
+static bool flashFromRam(uint32_t bank)
+{
+    return ramProgramming && bank == flash_codeBank();
+}
+
+//-----------------------------------------------------------------------------
+// Traced wrappers of the HAL calls shared by the programming paths
+//-----------------------------------------------------------------------------
+
+static HAL_StatusTypeDef flashUnlock(void)
+{
+    HAL_StatusTypeDef status = HAL_FLASH_Unlock();
+    flash_trace(FLASH_TRACE_UNLOCK, status);
+    if (status != HAL_OK) {
+        flash_log(FLASH_LOG_UNLOCK_FAILED, status);
+    }
+    return status;
+}
+
+static HAL_StatusTypeDef flashLock(void)
+{
+    HAL_StatusTypeDef status = HAL_FLASH_Lock();
+    flash_trace(FLASH_TRACE_LOCK, status);
+    return status;
+}
+
+static HAL_StatusTypeDef flashErasePage(uint32_t bank, uint32_t page)
+{
+    uint32_t PageError;
+    FLASH_EraseInitTypeDef EraseInitStruct;
+
+    EraseInitStruct.TypeErase = FLASH_TYPEERASE_PAGES;
+    EraseInitStruct.Banks = bank;
+    EraseInitStruct.Page = page;
+    EraseInitStruct.NbPages = 1;
+    HAL_StatusTypeDef status = flashFromRam(bank) ? flashRamErase(bank, page)
+                                                  : HAL_FLASHEx_Erase(&EraseInitStruct, &PageError);
+    flash_trace(FLASH_TRACE_ERASE, (bank << 8) | page | (status != HAL_OK ? FLASH_TRACE_ERROR : 0));
+    if (status == HAL_OK) {
+        storageCounters.pagesErased++;
+    } else {
+        flash_log(FLASH_LOG_ERASE_FAILED, bank, page, status);
+    }
+    return status;
+}
+
+static HAL_StatusTypeDef flashProgramQuadword(uint32_t address, uint32_t *word)
+{
+    uint32_t quadword = (address - FLASH_BASE) / FLASH_QUADWORD_SIZE;
+    uint32_t bank = (address - FLASH_BASE) / FLASH_BANK_SIZE + 1;
+    // Pass the data pointer as uintptr_t so it survives 64-bit host builds
+    HAL_StatusTypeDef status = flashFromRam(bank) ? flashRamProgram(address, word)
+        : HAL_FLASH_Program(FLASH_TYPEPROGRAM_QUADWORD, address, (uintptr_t)word);
+    if (status == HAL_OK) {
+        flash_trace(FLASH_TRACE_PROGRAM, quadword);
+        storageCounters.quadwordsProgrammed++;
+    } else {
+        flash_trace(FLASH_TRACE_PROGRAM, quadword | FLASH_TRACE_ERROR);
+        flash_log(FLASH_LOG_PROGRAM_FAILED, address, status);
+    }
+    return status;
+}
+
+// State of the background erase started by flash_pageEraseStart, updated
+// from the flash interrupt
+#define ERASE_IDLE    0
+#define ERASE_BUSY    1
+#define ERASE_DONE    2
+#define ERASE_FAILED  3
+
+STORAGE_THREAD_LOCAL static volatile uint32_t eraseState = ERASE_IDLE;
+STORAGE_THREAD_LOCAL static uint32_t eraseBank;
+STORAGE_THREAD_LOCAL static uint32_t erasePage;
+
+static void flashTraceVerify(uint32_t mismatch)
+{
+    flash_trace(FLASH_TRACE_VERIFY, mismatch ? FLASH_TRACE_ERROR : 0);
+}
 
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -39,21 +206,25 @@ void findPageAndBank(uint32_t address, uint32_t *bank, uint32_t *page)
     *page = ((address - FLASH_BASE) % FLASH_BANK_SIZE) / FLASH_PAGE_SIZE;
 }
 
-extern "C" {
-int flash_pageEraseWriteVerify(uint32_t *data, uint32_t size, uint32_t addr)
+//-----------------------------------------------------------------------------
+// Erase page of bank and program data from its start, unless the page already
+// holds data. address is that of the page; partitions pass it as a constant so
+// no address arithmetic runs on the commit path.
+//-----------------------------------------------------------------------------
+
+int flash_pageEraseWriteVerifyPage(uint32_t *data, uint32_t size, uint32_t bank, uint32_t page,
+                                   uint32_t address)
 {
-    uint32_t PageError;
-    uint32_t iter;
     uint32_t word[4] = { 0, 0, 0, 0 };
-    uint32_t address;
+    uint32_t pageAddress = address;
     uint32_t written;
-    FLASH_EraseInitTypeDef EraseInitStruct;
-    uint32_t associatedBank, associatedPage;
-
-    // Find the page and bank based on the provided address
-    findPageAndBank(addr, &associatedBank, &associatedPage);
+    uint32_t chunk;
 
-    address = flash_getPageAddress(associatedBank, associatedPage);
+    // Nothing to do if the page already holds this image
+    if (flash_checkProgram(pageAddress, size, (uint8_t*) data) == 0) {
+        storageCounters.skippedCommits++;
+        return 0;
+    }
 
 //    // Disable instruction cache
 //    if (HAL_ICACHE_Disable() != HAL_OK) {
@@ -61,41 +232,38 @@ int flash_pageEraseWriteVerify(uint32_t *data, uint32_t size, uint32_t addr)
 //    }
 
     // Unlock flash
-    if (HAL_FLASH_Unlock() != HAL_OK) {
+    if (flashUnlock() != HAL_OK) {
         return 1;
     }
 
     // Erase the page
-    EraseInitStruct.TypeErase = FLASH_TYPEERASE_PAGES;
-    EraseInitStruct.Banks = associatedBank;
-    EraseInitStruct.Page = associatedPage;
-    EraseInitStruct.NbPages = 1;
-    if (HAL_FLASHEx_Erase(&EraseInitStruct, &PageError) != HAL_OK) {
-        HAL_FLASH_Lock();
+    if (flashErasePage(bank, page) != HAL_OK) {
+        flashLock();
         return 1;
     }
 
     // Program the page 1 quadword at a time
-    iter = 0;
     written = 0;
     while (written < size) {
-        // Build the quad word
-        word[0] = data[iter + 0];
-        word[1] = data[iter + 1];
-        word[2] = data[iter + 2];
-        word[3] = data[iter + 3];
+        // Build the quad word, padding a final partial one with the erased
+        // value instead of reading past the end of data
+        chunk = size - written;
+        if (chunk > FLASH_QUADWORD_SIZE) {
+            chunk = FLASH_QUADWORD_SIZE;
+        }
+        std::memset(word, 0xFF, sizeof(word));
+        std::memcpy(word, (const uint8_t*) data + written, chunk);
 
         // Write the quad word
-        flash_write(address, (uint32_t) word, 0);
+        flash_write(address, word, 0);
 
         // Increment the trackers
-        iter += 4; // 4 words written
-        address += (4 * sizeof(uint32_t)); // 16 bytes written
-        written += (4 * sizeof(uint32_t)); // 16 bytes written
+        address += FLASH_QUADWORD_SIZE;
+        written += chunk;
     }
 
     // Lock the flash
-    if (HAL_FLASH_Lock() != HAL_OK) {
+    if (flashLock() != HAL_OK) {
         return 1;
     }
 
@@ -105,22 +273,217 @@ int flash_pageEraseWriteVerify(uint32_t *data, uint32_t size, uint32_t addr)
 //    }
 
     // Verify the data in the page
-    address = flash_getPageAddress(associatedBank, associatedPage);
-    if (flash_checkProgram(address, size, (uint8_t*) data)) {
+    uint32_t mismatch = flash_checkProgram(pageAddress, size, (uint8_t*) data);
+    flashTraceVerify(mismatch);
+    if (mismatch) {
+        storageCounters.verifyFailures++;
+        flash_log(FLASH_LOG_VERIFY_FAILED, pageAddress, size);
         return 1; // Verification failed
     }
-    return 0; // Success
+    // Keep the boot validation digest of an fwimage page current
+    return flash_digestRecordPage(pageAddress);
+}
+
+extern "C" {
+int flash_pageEraseWriteVerify(uint32_t *data, uint32_t size, uint32_t addr)
+{
+    uint32_t associatedBank, associatedPage;
+
+    // Find the page and bank based on the provided address
+    findPageAndBank(addr, &associatedBank, &associatedPage);
+
+    return flash_pageEraseWriteVerifyPage(data, size, associatedBank, associatedPage,
+                                          flash_getPageAddress(associatedBank, associatedPage));
 }
 }
 
 //-----------------------------------------------------------------------------
+// Bank the CPU fetches instructions from, taken from the address of this
+// function like findPageAndBank. The host shim supplies the simulated one.
 //-----------------------------------------------------------------------------
 
-uint32_t flash_write(uint32_t StartSectorAddress, uint32_t word, uint16_t numberofwords)
+uint32_t flash_codeBank(void)
 {
-    if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_QUADWORD, StartSectorAddress, (uint32_t)word) == HAL_OK) {
-        StartSectorAddress += 16; // Move to the next quadword
+#ifdef FLASH_CODE_BANK
+    return FLASH_CODE_BANK();
+#else
+    return ((uint32_t)(uintptr_t)&flash_codeBank - FLASH_BASE) / FLASH_BANK_SIZE + 1;
+#endif
+}
+
+void flash_setRamProgramming(bool enable)
+{
+    ramProgramming = enable;
+}
+
+bool flash_getRamProgramming(void)
+{
+    return ramProgramming;
+}
+
+//-----------------------------------------------------------------------------
+// Erase a single page, leaving the flash locked afterwards
+//-----------------------------------------------------------------------------
+
+int flash_pageErase(uint32_t bank, uint32_t page)
+{
+    if (flashUnlock() != HAL_OK) {
+        return 1;
+    }
+
+    if (flashErasePage(bank, page) != HAL_OK) {
+        flashLock();
+        return 1;
+    }
+
+    if (flashLock() != HAL_OK) {
+        return 1;
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Background page erase. The erase runs from HAL_FLASHEx_Erase_IT while the
+// caller keeps working from RAM; the flash interrupt (FLASH_IRQn enabled in
+// the NVIC, HAL_FLASH_IRQHandler in FLASH_IRQHandler) reports completion.
+// Flash reads of the same bank stall until it is done.
+//-----------------------------------------------------------------------------
+
+int flash_pageEraseStart(uint32_t bank, uint32_t page)
+{
+    FLASH_EraseInitTypeDef EraseInitStruct;
+
+    if (eraseState != ERASE_IDLE || flashUnlock() != HAL_OK) {
+        return 1;
+    }
+
+    eraseBank = bank;
+    erasePage = page;
+
+    // Code could not run beside an erase of its own bank, so that one
+    // completes from RAM before returning
+    if (flashFromRam(bank)) {
+        eraseState = flashRamErase(bank, page) == HAL_OK ? ERASE_DONE : ERASE_FAILED;
+        return 0;
+    }
+
+    eraseState = ERASE_BUSY;
+    EraseInitStruct.TypeErase = FLASH_TYPEERASE_PAGES;
+    EraseInitStruct.Banks = bank;
+    EraseInitStruct.Page = page;
+    EraseInitStruct.NbPages = 1;
+    if (HAL_FLASHEx_Erase_IT(&EraseInitStruct) != HAL_OK) {
+        eraseState = ERASE_IDLE;
+        flash_trace(FLASH_TRACE_ERASE, (bank << 8) | page | FLASH_TRACE_ERROR);
+        flash_log(FLASH_LOG_ERASE_FAILED, bank, page, HAL_ERROR);
+        flashLock();
+        return 1;
+    }
+    return 0;
+}
+
+bool flash_eraseBusy(void)
+{
+    return eraseState == ERASE_BUSY;
+}
+
+// Wait for the background erase if it is still running and lock the flash
+int flash_eraseFinish(void)
+{
+    if (eraseState == ERASE_IDLE) {
+        return 1; // Nothing was started
+    }
+    FLASH_WaitForLastOperation(FLASH_TIMEOUT_VALUE);
+    while (eraseState == ERASE_BUSY) {
+        // End of operation interrupt pending
+    }
+
+    bool failed = eraseState == ERASE_FAILED;
+    eraseState = ERASE_IDLE;
+    flash_trace(FLASH_TRACE_ERASE, (eraseBank << 8) | erasePage | (failed ? FLASH_TRACE_ERROR : 0));
+    if (!failed) {
+        storageCounters.pagesErased++;
     } else {
+        flash_log(FLASH_LOG_ERASE_FAILED, eraseBank, erasePage, HAL_ERROR);
+    }
+    if (flashLock() != HAL_OK || failed) {
+        return 1;
+    }
+    return 0;
+}
+
+extern "C" {
+void HAL_FLASH_EndOfOperationCallback(uint32_t ReturnValue)
+{
+    (void)ReturnValue;
+    if (eraseState == ERASE_BUSY) {
+        eraseState = ERASE_DONE;
+    }
+}
+
+void HAL_FLASH_OperationErrorCallback(uint32_t ReturnValue)
+{
+    (void)ReturnValue;
+    if (eraseState == ERASE_BUSY) {
+        eraseState = ERASE_FAILED;
+    }
+}
+}
+
+//-----------------------------------------------------------------------------
+// Program size bytes at a quadword aligned address of an erased area. The
+// final partial quadword is padded with the erased value so nothing is read
+// past the end of data. Quadwords of nothing but the erased value are left
+// unprogrammed: they read the same, and an area that reads erased can then
+// always be programmed. A failed quadword locks the flash again and returns
+// 1. Does not verify.
+//-----------------------------------------------------------------------------
+
+int flash_programQuadwords(uint32_t address, const uint8_t *data, uint32_t size)
+{
+    uint32_t word[4];
+    uint32_t written;
+    uint32_t chunk;
+
+    if (address % FLASH_QUADWORD_SIZE) {
+        return 1;
+    }
+
+    if (flashUnlock() != HAL_OK) {
+        return 1;
+    }
+
+    written = 0;
+    while (written < size) {
+        chunk = size - written;
+        if (chunk > FLASH_QUADWORD_SIZE) {
+            chunk = FLASH_QUADWORD_SIZE;
+        }
+        std::memset(word, 0xFF, sizeof(word));
+        std::memcpy(word, data + written, chunk);
+
+        if ((word[0] & word[1] & word[2] & word[3]) != 0xFFFFFFFFU &&
+            flashProgramQuadword(address, word) != HAL_OK) {
+            flashLock();
+            return 1;
+        }
+
+        address += FLASH_QUADWORD_SIZE;
+        written += chunk;
+    }
+
+    if (flashLock() != HAL_OK) {
+        return 1;
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+uint32_t flash_write(uint32_t StartSectorAddress, uint32_t *word, uint16_t numberofwords)
+{
+    if (flashProgramQuadword(StartSectorAddress, word) != HAL_OK) {
         while (1) {
             Error_Handler(); // Handle error appropriately
         }
@@ -135,11 +498,10 @@ uint32_t flash_write(uint32_t StartSectorAddress, uint32_t word, uint16_t number
 int flash_read(uint32_t StartSectorAddress, uint32_t *RxBuf, uint16_t numberofwords)
 {
     uint32_t start = numberofwords;
-    while (1) {
-        RxBuf[start - numberofwords] = *(__IO uint32_t*)StartSectorAddress;
+    while (numberofwords) {
+        RxBuf[start - numberofwords] = *(__IO uint32_t*)FLASH_MAP(StartSectorAddress);
         StartSectorAddress += 4; // Move to the next word
-        if (!(numberofwords--))
-            break;
+        numberofwords--;
     }
 
     return 0; // Success
@@ -150,7 +512,7 @@ int flash_read(uint32_t StartSectorAddress, uint32_t *RxBuf, uint16_t numberofwo
 
 uint32_t flash_checkProgram(uint32_t StartAddress, uint32_t len, uint8_t *data)
 {
-    return util_memcmp((uint8_t*)StartAddress, data, len);
+    return util_memcmp((uint8_t*)FLASH_MAP(StartAddress), data, len);
 }
 
 
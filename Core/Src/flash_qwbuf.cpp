@@ -0,0 +1,165 @@
+/*
+ * flash_qwbuf.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "flash_qwbuf.h"
+#include "flash_program.h"
+#include <cstring>
+
+static_assert(sizeof(FlashQwSlot::data) == FLASH_QUADWORD_SIZE, "Slot must hold one quadword");
+
+//-----------------------------------------------------------------------------
+//
+// Local Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+// A quadword can only be programmed once after erase. One that reads erased
+// never was: flash_programQuadwords leaves all-0xFF quadwords unprogrammed
+static bool qwbufErased(uint32_t address)
+{
+    const uint8_t* flash = (const uint8_t*)FLASH_MAP(address);
+    for (uint32_t i = 0; i < FLASH_QUADWORD_SIZE; ++i) {
+        if (flash[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int qwbufProgram(FlashQwBuffer* buf, FlashQwSlot* slot)
+{
+    uint32_t address = slot->address;
+
+    if (slot->filled != 0xFFFF) {
+        buf->padded++;
+    }
+    buf->programmed++;
+    slot->address = FLASH_QWBUF_FREE;
+    return flash_programQuadwords(address, slot->data, FLASH_QUADWORD_SIZE);
+}
+
+static FlashQwSlot* qwbufFind(FlashQwBuffer* buf, uint32_t address)
+{
+    for (FlashQwSlot& slot : buf->slots) {
+        if (slot.address == address) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+// Start buffering the quadword at address, flushing the oldest slot if all
+// are in use
+static FlashQwSlot* qwbufAllocate(FlashQwBuffer* buf, uint32_t address)
+{
+    FlashQwSlot* slot = &buf->slots[0];
+
+    if (!qwbufErased(address)) {
+        return nullptr;
+    }
+    for (FlashQwSlot& s : buf->slots) {
+        if (s.address == FLASH_QWBUF_FREE) {
+            slot = &s;
+            break;
+        }
+        if (s.age < slot->age) {
+            slot = &s;
+        }
+    }
+    if (slot->address != FLASH_QWBUF_FREE && qwbufProgram(buf, slot) != 0) {
+        return nullptr;
+    }
+
+    slot->address = address;
+    slot->filled = 0;
+    std::memset(slot->data, 0xFF, sizeof(slot->data));
+    return slot;
+}
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+void flash_qwbufInit(FlashQwBuffer* buf)
+{
+    std::memset(buf, 0, sizeof(*buf));
+    for (FlashQwSlot& slot : buf->slots) {
+        slot.address = FLASH_QWBUF_FREE;
+    }
+}
+
+int flash_qwbufWrite(FlashQwBuffer* buf, uint32_t address, const void* data, uint32_t size)
+{
+    const uint8_t* in = (const uint8_t*)data;
+
+    while (size) {
+        uint32_t base = address & ~(FLASH_QUADWORD_SIZE - 1);
+        uint32_t offset = address - base;
+        FlashQwSlot* slot = qwbufFind(buf, base);
+
+        // Whole quadwords nobody is buffering go straight to flash
+        if (!slot && offset == 0 && size >= FLASH_QUADWORD_SIZE) {
+            uint32_t run = 0;
+            while (run + FLASH_QUADWORD_SIZE <= size && !qwbufFind(buf, base + run)) {
+                if (!qwbufErased(base + run)) {
+                    return 1;
+                }
+                run += FLASH_QUADWORD_SIZE;
+            }
+            if (flash_programQuadwords(base, in, run) != 0) {
+                return 1;
+            }
+            buf->programmed += run / FLASH_QUADWORD_SIZE;
+            address += run;
+            in += run;
+            size -= run;
+            continue;
+        }
+
+        if (!slot && (slot = qwbufAllocate(buf, base)) == nullptr) {
+            return 1;
+        }
+        uint32_t n = FLASH_QUADWORD_SIZE - offset;
+        if (n > size) {
+            n = size;
+        }
+        std::memcpy(slot->data + offset, in, n);
+        slot->filled |= (uint16_t)(((1U << n) - 1) << offset);
+        slot->age = ++buf->clock;
+        if (slot->filled == 0xFFFF && qwbufProgram(buf, slot) != 0) {
+            return 1;
+        }
+        address += n;
+        in += n;
+        size -= n;
+    }
+    return 0;
+}
+
+int flash_qwbufFlush(FlashQwBuffer* buf)
+{
+    int result = 0;
+    for (FlashQwSlot& slot : buf->slots) {
+        if (slot.address != FLASH_QWBUF_FREE && qwbufProgram(buf, &slot) != 0) {
+            result = 1;
+        }
+    }
+    return result;
+}
+
+uint32_t flash_qwbufPending(const FlashQwBuffer* buf)
+{
+    uint32_t pending = 0;
+    for (const FlashQwSlot& slot : buf->slots) {
+        if (slot.address != FLASH_QWBUF_FREE) {
+            pending += __builtin_popcount(slot.filled);
+        }
+    }
+    return pending;
+}
@@ -0,0 +1,42 @@
+/*
+ * flash_trace.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "flash_trace.h"
+#include "flash_log.h"
+#include <cstring>
+
+STORAGE_THREAD_LOCAL FlashTraceRing flashTrace = {FLASH_TRACE_MAGIC, FLASH_TRACE_SIZE - 1, 0, 0, {}};
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+// Store operations also record the timestamp unit, which is only known at
+// run time on target
+void flash_traceBegin(uint32_t op)
+{
+#if FLASH_TRACE_ENABLE
+    if (flashTrace.cyclesPerSecond == 0) {
+        flashTrace.cyclesPerSecond = storageStatsCyclesPerSecond();
+    }
+#endif
+    flash_logStart();
+    flash_trace(FLASH_TRACE_STORE_BEGIN, op);
+}
+
+void flash_traceEnd(uint32_t op, int result)
+{
+    flash_trace(FLASH_TRACE_STORE_END, op | (result ? FLASH_TRACE_ERROR : 0));
+}
+
+void flash_traceClear(void)
+{
+    std::memset(flashTrace.events, 0, sizeof(flashTrace.events));
+    flashTrace.head = 0;
+}
@@ -0,0 +1,251 @@
+/*
+ * flash_wear.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "flash_wear.h"
+#include "flash_program.h"
+#include "util.h"
+#include "storage_stats.h"
+#include "flash_trace.h"
+#include "flash_log.h"
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+//
+// Local Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define WEAR_COMMIT_MAGIC  0x57434D31U  // "WCM1"
+#define WEAR_ERASE_MAGIC   0x57455231U  // "WER1"
+
+//-----------------------------------------------------------------------------
+//
+// Local Datatypes
+//
+//-----------------------------------------------------------------------------
+
+// First quadword of a page, programmed after the payload
+struct WearCommitHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t length;
+    uint32_t crc;
+};
+
+// Second quadword of a page, programmed right after the erase
+struct WearEraseRecord {
+    uint32_t magic;
+    uint32_t eraseCount;
+    uint32_t eraseCountInv;
+    uint32_t reserved;
+};
+
+//-----------------------------------------------------------------------------
+//
+// Local Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+static uint32_t wearPageAddress(const FlashWearRegion* region, uint32_t index)
+{
+    return flash_getPageAddress(region->bank, region->firstPage + index);
+}
+
+// Serial number comparison so the sequence may wrap
+static bool wearNewer(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) > 0;
+}
+
+static bool wearPayloadValid(uint32_t address, const WearCommitHeader* header)
+{
+    const uint8_t* payload = (const uint8_t*)FLASH_MAP(address + FLASH_WEAR_HEADER_SIZE);
+    return util_crc32(0, payload, header->length) == header->crc;
+}
+
+// A commit that failed part way; the region still has the previous one
+static int wearCommitFailed(const FlashWearRegion* region, uint32_t target, uint32_t size)
+{
+    flash_log(FLASH_LOG_WEAR_COMMIT_FAILED, region->bank, region->firstPage + target, region->sequence + 1, size);
+    return 1;
+}
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+int flash_wearMount(FlashWearRegion* region, uint32_t bank, uint32_t firstPage, uint32_t pageCount)
+{
+    WearCommitHeader headers[FLASH_WEAR_MAX_PAGES];
+    bool candidate[FLASH_WEAR_MAX_PAGES];
+
+    if (!region || pageCount == 0 || pageCount > FLASH_WEAR_MAX_PAGES) {
+        return 1;
+    }
+
+    region->bank = bank;
+    region->firstPage = firstPage;
+    region->pageCount = pageCount;
+    region->newestIndex = FLASH_WEAR_NONE;
+    region->sequence = 0;
+    region->length = 0;
+
+    // Only the two header quadwords of each page are read here
+    for (uint32_t i = 0; i < pageCount; ++i) {
+        uint32_t address = wearPageAddress(region, i);
+        WearEraseRecord record;
+        std::memcpy(&headers[i], (const void*)FLASH_MAP(address), sizeof(WearCommitHeader));
+        std::memcpy(&record, (const void*)FLASH_MAP(address + FLASH_QUADWORD_SIZE), sizeof(record));
+
+        candidate[i] = headers[i].magic == WEAR_COMMIT_MAGIC &&
+                       headers[i].length <= flash_wearCapacity();
+        region->eraseCount[i] = 0;
+        if (record.magic == WEAR_ERASE_MAGIC && record.eraseCount == ~record.eraseCountInv) {
+            region->eraseCount[i] = record.eraseCount;
+        }
+    }
+
+    // Take the newest header whose payload checks out, falling back to older
+    // commits if the newest one was torn or corrupted
+    while (true) {
+        uint32_t best = FLASH_WEAR_NONE;
+        for (uint32_t i = 0; i < pageCount; ++i) {
+            if (candidate[i] && (best == FLASH_WEAR_NONE ||
+                                 wearNewer(headers[i].sequence, headers[best].sequence))) {
+                best = i;
+            }
+        }
+        if (best == FLASH_WEAR_NONE) {
+            return 0; // Empty region
+        }
+        if (wearPayloadValid(wearPageAddress(region, best), &headers[best])) {
+            region->newestIndex = best;
+            region->sequence = headers[best].sequence;
+            region->length = headers[best].length;
+            return 0;
+        }
+        flash_log(FLASH_LOG_WEAR_COMMIT_INVALID, bank, firstPage + best, headers[best].sequence);
+        candidate[best] = false;
+    }
+}
+
+int flash_wearCommit(FlashWearRegion* region, const uint8_t* data, uint32_t size)
+{
+    uint32_t target;
+    uint32_t address;
+    WearEraseRecord record;
+    WearCommitHeader header;
+
+    if (!region || region->pageCount == 0 || size > flash_wearCapacity()) {
+        return 1;
+    }
+
+    // An identical newest commit needs no new page
+    if (region->newestIndex != FLASH_WEAR_NONE && region->length == size &&
+        flash_checkProgram(wearPageAddress(region, region->newestIndex) + FLASH_WEAR_HEADER_SIZE,
+                           size, (uint8_t*)data) == 0) {
+        storageCounters.skippedCommits++;
+        return 0;
+    }
+
+    target = 0;
+    if (region->newestIndex != FLASH_WEAR_NONE) {
+        target = (region->newestIndex + 1) % region->pageCount;
+    }
+    address = wearPageAddress(region, target);
+
+    if (flash_pageErase(region->bank, region->firstPage + target) != 0) {
+        return wearCommitFailed(region, target, size);
+    }
+    region->eraseCount[target]++;
+
+    record.magic = WEAR_ERASE_MAGIC;
+    record.eraseCount = region->eraseCount[target];
+    record.eraseCountInv = ~region->eraseCount[target];
+    record.reserved = 0xFFFFFFFFU;
+    if (flash_programQuadwords(address + FLASH_QUADWORD_SIZE, (const uint8_t*)&record, sizeof(record)) != 0) {
+        return wearCommitFailed(region, target, size);
+    }
+
+    if (flash_programQuadwords(address + FLASH_WEAR_HEADER_SIZE, data, size) != 0) {
+        return wearCommitFailed(region, target, size);
+    }
+
+    header.magic = WEAR_COMMIT_MAGIC;
+    header.sequence = region->sequence + 1;
+    header.length = size;
+    header.crc = util_crc32(0, data, size);
+    if (flash_programQuadwords(address, (const uint8_t*)&header, sizeof(header)) != 0) {
+        return wearCommitFailed(region, target, size);
+    }
+
+    // Verify both the payload and the header before switching over
+    uint32_t mismatch = flash_checkProgram(address + FLASH_WEAR_HEADER_SIZE, size, (uint8_t*)data) ||
+                        flash_checkProgram(address, sizeof(header), (uint8_t*)&header);
+    flash_trace(FLASH_TRACE_VERIFY, mismatch ? FLASH_TRACE_ERROR : 0);
+    if (mismatch) {
+        storageCounters.verifyFailures++;
+        return wearCommitFailed(region, target, size);
+    }
+
+    region->newestIndex = target;
+    region->sequence = header.sequence;
+    region->length = size;
+    return 0;
+}
+
+int flash_wearRead(const FlashWearRegion* region, uint8_t* data, size_t& size)
+{
+    if (!region || region->newestIndex == FLASH_WEAR_NONE || region->length > size) {
+        return 1;
+    }
+
+    uint32_t address = wearPageAddress(region, region->newestIndex) + FLASH_WEAR_HEADER_SIZE;
+    std::memcpy(data, (const void*)FLASH_MAP(address), region->length);
+    size = region->length;
+    return 0;
+}
+
+uint32_t flash_wearPayloadAddress(const FlashWearRegion* region)
+{
+    if (!region || region->newestIndex == FLASH_WEAR_NONE) {
+        return 0;
+    }
+    return wearPageAddress(region, region->newestIndex) + FLASH_WEAR_HEADER_SIZE;
+}
+
+int flash_wearCheckPage(const uint8_t* page, uint32_t* sequence, uint32_t* length)
+{
+    WearCommitHeader header;
+    std::memcpy(&header, page, sizeof(header));
+
+    if (header.magic != WEAR_COMMIT_MAGIC) {
+        return 1;
+    }
+    *sequence = header.sequence;
+    *length = header.length;
+    if (header.length > flash_wearCapacity() ||
+        util_crc32(0, page + FLASH_WEAR_HEADER_SIZE, header.length) != header.crc) {
+        return 2;
+    }
+    return 0;
+}
+
+uint32_t flash_wearGetEraseCount(const FlashWearRegion* region, uint32_t index)
+{
+    if (!region || index >= region->pageCount) {
+        return 0;
+    }
+    return region->eraseCount[index];
+}
+
+uint32_t flash_wearCapacity(void)
+{
+    return FLASH_PAGE_SIZE - FLASH_WEAR_HEADER_SIZE;
+}
@@ -0,0 +1,331 @@
+/*
+ * fw_image.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "fw_image.h"
+#include "flash_program.h"
+#include "flash_digest.h"
+#include "flash_trace.h"
+#include "flash_log.h"
+#include "storage_stats.h"
+#include "util.h"
+#include <cstring>
+
+static_assert((FW_IMAGE_STAGE_SIZE & (FW_IMAGE_STAGE_SIZE - 1)) == 0 &&
+              FW_IMAGE_STAGE_SIZE >= FLASH_QUADWORD_SIZE,
+              "FW_IMAGE_STAGE_SIZE must be a power of two of at least a quadword");
+
+//-----------------------------------------------------------------------------
+//
+// Local Datatypes
+//
+//-----------------------------------------------------------------------------
+
+struct FwImageWriter {
+    FwImageRegion region;
+    uint32_t totalSize;
+    uint32_t eraseLimit;           // End of the last page the image touches
+    uint32_t nextProgram;          // Flash address of the next quadword
+    uint32_t erasedEnd;            // Pages below this address are erased
+    bool erasing;                  // Background erase of the page at erasedEnd
+    bool differential;
+    uint32_t compared;             // Differential: end of the bytes matched to flash
+    bool active;
+    bool failed;
+    uint32_t stageHead;            // Free running FIFO byte counters
+    uint32_t stageTail;
+    FwImageStatus status;
+    alignas(4) uint8_t stage[FW_IMAGE_STAGE_SIZE];
+};
+
+STORAGE_THREAD_LOCAL static FwImageWriter fwImage;
+
+//-----------------------------------------------------------------------------
+//
+// Local Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+static int fwImageFail(void)
+{
+    if (fwImage.erasing) {
+        flash_eraseFinish();
+        fwImage.erasing = false;
+    }
+    fwImage.failed = true;
+    fwImage.active = false;
+    flash_log(FLASH_LOG_FW_IMAGE_FAILED, fwImage.status.received, fwImage.totalSize);
+    flash_traceEnd(FLASH_TRACE_OP_FW_IMAGE, 1);
+    return 1;
+}
+
+// Program and verify staged quadwords that fall into erased pages
+static int fwImageProgramRun(uint32_t staged)
+{
+    uint32_t offset = fwImage.stageTail & (FW_IMAGE_STAGE_SIZE - 1);
+    uint32_t run = staged;
+
+    if (run > FW_IMAGE_STAGE_SIZE - offset) {
+        run = FW_IMAGE_STAGE_SIZE - offset; // Up to the end of the FIFO
+    }
+    if (run > fwImage.erasedEnd - fwImage.nextProgram) {
+        run = fwImage.erasedEnd - fwImage.nextProgram;
+    }
+
+    if (flash_programQuadwords(fwImage.nextProgram, fwImage.stage + offset, run) != 0) {
+        return 1;
+    }
+    if (flash_checkProgram(fwImage.nextProgram, run, fwImage.stage + offset) != 0) {
+        storageCounters.verifyFailures++;
+        return 1;
+    }
+
+    // A padded final quadword still occupies a whole one in flash
+    fwImage.nextProgram += (run + FLASH_QUADWORD_SIZE - 1) & ~(FLASH_QUADWORD_SIZE - 1);
+    fwImage.stageTail += run;
+    fwImage.status.programmed += run;
+
+    // Programming reached the next page: the previous one is complete
+    if ((fwImage.nextProgram & (FLASH_PAGE_SIZE - 1)) == 0) {
+        return flash_digestRecordPage(fwImage.nextProgram - FLASH_PAGE_SIZE);
+    }
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Differential mode: compare newly staged bytes of the undecided page at
+// erasedEnd with flash. Returns 1 as soon as they differ.
+//-----------------------------------------------------------------------------
+
+static int fwImageCompare(uint32_t stagedEnd)
+{
+    while (fwImage.compared < stagedEnd) {
+        uint32_t offset = (fwImage.stageTail + (fwImage.compared - fwImage.nextProgram)) &
+                          (FW_IMAGE_STAGE_SIZE - 1);
+        uint32_t n = stagedEnd - fwImage.compared;
+        if (n > FW_IMAGE_STAGE_SIZE - offset) {
+            n = FW_IMAGE_STAGE_SIZE - offset;
+        }
+        if (flash_checkProgram(fwImage.compared, n, fwImage.stage + offset) != 0) {
+            return 1;
+        }
+        fwImage.compared += n;
+    }
+    return 0;
+}
+
+// Decide the page at erasedEnd: start its erase at the first difference,
+// drop it from the FIFO once all of it matched. Returns 1 when it made progress.
+static int fwImageDecidePage(int* error)
+{
+    uint32_t imageEnd = fwImage.region.address + fwImage.totalSize;
+    uint32_t pageEnd = fwImage.erasedEnd + FLASH_PAGE_SIZE;
+    uint32_t stagedEnd = fwImage.nextProgram + (fwImage.stageHead - fwImage.stageTail);
+
+    pageEnd = pageEnd < imageEnd ? pageEnd : imageEnd;
+    stagedEnd = stagedEnd < pageEnd ? stagedEnd : pageEnd;
+
+    if (fwImageCompare(stagedEnd) != 0) {
+        uint32_t bank, page;
+        findPageAndBank(fwImage.erasedEnd, &bank, &page);
+        if (flash_pageEraseStart(bank, page) != 0) {
+            *error = 1;
+            return 0;
+        }
+        fwImage.erasing = true;
+        return 1;
+    }
+
+    if (fwImage.compared == pageEnd) {
+        fwImage.stageTail += pageEnd - fwImage.nextProgram;
+        fwImage.nextProgram = fwImage.erasedEnd + FLASH_PAGE_SIZE;
+        fwImage.erasedEnd = fwImage.nextProgram;
+        fwImage.compared = fwImage.nextProgram;
+        fwImage.status.pagesSkipped++;
+        return 1;
+    }
+    return 0; // Waiting for more of the page
+}
+
+//-----------------------------------------------------------------------------
+// Move staged data into flash. Without block this returns as soon as only a
+// running erase is left to wait for; with block it waits for it. final also
+// programs a trailing partial quadword.
+//-----------------------------------------------------------------------------
+
+static int fwImagePump(bool final, bool block)
+{
+    while (true) {
+        if (fwImage.erasing) {
+            if (flash_eraseBusy()) {
+                if (!block) {
+                    return 0;
+                }
+                fwImage.status.eraseWaits++;
+            }
+            fwImage.erasing = false;
+            if (flash_eraseFinish() != 0) {
+                return 1;
+            }
+            fwImage.erasedEnd += FLASH_PAGE_SIZE;
+            fwImage.compared = fwImage.erasedEnd;
+            fwImage.status.pagesErased++;
+        }
+
+        uint32_t staged = fwImage.stageHead - fwImage.stageTail;
+        if (!final) {
+            staged &= ~(FLASH_QUADWORD_SIZE - 1);
+        }
+        if (staged && fwImage.nextProgram < fwImage.erasedEnd) {
+            if (fwImageProgramRun(staged) != 0) {
+                return 1;
+            }
+            continue;
+        }
+
+        if (fwImage.differential) {
+            int error = 0;
+            if (fwImage.erasedEnd < fwImage.eraseLimit && fwImageDecidePage(&error)) {
+                continue;
+            }
+            return error;
+        }
+
+        // Erase ahead once programming has entered the last erased page,
+        // while the link is still delivering data for it
+        if (fwImage.erasedEnd < fwImage.eraseLimit &&
+            fwImage.nextProgram + FLASH_PAGE_SIZE >= fwImage.erasedEnd) {
+            uint32_t bank, page;
+            findPageAndBank(fwImage.erasedEnd, &bank, &page);
+            if (flash_pageEraseStart(bank, page) != 0) {
+                return 1;
+            }
+            fwImage.erasing = true;
+            continue;
+        }
+        return 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+static int fwImageStart(const FwImageRegion* region, uint32_t totalSize, bool differential)
+{
+    if (fwImage.erasing) {
+        flash_eraseFinish(); // Abandoned image
+    }
+    std::memset(&fwImage, 0, sizeof(fwImage));
+
+    if (!region || region->address % FLASH_PAGE_SIZE || region->size % FLASH_PAGE_SIZE ||
+        totalSize == 0 || totalSize > region->size ||
+        (differential && FW_IMAGE_STAGE_SIZE < FLASH_PAGE_SIZE)) {
+        return 1;
+    }
+
+    flash_traceBegin(FLASH_TRACE_OP_FW_IMAGE);
+    fwImage.region = *region;
+    fwImage.totalSize = totalSize;
+    fwImage.eraseLimit = region->address + ((totalSize + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1));
+    fwImage.nextProgram = region->address;
+    fwImage.erasedEnd = region->address;
+    fwImage.compared = region->address;
+    fwImage.differential = differential;
+    fwImage.active = true;
+    if (flash_digestBeginImage(region->address) != 0) {
+        return fwImageFail();
+    }
+
+    // Starts the erase of the first page; the first chunks are staged meanwhile
+    if (fwImagePump(false, false) != 0) {
+        return fwImageFail();
+    }
+    return 0;
+}
+
+int fwImageBegin(const FwImageRegion* region, uint32_t totalSize)
+{
+    return fwImageStart(region, totalSize, false);
+}
+
+int fwImageBeginDifferential(const FwImageRegion* region, uint32_t totalSize)
+{
+    return fwImageStart(region, totalSize, true);
+}
+
+int fwImageWrite(const uint8_t* chunk, uint32_t size)
+{
+    if (!fwImage.active || size > fwImage.totalSize - fwImage.status.received) {
+        return 1;
+    }
+
+    while (size) {
+        uint32_t free = FW_IMAGE_STAGE_SIZE - (fwImage.stageHead - fwImage.stageTail);
+        if (free == 0) {
+            // Link outran the flash, wait for it
+            if (fwImagePump(false, true) != 0) {
+                return fwImageFail();
+            }
+            continue;
+        }
+
+        uint32_t offset = fwImage.stageHead & (FW_IMAGE_STAGE_SIZE - 1);
+        uint32_t n = size;
+        if (n > free) {
+            n = free;
+        }
+        if (n > FW_IMAGE_STAGE_SIZE - offset) {
+            n = FW_IMAGE_STAGE_SIZE - offset;
+        }
+        std::memcpy(fwImage.stage + offset, chunk, n);
+        fwImage.status.crc = util_crc32(fwImage.status.crc, chunk, n);
+        fwImage.stageHead += n;
+        fwImage.status.received += n;
+        chunk += n;
+        size -= n;
+    }
+
+    if (fwImagePump(false, false) != 0) {
+        return fwImageFail();
+    }
+    return 0;
+}
+
+int fwImageFinish(void)
+{
+    if (!fwImage.active || fwImage.status.received != fwImage.totalSize) {
+        return fwImage.active ? fwImageFail() : 1;
+    }
+
+    if (fwImagePump(true, true) != 0) {
+        return fwImageFail();
+    }
+
+    // Each run was verified as it was programmed; the CRC also catches a
+    // page that was disturbed afterwards
+    const uint8_t* image = (const uint8_t*)FLASH_MAP(fwImage.region.address);
+    uint32_t crc = util_crc32(0, image, fwImage.totalSize);
+    if (crc != fwImage.status.crc) {
+        storageCounters.verifyFailures++;
+        flash_log(FLASH_LOG_FW_IMAGE_CRC, crc, fwImage.totalSize, fwImage.status.crc);
+        return fwImageFail();
+    }
+    if (flash_digestFinishImage(fwImage.region.address, fwImage.totalSize) != 0) {
+        return fwImageFail();
+    }
+
+    fwImage.active = false;
+    flash_traceEnd(FLASH_TRACE_OP_FW_IMAGE, 0);
+    return 0;
+}
+
+void fwImageGetStatus(FwImageStatus* status)
+{
+    *status = fwImage.status;
+}
@@ -0,0 +1,190 @@
+/*
+ * lz.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "lz.h"
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+//
+// Local Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+static uint32_t lzRead32(const uint8_t* p)
+{
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t lzHash(uint32_t value)
+{
+    return (value * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+// Append a length extension: 255 per full byte, then the remainder
+static bool lzPutLength(uint8_t*& op, const uint8_t* end, uint32_t length)
+{
+    while (length >= 255) {
+        if (op >= end) {
+            return false;
+        }
+        *op++ = 255;
+        length -= 255;
+    }
+    if (op >= end) {
+        return false;
+    }
+    *op++ = (uint8_t)length;
+    return true;
+}
+
+static bool lzGetLength(const uint8_t*& ip, const uint8_t* end, uint32_t& length)
+{
+    uint8_t b;
+    do {
+        if (ip >= end) {
+            return false;
+        }
+        b = *ip++;
+        length += b;
+    } while (b == 255);
+    return true;
+}
+
+// Emit literals [anchor, anchor + literals) followed by an optional match
+static bool lzPutSequence(uint8_t*& op, const uint8_t* end, const uint8_t* anchor,
+                          uint32_t literals, uint32_t offset, uint32_t matchLength)
+{
+    uint32_t matchCode = matchLength ? matchLength - LZ_MIN_MATCH : 0;
+
+    if (op >= end) {
+        return false;
+    }
+    uint8_t* token = op++;
+    *token = (uint8_t)(((literals < 15 ? literals : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+    if (literals >= 15 && !lzPutLength(op, end, literals - 15)) {
+        return false;
+    }
+    if ((uint32_t)(end - op) < literals) {
+        return false;
+    }
+    std::memcpy(op, anchor, literals);
+    op += literals;
+
+    if (matchLength) {
+        if (end - op < 2) {
+            return false;
+        }
+        *op++ = (uint8_t)offset;
+        *op++ = (uint8_t)(offset >> 8);
+        if (matchCode >= 15 && !lzPutLength(op, end, matchCode - 15)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+uint32_t lz_compress(const uint8_t* src, uint32_t srcSize, uint8_t* dst, uint32_t dstCapacity)
+{
+    uint16_t table[1U << LZ_HASH_BITS];   // Position + 1 of the last occurrence, 0 = none
+    uint8_t* op = dst;
+    const uint8_t* end = dst + dstCapacity;
+    uint32_t anchor = 0;
+    uint32_t ip = 0;
+
+    if (srcSize > LZ_MAX_INPUT) {
+        return 0;
+    }
+    std::memset(table, 0, sizeof(table));
+
+    while (ip + LZ_MIN_MATCH <= srcSize) {
+        uint32_t value = lzRead32(src + ip);
+        uint32_t h = lzHash(value);
+        uint32_t ref = table[h];
+        table[h] = (uint16_t)(ip + 1);
+
+        if (ref == 0 || ip - (ref - 1) > LZ_WINDOW || lzRead32(src + ref - 1) != value) {
+            ip++;
+            continue;
+        }
+
+        ref -= 1;
+        uint32_t length = LZ_MIN_MATCH;
+        while (ip + length < srcSize && src[ref + length] == src[ip + length]) {
+            length++;
+        }
+        if (!lzPutSequence(op, end, src + anchor, ip - anchor, ip - ref, length)) {
+            return 0;
+        }
+
+        // Index the last position of the match so runs keep chaining
+        ip += length;
+        anchor = ip;
+        if (ip - 1 + LZ_MIN_MATCH <= srcSize) {
+            table[lzHash(lzRead32(src + ip - 1))] = (uint16_t)ip;
+        }
+    }
+
+    if (!lzPutSequence(op, end, src + anchor, srcSize - anchor, 0, 0)) {
+        return 0;
+    }
+    return (uint32_t)(op - dst);
+}
+
+uint32_t lz_decompress(const uint8_t* src, uint32_t srcSize, uint8_t* dst, uint32_t dstCapacity)
+{
+    const uint8_t* ip = src;
+    const uint8_t* inEnd = src + srcSize;
+    uint32_t out = 0;
+
+    while (ip < inEnd) {
+        uint8_t token = *ip++;
+        uint32_t literals = token >> 4;
+        if (literals == 15 && !lzGetLength(ip, inEnd, literals)) {
+            return 0;
+        }
+        if ((uint32_t)(inEnd - ip) < literals || dstCapacity - out < literals) {
+            return 0;
+        }
+        std::memcpy(dst + out, ip, literals);
+        ip += literals;
+        out += literals;
+
+        if (ip == inEnd) {
+            break; // Final sequence has no match
+        }
+
+        if (inEnd - ip < 2) {
+            return 0;
+        }
+        uint32_t offset = ip[0] | ((uint32_t)ip[1] << 8);
+        ip += 2;
+        uint32_t length = token & 15;
+        if (length == 15 && !lzGetLength(ip, inEnd, length)) {
+            return 0;
+        }
+        length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > out || dstCapacity - out < length) {
+            return 0;
+        }
+
+        // Byte by byte: an overlapping match repeats the bytes just written
+        const uint8_t* from = dst + out - offset;
+        for (uint32_t i = 0; i < length; ++i) {
+            dst[out + i] = from[i];
+        }
+        out += length;
+    }
+    return out;
+}
@@ -0,0 +1,484 @@
+/*
+ * serial_protocol.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "serial_protocol.h"
+#include "config.h"
+#include "firmware.h"
+#include "util.h"
+#include <climits>
+#include <cstring>
+
+static_assert(MAX_STRING_LENGTH <= 256, "serial_protocol: string length must fit in a byte");
+
+#define SERIAL_MAX_FRAME (SERIAL_HEADER_SIZE + 0xFFFFU + SERIAL_CRC_SIZE)
+
+// Payload offsets
+#define SERIAL_STORE_OFFSET   0
+#define SERIAL_COUNT_OFFSET   1
+#define SERIAL_ITEMS_OFFSET   3
+#define SERIAL_DUMP_MORE      3        // DUMP response: more, next id, records
+#define SERIAL_DUMP_NEXT      4
+#define SERIAL_DUMP_RECORDS   8
+
+// Store behind each SerialStore
+struct SerialStoreOps {
+    int (*lookup)(int id, StoreEntryView* entry);
+    StoreRange (*range)(int loId, int hiId);
+    int (*writeInt)(int id, int value);
+    int (*writeString)(int id, const char* str);
+    int (*idFromName)(const char* name);
+};
+
+static const SerialStoreOps serialStores[] = {
+    {configLookup, configRange, configWriteInt, configWriteString, configGetIDFromName},
+    {firmwareLookup, firmwareRange, firmwareWriteInt, firmwareWriteString, firmwareGetIDFromName},
+};
+
+//-----------------------------------------------------------------------------
+//
+// Local Functions
+//
+//-----------------------------------------------------------------------------
+
+static uint16_t readLe16(const uint8_t* p) {
+    return util_read_le16(const_cast<UINT8*>(p));
+}
+
+static int readLe32(const uint8_t* p) {
+    return (int)util_read_le32(const_cast<UINT8*>(p));
+}
+
+static uint32_t frameCrc(const uint8_t* frame, size_t size) {
+    return util_crc32(0, frame, (UINT32)size);
+}
+
+static size_t recordSize(const StoreEntryView& entry) {
+    if (entry.type == TYPE_INT) {
+        return 5 + 4;
+    }
+    if (entry.type == TYPE_STRING) {
+        return 5 + 1 + entry.length + 1;
+    }
+    return 5;
+}
+
+static void putRecord(uint8_t* p, const StoreEntryView& entry) {
+    util_write_le32(p, (UINT32)entry.id);
+    p[4] = (uint8_t)entry.type;
+    if (entry.type == TYPE_INT) {
+        util_write_le32(p + 5, (UINT32)entry.value);
+    } else if (entry.type == TYPE_STRING) {
+        p[5] = (uint8_t)entry.length;
+        std::memcpy(p + 6, entry.text, entry.length);
+        p[6 + entry.length] = '\0';
+    }
+}
+
+// Record at p, not reaching past end; returns its size, 0 if malformed
+static size_t parseRecord(const uint8_t* p, const uint8_t* end, StoreEntryView* entry) {
+    if (end - p < 5) {
+        return 0;
+    }
+    *entry = {readLe32(p), p[4], 0, nullptr, 0};
+    if (entry->type == TYPE_INT) {
+        if (end - p < 9) {
+            return 0;
+        }
+        entry->value = readLe32(p + 5);
+    } else if (entry->type == TYPE_STRING) {
+        if (end - p < 7 || (size_t)(end - p) < 7 + (size_t)p[5] || p[6 + p[5]] != '\0') {
+            return 0;
+        }
+        entry->length = p[5];
+        entry->text = (const char*)p + 6;
+    } else if (entry->type != SERIAL_TYPE_NONE) {
+        return 0;
+    }
+    return recordSize(*entry);
+}
+
+// Name at p (length, text, NUL); returns its size, 0 if malformed
+static size_t parseName(const uint8_t* p, const uint8_t* end) {
+    if (end - p < 2 || (size_t)(end - p) < 2 + (size_t)p[0] || p[1 + p[0]] != '\0') {
+        return 0;
+    }
+    return 2 + p[0];
+}
+
+//-----------------------------------------------------------------------------
+// Commands. Each answers into the payload and sets *size to the response
+// payload length. GET and RESOLVE answer the longest prefix of the request
+// that fits: those questions are moved to the end of the frame, and every
+// answer then only overwrites questions already read.
+//-----------------------------------------------------------------------------
+
+static SerialStatus handleGet(const SerialStoreOps& ops, uint8_t* payload, size_t length,
+                              uint8_t* limit, size_t* size) {
+    size_t count = readLe16(payload + SERIAL_COUNT_OFFSET);
+    if (length != SERIAL_ITEMS_OFFSET + count * 4) {
+        return SERIAL_STATUS_BAD_PAYLOAD;
+    }
+
+    // Records are longer than IDs, so the prefix fits if its records do
+    size_t space = limit - (payload + SERIAL_ITEMS_OFFSET);
+    size_t answered = 0;
+    size_t total = 0;
+    StoreEntryView entry;
+    while (answered < count) {
+        int id = readLe32(payload + SERIAL_ITEMS_OFFSET + answered * 4);
+        if (ops.lookup(id, &entry) != 0) {
+            entry = {id, SERIAL_TYPE_NONE, 0, nullptr, 0};
+        }
+        if (total + recordSize(entry) > space) {
+            break; // The client asks again for the rest
+        }
+        total += recordSize(entry);
+        answered++;
+    }
+    uint8_t* ids = limit - answered * 4;
+    std::memmove(ids, payload + SERIAL_ITEMS_OFFSET, answered * 4);
+
+    uint8_t* p = payload + SERIAL_ITEMS_OFFSET;
+    for (size_t i = 0; i < answered; ++i) {
+        int id = readLe32(ids + i * 4);
+        if (ops.lookup(id, &entry) != 0) {
+            entry = {id, SERIAL_TYPE_NONE, 0, nullptr, 0};
+        }
+        putRecord(p, entry);
+        p += recordSize(entry);
+    }
+    util_write_le16(payload + SERIAL_COUNT_OFFSET, (UINT16)answered);
+    *size = p - payload;
+    return SERIAL_STATUS_OK;
+}
+
+static SerialStatus handleSet(const SerialStoreOps& ops, uint8_t* payload, size_t length, size_t* size) {
+    size_t count = readLe16(payload + SERIAL_COUNT_OFFSET);
+    const uint8_t* end = payload + length;
+    const uint8_t* p = payload + SERIAL_ITEMS_OFFSET;
+    StoreEntryView entry;
+
+    // Check every record before storing any
+    for (size_t i = 0; i < count; ++i) {
+        size_t n = parseRecord(p, end, &entry);
+        if (n == 0 || entry.type == SERIAL_TYPE_NONE) {
+            return SERIAL_STATUS_BAD_PAYLOAD;
+        }
+        p += n;
+    }
+    if (p != end) {
+        return SERIAL_STATUS_BAD_PAYLOAD;
+    }
+
+    // Result i lands before record i, which has been stored by then
+    p = payload + SERIAL_ITEMS_OFFSET;
+    for (size_t i = 0; i < count; ++i) {
+        p += parseRecord(p, end, &entry);
+        int result;
+        if (entry.type == TYPE_INT) {
+            result = ops.writeInt(entry.id, entry.value);
+        } else {
+            result = entry.length < MAX_STRING_LENGTH ? ops.writeString(entry.id, entry.text) : 1;
+        }
+        payload[SERIAL_ITEMS_OFFSET + i] = (uint8_t)result;
+    }
+    *size = SERIAL_ITEMS_OFFSET + count;
+    return SERIAL_STATUS_OK;
+}
+
+static SerialStatus handleResolve(const SerialStoreOps& ops, uint8_t* payload, size_t length,
+                                  uint8_t* limit, size_t* size) {
+    size_t count = readLe16(payload + SERIAL_COUNT_OFFSET);
+    const uint8_t* end = payload + length;
+    const uint8_t* q = payload + SERIAL_ITEMS_OFFSET;
+    for (size_t i = 0; i < count; ++i) {
+        size_t n = parseName(q, end);
+        if (n == 0) {
+            return SERIAL_STATUS_BAD_PAYLOAD;
+        }
+        q += n;
+    }
+    if (q != end) {
+        return SERIAL_STATUS_BAD_PAYLOAD;
+    }
+
+    // Names can be shorter than IDs: the prefix of k names fits if, for every
+    // j <= k, j IDs and the names after the j-th do
+    size_t space = limit - (payload + SERIAL_ITEMS_OFFSET);
+    size_t answered = 0;
+    size_t namesSize = 0;
+    long worst = 0;                        // Largest 4 * j - (size of the first j names)
+    q = payload + SERIAL_ITEMS_OFFSET;
+    while (answered < count) {
+        size_t n = parseName(q, end);
+        long next = (long)(answered + 1) * 4 - (long)(namesSize + n);
+        if ((next > worst ? next : worst) + (long)(namesSize + n) > (long)space) {
+            break; // The client asks again for the rest
+        }
+        worst = next > worst ? next : worst;
+        namesSize += n;
+        q += n;
+        answered++;
+    }
+    uint8_t* names = limit - namesSize;
+    std::memmove(names, payload + SERIAL_ITEMS_OFFSET, namesSize);
+
+    uint8_t* p = payload + SERIAL_ITEMS_OFFSET;
+    for (size_t i = 0; i < answered; ++i) {
+        int id = ops.idFromName((const char*)names + 1);  // Resolved before its bytes are overwritten
+        names += 2 + names[0];
+        util_write_le32(p, (UINT32)id);
+        p += 4;
+    }
+    util_write_le16(payload + SERIAL_COUNT_OFFSET, (UINT16)answered);
+    *size = p - payload;
+    return SERIAL_STATUS_OK;
+}
+
+static SerialStatus handleDump(const SerialStoreOps& ops, uint8_t* payload, size_t length,
+                               uint8_t* limit, size_t* size) {
+    if (length != SERIAL_ITEMS_OFFSET + 4 || readLe16(payload + SERIAL_COUNT_OFFSET) != 1) {
+        return SERIAL_STATUS_BAD_PAYLOAD;
+    }
+    StoreRange range = ops.range(readLe32(payload + SERIAL_ITEMS_OFFSET), INT_MAX);
+
+    uint8_t* p = payload + SERIAL_DUMP_RECORDS;
+    size_t count = 0;
+    payload[SERIAL_DUMP_MORE] = 0;
+    util_write_le32(payload + SERIAL_DUMP_NEXT, 0);
+    for (StoreIterator it = range.begin(); it != range.end(); ++it) {
+        StoreEntryView entry = *it;
+        size_t n = recordSize(entry);
+        if (p + n > limit || count == 0xFFFF) {
+            payload[SERIAL_DUMP_MORE] = 1;
+            util_write_le32(payload + SERIAL_DUMP_NEXT, (UINT32)entry.id);
+            break;
+        }
+        putRecord(p, entry);
+        p += n;
+        count++;
+    }
+    util_write_le16(payload + SERIAL_COUNT_OFFSET, (UINT16)count);
+    *size = p - payload;
+    return SERIAL_STATUS_OK;
+}
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+size_t serialFrameLength(const uint8_t* frame) {
+    if (frame[0] != SERIAL_SYNC) {
+        return 0;
+    }
+    return SERIAL_HEADER_SIZE + readLe16(frame + 4) + SERIAL_CRC_SIZE;
+}
+
+size_t serialHandleFrame(uint8_t* frame, size_t length, size_t capacity) {
+    if (length < SERIAL_HEADER_SIZE || frame[0] != SERIAL_SYNC ||
+        capacity < SERIAL_HEADER_SIZE + SERIAL_CRC_SIZE || length > capacity) {
+        return 0;
+    }
+    if (capacity > SERIAL_MAX_FRAME) {
+        capacity = SERIAL_MAX_FRAME;
+    }
+    uint8_t* payload = frame + SERIAL_HEADER_SIZE;
+    uint8_t* limit = frame + capacity - SERIAL_CRC_SIZE;
+    size_t payloadLength = readLe16(frame + 4);
+    size_t responseLength = 0;
+    SerialStatus status;
+
+    if (serialFrameLength(frame) != length ||
+        frameCrc(frame, length - SERIAL_CRC_SIZE) != (uint32_t)readLe32(frame + length - SERIAL_CRC_SIZE)) {
+        status = SERIAL_STATUS_BAD_FRAME;
+    } else if (payloadLength < SERIAL_ITEMS_OFFSET) {
+        status = SERIAL_STATUS_BAD_PAYLOAD;
+    } else if (payload[SERIAL_STORE_OFFSET] >= sizeof(serialStores) / sizeof(serialStores[0])) {
+        status = SERIAL_STATUS_BAD_STORE;
+    } else {
+        const SerialStoreOps& ops = serialStores[payload[SERIAL_STORE_OFFSET]];
+        switch (frame[1]) {
+            case SERIAL_CMD_GET:
+                status = handleGet(ops, payload, payloadLength, limit, &responseLength);
+                break;
+            case SERIAL_CMD_SET:
+                status = handleSet(ops, payload, payloadLength, &responseLength);
+                break;
+            case SERIAL_CMD_RESOLVE:
+                status = handleResolve(ops, payload, payloadLength, limit, &responseLength);
+                break;
+            case SERIAL_CMD_DUMP:
+                status = handleDump(ops, payload, payloadLength, limit, &responseLength);
+                break;
+            default:
+                status = SERIAL_STATUS_BAD_COMMAND;
+                break;
+        }
+    }
+    if (status != SERIAL_STATUS_OK) {
+        responseLength = 0;
+    }
+
+    frame[1] |= SERIAL_RESPONSE;
+    frame[3] = status;
+    util_write_le16(frame + 4, (UINT16)responseLength);
+    length = SERIAL_HEADER_SIZE + responseLength;
+    util_write_le32(frame + length, frameCrc(frame, length));
+    return length + SERIAL_CRC_SIZE;
+}
+
+int serialPoll(const SerialTransport* transport, uint8_t* frame, size_t capacity) {
+    size_t size = 0;
+    if (transport->receive(transport->context, frame, capacity, &size) != 0) {
+        return 1;
+    }
+    size = serialHandleFrame(frame, size, capacity);
+    if (size == 0) {
+        return 1; // Not a frame, nothing to answer
+    }
+    return transport->send(transport->context, frame, size) != 0 ? 1 : 0;
+}
+
+void serialBegin(SerialWriter* writer, uint8_t* frame, size_t capacity,
+                 SerialCommand command, uint8_t sequence, SerialStore store) {
+    writer->frame = frame;
+    writer->capacity = capacity < SERIAL_MAX_FRAME ? capacity : SERIAL_MAX_FRAME;
+    writer->length = SERIAL_HEADER_SIZE + SERIAL_ITEMS_OFFSET;
+    writer->count = 0;
+    frame[0] = SERIAL_SYNC;
+    frame[1] = command;
+    frame[2] = sequence;
+    frame[3] = SERIAL_STATUS_OK;
+    frame[SERIAL_HEADER_SIZE + SERIAL_STORE_OFFSET] = store;
+}
+
+// Room for an item of size bytes
+static bool serialFits(const SerialWriter* writer, size_t size) {
+    if (writer->frame[1] == SERIAL_CMD_DUMP && writer->count > 0) {
+        return false; // DUMP takes one ID
+    }
+    return writer->count < 0xFFFF && writer->length + size + SERIAL_CRC_SIZE <= writer->capacity;
+}
+
+int serialAddId(SerialWriter* writer, int id) {
+    if (!serialFits(writer, 4)) {
+        return 1;
+    }
+    util_write_le32(writer->frame + writer->length, (UINT32)id);
+    writer->length += 4;
+    writer->count++;
+    return 0;
+}
+
+int serialAddInt(SerialWriter* writer, int id, int value) {
+    StoreEntryView entry = {id, TYPE_INT, value, nullptr, 0};
+    if (!serialFits(writer, recordSize(entry))) {
+        return 1;
+    }
+    putRecord(writer->frame + writer->length, entry);
+    writer->length += recordSize(entry);
+    writer->count++;
+    return 0;
+}
+
+int serialAddString(SerialWriter* writer, int id, const char* value) {
+    StoreEntryView entry = {id, TYPE_STRING, 0, value, std::strlen(value)};
+    if (entry.length > 0xFF || !serialFits(writer, recordSize(entry))) {
+        return 1;
+    }
+    putRecord(writer->frame + writer->length, entry);
+    writer->length += recordSize(entry);
+    writer->count++;
+    return 0;
+}
+
+int serialAddName(SerialWriter* writer, const char* name) {
+    size_t length = std::strlen(name);
+    if (length > 0xFF || !serialFits(writer, 2 + length)) {
+        return 1;
+    }
+    uint8_t* p = writer->frame + writer->length;
+    p[0] = (uint8_t)length;
+    std::memcpy(p + 1, name, length + 1);
+    writer->length += 2 + length;
+    writer->count++;
+    return 0;
+}
+
+size_t serialEnd(SerialWriter* writer) {
+    uint8_t* frame = writer->frame;
+    util_write_le16(frame + SERIAL_HEADER_SIZE + SERIAL_COUNT_OFFSET, writer->count);
+    util_write_le16(frame + 4, (UINT16)(writer->length - SERIAL_HEADER_SIZE));
+    util_write_le32(frame + writer->length, frameCrc(frame, writer->length));
+    return writer->length + SERIAL_CRC_SIZE;
+}
+
+int serialTransact(const SerialTransport* transport, uint8_t* frame, size_t length,
+                   size_t capacity, size_t* responseLength) {
+    uint8_t command = frame[1];
+    uint8_t sequence = frame[2];
+    size_t size = 0;
+    if (transport->send(transport->context, frame, length) != 0 ||
+        transport->receive(transport->context, frame, capacity, &size) != 0) {
+        return 1;
+    }
+    if (size < SERIAL_HEADER_SIZE + SERIAL_CRC_SIZE || serialFrameLength(frame) != size ||
+        frameCrc(frame, size - SERIAL_CRC_SIZE) != (uint32_t)readLe32(frame + size - SERIAL_CRC_SIZE)) {
+        return 1;
+    }
+    *responseLength = size;
+    return frame[1] == (command | SERIAL_RESPONSE) && frame[2] == sequence &&
+           frame[3] == SERIAL_STATUS_OK ? 0 : 1;
+}
+
+int serialDecodeEntries(const uint8_t* frame, size_t length, StoreVisitor visitor, void* context) {
+    const uint8_t* payload = frame + SERIAL_HEADER_SIZE;
+    const uint8_t* end = frame + length - SERIAL_CRC_SIZE;
+    bool dump = (frame[1] & ~SERIAL_RESPONSE) == SERIAL_CMD_DUMP;
+    const uint8_t* p = payload + (dump ? SERIAL_DUMP_RECORDS : SERIAL_ITEMS_OFFSET);
+    if (p > end) {
+        return -1;
+    }
+    size_t count = readLe16(payload + SERIAL_COUNT_OFFSET);
+    int visited = 0;
+    for (size_t i = 0; i < count; ++i) {
+        StoreEntryView entry;
+        size_t n = parseRecord(p, end, &entry);
+        if (n == 0) {
+            return -1;
+        }
+        p += n;
+        ++visited;
+        if (!visitor(entry, context)) {
+            break;
+        }
+    }
+    return visited;
+}
+
+int serialDumpMore(const uint8_t* frame, int* nextId) {
+    const uint8_t* payload = frame + SERIAL_HEADER_SIZE;
+    if (!payload[SERIAL_DUMP_MORE]) {
+        return 0;
+    }
+    *nextId = readLe32(payload + SERIAL_DUMP_NEXT);
+    return 1;
+}
+
+size_t serialResultCount(const uint8_t* frame) {
+    return readLe16(frame + SERIAL_HEADER_SIZE + SERIAL_COUNT_OFFSET);
+}
+
+int serialResult(const uint8_t* frame, size_t index) {
+    const uint8_t* items = frame + SERIAL_HEADER_SIZE + SERIAL_ITEMS_OFFSET;
+    if ((frame[1] & ~SERIAL_RESPONSE) == SERIAL_CMD_RESOLVE) {
+        return readLe32(items + index * 4);
+    }
+    return items[index];
+}
@@ -0,0 +1,107 @@
+/*
+ * storage_stats.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "storage_stats.h"
+#include "main.h"
+#include <cstring>
+#if !defined(DWT)
+#include <chrono>
+#endif
+
+STORAGE_THREAD_LOCAL StorageStats storageCounters = {};
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+void storageGetStats(StorageStats* stats)
+{
+    *stats = storageCounters;
+    stats->cyclesPerSecond = storageStatsCyclesPerSecond();
+    for (int i = 0; i < STORAGE_STATS_HOT_IDS; ++i) {
+        if (stats->hotCounts[i] == 0) {
+            stats->hotIds[i] = -1;
+        }
+    }
+}
+
+void storageResetStats(void)
+{
+    std::memset(&storageCounters, 0, sizeof(storageCounters));
+}
+
+//-----------------------------------------------------------------------------
+// Free running timestamp; only differences are meaningful
+//-----------------------------------------------------------------------------
+
+uint32_t storageStatsCycles(void)
+{
+#if defined(DWT)
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+#else
+    return (uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+uint32_t storageStatsCyclesPerSecond(void)
+{
+#if defined(DWT)
+    return SystemCoreClock;
+#else
+    return 1000000000U; // Host timings are in nanoseconds
+#endif
+}
+
+void storageStatsTiming(StorageTiming* timing, uint32_t startCycles)
+{
+    uint32_t elapsed = storageStatsCycles() - startCycles;
+
+    timing->count++;
+    timing->totalCycles += elapsed;
+    if (elapsed > timing->maxCycles) {
+        timing->maxCycles = elapsed;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Count an entry update and track the most written IDs with the Misra-Gries
+// summary: IDs written more than 1/(N+1) of the time are guaranteed to stay
+// in the table, at a fixed cost of N slots.
+//-----------------------------------------------------------------------------
+
+void storageStatsUpdate(int id)
+{
+    int freeSlot = -1;
+
+    storageCounters.updates++;
+    for (int i = 0; i < STORAGE_STATS_HOT_IDS; ++i) {
+        if (storageCounters.hotCounts[i] == 0) {
+            freeSlot = i;
+        } else if (storageCounters.hotIds[i] == id) {
+            storageCounters.hotCounts[i]++;
+            return;
+        }
+    }
+
+    if (freeSlot >= 0) {
+        storageCounters.hotIds[freeSlot] = id;
+        storageCounters.hotCounts[freeSlot] = 1;
+        return;
+    }
+
+    for (int i = 0; i < STORAGE_STATS_HOT_IDS; ++i) {
+        storageCounters.hotCounts[i]--;
+    }
+}
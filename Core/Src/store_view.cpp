@@ -0,0 +1,248 @@
+/*
+ * store_view.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "store_view.h"
+#include "flash_log.h"
+#include <algorithm>
+
+//-----------------------------------------------------------------------------
+// Bulk load. While an image loads, the type field of an appended entry holds
+// its load order, counting up from LOAD_ORDER_FIRST in image order; entries
+// that were in the store keep TYPE_INT or TYPE_STRING, below any load order.
+// Sorting by ID and load order leaves the entry that wins at the end of its
+// run of equal IDs. Settling keeps only that one and puts the type back.
+//-----------------------------------------------------------------------------
+
+#define LOAD_ORDER_FIRST (TYPE_STRING + 1)
+
+template <typename Entry>
+static bool loadOrderLess(const Entry& a, const Entry& b) {
+    return a.id < b.id || (a.id == b.id && a.type < b.type);
+}
+
+static StoreEntryView loadIntView(const IntEntry& e) {
+    return {e.id, TYPE_INT, e.value, nullptr, 0};
+}
+
+static StoreEntryView loadStringView(const StringEntry& e) {
+    return {e.id, TYPE_STRING, 0, e.value, std::strlen(e.value)};
+}
+
+// Sort unless the entries are in ascending ID order already, then keep the
+// last entry of each ID if the rules keep it
+static void loadSettleInts(InitArrayMap& map, bool sorted, const StoreLoadRules& rules) {
+    if (!sorted) {
+        std::sort(map.intArray, map.intArray + map.intCount, loadOrderLess<IntEntry>);
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < map.intCount; ++i) {
+        if (i + 1 < map.intCount && map.intArray[i + 1].id == map.intArray[i].id) {
+            continue; // Replaced by a later entry
+        }
+        map.intArray[i].type = TYPE_INT;
+        if (rules.keep && !rules.keep(loadIntView(map.intArray[i]))) {
+            continue;
+        }
+        if (kept != i) {
+            map.intArray[kept] = map.intArray[i];
+        }
+        kept++;
+    }
+    map.intCount = kept;
+}
+
+static void loadSettleStrings(InitArrayMap& map, bool sorted, const StoreLoadRules& rules) {
+    if (!sorted) {
+        std::sort(map.stringArray, map.stringArray + map.stringCount, loadOrderLess<StringEntry>);
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < map.stringCount; ++i) {
+        if (i + 1 < map.stringCount && map.stringArray[i + 1].id == map.stringArray[i].id) {
+            continue;
+        }
+        map.stringArray[i].type = TYPE_STRING;
+        if (rules.keep && !rules.keep(loadStringView(map.stringArray[i]))) {
+            continue;
+        }
+        if (kept != i) {
+            map.stringArray[kept] = map.stringArray[i];
+        }
+        kept++;
+    }
+    map.stringCount = kept;
+}
+
+// Entry by entry once the store stays full: update, drop or insert in place
+static void loadMergeInt(InitArrayMap& map, const IntEntry& entry, const StoreLoadRules& rules) {
+    size_t i = storeLowerBoundInt(map, entry.id);
+    bool found = i < map.intCount && map.intArray[i].id == entry.id;
+    bool keep = !rules.keep || rules.keep(loadIntView(entry));
+    if (found && !keep) {
+        std::memmove(&map.intArray[i], &map.intArray[i + 1], (map.intCount - i - 1) * sizeof(IntEntry));
+        map.intCount--;
+    } else if (found) {
+        map.intArray[i].value = entry.value;
+    } else if (keep && map.intCount < rules.maxInts) {
+        storeInsertInt(map, i, entry.id, entry.value);
+    }
+}
+
+static void loadMergeString(InitArrayMap& map, const StringEntry& entry, const StoreLoadRules& rules) {
+    size_t i = storeLowerBoundString(map, entry.id);
+    bool found = i < map.stringCount && map.stringArray[i].id == entry.id;
+    bool keep = !rules.keep || rules.keep(loadStringView(entry));
+    if (found && !keep) {
+        std::memmove(&map.stringArray[i], &map.stringArray[i + 1],
+                     (map.stringCount - i - 1) * sizeof(StringEntry));
+        map.stringCount--;
+    } else if (found) {
+        std::memcpy(map.stringArray[i].value, entry.value, MAX_STRING_LENGTH);
+    } else if (keep && map.stringCount < rules.maxStrings) {
+        storeInsertString(map, i, entry.id, entry.value);
+    }
+}
+
+// State of a load, shared by the decoder and a migrator
+struct StoreLoader {
+    InitArrayMap& map;
+    const StoreLoadRules& rules;
+    int order;
+    bool intsSorted;               // Appended in ascending ID order so far
+    bool stringsSorted;
+    bool intsMerging;              // Settling freed too little: merge entry by entry
+    bool stringsMerging;
+};
+
+static void loadInt(StoreLoader& loader, IntEntry& entry)
+{
+    InitArrayMap& map = loader.map;
+    const StoreLoadRules& rules = loader.rules;
+
+    if (rules.accept && !rules.accept(loadIntView(entry))) {
+        return;
+    }
+    if (!loader.intsMerging && map.intCount >= rules.maxInts) {
+        // Full: settle to free the slots of replaced entries, and keep
+        // appending only while that frees a quarter of the store
+        loadSettleInts(map, loader.intsSorted, rules);
+        loader.intsSorted = true;
+        loader.intsMerging = map.intCount >= rules.maxInts - rules.maxInts / 4;
+    }
+    if (loader.intsMerging) {
+        loadMergeInt(map, entry, rules);
+        return;
+    }
+    loader.intsSorted = loader.intsSorted && (map.intCount == 0 || map.intArray[map.intCount - 1].id < entry.id);
+    entry.type = loader.order++;
+    map.intArray[map.intCount++] = entry;
+}
+
+static void loadString(StoreLoader& loader, StringEntry& entry)
+{
+    InitArrayMap& map = loader.map;
+    const StoreLoadRules& rules = loader.rules;
+
+    if (rules.accept && !rules.accept(loadStringView(entry))) {
+        return;
+    }
+    if (!loader.stringsMerging && map.stringCount >= rules.maxStrings) {
+        loadSettleStrings(map, loader.stringsSorted, rules);
+        loader.stringsSorted = true;
+        loader.stringsMerging = map.stringCount >= rules.maxStrings - rules.maxStrings / 4;
+    }
+    if (loader.stringsMerging) {
+        loadMergeString(map, entry, rules);
+        return;
+    }
+    loader.stringsSorted = loader.stringsSorted &&
+                           (map.stringCount == 0 || map.stringArray[map.stringCount - 1].id < entry.id);
+    entry.type = loader.order++;
+    map.stringArray[map.stringCount++] = entry;
+}
+
+void storeLoadEmit(StoreLoader* loader, const StoreEntryView& entry)
+{
+    if (entry.type == TYPE_INT) {
+        IntEntry e(entry.id, entry.value);
+        loadInt(*loader, e);
+    } else {
+        StringEntry e(entry.id, entry.text);
+        loadString(*loader, e);
+    }
+}
+
+int storeLoadImage(InitArrayMap& map, const uint8_t* image, size_t size, const StoreLoadRules& rules)
+{
+    const uint8_t* end = image + size;
+    uint32_t intCount = 0;
+    uint32_t stringCount = 0;
+    if (size < 2 * sizeof(uint32_t)) {
+        return 1;
+    }
+    std::memcpy(&intCount, image, sizeof(uint32_t));
+    image += sizeof(uint32_t);
+    std::memcpy(&stringCount, image, sizeof(uint32_t));
+    image += sizeof(uint32_t);
+
+    StoreLoader loader = {map, rules, LOAD_ORDER_FIRST, true, true, false, false};
+    const StoreMigrator* migrator = rules.migrator;
+    int result = 0;
+
+    uint64_t total = (uint64_t)intCount + stringCount;
+    uint64_t n = 0;
+    for (; n < total; ++n) {
+        int type = 0;
+        int id = 0;
+        if ((size_t)(end - image) < 2 * sizeof(int)) {
+            result = 1; // Counts promise more than the image holds
+            break;
+        }
+        std::memcpy(&type, image, sizeof(int));
+        image += sizeof(int);
+        std::memcpy(&id, image, sizeof(int));
+        image += sizeof(int);
+
+        if (type == TYPE_INT) {
+            if ((size_t)(end - image) < sizeof(int)) {
+                result = 1;
+                break;
+            }
+            IntEntry entry(id);
+            std::memcpy(&entry.value, image, sizeof(int));
+            image += sizeof(int);
+            if (!migrator || !migrator->entry(migrator->context, loadIntView(entry), &loader)) {
+                loadInt(loader, entry);
+            }
+        } else if (type == TYPE_STRING) {
+            if ((size_t)(end - image) < STRING_ENTRY_SIZE) {
+                result = 1;
+                break;
+            }
+            StringEntry entry(id);
+            std::memcpy(entry.value, image, MAX_STRING_LENGTH);
+            entry.value[MAX_STRING_LENGTH - 1] = '\0';
+            image += STRING_ENTRY_SIZE;
+            if (!migrator || !migrator->entry(migrator->context, loadStringView(entry), &loader)) {
+                loadString(loader, entry);
+            }
+        } else {
+            result = 1; // Unknown type: the size of the entry is unknown too
+            break;
+        }
+    }
+
+    if (result != 0) {
+        flash_log(FLASH_LOG_STORE_IMAGE_INVALID, (uint32_t)size, (uint32_t)(size - (end - image)),
+                  (uint32_t)n, (uint32_t)total);
+    }
+    if (migrator) {
+        migrator->finish(migrator->context, &loader);
+    }
+    loadSettleInts(map, loader.intsSorted, rules);
+    loadSettleStrings(map, loader.stringsSorted, rules);
+    return result;
+}
@@ -1,5 +1,6 @@
 #include "util.h"
 #include "defs.h"
+#include <stdint.h>
 
 //-----------------------------------------------------------------------------
 //
@@ -44,10 +45,10 @@ void util_memcpy(UINT8* dest, UINT8* src, UINT32 len){
   // Check for dest and src to be aligned on the same offset from a word
   // boundary
 
-  if (((UINT32)dest % 4) == ((UINT32)src % 4)) {
+  if (((uintptr_t)dest % 4) == ((uintptr_t)src % 4)) {
     // Copy bytes until we're aligned on a word boundary
     // Get byte alignment offset
-    alignment = ((UINT32)(dest)) % 4;
+    alignment = ((uintptr_t)(dest)) % 4;
     i = 0;
     while (i < alignment) {
       // Copy byte
@@ -92,7 +93,7 @@ void util_memset(UINT8* dest, UINT8 val, UINT32 len) {
 
   // Set bytes until we're aligned on a word boundary
   // Get byte alignment offset
-  alignment = ((UINT32)(dest)) % 4;
+  alignment = ((uintptr_t)(dest)) % 4;
   i = 0;
   while (i < alignment) {
     // Copy byte
@@ -395,3 +396,26 @@ UINT32 util_memcmp(UINT8* loc1, UINT8* loc2, UINT32 len) {
   return 0; // Memory is matched
 }
 
+
+//-----------------------------------------------------------------------------
+// CRC-32 (IEEE 802.3, reflected). Pass 0 as crc for the first block and the
+// previous result to continue over further blocks. Uses a 16 entry nibble
+// table to keep the footprint small.
+//-----------------------------------------------------------------------------
+
+UINT32 util_crc32(UINT32 crc, const UINT8* data, UINT32 len) {
+  static const UINT32 table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+  };
+  UINT32 i;
+
+  crc = ~crc;
+  for (i = 0; i < len; i++) {
+    crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+    crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
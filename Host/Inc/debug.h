@@ -0,0 +1,23 @@
+/*
+ * debug.h
+ *
+ *  Host replacement for the target debug console; messages go to stderr.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef DEBUG_H
+#define DEBUG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void debug_msg(const char* fmt, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DEBUG_H
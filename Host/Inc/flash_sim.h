@@ -0,0 +1,103 @@
+/*
+ * flash_sim.h
+ *
+ *  Host flash simulator backing the HAL shim. The flash array is an mmap'd
+ *  image file (or anonymous memory) with STM32U5 bank/page geometry,
+ *  quadword write-once-after-erase rules, a latency model, per-page erase
+ *  counters, injectable faults and read-while-write bank contention.
+ *
+ *  A process can simulate many devices: flashSim_create makes one and
+ *  flashSim_bind selects it for the calling thread. Every other function,
+ *  and the HAL shim, acts on the device bound to the calling thread, the
+ *  default one unless bound otherwise.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef FLASH_SIM_H
+#define FLASH_SIM_H
+
+#include <cstddef>
+#include <cstdint>
+#include "stm32u5xx_hal.h"
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define FLASH_SIM_QUADWORD        16U
+#define FLASH_SIM_ERASED_BYTE     0xFFU
+
+// Approximate STM32U5 datasheet figures
+#define FLASH_SIM_ERASE_NS        1500000U  // 8 KB page erase
+#define FLASH_SIM_PROGRAM_NS      118000U   // 128-bit quadword program
+#define FLASH_SIM_ENDURANCE       10000U    // Erase cycles before a page fails
+
+enum FlashSimFault {
+    FLASH_SIM_FAULT_NONE,
+    FLASH_SIM_FAULT_UNLOCK,     // HAL_FLASH_Unlock returns HAL_ERROR
+    FLASH_SIM_FAULT_ERASE,      // HAL_FLASHEx_Erase fails, page untouched
+    FLASH_SIM_FAULT_PROGRAM,    // HAL_FLASH_Program fails, quadword untouched
+    FLASH_SIM_FAULT_BITFLIP,    // HAL_FLASH_Program succeeds but drops one bit
+};
+
+struct FlashSimDevice;
+
+struct FlashSimStats {
+    uint64_t timeNs;            // Simulated clock: flash operations plus flashSim_advance
+    uint32_t unlocks;
+    uint32_t pagesErased;
+    uint32_t quadwordsProgrammed;
+    uint32_t programErrors;     // Rejected by the write-once/alignment/lock rules
+    uint32_t faultsInjected;
+    uint64_t stallNs;           // Code bank busy, CPU frozen
+    uint64_t ramOnlyNs;         // Code bank busy, only RAM code running
+    uint64_t concurrentNs;      // Other bank busy, code running alongside
+    uint64_t maxStallNs;        // Longest single freeze
+};
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+// Map the flash array onto imagePath (created erased if needed), or onto
+// anonymous memory when imagePath is nullptr. Returns 0 for success.
+int flashSim_open(const char* imagePath);
+void flashSim_close(void);
+
+// An additional device, open on erased anonymous memory with the default
+// timing; nullptr if it cannot be mapped. A device is bound to at most one
+// thread at a time.
+FlashSimDevice* flashSim_create(void);
+void flashSim_destroy(FlashSimDevice* device);
+
+// Bind device to the calling thread, nullptr for the default device.
+// Returns the device bound before, nullptr for the default one.
+FlashSimDevice* flashSim_bind(FlashSimDevice* device);
+
+// Latency model; realTime also busy-waits so wall clock measurements match
+void flashSim_setTiming(uint32_t eraseNs, uint32_t programNs, bool realTime);
+void flashSim_setEndurance(uint32_t cycles);
+
+// Let simulated time pass outside the flash, e.g. waiting for a link.
+// Completes a background erase whose time is up.
+void flashSim_advance(uint64_t ns);
+
+// Bank the simulated CPU executes from (default FLASH_BANK_1, 0 for code
+// running from RAM only). Flash operations on that bank stall it unless
+// they are issued from the RAM routines.
+void flashSim_setCodeBank(uint32_t bank);
+
+// Arm a fault to fire on the Nth following matching operation (1 = next)
+void flashSim_injectFault(FlashSimFault fault, uint32_t afterOps);
+
+uint32_t flashSim_getEraseCount(uint32_t bank, uint32_t page);
+void flashSim_getStats(FlashSimStats* stats);
+void flashSim_resetStats(void);
+
+#endif // FLASH_SIM_H
@@ -0,0 +1,104 @@
+/*
+ * host_config_params.h
+ *
+ *  Parameter schema of the host build (CONFIG_PARAMS_FILE): a sensor
+ *  node's calibration table and settings, used by the schema benches. IDs
+ *  start at 5000 so they do not collide with the IDs of the other benches.
+ *  The migrations lead images of the two earlier releases to this one.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef HOST_CONFIG_PARAMS_H
+#define HOST_CONFIG_PARAMS_H
+
+#define CONFIG_PARAMS(INT, STRING) \
+    INT(cal_x0, 5000, 0, -32768, 32767) \
+    INT(cal_y0, 5001, 0, -32768, 32767) \
+    INT(cal_z0, 5002, 0, -32768, 32767) \
+    INT(cal_x1, 5003, 0, -32768, 32767) \
+    INT(cal_y1, 5004, 0, -32768, 32767) \
+    INT(cal_z1, 5005, 0, -32768, 32767) \
+    INT(cal_x2, 5006, 0, -32768, 32767) \
+    INT(cal_y2, 5007, 0, -32768, 32767) \
+    INT(cal_z2, 5008, 0, -32768, 32767) \
+    INT(cal_x3, 5009, 0, -32768, 32767) \
+    INT(cal_y3, 5010, 0, -32768, 32767) \
+    INT(cal_z3, 5011, 0, -32768, 32767) \
+    INT(cal_x4, 5012, 0, -32768, 32767) \
+    INT(cal_y4, 5013, 0, -32768, 32767) \
+    INT(cal_z4, 5014, 0, -32768, 32767) \
+    INT(cal_x5, 5015, 0, -32768, 32767) \
+    INT(cal_y5, 5016, 0, -32768, 32767) \
+    INT(cal_z5, 5017, 0, -32768, 32767) \
+    INT(cal_x6, 5018, 0, -32768, 32767) \
+    INT(cal_y6, 5019, 0, -32768, 32767) \
+    INT(cal_z6, 5020, 0, -32768, 32767) \
+    INT(cal_x7, 5021, 0, -32768, 32767) \
+    INT(cal_y7, 5022, 0, -32768, 32767) \
+    INT(cal_z7, 5023, 0, -32768, 32767) \
+    INT(cal_x8, 5024, 0, -32768, 32767) \
+    INT(cal_y8, 5025, 0, -32768, 32767) \
+    INT(cal_z8, 5026, 0, -32768, 32767) \
+    INT(cal_x9, 5027, 0, -32768, 32767) \
+    INT(cal_y9, 5028, 0, -32768, 32767) \
+    INT(cal_z9, 5029, 0, -32768, 32767) \
+    INT(cal_x10, 5030, 0, -32768, 32767) \
+    INT(cal_y10, 5031, 0, -32768, 32767) \
+    INT(cal_z10, 5032, 0, -32768, 32767) \
+    INT(cal_x11, 5033, 0, -32768, 32767) \
+    INT(cal_y11, 5034, 0, -32768, 32767) \
+    INT(cal_z11, 5035, 0, -32768, 32767) \
+    INT(cal_x12, 5036, 0, -32768, 32767) \
+    INT(cal_y12, 5037, 0, -32768, 32767) \
+    INT(cal_z12, 5038, 0, -32768, 32767) \
+    INT(cal_x13, 5039, 0, -32768, 32767) \
+    INT(cal_y13, 5040, 0, -32768, 32767) \
+    INT(cal_z13, 5041, 0, -32768, 32767) \
+    INT(cal_x14, 5042, 0, -32768, 32767) \
+    INT(cal_y14, 5043, 0, -32768, 32767) \
+    INT(cal_z14, 5044, 0, -32768, 32767) \
+    INT(cal_x15, 5045, 0, -32768, 32767) \
+    INT(cal_y15, 5046, 0, -32768, 32767) \
+    INT(cal_z15, 5047, 0, -32768, 32767) \
+    INT(sample_rate_hz, 5048, 100, 1, 1000) \
+    INT(filter_taps, 5049, 16, 1, 64) \
+    INT(tx_power_dbm, 5050, 10, -20, 20) \
+    INT(baud_rate, 5051, 115200, 9600, 4000000) \
+    INT(log_level, 5052, 2, 0, 5) \
+    INT(watchdog_ms, 5053, 2000, 100, 60000) \
+    INT(retry_count, 5054, 3, 0, 10) \
+    INT(heartbeat_s, 5055, 30, 1, 3600) \
+    INT(gain, 5056, 1, 1, 128) \
+    INT(offset, 5057, 0, -1000, 1000) \
+    INT(threshold_low, 5058, 100, 0, 4095) \
+    INT(threshold_high, 5059, 3900, 0, 4095) \
+    STRING(device_name, 5060, "sensor") \
+    STRING(site, 5061, "") \
+    STRING(owner, 5062, "") \
+    STRING(wifi_ssid, 5063, "") \
+    STRING(server_host, 5064, "telemetry.local") \
+    STRING(timezone, 5065, "UTC") \
+    STRING(unit_label, 5066, "mV") \
+    STRING(notes, 5067, "")
+
+// Version 1 moved the settings into the 5000 block and stored the baud rate
+// as a number; version 2 split the packed thresholds, merged the gain steps
+// and raised the filter_taps default from 8.
+#define CONFIG_SCHEMA_VERSION 2
+#define CONFIG_MIGRATIONS(RENAME, RETYPE, SPLIT, MERGE, DEFAULT, DROP) \
+    RENAME(1, 4048, CONFIG_sample_rate_hz) \
+    RENAME(1, 4049, CONFIG_filter_taps) \
+    RENAME(1, 4051, CONFIG_baud_rate) \
+    RETYPE(1, CONFIG_baud_rate, 'i') \
+    SPLIT(2, 4100, CONFIG_threshold_low, 0, 12) \
+    SPLIT(2, 4100, CONFIG_threshold_high, 12, 12) \
+    DROP(2, 4100) \
+    MERGE(2, 4101, CONFIG_gain, 4, 3) \
+    MERGE(2, 4102, CONFIG_gain, 0, 4) \
+    DROP(2, 4101) \
+    DROP(2, 4102) \
+    DEFAULT(2, CONFIG_filter_taps, 8)
+
+#endif // HOST_CONFIG_PARAMS_H
@@ -0,0 +1,26 @@
+/*
+ * host_tools.h
+ *
+ *  Entry points of the host tools dispatched from host_main.cpp.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef HOST_TOOLS_H
+#define HOST_TOOLS_H
+
+#include <cstdint>
+
+// Number of operator new calls since start-up
+uint64_t host_allocations();
+
+// Tools: argv[0] is the tool name, returns the process exit code
+int bench_main(int argc, char** argv);
+int tracedump_main(int argc, char** argv);
+int logdump_main(int argc, char** argv);
+int imagebuild_main(int argc, char** argv);
+int inspect_main(int argc, char** argv);
+int fleet_main(int argc, char** argv);
+
+#endif // HOST_TOOLS_H
@@ -0,0 +1,28 @@
+/*
+ * image_manifest.h
+ *
+ *  Entry specs shared by the image tools. A manifest column (imagebuild) or
+ *  a names file (inspect) names each entry as [config.|firmware.]name:id:type
+ *  with type i (integer) or s (string).
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef IMAGE_MANIFEST_H
+#define IMAGE_MANIFEST_H
+
+#include <string>
+
+struct ImageField {
+    std::string spec;          // Column header / JSON key
+    std::string name;
+    int id;
+    char type;                 // 'i' or 's'
+    bool firmware;
+};
+
+// Fill field from spec; false if spec is not an entry spec
+bool imageParseFieldSpec(const std::string& spec, ImageField& field);
+
+#endif // IMAGE_MANIFEST_H
@@ -0,0 +1,25 @@
+/*
+ * main.h
+ *
+ *  Host replacement for the CubeMX generated main.h.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#include "stm32u5xx_hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void Error_Handler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MAIN_H
@@ -0,0 +1,54 @@
+/*
+ * serial_loopback.h
+ *
+ *  In-process transport for serial_protocol.h on the host. The client
+ *  transport hands each request to a simulated device, which receives it
+ *  into its own frame buffer and answers it there with serialPoll, as the
+ *  firmware does behind a UART. Frames are counted and the time they would
+ *  take on a serial link is modelled.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef SERIAL_LOOPBACK_H
+#define SERIAL_LOOPBACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include "serial_protocol.h"
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define SERIAL_LOOPBACK_BITS_PER_BYTE 10U  // 8N1: start and stop bit
+
+struct SerialLoopback {
+    uint8_t deviceFrame[SERIAL_FRAME_SIZE]; // Receive buffer of the device
+    uint8_t wire[SERIAL_FRAME_SIZE];        // Frame in flight
+    size_t wireSize;                        // 0 when nothing is in flight
+    uint32_t linkBps;                       // 0 for no link time
+    uint32_t turnaroundNs;                  // Added once per request
+    uint64_t linkNs;                        // Modelled link time so far
+    uint64_t frames;                        // Requests answered
+    uint64_t bytes;                         // Bytes sent both ways
+    SerialTransport device;                 // Device side of the link
+};
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+void serialLoopbackInit(SerialLoopback* loopback, uint32_t linkBps, uint32_t turnaroundNs);
+
+// Client side transport; send delivers the request and runs the device
+SerialTransport serialLoopbackClient(SerialLoopback* loopback);
+
+void serialLoopbackResetStats(SerialLoopback* loopback);
+
+#endif // SERIAL_LOOPBACK_H
@@ -0,0 +1,102 @@
+/*
+ * stm32u5xx_hal.h
+ *
+ *  Host shim for the subset of the STM32U5 HAL used by flash_program.cpp.
+ *  The flash calls are serviced by the simulator in flash_sim.cpp.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#ifndef STM32U5XX_HAL_H
+#define STM32U5XX_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//-----------------------------------------------------------------------------
+//
+// Public Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define __IO volatile
+
+typedef enum {
+    HAL_OK      = 0x00U,
+    HAL_ERROR   = 0x01U,
+    HAL_BUSY    = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+// STM32U585 geometry: 2 banks of 128 pages, 8 KB per page
+#define FLASH_BASE                 0x08000000UL
+#define FLASH_PAGE_SIZE            0x00002000UL
+#define FLASH_PAGE_NB              128U
+#define FLASH_BANK_SIZE            (FLASH_PAGE_NB * FLASH_PAGE_SIZE)
+#define FLASH_SIZE                 (2U * FLASH_BANK_SIZE)
+
+#define FLASH_BANK_1               0x00000001U
+#define FLASH_BANK_2               0x00000002U
+#define FLASH_BANK_BOTH            (FLASH_BANK_1 | FLASH_BANK_2)
+
+#define FLASH_TYPEERASE_PAGES      0x00000000U
+#define FLASH_TYPEERASE_MASSERASE  0x00000004U
+
+#define FLASH_TYPEPROGRAM_QUADWORD 0x00000001U
+
+#define FLASH_FLAG_BSY             0x00010000U
+#define FLASH_FLAG_EOP             0x00000001U
+#define FLASH_FLAG_OPERR           0x00000002U
+#define FLASH_FLAG_PROGERR         0x00000008U
+#define FLASH_FLAG_WRPERR          0x00000010U
+
+#define FLASH_TIMEOUT_VALUE        1000U  // ms, as in stm32u5xx_hal_flash.h
+
+// Flash is not memory mapped on the host; translate through the simulator
+#define FLASH_MAP(addr)            flashSim_map((uint32_t)(addr))
+
+// Read-while-write model: the simulator decides which bank code is fetched
+// from and is told while flash_program.cpp runs its RAM routines
+#define FLASH_CODE_BANK()          flashSim_codeBank()
+#define FLASH_RAM_EXEC(running)    flashSim_ramExecution(running)
+
+typedef struct {
+    uint32_t TypeErase;   // Mass erase or page erase
+    uint32_t Banks;       // FLASH_BANK_1 / FLASH_BANK_2
+    uint32_t Page;        // First page to erase
+    uint32_t NbPages;     // Number of pages to erase
+} FLASH_EraseInitTypeDef;
+
+//-----------------------------------------------------------------------------
+//
+// Public Functions
+//
+//-----------------------------------------------------------------------------
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uintptr_t DataAddress);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError);
+HAL_StatusTypeDef HAL_FLASHEx_Erase_IT(FLASH_EraseInitTypeDef *pEraseInit);
+HAL_StatusTypeDef FLASH_WaitForLastOperation(uint32_t Timeout);
+uint32_t HAL_FLASH_GetError(void);
+
+// Completion callbacks of the _IT operations. The simulator calls them when
+// the operation completes, standing in for HAL_FLASH_IRQHandler.
+void HAL_FLASH_EndOfOperationCallback(uint32_t ReturnValue);
+void HAL_FLASH_OperationErrorCallback(uint32_t ReturnValue);
+
+__IO uint8_t* flashSim_map(uint32_t addr);
+uint32_t flashSim_codeBank(void);
+void flashSim_ramExecution(int running);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STM32U5XX_HAL_H
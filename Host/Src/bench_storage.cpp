@@ -0,0 +1,1686 @@
+/*
+ * bench_storage.cpp
+ *
+ *  Microbenchmarks for the config store and its flash path, run against the
+ *  flash simulator. Every measurement is printed as one JSON object per line
+ *  so results can be diffed between releases.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "host_tools.h"
+#include "flash_sim.h"
+#include "flash_program.h"
+#include "config.h"
+#include "config_schema.h"
+#include "config_migrate.h"
+#include "config_bind.h"
+#include "InitArrayMap.h"
+#include "storage_stats.h"
+#include "fw_image.h"
+#include "flash_digest.h"
+#include "flash_log.h"
+#include "cal_table.h"
+#include "flash_fs.h"
+#include "flash_qwbuf.h"
+#include "flash_partition.h"
+#include "config_history.h"
+#include "flashFile.h"
+#include "lz.h"
+#include "serial_protocol.h"
+#include "serial_loopback.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE 256            // Must match the buffer used by flashConfig
+#endif
+
+#define QUERY_COUNT 1024           // Size of the precomputed lookup pattern
+
+static const uint32_t entryCounts[] = {5, 50, 500, 1000};
+static const uint32_t stringLengths[] = {8, 24, MAX_STRING_LENGTH - 1};
+static const uint32_t hitPercents[] = {100, 50, 0};
+
+struct BenchResult {
+    const char* bench;
+    const char* kind;          // "int" or "string" store
+    uint32_t entries;
+    uint32_t strLen;
+    int hitPct;                // -1 when not applicable
+    uint64_t ops;
+    double nsPerOp;
+    uint32_t bytesPerCommit;
+    double allocsPerOp;
+    uint64_t flashNsPerOp;     // Simulated flash time, flash benches only
+    const char* status;
+    uint32_t pages;            // Wear-leveled region size, 0 when not applicable
+    uint32_t maxPageErases;    // Highest erase count of any page in the region
+    double ratio;              // Serialized / compressed size, compression benches only
+};
+
+static double minRunNs = 20e6;
+static const char* benchFilter = nullptr;
+static volatile int benchSink;
+
+static void report(const BenchResult& r) {
+    std::printf("{\"bench\":\"%s\",\"kind\":\"%s\",\"entries\":%u,\"strlen\":%u,",
+                r.bench, r.kind, r.entries, r.strLen);
+    if (r.hitPct >= 0) {
+        std::printf("\"hit_pct\":%d,", r.hitPct);
+    }
+    if (r.pages) {
+        std::printf("\"pages\":%u,\"max_page_erases\":%u,", r.pages, r.maxPageErases);
+    }
+    if (r.ratio > 0) {
+        std::printf("\"ratio\":%.2f,", r.ratio);
+    }
+    std::printf("\"ops\":%llu,\"ns_per_op\":%.1f,\"bytes_per_commit\":%u,"
+                "\"allocs_per_op\":%.3f,\"flash_ns_per_op\":%llu,\"status\":\"%s\"}\n",
+                (unsigned long long) r.ops, r.nsPerOp, r.bytesPerCommit, r.allocsPerOp,
+                (unsigned long long) r.flashNsPerOp, r.status);
+    std::fflush(stdout);
+}
+
+static BenchResult makeResult(const char* bench, const char* kind, uint32_t entries,
+                              uint32_t strLen, int hitPct) {
+    BenchResult r = {};
+    r.bench = bench;
+    r.kind = kind;
+    r.entries = entries;
+    r.strLen = strLen;
+    r.hitPct = hitPct;
+    r.status = "ok";
+    return r;
+}
+
+static bool selected(const char* bench) {
+    return !benchFilter || std::strstr(bench, benchFilter);
+}
+
+// Run op in batches until minRunNs has elapsed; fills ops, nsPerOp, allocsPerOp
+template <typename Op>
+static void measure(BenchResult& r, Op op, uint64_t maxOps = ~0ULL) {
+    uint64_t allocStart = host_allocations();
+    uint64_t batch = 1;
+    uint64_t ops = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    while (elapsed < minRunNs && ops < maxOps) {
+        uint64_t count = (maxOps - ops < batch) ? maxOps - ops : batch;
+        for (uint64_t i = 0; i < count; ++i) {
+            op(ops + i);
+        }
+        ops += count;
+        if (batch < 4096) {
+            batch *= 2;
+        }
+        elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+    r.ops = ops;
+    r.nsPerOp = elapsed / ops;
+    r.allocsPerOp = (double)(host_allocations() - allocStart) / ops;
+}
+
+static uint32_t lcg(uint32_t& state) {
+    state = state * 1664525U + 1013904223U;
+    return state >> 8;
+}
+
+static void makeName(char* name, int id) {
+    std::snprintf(name, MAX_STRING_LENGTH, "param_%04d", id);
+}
+
+static void makeString(char* value, uint32_t len, int id) {
+    for (uint32_t i = 0; i < len; ++i) {
+        value[i] = (char)('a' + (id + i) % 26);
+    }
+    value[len] = '\0';
+}
+
+// Populate the store with ids 0..entries-1; strLen 0 builds an int store
+static void populate(uint32_t entries, uint32_t strLen) {
+    char name[MAX_STRING_LENGTH];
+    char value[MAX_STRING_LENGTH];
+    configClear();
+    for (uint32_t id = 0; id < entries; ++id) {
+        makeName(name, id);
+        if (strLen) {
+            makeString(value, strLen, id);
+            configWrite(name, id, 's', value);
+        } else {
+            int v = (int) id * 3;
+            configWrite(name, id, 'i', &v);
+        }
+    }
+}
+
+// Change entry 0 so the next commit has something to write
+static void touchEntry(uint32_t strLen, uint64_t i) {
+    char value[MAX_STRING_LENGTH];
+    if (strLen) {
+        makeString(value, strLen, (int) i);
+        configWriteString(0, value);
+    } else {
+        configWriteInt(0, (int) i);
+    }
+}
+
+// Lookup ids with the requested share of hits; misses use ids past the store
+static std::vector<int> makeQueries(uint32_t entries, uint32_t hitPct) {
+    std::vector<int> queries(QUERY_COUNT);
+    uint32_t state = entries * 7919U + hitPct;
+    for (int& q : queries) {
+        bool hit = (lcg(state) % 100) < hitPct;
+        q = hit ? (int)(lcg(state) % entries) : (int)(entries + lcg(state) % entries);
+    }
+    return queries;
+}
+
+static void benchLookups(uint32_t entries) {
+    populate(entries, 0);
+    for (uint32_t hitPct : hitPercents) {
+        std::vector<int> queries = makeQueries(entries, hitPct);
+        if (selected("configGetInt")) {
+            BenchResult r = makeResult("configGetInt", "int", entries, 0, (int) hitPct);
+            measure(r, [&](uint64_t i) { benchSink = configGetInt(queries[i % QUERY_COUNT]); });
+            report(r);
+        }
+        if (selected("configGetIDFromName")) {
+            std::vector<char> names(QUERY_COUNT * MAX_STRING_LENGTH);
+            for (uint32_t i = 0; i < QUERY_COUNT; ++i) {
+                makeName(&names[i * MAX_STRING_LENGTH], queries[i]);
+            }
+            BenchResult r = makeResult("configGetIDFromName", "int", entries, 0, (int) hitPct);
+            measure(r, [&](uint64_t i) {
+                benchSink = configGetIDFromName(&names[(i % QUERY_COUNT) * MAX_STRING_LENGTH]);
+            });
+            report(r);
+        }
+    }
+
+    // Diagnostics export of every entry: probing each possible ID against
+    // one ordered pass; ns_per_op is per complete export
+    if (selected("configExport")) {
+        BenchResult r = makeResult("configExport", "probe", entries, 0, -1);
+        measure(r, [&](uint64_t) {
+            int sum = 0;
+            for (uint32_t id = 0; id < entries; ++id) {
+                sum += configGetInt((int)id);
+            }
+            benchSink = sum;
+        });
+        report(r);
+
+        r = makeResult("configExport", "forEach", entries, 0, -1);
+        measure(r, [&](uint64_t) {
+            int sum = 0;
+            configForEach([](const StoreEntryView& e, void* context) {
+                *static_cast<int*>(context) += e.value;
+                return true;
+            }, &sum);
+            benchSink = sum;
+        });
+        report(r);
+    }
+}
+
+// Compression ratio and speed of the serialized store, and the flash cost of
+// committing and loading it compressed
+static void benchCompression(uint32_t entries, uint32_t strLen, uint32_t* image,
+                             size_t imageSize, bool flushed) {
+    const char* kind = strLen ? "string" : "int";
+    static uint8_t packed[FLASH_PAGE_SIZE];
+    static uint8_t unpacked[FLASH_PAGE_SIZE];
+    uint32_t packedSize = 0;
+
+    if (flushed) {
+        packedSize = lz_compress(reinterpret_cast<uint8_t*>(image), (uint32_t)imageSize, packed, sizeof(packed));
+    }
+
+    if (selected("lzCompress")) {
+        BenchResult r = makeResult("lzCompress", kind, entries, strLen, -1);
+        if (packedSize) {
+            measure(r, [&](uint64_t) {
+                benchSink = (int)lz_compress(reinterpret_cast<uint8_t*>(image), (uint32_t)imageSize,
+                                             packed, sizeof(packed));
+            });
+            r.bytesPerCommit = packedSize;
+            r.ratio = (double)imageSize / packedSize;
+        } else {
+            r.status = flushed ? "incompressible" : "exceeds_page";
+        }
+        report(r);
+    }
+
+    if (selected("lzDecompress")) {
+        BenchResult r = makeResult("lzDecompress", kind, entries, strLen, -1);
+        if (packedSize) {
+            uint32_t size = 0;
+            measure(r, [&](uint64_t) {
+                size = lz_decompress(packed, packedSize, unpacked, sizeof(unpacked));
+            });
+            r.bytesPerCommit = packedSize;
+            r.ratio = (double)imageSize / packedSize;
+            if (size != imageSize || std::memcmp(unpacked, image, imageSize) != 0) {
+                r.status = "mismatch";
+            }
+        } else {
+            r.status = flushed ? "incompressible" : "exceeds_page";
+        }
+        report(r);
+    }
+
+    uint32_t address = flash_partition(FLASH_PARTITION_user).address;
+    bool fits = flushed && imageSize <= BUFFER_SIZE;
+
+    fileSetCompression(true);
+    if (selected("flashConfigLz")) {
+        BenchResult r = makeResult("flashConfigLz", kind, entries, strLen, -1);
+        if (fits) {
+            int failures = 0;
+            flashSim_resetStats();
+            measure(r, [&](uint64_t i) {
+                touchEntry(strLen, i);
+                failures += flashConfig(address);
+            }, 200);
+            FlashSimStats stats;
+            flashSim_getStats(&stats);
+            r.bytesPerCommit = (uint32_t)(stats.quadwordsProgrammed * FLASH_SIM_QUADWORD / r.ops);
+            r.flashNsPerOp = stats.timeNs / r.ops;
+            r.status = failures ? "error" : "ok";
+        } else {
+            r.status = "exceeds_buffer";
+        }
+        report(r);
+    }
+
+    if (selected("loadConfigLz")) {
+        BenchResult r = makeResult("loadConfigLz", kind, entries, strLen, -1);
+        if (fits) {
+            int failures = flashConfig(address);
+            measure(r, [&](uint64_t) {
+                configClear();
+                failures += loadConfig(address);
+            });
+            r.bytesPerCommit = (uint32_t) imageSize;
+            r.status = failures ? "error" : "ok";
+        } else {
+            r.status = "exceeds_buffer";
+        }
+        report(r);
+    }
+    fileSetCompression(false);
+}
+
+static void benchStore(uint32_t entries, uint32_t strLen) {
+    const char* kind = strLen ? "string" : "int";
+    static uint32_t buffer[FLASH_PAGE_SIZE / sizeof(uint32_t)];
+    char value[MAX_STRING_LENGTH];
+    char name[MAX_STRING_LENGTH];
+    populate(entries, strLen);
+
+    if (selected("configWrite")) {
+        // Overwrite existing entries, which is the common parameter update path
+        std::vector<int> queries = makeQueries(entries, 100);
+        BenchResult r = makeResult("configWrite", kind, entries, strLen, -1);
+        measure(r, [&](uint64_t i) {
+            int id = queries[i % QUERY_COUNT];
+            makeName(name, id);
+            if (strLen) {
+                makeString(value, strLen, id + (int) i);
+                benchSink = configWrite(name, id, 's', value);
+            } else {
+                int v = (int) i;
+                benchSink = configWrite(name, id, 'i', &v);
+            }
+        });
+        report(r);
+    }
+
+    size_t imageSize = sizeof(buffer);
+    int flushResult = configFlush(buffer, imageSize);
+
+    if (selected("configFlush")) {
+        BenchResult r = makeResult("configFlush", kind, entries, strLen, -1);
+        if (flushResult == 0) {
+            measure(r, [&](uint64_t) {
+                size_t size = sizeof(buffer);
+                benchSink = configFlush(buffer, size);
+            });
+            r.bytesPerCommit = (uint32_t) imageSize;
+        } else {
+            r.status = "exceeds_page";
+        }
+        report(r);
+    }
+
+    if (selected("processConfigBuffer")) {
+        BenchResult r = makeResult("processConfigBuffer", kind, entries, strLen, -1);
+        if (flushResult == 0) {
+            measure(r, [&](uint64_t) {
+                configClear();
+                processConfigBuffer(reinterpret_cast<uint8_t*>(buffer), imageSize);
+            });
+            r.bytesPerCommit = (uint32_t) imageSize;
+            // The decoded store must serialize back to the same image
+            static uint32_t check[FLASH_PAGE_SIZE / sizeof(uint32_t)];
+            size_t checkSize = sizeof(check);
+            if (configFlush(check, checkSize) != 0 || checkSize != imageSize ||
+                std::memcmp(check, buffer, imageSize) != 0) {
+                r.status = "mismatch";
+            }
+        } else {
+            r.status = "exceeds_page";
+        }
+        report(r);
+    }
+
+    uint32_t address = flash_partition(FLASH_PARTITION_user).address;
+    bool fits = flushResult == 0 && imageSize <= BUFFER_SIZE;
+
+    if (selected("flashConfig")) {
+        BenchResult r = makeResult("flashConfig", kind, entries, strLen, -1);
+        if (fits) {
+            int failures = 0;
+            flashSim_resetStats();
+            measure(r, [&](uint64_t i) {
+                touchEntry(strLen, i);
+                failures += flashConfig(address);
+            }, 200);
+            FlashSimStats stats;
+            flashSim_getStats(&stats);
+            r.bytesPerCommit = (uint32_t)(stats.quadwordsProgrammed * FLASH_SIM_QUADWORD / r.ops);
+            r.flashNsPerOp = stats.timeNs / r.ops;
+            r.status = failures ? "error" : "ok";
+        } else {
+            r.status = "exceeds_buffer";
+        }
+        report(r);
+    }
+
+    if (selected("flashConfigUnchanged")) {
+        // Commit without changes: compared against flash and skipped
+        BenchResult r = makeResult("flashConfigUnchanged", kind, entries, strLen, -1);
+        if (fits) {
+            int failures = flashConfig(address);
+            flashSim_resetStats();
+            measure(r, [&](uint64_t) { failures += flashConfig(address); });
+            FlashSimStats stats;
+            flashSim_getStats(&stats);
+            r.bytesPerCommit = (uint32_t)(stats.quadwordsProgrammed * FLASH_SIM_QUADWORD / r.ops);
+            r.flashNsPerOp = stats.timeNs / r.ops;
+            r.status = failures ? "error" : "ok";
+        } else {
+            r.status = "exceeds_buffer";
+        }
+        report(r);
+    }
+
+    benchCompression(entries, strLen, buffer, imageSize, flushResult == 0);
+
+    if (selected("loadConfig")) {
+        BenchResult r = makeResult("loadConfig", kind, entries, strLen, -1);
+        if (fits) {
+            flashConfig(address);
+            int failures = 0;
+            measure(r, [&](uint64_t) {
+                configClear();
+                failures += loadConfig(address);
+            });
+            r.bytesPerCommit = (uint32_t) imageSize;
+            r.status = failures ? "error" : "ok";
+        } else {
+            r.status = "exceeds_buffer";
+        }
+        report(r);
+    }
+}
+
+// Commit the same store repeatedly to wear-leveled regions of growing size;
+// the worst page's erase count should fall linearly with the page count
+static void benchWear(uint32_t entries) {
+    static const uint32_t regionPages[] = {1, 2, 4, 8};
+    const uint32_t commits = 240;
+
+    if (!selected("flashConfigRegion")) {
+        return;
+    }
+    populate(entries, 0);
+    for (uint32_t pages : regionPages) {
+        BenchResult r = makeResult("flashConfigRegion", "int", entries, 0, -1);
+        r.pages = pages;
+        FlashWearRegion region;
+        int failures = 0;
+        const FlashPartition& config = flash_partition(FLASH_PARTITION_config);
+        uint32_t firstPage = config.firstPage + config.pageCount - pages;
+        flash_partitionErase(FLASH_PARTITION_config);
+        flash_wearMount(&region, config.bank, firstPage, pages);
+        flashSim_resetStats();
+        measure(r, [&](uint64_t i) {
+            touchEntry(0, i);
+            failures += flashConfigRegion(&region);
+        }, commits);
+
+        FlashSimStats stats;
+        flashSim_getStats(&stats);
+        for (uint32_t i = 0; i < pages; ++i) {
+            uint32_t erases = flash_wearGetEraseCount(&region, i);
+            r.maxPageErases = erases > r.maxPageErases ? erases : r.maxPageErases;
+        }
+        r.bytesPerCommit = (uint32_t)(stats.quadwordsProgrammed * FLASH_SIM_QUADWORD / r.ops);
+        r.flashNsPerOp = stats.timeNs / r.ops;
+
+        // A fresh mount must find the commit that was written last
+        FlashWearRegion mounted;
+        flash_wearMount(&mounted, config.bank, firstPage, pages);
+        if (failures || mounted.newestIndex != region.newestIndex ||
+            mounted.sequence != region.sequence) {
+            r.status = "error";
+        }
+        report(r);
+    }
+}
+
+enum FwImageMode {
+    FW_IMAGE_PAGE_BUFFERED,        // Baseline: collect a page, erase, program
+    FW_IMAGE_ERASE_AHEAD,          // fwImageBegin
+    FW_IMAGE_DIFFERENTIAL,         // fwImageBeginDifferential
+};
+
+static const char* const fwImageModeNames[] = {"page_buffered", "erase_ahead", "differential"};
+
+// Simulated link delivering an image in chunks at linkBps (0 = as fast as
+// the writer takes it). A chunk can only be written once it has arrived and
+// the previous write call has returned. Returns the simulated update time.
+static uint64_t benchFwImageRun(uint32_t linkBps, uint32_t chunk, FwImageMode mode,
+                                const std::vector<uint8_t>& image, const FwImageRegion& region,
+                                uint64_t fullUpdateNs) {
+    std::vector<uint8_t> page(FLASH_PAGE_SIZE);
+    uint64_t chunkNs = linkBps ? (uint64_t)chunk * 8 * 1000000000ULL / linkBps : 0;
+    uint64_t maxStallNs = 0;
+    uint32_t pageFill = 0;
+    uint32_t pageAddress = region.address;
+    int failures = 0;
+    FlashSimStats stats;
+
+    flashSim_resetStats();
+    if (mode == FW_IMAGE_ERASE_AHEAD) {
+        failures += fwImageBegin(&region, (uint32_t)image.size());
+    } else if (mode == FW_IMAGE_DIFFERENTIAL) {
+        failures += fwImageBeginDifferential(&region, (uint32_t)image.size());
+    }
+    for (uint32_t offset = 0, k = 1; offset < image.size(); offset += chunk, ++k) {
+        uint32_t n = (uint32_t)image.size() - offset < chunk ? (uint32_t)image.size() - offset : chunk;
+        flashSim_getStats(&stats);
+        if (stats.timeNs < k * chunkNs) {
+            flashSim_advance(k * chunkNs - stats.timeNs); // Wait for the chunk to arrive
+        }
+        flashSim_getStats(&stats);
+        uint64_t callStart = stats.timeNs;
+
+        if (mode != FW_IMAGE_PAGE_BUFFERED) {
+            failures += fwImageWrite(image.data() + offset, n);
+        } else {
+            std::memcpy(page.data() + pageFill, image.data() + offset, n);
+            pageFill += n;
+            if (pageFill == FLASH_PAGE_SIZE || offset + n == image.size()) {
+                uint32_t bank, pageIndex;
+                findPageAndBank(pageAddress, &bank, &pageIndex);
+                failures += flash_pageErase(bank, pageIndex);
+                failures += flash_programQuadwords(pageAddress, page.data(), pageFill);
+                pageAddress += FLASH_PAGE_SIZE;
+                pageFill = 0;
+            }
+        }
+
+        flashSim_getStats(&stats);
+        maxStallNs = stats.timeNs - callStart > maxStallNs ? stats.timeNs - callStart : maxStallNs;
+    }
+    failures += mode != FW_IMAGE_PAGE_BUFFERED ? fwImageFinish() : 0;
+    flashSim_getStats(&stats);
+
+    FwImageStatus status = {};
+    if (mode != FW_IMAGE_PAGE_BUFFERED) {
+        fwImageGetStatus(&status);
+    }
+    bool match = std::memcmp((const void*)FLASH_MAP(region.address), image.data(), image.size()) == 0;
+    uint64_t linkNs = linkBps ? (uint64_t)image.size() * 8 * 1000000000ULL / linkBps : 0;
+    std::printf("{\"bench\":\"fwImage\",\"mode\":\"%s\",\"link_bps\":%u,\"chunk\":%u,"
+                "\"image_bytes\":%u,\"update_ms\":%.2f,\"link_ms\":%.2f,\"max_write_stall_us\":%.1f,"
+                "\"erase_waits\":%u,\"pages_written\":%u,\"pages_skipped\":%u,",
+                fwImageModeNames[mode], linkBps, chunk, (uint32_t)image.size(),
+                stats.timeNs / 1e6, linkNs / 1e6, maxStallNs / 1e3, status.eraseWaits,
+                stats.pagesErased, status.pagesSkipped);
+    if (fullUpdateNs) {
+        std::printf("\"time_saved_ms\":%.2f,", ((double)fullUpdateNs - (double)stats.timeNs) / 1e6);
+    }
+    std::printf("\"status\":\"%s\"}\n", failures || !match ? "error" : "ok");
+    std::fflush(stdout);
+    return stats.timeNs;
+}
+
+// Put an image into flash without reporting, as the starting point of a run
+static int fwImageLoad(const std::vector<uint8_t>& image, const FwImageRegion& region) {
+    int failures = fwImageBegin(&region, (uint32_t)image.size());
+    failures += fwImageWrite(image.data(), (uint32_t)image.size());
+    return failures + fwImageFinish();
+}
+
+static void benchFwImage(void) {
+    static const uint32_t linkRates[] = {115200, 921600, 4000000, 0};
+    const uint32_t imageSize = 8 * FLASH_PAGE_SIZE - 100;  // Ends on a partial quadword
+    const uint32_t chunk = 256;
+
+    if (!selected("fwImage")) {
+        return;
+    }
+    std::vector<uint8_t> image(imageSize);
+    uint32_t seed = 7;
+    for (uint8_t& b : image) {
+        b = (uint8_t)lcg(seed);
+    }
+    FwImageRegion region = {flash_partition(FLASH_PARTITION_fwimage).address, 8 * FLASH_PAGE_SIZE};
+
+    // Minor release: a few small patches touching two of the eight pages
+    std::vector<uint8_t> patched(image);
+    for (uint32_t offset : {0x1234U, 0x1300U, 0x5F00U}) {
+        for (uint32_t i = 0; i < 64; ++i) {
+            patched[offset + i] ^= 0x5A;
+        }
+    }
+
+    // Every run updates from image to patched
+    for (uint32_t linkBps : linkRates) {
+        fwImageLoad(image, region);
+        benchFwImageRun(linkBps, chunk, FW_IMAGE_PAGE_BUFFERED, patched, region, 0);
+        fwImageLoad(image, region);
+        uint64_t fullNs = benchFwImageRun(linkBps, chunk, FW_IMAGE_ERASE_AHEAD, patched, region, 0);
+        fwImageLoad(image, region);
+        benchFwImageRun(linkBps, chunk, FW_IMAGE_DIFFERENTIAL, patched, region, fullNs);
+    }
+}
+
+// Boot validation of an image filling the fwimage partition: a CRC over the
+// whole image as fwImageFinish computes it, against the page digest table
+// in each mode. Every op starts from a cold table, as a boot does.
+static void benchBootValidate(void) {
+    static const char* const modeNames[] = {"table", "spot", "full"};
+    const uint32_t spotPages = 2;
+    const FlashPartition& area = flash_partition(FLASH_PARTITION_fwimage);
+
+    if (!selected("bootValidate")) {
+        return;
+    }
+    std::vector<uint8_t> image(area.size - 100);
+    uint32_t seed = 13;
+    for (uint8_t& b : image) {
+        b = (uint8_t)lcg(seed);
+    }
+    FwImageRegion region = {area.address, area.size};
+    int failures = fwImageLoad(image, region);
+    uint32_t pages = (uint32_t)((image.size() + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE);
+    const uint8_t* flash = (const uint8_t*)FLASH_MAP(area.address);
+    uint32_t crc = util_crc32(0, image.data(), (uint32_t)image.size());
+
+    BenchResult r = makeResult("bootValidate", "crc", 0, 0, -1);
+    measure(r, [&](uint64_t) { failures += util_crc32(0, flash, (uint32_t)image.size()) != crc; });
+    std::printf("{\"bench\":\"bootValidate\",\"mode\":\"crc_sweep\",\"image_bytes\":%u,\"pages\":%u,"
+                "\"ops\":%llu,\"ns_per_op\":%.1f,\"bytes_read\":%u,\"pages_checked\":%u,"
+                "\"flash_ns_per_op\":0,\"status\":\"%s\"}\n",
+                (uint32_t)image.size(), pages, (unsigned long long)r.ops, r.nsPerOp,
+                (uint32_t)image.size(), pages, failures ? "error" : "ok");
+
+    for (int mode = FLASH_DIGEST_TABLE; mode <= FLASH_DIGEST_FULL; ++mode) {
+        FlashDigestReport report = {};
+        FlashSimStats stats;
+        failures = 0;
+        r = makeResult("bootValidate", modeNames[mode], 0, 0, -1);
+        flashSim_resetStats();
+        measure(r, [&](uint64_t) {
+            flash_digestForget();
+            failures += flash_digestValidate((FlashDigestMode)mode, spotPages, &report);
+        });
+        flashSim_getStats(&stats);
+        std::printf("{\"bench\":\"bootValidate\",\"mode\":\"%s\",\"image_bytes\":%u,\"pages\":%u,"
+                    "\"ops\":%llu,\"ns_per_op\":%.1f,\"bytes_read\":%u,\"pages_checked\":%u,"
+                    "\"flash_ns_per_op\":%llu,\"status\":\"%s\"}\n",
+                    modeNames[mode], (uint32_t)image.size(), pages, (unsigned long long)r.ops, r.nsPerOp,
+                    report.bytesRead, report.pagesChecked, (unsigned long long)(stats.timeNs / r.ops),
+                    failures || report.imageSize != image.size() ? "error" : "ok");
+    }
+    std::fflush(stdout);
+}
+
+// Calibration lookup as done before cal_table: walk the breakpoints, then
+// util_linear on the segment found
+static int32_t linearLookup(const int32_t* xs, const int32_t* ys, uint32_t count, int32_t x) {
+    uint32_t i = 0;
+    if (x <= xs[0]) {
+        return ys[0];
+    }
+    if (x >= xs[count - 1]) {
+        return ys[count - 1];
+    }
+    while (x >= xs[i + 1]) {
+        ++i;
+    }
+    return util_linear(x, xs[i], xs[i + 1], ys[i], ys[i + 1]);
+}
+
+// A random walk of sensor samples over 0..65535, a little past both ends,
+// looked up in a uniform and a breakpoint table flashed to magcal: the
+// util_linear loop against calTableEval and calTableEvalBatch. max_error is
+// against util_linear on the same points.
+static void benchCalLut(void) {
+    static const uint32_t pointCounts[] = {16, 64, 256};
+    static const char* const kindNames[] = {"uniform", "breakpoints"};
+    static const char* const modeNames[] = {"util_linear", "eval", "batch"};
+    static uint64_t image[FLASH_PAGE_SIZE / sizeof(uint64_t)];
+    const uint32_t samples = 4096;
+
+    if (!selected("calLut")) {
+        return;
+    }
+    std::vector<int32_t> x(samples);
+    std::vector<int32_t> y(samples);
+    uint32_t seed = 29;
+    int32_t walk = 32768;
+    for (int32_t& v : x) {
+        walk += (int32_t)(lcg(seed) % 1025) - 512;
+        walk = walk < -256 ? -256 : (walk > 65791 ? 65791 : walk);
+        v = walk;
+    }
+
+    for (uint32_t points : pointCounts) {
+        std::vector<int32_t> xs[2];
+        std::vector<int32_t> ys[2];
+        CalImageWriter writer;
+        int failures = 0;
+
+        // Uniform points, and breakpoints crowded towards 0; y a parabola
+        for (int kind = 0; kind < 2; ++kind) {
+            for (uint32_t i = 0; i < points; ++i) {
+                int32_t xi = (kind == 0) ? (int32_t)(i * (65535 / (points - 1)))
+                                         : (int32_t)(65535ULL * i * i / ((points - 1) * (points - 1)));
+                xs[kind].push_back(xi);
+                ys[kind].push_back((int32_t)((((int64_t)xi - 32768) * (xi - 32768)) >> 19) - 1024);
+            }
+        }
+        calImageBegin(&writer, (uint8_t*)image, sizeof(image));
+        failures += calImageAddUniform(&writer, 1, 0, 65535 / (points - 1), ys[0].data(), (uint16_t)points);
+        failures += calImageAddBreakpoints(&writer, 2, xs[1].data(), ys[1].data(), (uint16_t)points);
+        size_t size = calImageEnd(&writer);
+        failures += calImageFlash(FLASH_PARTITION_magcal, (const uint8_t*)image, size);
+
+        for (int kind = 0; kind < 2; ++kind) {
+            CalTable table = {};
+            if (calTableFind(FLASH_PARTITION_magcal, (uint16_t)(kind + 1), &table) != 0) {
+                ++failures;
+                continue;
+            }
+            for (int mode = 0; mode < 3; ++mode) {
+                BenchResult r = makeResult("calLut", kindNames[kind], points, 0, -1);
+                measure(r, [&](uint64_t) {
+                    if (mode == 0) {
+                        for (uint32_t k = 0; k < samples; ++k) {
+                            y[k] = linearLookup(xs[kind].data(), ys[kind].data(), points, x[k]);
+                        }
+                    } else if (mode == 1) {
+                        for (uint32_t k = 0; k < samples; ++k) {
+                            y[k] = calTableEval(&table, x[k]);
+                        }
+                    } else {
+                        calTableEvalBatch(&table, x.data(), y.data(), samples);
+                    }
+                    benchSink += y[samples - 1];
+                });
+
+                int32_t maxError = 0;
+                for (uint32_t k = 0; k < samples; ++k) {
+                    int32_t error = y[k] - linearLookup(xs[kind].data(), ys[kind].data(), points, x[k]);
+                    error = error < 0 ? -error : error;
+                    maxError = error > maxError ? error : maxError;
+                }
+                std::printf("{\"bench\":\"calLut\",\"table\":\"%s\",\"points\":%u,\"mode\":\"%s\","
+                            "\"image_bytes\":%u,\"samples\":%u,\"ops\":%llu,\"ns_per_sample\":%.2f,"
+                            "\"max_error\":%d,\"status\":\"%s\"}\n",
+                            kindNames[kind], points, modeNames[mode], (uint32_t)size, samples,
+                            (unsigned long long)r.ops, r.nsPerOp / samples, maxError,
+                            failures || maxError > 1 ? "error" : "ok");
+            }
+        }
+    }
+    std::fflush(stdout);
+}
+
+// Every schema parameter written with a share of them moved off their
+// default: "sparse" stores them under their schema IDs, "dense" under
+// undeclared IDs as before the schema, so every value takes an entry
+static void benchSchema(void) {
+    static const uint32_t overridePercents[] = {0, 10, 50, 100};
+    static uint32_t buffer[FLASH_PAGE_SIZE / sizeof(uint32_t)];
+    const int denseOffset = 1000;
+
+    if (configSchemaCount == 0) {
+        return; // Host build without CONFIG_PARAMS_FILE
+    }
+    for (uint32_t pct : overridePercents) {
+        for (int dense = 0; dense <= 1; ++dense) {
+            BenchResult r = makeResult("schemaFlush", dense ? "dense" : "sparse", configSchemaCount, 0, -1);
+            if (!selected(r.bench)) {
+                continue;
+            }
+            uint32_t state = 12345;
+            configClear();
+            measure(r, [&](uint64_t i) {
+                const ConfigParam& p = configSchema[i % configSchemaCount];
+                bool changed = lcg(state) % 100 < pct;
+                int id = p.id + (dense ? denseOffset : 0);
+                if (p.type == 'i') {
+                    int v = changed ? (p.defaultValue < p.max ? p.defaultValue + 1 : p.defaultValue - 1)
+                                    : p.defaultValue;
+                    benchSink = configWrite(p.name, id, 'i', &v);
+                } else {
+                    benchSink = configWrite(p.name, id, 's', changed ? "changed" : p.defaultString);
+                }
+                if ((i + 1) % configSchemaCount == 0) {
+                    size_t size = sizeof(buffer);
+                    benchSink = configFlush(buffer, size);
+                    r.bytesPerCommit = (uint32_t)size;
+                    state = 12345; // Same values next round
+                }
+            }, 200ULL * configSchemaCount);
+            r.hitPct = (int)pct;
+            r.entries = (uint32_t)(configArrayMap.intCount + configArrayMap.stringCount);
+            report(r);
+        }
+    }
+
+    if (selected("schemaGetDefault")) {
+        configClear();
+        BenchResult r = makeResult("schemaGetDefault", "int", configSchemaCount, 0, -1);
+        measure(r, [&](uint64_t i) { benchSink = configGetInt(configSchema[i % configSchemaCount].id); });
+        report(r);
+    }
+}
+
+// Append a configFlush-layout entry to a hand-built image
+static void putImageInt(std::vector<uint32_t>& image, int id, int value) {
+    image.insert(image.end(), {(uint32_t)TYPE_INT, (uint32_t)id, (uint32_t)value});
+}
+
+static void putImageString(std::vector<uint32_t>& image, int id, const char* value) {
+    uint32_t words[STRING_ENTRY_SIZE / sizeof(uint32_t)] = {};
+    std::strncpy(reinterpret_cast<char*>(words), value, MAX_STRING_LENGTH - 1);
+    image.insert(image.end(), {(uint32_t)TYPE_STRING, (uint32_t)id});
+    image.insert(image.end(), words, words + STRING_ENTRY_SIZE / sizeof(uint32_t));
+}
+
+// Every schema parameter off its default, loaded from a current image and
+// from the same settings as the oldest release stored them (see the
+// host params migrations); both must leave the same store. A migrated
+// partition is written back on the first load only.
+static void benchMigrate(void) {
+    if (configSchemaCount == 0 || CONFIG_SCHEMA_VERSION == 0 || !selected("configMigrate")) {
+        return; // Host build without CONFIG_PARAMS_FILE or migrations
+    }
+    static uint32_t current[BUFFER_SIZE / sizeof(uint32_t)];
+    static uint32_t check[BUFFER_SIZE / sizeof(uint32_t)];
+    std::vector<uint32_t> oldInts;
+    std::vector<uint32_t> oldStrings;
+    int failures = 0;
+
+    configClear();
+    for (uint32_t i = 0; i < configSchemaCount; ++i) {
+        const ConfigParam& p = configSchema[i];
+        if (p.type == 's') {
+            failures += configWriteString(p.id, "changed");
+            continue;
+        }
+        int v = p.defaultValue < p.max ? p.defaultValue + 1 : p.defaultValue - 1;
+        v = p.id == CONFIG_threshold_low ? 250 : p.id == CONFIG_threshold_high ? 3700 :
+            p.id == CONFIG_gain ? 37 : p.id == CONFIG_baud_rate ? 921600 : v;
+        failures += configWriteInt(p.id, v);
+    }
+    size_t currentSize = sizeof(current);
+    failures += configFlush(current, currentSize);
+
+    // Version 0: old IDs, baud rate as text, thresholds and gain packed
+    uint32_t oldCounts[2] = {0, 0};
+    putImageInt(oldInts, 4048, configGetInt(CONFIG_sample_rate_hz));
+    putImageInt(oldInts, 4049, configGetInt(CONFIG_filter_taps));
+    putImageInt(oldInts, 4100, configGetInt(CONFIG_threshold_low) | configGetInt(CONFIG_threshold_high) << 12);
+    putImageInt(oldInts, 4101, configGetInt(CONFIG_gain) >> 4);
+    putImageInt(oldInts, 4102, configGetInt(CONFIG_gain) & 0xF);
+    putImageString(oldStrings, 4051, "921600");
+    oldCounts[1]++;
+    oldCounts[0] += 5;
+    for (uint32_t i = 0; i < configSchemaCount; ++i) {
+        const ConfigParam& p = configSchema[i];
+        if (p.type == 's') {
+            putImageString(oldStrings, p.id, "changed");
+            oldCounts[1]++;
+        } else if (p.id != CONFIG_sample_rate_hz && p.id != CONFIG_filter_taps && p.id != CONFIG_baud_rate &&
+                   p.id != CONFIG_threshold_low && p.id != CONFIG_threshold_high && p.id != CONFIG_gain) {
+            putImageInt(oldInts, p.id, configGetInt(p.id));
+            oldCounts[0]++;
+        }
+    }
+    std::vector<uint32_t> old(oldCounts, oldCounts + 2);
+    old.insert(old.end(), oldInts.begin(), oldInts.end());
+    old.insert(old.end(), oldStrings.begin(), oldStrings.end());
+    const uint8_t* oldImage = reinterpret_cast<const uint8_t*>(old.data());
+    size_t oldSize = old.size() * sizeof(uint32_t);
+
+    BenchResult load = makeResult("configMigrate", "current", configSchemaCount, 0, -1);
+    measure(load, [&](uint64_t) {
+        configClear();
+        failures += processConfigBuffer(reinterpret_cast<const uint8_t*>(current), currentSize);
+    });
+    BenchResult migrate = makeResult("configMigrate", "v0", configSchemaCount, 0, -1);
+    measure(migrate, [&](uint64_t) {
+        configClear();
+        failures += processConfigBuffer(oldImage, oldSize);
+    });
+    size_t checkSize = sizeof(check);
+    failures += configFlush(check, checkSize);
+    if (checkSize != currentSize || std::memcmp(check, current, currentSize) != 0) {
+        failures++;
+    }
+
+    // Migrated on the first load from flash and written back, loaded as is after
+    uint32_t commits = storageCounters.commits;
+    failures += fileWritePartition(FLASH_PARTITION_config, old.data(), oldSize);
+    configClear();
+    failures += loadConfigPartition(FLASH_PARTITION_config);
+    uint32_t writeBacks = storageCounters.commits - commits;
+    configClear();
+    failures += loadConfigPartition(FLASH_PARTITION_config);
+    failures += storageCounters.commits - commits != writeBacks;
+
+    uint8_t stored[BUFFER_SIZE];
+    size_t storedSize = sizeof(stored);
+    failures += readAndLoadPartitionData(stored, storedSize, FLASH_PARTITION_config);
+    if (writeBacks != 1 || configImageVersion(stored, storedSize) != CONFIG_SCHEMA_VERSION) {
+        failures++;
+    }
+
+    // The version entry is configFlush's alone; SET over the serial link too
+    uint8_t frame[SERIAL_FRAME_SIZE];
+    SerialWriter writer;
+    failures += configWriteInt(CONFIG_VERSION_ID, 42) != 1;
+    failures += configWriteString(CONFIG_VERSION_ID, "42") != 1;
+    serialBegin(&writer, frame, sizeof(frame), SERIAL_CMD_SET, 1, SERIAL_STORE_CONFIG);
+    serialAddInt(&writer, CONFIG_VERSION_ID, 42);
+    serialHandleFrame(frame, serialEnd(&writer), sizeof(frame));
+    failures += serialResultCount(frame) != 1 || serialResult(frame, 0) != 1;
+
+    // A version 0 history: generation 2 holds the image, a delta restores
+    // generation 1. The write-back on load adds generation 3 and keeps both.
+    std::vector<uint32_t> v0 = {2, 0};
+    putImageInt(v0, 4048, 250);
+    putImageInt(v0, 4049, 20);
+    uint32_t v0Size = (uint32_t)(v0.size() * sizeof(uint32_t));
+    uint32_t delta[3] = {1, 1 + 2 * sizeof(int), 1};              // Generation, size, changes
+    uint8_t op[1 + 2 * sizeof(int)] = {TYPE_INT};
+    int opId = 4049, opValue = 12;
+    std::memcpy(op + 1, &opId, sizeof(int));
+    std::memcpy(op + 1 + sizeof(int), &opValue, sizeof(int));
+    uint32_t trailer[4] = {CONFIG_HISTORY_MAGIC, 2, v0Size, 1};   // Magic, generation, image, deltas
+    std::vector<uint8_t> page(reinterpret_cast<uint8_t*>(v0.data()), reinterpret_cast<uint8_t*>(v0.data()) + v0Size);
+    page.insert(page.end(), reinterpret_cast<uint8_t*>(delta), reinterpret_cast<uint8_t*>(delta) + sizeof(delta));
+    page.insert(page.end(), op, op + sizeof(op));
+    page.resize((page.size() + 3) & ~(size_t)3, 0xFF);
+    page.insert(page.end(), reinterpret_cast<uint8_t*>(trailer), reinterpret_cast<uint8_t*>(trailer) + sizeof(trailer));
+
+    ConfigGeneration generations[CONFIG_HISTORY_DEPTH];
+    failures += flash_partitionErase(FLASH_PARTITION_config);
+    failures += flash_wearCommit(flash_partitionRegion(FLASH_PARTITION_config), page.data(), (uint32_t)page.size());
+    configClear();
+    failures += loadConfigPartition(FLASH_PARTITION_config);
+    size_t kept = configHistoryList(FLASH_PARTITION_config, generations, CONFIG_HISTORY_DEPTH);
+    failures += kept != 3 || generations[0].generation != 3 || generations[2].generation != 1;
+    static const int tapsByGeneration[] = {0, 12, 20, 20};
+    for (uint32_t g = 1; g <= 3; ++g) {
+        failures += configHistoryLoad(FLASH_PARTITION_config, g) != 0 ||
+                    configGetInt(CONFIG_sample_rate_hz) != 250 ||
+                    configGetInt(CONFIG_filter_taps) != tapsByGeneration[g];
+    }
+    storedSize = sizeof(stored);
+    failures += readAndLoadPartitionData(stored, storedSize, FLASH_PARTITION_config);
+    failures += configImageVersion(stored, storedSize) != CONFIG_SCHEMA_VERSION;
+
+    std::printf("{\"bench\":\"configMigrate\",\"entries\":%u,\"current_ns_per_load\":%.1f,"
+                "\"v0_ns_per_load\":%.1f,\"overhead_pct\":%.1f,\"write_backs\":%u,\"history_kept\":%u,"
+                "\"status\":\"%s\"}\n",
+                configSchemaCount, load.nsPerOp, migrate.nsPerOp, 100.0 * (migrate.nsPerOp / load.nsPerOp - 1),
+                writeBacks, (uint32_t)kept, failures ? "error" : "ok");
+    configClear();
+    std::fflush(stdout);
+}
+
+// A module's settings as bound for the bindStruct bench: an undeclared
+// counter first, then host schema parameters
+struct NodeSettings {
+    int bootCount;
+    int sampleRate;
+    int filterTaps;
+    int txPower;
+    int baudRate;
+    int logLevel;
+    int watchdogMs;
+    int retryCount;
+    int heartbeatS;
+    int gain;
+    int offset;
+    int thresholdLow;
+    int thresholdHigh;
+    char deviceName[24];
+    char serverHost[32];
+    char timezone[16];
+};
+
+#define NODE_BOOT_COUNT_ID 4999
+
+#define NODE_SETTINGS_FIELDS(INT, STRING)       \
+    INT(bootCount, NODE_BOOT_COUNT_ID)          \
+    INT(sampleRate, CONFIG_sample_rate_hz)      \
+    INT(filterTaps, CONFIG_filter_taps)         \
+    INT(txPower, CONFIG_tx_power_dbm)           \
+    INT(baudRate, CONFIG_baud_rate)             \
+    INT(logLevel, CONFIG_log_level)             \
+    INT(watchdogMs, CONFIG_watchdog_ms)         \
+    INT(retryCount, CONFIG_retry_count)         \
+    INT(heartbeatS, CONFIG_heartbeat_s)         \
+    INT(gain, CONFIG_gain)                      \
+    INT(offset, CONFIG_offset)                  \
+    INT(thresholdLow, CONFIG_threshold_low)     \
+    INT(thresholdHigh, CONFIG_threshold_high)   \
+    STRING(deviceName, CONFIG_device_name)      \
+    STRING(serverHost, CONFIG_server_host)      \
+    STRING(timezone, CONFIG_timezone)
+
+CONFIG_BIND(NodeSettings, NODE_SETTINGS_FIELDS)
+
+// The per-ID code configReadStruct replaces, with its error checks
+static int readNodeSettingsSingle(NodeSettings* s) {
+    StoreEntryView counter;
+    int* ints[] = {&s->sampleRate, &s->filterTaps, &s->txPower, &s->baudRate, &s->logLevel, &s->watchdogMs,
+                   &s->retryCount, &s->heartbeatS, &s->gain, &s->offset, &s->thresholdLow, &s->thresholdHigh};
+    const int intIds[] = {CONFIG_sample_rate_hz, CONFIG_filter_taps, CONFIG_tx_power_dbm, CONFIG_baud_rate,
+                          CONFIG_log_level, CONFIG_watchdog_ms, CONFIG_retry_count, CONFIG_heartbeat_s,
+                          CONFIG_gain, CONFIG_offset, CONFIG_threshold_low, CONFIG_threshold_high};
+    char* strings[] = {s->deviceName, s->serverHost, s->timezone};
+    const size_t sizes[] = {sizeof(s->deviceName), sizeof(s->serverHost), sizeof(s->timezone)};
+    const int stringIds[] = {CONFIG_device_name, CONFIG_server_host, CONFIG_timezone};
+    int failures = 0;
+
+    if (configLookup(NODE_BOOT_COUNT_ID, &counter) == 0 && counter.type == TYPE_INT) {
+        s->bootCount = counter.value;
+    }
+    for (size_t i = 0; i < sizeof(intIds) / sizeof(intIds[0]); ++i) {
+        int v = configGetInt(intIds[i]);
+        if (v == -1) {
+            failures++;
+            continue;
+        }
+        *ints[i] = v;
+    }
+    for (size_t i = 0; i < sizeof(stringIds) / sizeof(stringIds[0]); ++i) {
+        const char* v = configGetString(stringIds[i]);
+        if (!v) {
+            failures++;
+            continue;
+        }
+        std::strncpy(strings[i], v, sizes[i] - 1);
+        strings[i][sizes[i] - 1] = '\0';
+    }
+    return failures;
+}
+
+static int writeNodeSettingsSingle(const NodeSettings* s) {
+    return configWriteInt(NODE_BOOT_COUNT_ID, s->bootCount) + configWriteInt(CONFIG_sample_rate_hz, s->sampleRate) +
+           configWriteInt(CONFIG_filter_taps, s->filterTaps) + configWriteInt(CONFIG_tx_power_dbm, s->txPower) +
+           configWriteInt(CONFIG_baud_rate, s->baudRate) + configWriteInt(CONFIG_log_level, s->logLevel) +
+           configWriteInt(CONFIG_watchdog_ms, s->watchdogMs) + configWriteInt(CONFIG_retry_count, s->retryCount) +
+           configWriteInt(CONFIG_heartbeat_s, s->heartbeatS) + configWriteInt(CONFIG_gain, s->gain) +
+           configWriteInt(CONFIG_offset, s->offset) + configWriteInt(CONFIG_threshold_low, s->thresholdLow) +
+           configWriteInt(CONFIG_threshold_high, s->thresholdHigh) +
+           configWriteString(CONFIG_device_name, s->deviceName) +
+           configWriteString(CONFIG_server_host, s->serverHost) + configWriteString(CONFIG_timezone, s->timezone);
+}
+
+// Read and write a module's settings with one call per parameter and with
+// the struct binding, in a store that also holds `entries` other entries;
+// both must give the same struct and the same store
+static void benchBind(uint32_t entries) {
+    if (configSchemaCount == 0 || !selected("bindStruct")) {
+        return; // Host build without CONFIG_PARAMS_FILE
+    }
+    static uint32_t expected[BUFFER_SIZE / sizeof(uint32_t)];
+    static uint32_t check[BUFFER_SIZE / sizeof(uint32_t)];
+    NodeSettings variants[2] = {
+        {7, 250, 32, 14, 921600, 3, 5000, 5, 60, 37, 12, 250, 3700, "node-7", "gw.example.net", "CET"},
+        {8, 100, 16, 10, 115200, 2, 2000, 3, 30, 1, 0, 100, 3900, "sensor", "telemetry.local", "UTC"},
+    };
+    const uint32_t fields = ConfigBinding<NodeSettings>::count;
+    NodeSettings single = {};
+    NodeSettings bound = {};
+    int failures = 0;
+
+    populate(entries, 0);
+    failures += writeNodeSettingsSingle(&variants[0]);
+
+    BenchResult singleRead = makeResult("bindStruct", "int", entries, 0, -1);
+    measure(singleRead, [&](uint64_t) { failures += readNodeSettingsSingle(&single) != 0; });
+    BenchResult structRead = makeResult("bindStruct", "int", entries, 0, -1);
+    measure(structRead, [&](uint64_t) {
+        ConfigFieldStatus status = configReadStruct(&bound);
+        failures += status.missing != 0 || status.outOfRange != 0;
+    });
+    failures += std::memcmp(&single, &bound, sizeof(single)) != 0;
+
+    // Every write changes the values, the second variant back to their defaults
+    BenchResult singleWrite = makeResult("bindStruct", "int", entries, 0, -1);
+    measure(singleWrite, [&](uint64_t i) { failures += writeNodeSettingsSingle(&variants[i & 1]) != 0; });
+    failures += writeNodeSettingsSingle(&variants[1]);
+    BenchResult structWrite = makeResult("bindStruct", "int", entries, 0, -1);
+    measure(structWrite, [&](uint64_t i) {
+        ConfigFieldStatus status = configWriteStruct(&variants[i & 1]);
+        failures += status.missing != 0 || status.outOfRange != 0 || status.changed == 0;
+    });
+
+    for (const NodeSettings& last : variants) {
+        populate(entries, 0);
+        failures += writeNodeSettingsSingle(&variants[&last == variants]);
+        failures += writeNodeSettingsSingle(&last);
+        size_t expectedSize = sizeof(expected);
+        failures += configFlush(expected, expectedSize);
+        populate(entries, 0);
+        configWriteStruct(&variants[&last == variants]);
+        configWriteStruct(&last);
+        size_t checkSize = sizeof(check);
+        failures += configFlush(check, checkSize);
+        if (checkSize != expectedSize || std::memcmp(check, expected, checkSize) != 0) {
+            failures++;
+        }
+    }
+
+    // Status bits: a rejected value, an unchanged write and a missing entry
+    NodeSettings rejected = variants[0];
+    rejected.txPower = 99;
+    ConfigFieldStatus status = configWriteStruct(&rejected);
+    failures += status.outOfRange != 1U << 3;
+    status = configWriteStruct(&rejected);
+    failures += status.changed != 0;
+    configClear();
+    status = configReadStruct(&bound);
+    failures += status.missing != 1U;
+
+    std::printf("{\"bench\":\"bindStruct\",\"fields\":%u,\"entries\":%u,\"single_read_ns\":%.1f,"
+                "\"struct_read_ns\":%.1f,\"single_write_ns\":%.1f,\"struct_write_ns\":%.1f,"
+                "\"read_speedup\":%.1f,\"write_speedup\":%.1f,\"status\":\"%s\"}\n",
+                fields, entries, singleRead.nsPerOp, structRead.nsPerOp, singleWrite.nsPerOp,
+                structWrite.nsPerOp, singleRead.nsPerOp / structRead.nsPerOp,
+                singleWrite.nsPerOp / structWrite.nsPerOp, failures ? "error" : "ok");
+    std::fflush(stdout);
+}
+
+// Append fixed-size log records to a file on the default volume, then
+// remount and read them back in record sized reads
+static void benchFs(void) {
+    const uint32_t record = 37;                        // Straddles quadwords
+    const uint32_t capacity = 16 * FLASH_PAGE_SIZE;
+    uint8_t data[record];
+
+    if (!selected("fs")) {
+        return;
+    }
+    const FlashPartition& volume = flash_partition(FLASH_PARTITION_fs);
+    flash_partitionErase(FLASH_PARTITION_fs);
+    flash_fsMount(volume.bank, volume.firstPage, volume.pageCount);
+    int fd = flash_fsOpen("log.bin", FLASH_FS_WRITE | FLASH_FS_CREATE, capacity);
+
+    BenchResult w = makeResult("fsWrite", "file", 0, record, -1);
+    int failures = fd < 0;
+    flashSim_resetStats();
+    measure(w, [&](uint64_t i) {
+        std::memset(data, (int)(i & 0xFF), record);
+        failures += flash_fsWrite(fd, data, record) != (int)record;
+    }, capacity / record);
+    FlashSimStats stats;
+    flashSim_getStats(&stats);
+    w.entries = (uint32_t)w.ops;
+    w.bytesPerCommit = (uint32_t)(stats.quadwordsProgrammed * FLASH_SIM_QUADWORD / w.ops);
+    w.flashNsPerOp = stats.timeNs / w.ops;
+    failures += flash_fsClose(fd) != 0;
+    w.status = failures ? "error" : "ok";
+    report(w);
+
+    // A fresh mount must see every record
+    BenchResult r = makeResult("fsRead", "file", (uint32_t)w.ops, record, -1);
+    failures = flash_fsMount(volume.bank, volume.firstPage, volume.pageCount) != 0;
+    fd = flash_fsOpen("log.bin", FLASH_FS_READ, 0);
+    failures += flash_fsSize(fd) != (int32_t)(w.ops * record);
+    measure(r, [&](uint64_t i) {
+        if (i % w.ops == 0) {
+            flash_fsSeek(fd, 0, FLASH_FS_SEEK_SET);
+        }
+        failures += flash_fsRead(fd, data, record) != (int)record ||
+                    data[0] != (uint8_t)(i % w.ops) || data[record - 1] != data[0];
+    });
+    failures += flash_fsClose(fd) != 0;
+    r.status = failures ? "error" : "ok";
+    report(r);
+
+    // Unsynced data ending in 0xFF, as padded blobs do, must survive a
+    // remount without the next append programming its quadwords again
+    uint8_t blob[2 * FLASH_QUADWORD_SIZE];
+    std::memset(blob, 0x11, FLASH_QUADWORD_SIZE);
+    std::memset(blob + FLASH_QUADWORD_SIZE, 0xFF, FLASH_QUADWORD_SIZE);
+    fd = flash_fsOpen("blob.bin", FLASH_FS_WRITE | FLASH_FS_CREATE, 0);
+    failures = flash_fsWrite(fd, blob, sizeof(blob)) != (int)sizeof(blob);
+    failures += flash_fsMount(volume.bank, volume.firstPage, volume.pageCount) != 0;
+    fd = flash_fsOpen("blob.bin", FLASH_FS_READ | FLASH_FS_WRITE, 0);
+    int32_t remountSize = flash_fsSize(fd);
+    failures += remountSize != (int32_t)sizeof(blob);
+    failures += flash_fsWrite(fd, blob, sizeof(blob)) != (int)sizeof(blob);
+    for (int i = 0; i < 2; ++i) {
+        uint8_t back[sizeof(blob)];
+        failures += flash_fsRead(fd, back, sizeof(back)) != (int)sizeof(back) ||
+                    std::memcmp(back, blob, sizeof(blob)) != 0;
+    }
+    failures += flash_fsClose(fd) != 0;
+    std::printf("{\"bench\":\"fsRemount\",\"tail\":\"0xFF\",\"size\":%d,\"status\":\"%s\"}\n",
+                remountSize, failures ? "error" : "ok");
+
+    // A reader keeps its position when another descriptor truncates the
+    // file: it must read nothing rather than past the new end
+    uint8_t back[sizeof(blob)];
+    int reader = flash_fsOpen("blob.bin", FLASH_FS_READ, 0);
+    failures = flash_fsRead(reader, back, sizeof(back)) != (int)sizeof(back);
+    fd = flash_fsOpen("blob.bin", FLASH_FS_WRITE | FLASH_FS_TRUNCATE, 0);
+    failures += flash_fsWrite(fd, blob, 8) != 8;
+    std::memset(back, 0x5A, sizeof(back));
+    int afterTruncate = flash_fsRead(reader, back, sizeof(back));
+    failures += afterTruncate != 0 || back[0] != 0x5A;
+    failures += flash_fsSeek(reader, 0, FLASH_FS_SEEK_SET) != 0;
+    failures += flash_fsRead(reader, back, sizeof(back)) != 8 || std::memcmp(back, blob, 8) != 0;
+    failures += flash_fsClose(fd) != 0;
+    failures += flash_fsClose(reader) != 0;
+    std::printf("{\"bench\":\"fsTruncate\",\"read_after\":%d,\"status\":\"%s\"}\n", afterTruncate,
+                failures ? "error" : "ok");
+}
+
+// A storage diagnostic recorded with flash_log against formatting the
+// same message inline, as a debug_msg into a console buffer would
+static void benchLog(void) {
+    char text[96];
+
+    if (!selected("flashLog")) {
+        return;
+    }
+    flash_logClear();
+    BenchResult r = makeResult("flashLog", "deferred", 0, 0, -1);
+    measure(r, [&](uint64_t i) {
+        flash_log(FLASH_LOG_ERASE_FAILED, FLASH_BANK_2, (uint32_t)i & 0x7FU, 1);
+    });
+    report(r);
+
+    r = makeResult("flashLog", "snprintf", 0, 0, -1);
+    measure(r, [&](uint64_t i) {
+        benchSink = std::snprintf(text, sizeof(text), flashLogFormats[FLASH_LOG_ERASE_FAILED],
+                                  (unsigned)FLASH_BANK_2, (unsigned)(i & 0x7FU), 1U);
+    });
+    report(r);
+    flash_logClear();
+}
+
+// Small appends through the coalescing buffer against programming each
+// append on its own, padded to whole quadwords
+static void benchQwbuf(void) {
+    static const uint32_t recordSizes[] = {1, 5, 13, 37};
+    const uint32_t pages = 4;
+    const FlashPartition& area = flash_partition(FLASH_PARTITION_fwimage);
+    const uint32_t base = area.address;
+    uint8_t data[64];
+
+    for (int coalesce = 1; coalesce >= 0; --coalesce) {
+        const char* name = coalesce ? "qwbufAppend" : "paddedAppend";
+        if (!selected(name)) {
+            continue;
+        }
+        for (uint32_t record : recordSizes) {
+            BenchResult r = makeResult(name, "log", 0, record, -1);
+            FlashQwBuffer buf;
+            uint32_t address = base;
+            int failures = 0;
+
+            for (uint32_t i = 0; i < pages; ++i) {
+                flash_pageErase(area.bank, area.firstPage + i);
+            }
+            flash_qwbufInit(&buf);
+            flashSim_resetStats();
+            measure(r, [&](uint64_t i) {
+                std::memset(data, (int)(i & 0xFF), record);
+                if (coalesce) {
+                    failures += flash_qwbufWrite(&buf, address, data, record);
+                    address += record;
+                } else {
+                    failures += flash_programQuadwords(address, data, record);
+                    address += (record + FLASH_QUADWORD_SIZE - 1) & ~(FLASH_QUADWORD_SIZE - 1);
+                }
+            }, pages * FLASH_PAGE_SIZE / ((record + FLASH_QUADWORD_SIZE - 1) & ~(FLASH_QUADWORD_SIZE - 1)));
+            failures += flash_qwbufFlush(&buf);
+
+            FlashSimStats stats;
+            flashSim_getStats(&stats);
+            r.entries = (uint32_t)r.ops;
+            r.bytesPerCommit = (uint32_t)(stats.quadwordsProgrammed * FLASH_SIM_QUADWORD / r.ops);
+            r.flashNsPerOp = stats.timeNs / r.ops;
+            r.ratio = (double)(stats.quadwordsProgrammed * FLASH_SIM_QUADWORD) / (r.ops * record);
+
+            // The log must read back as written
+            if (coalesce) {
+                const uint8_t* flash = (const uint8_t*)FLASH_MAP(base);
+                for (uint64_t i = 0; i < r.ops * record; ++i) {
+                    failures += flash[i] != (uint8_t)(i / record);
+                }
+            }
+            r.status = failures ? "error" : "ok";
+            report(r);
+        }
+    }
+
+    // A quadword written as all 0xFF stays erased and takes later bytes; a
+    // failed program returns an error instead of stopping in Error_Handler
+    if (selected("qwbufErased")) {
+        FlashQwBuffer buf;
+        const uint8_t* flash = (const uint8_t*)FLASH_MAP(base);
+        int failures = flash_pageErase(area.bank, area.firstPage);
+
+        flash_qwbufInit(&buf);
+        std::memset(data, 0xFF, FLASH_QUADWORD_SIZE);
+        failures += flash_qwbufWrite(&buf, base, data, FLASH_QUADWORD_SIZE);
+        std::memset(data, 0x22, FLASH_QUADWORD_SIZE);
+        failures += flash_qwbufWrite(&buf, base + 4, data, 4);
+        failures += flash_qwbufFlush(&buf);
+        for (uint32_t i = 0; i < FLASH_QUADWORD_SIZE; ++i) {
+            failures += flash[i] != (i >= 4 && i < 8 ? 0x22 : 0xFF);
+        }
+        flashSim_injectFault(FLASH_SIM_FAULT_PROGRAM, 1);
+        int faulted = flash_qwbufWrite(&buf, base + FLASH_QUADWORD_SIZE, data, FLASH_QUADWORD_SIZE);
+        flashSim_injectFault(FLASH_SIM_FAULT_NONE, 0);
+        failures += faulted != 1;
+        std::printf("{\"bench\":\"qwbufErased\",\"fault_result\":%d,\"status\":\"%s\"}\n", faulted,
+                    failures ? "error" : "ok");
+    }
+}
+
+enum BankMode {
+    BANK_OTHER,                    // Code in bank 1, commits to bank 2
+    BANK_SAME,                     // Code and commits in bank 2, routines in flash
+    BANK_SAME_RAM,                 // Code and commits in bank 2, routines in RAM
+};
+
+static const char* const bankModeNames[] = {"other_bank", "same_bank", "same_bank_ram"};
+
+// Commit the store to the USER page while code executes from the same or the
+// other bank. stall_us is time the CPU is frozen, ram_only_us time only RAM
+// code (with interrupts masked) runs, concurrent_us time code keeps running.
+static void benchBankContention(uint32_t entries) {
+    const uint32_t commits = 100;
+    const FlashPartition& user = flash_partition(FLASH_PARTITION_user);
+
+    if (!selected("bankContention")) {
+        return;
+    }
+    for (int mode = BANK_OTHER; mode <= BANK_SAME_RAM; ++mode) {
+        int failures = 0;
+        FlashSimStats stats;
+
+        populate(entries, 0);
+        flashSim_setCodeBank(mode == BANK_OTHER ? (user.bank == FLASH_BANK_1 ? FLASH_BANK_2 : FLASH_BANK_1)
+                                                : user.bank);
+        flash_setRamProgramming(mode == BANK_SAME_RAM);
+        flashSim_resetStats();
+        for (uint32_t i = 0; i < commits; ++i) {
+            touchEntry(0, i);
+            failures += flashConfigPartition(FLASH_PARTITION_user);
+        }
+        flashSim_getStats(&stats);
+
+        uint64_t busyNs = stats.stallNs + stats.ramOnlyNs + stats.concurrentNs;
+        std::printf("{\"bench\":\"bankContention\",\"mode\":\"%s\",\"entries\":%u,\"commits\":%u,"
+                    "\"commit_us\":%.1f,\"stall_us\":%.1f,\"ram_only_us\":%.1f,\"concurrent_us\":%.1f,"
+                    "\"max_stall_us\":%.1f,\"code_running_pct\":%.1f,\"status\":\"%s\"}\n",
+                    bankModeNames[mode], entries, commits, stats.timeNs / 1e3 / commits,
+                    stats.stallNs / 1e3 / commits, stats.ramOnlyNs / 1e3 / commits,
+                    stats.concurrentNs / 1e3 / commits, stats.maxStallNs / 1e3,
+                    busyNs ? 100.0 * stats.concurrentNs / busyNs : 100.0, failures ? "error" : "ok");
+        std::fflush(stdout);
+    }
+    flashSim_setCodeBank(FLASH_BANK_1);
+    flash_setRamProgramming(true);
+}
+
+// Generations of the config partition with two entries changed per commit:
+// the flash a commit takes and what the older generations cost as deltas
+// against full copies, then the time to load a generation depth commits back
+static void benchHistory(uint32_t entries) {
+    ConfigGeneration list[CONFIG_HISTORY_DEPTH];
+    const uint32_t commits = 2 * CONFIG_HISTORY_DEPTH;
+    int failures = 0;
+    FlashSimStats stats;
+
+    if (!selected("configHistory")) {
+        return;
+    }
+    populate(entries, 0);
+    flash_partitionErase(FLASH_PARTITION_config);
+    flashSim_resetStats();
+    for (uint32_t i = 0; i < commits; ++i) {
+        touchEntry(0, i);
+        configWriteInt((int)(1 + i % (entries - 1)), (int)i);
+        failures += configHistoryCommit(FLASH_PARTITION_config);
+    }
+    flashSim_getStats(&stats);
+
+    size_t count = configHistoryList(FLASH_PARTITION_config, list, CONFIG_HISTORY_DEPTH);
+    uint32_t deltaBytes = 0;
+    for (size_t i = 1; i < count; ++i) {
+        deltaBytes += list[i].storedBytes;
+    }
+    std::printf("{\"bench\":\"configHistory\",\"entries\":%u,\"generations\":%u,\"image_bytes\":%u,"
+                "\"delta_bytes\":%u,\"full_copy_bytes\":%u,\"commit_flash_us\":%.1f,"
+                "\"bytes_per_commit\":%u,\"status\":\"%s\"}\n",
+                entries, (uint32_t)count, list[0].storedBytes, deltaBytes,
+                (uint32_t)(count - 1) * list[0].storedBytes, stats.timeNs / 1e3 / commits,
+                (uint32_t)(stats.quadwordsProgrammed * FLASH_SIM_QUADWORD / commits),
+                failures || count != CONFIG_HISTORY_DEPTH ? "error" : "ok");
+
+    for (size_t depth = 0; depth < count; ++depth) {
+        BenchResult r = makeResult("historyLoad", "int", entries, 0, -1);
+        measure(r, [&](uint64_t) { failures += configHistoryLoad(FLASH_PARTITION_config, list[depth].generation); });
+        std::printf("{\"bench\":\"historyLoad\",\"entries\":%u,\"depth\":%u,\"ops\":%llu,\"ns_per_op\":%.1f,"
+                    "\"status\":\"%s\"}\n", entries, (uint32_t)depth, (unsigned long long)r.ops, r.nsPerOp,
+                    failures ? "error" : "ok");
+    }
+    std::fflush(stdout);
+}
+
+static const char* const loadOrderNames[] = {"sorted", "reversed", "shuffled", "duplicates"};
+
+// Leading version entry of a current configFlush image, if the schema has one
+static const uint32_t loadVersionEntries = CONFIG_SCHEMA_VERSION > 0 ? 1 : 0;
+static const size_t loadImageHeader = 2 * sizeof(uint32_t) + loadVersionEntries * INT_ENTRY_SIZE;
+
+// Current int image of ids 0..entries-1 in the given order; duplicates writes
+// every id twice in shuffled order, the second time with the value that wins
+static std::vector<uint8_t> makeLoadImage(uint32_t entries, int order) {
+    std::vector<int> ids(entries);
+    for (uint32_t i = 0; i < entries; ++i) {
+        ids[i] = order == 1 ? (int)(entries - 1 - i) : (int)i;
+    }
+    if (order == 3) {
+        ids.insert(ids.end(), ids.begin(), ids.end());
+    }
+    uint32_t state = entries;
+    for (size_t i = ids.size(); order >= 2 && i > 1; --i) {
+        std::swap(ids[i - 1], ids[lcg(state) % i]);
+    }
+
+    std::vector<uint8_t> image(loadImageHeader + ids.size() * INT_ENTRY_SIZE);
+    uint32_t counts[2] = {(uint32_t)ids.size() + loadVersionEntries, 0};
+    std::memcpy(image.data(), counts, sizeof(counts));
+    if (loadVersionEntries) {
+        int version[3] = {TYPE_INT, CONFIG_VERSION_ID, CONFIG_SCHEMA_VERSION};
+        std::memcpy(image.data() + sizeof(counts), version, INT_ENTRY_SIZE);
+    }
+    std::vector<bool> seen(entries);
+    uint8_t* p = image.data() + loadImageHeader;
+    for (int id : ids) {
+        int entry[3] = {TYPE_INT, id, seen[id] ? id * 3 : -id};
+        seen[id] = true;
+        std::memcpy(p, entry, INT_ENTRY_SIZE);
+        p += INT_ENTRY_SIZE;
+    }
+    return image;
+}
+
+// processConfigBuffer against the single-entry insert path it replaced, on
+// images in and out of ID order; both must leave the same store
+static void benchBulkLoad(uint32_t entries) {
+    if (!selected("bulkLoad")) {
+        return;
+    }
+    for (int order = 0; order < 4; ++order) {
+        std::vector<uint8_t> image = makeLoadImage(entries, order);
+        std::vector<uint32_t> expected(image.size() / sizeof(uint32_t));
+        std::vector<uint32_t> check(expected.size());
+        uint32_t imageEntries = (uint32_t)((image.size() - loadImageHeader) / INT_ENTRY_SIZE);
+        int failures = 0;
+
+        BenchResult single = makeResult("bulkLoad", "int", entries, 0, -1);
+        measure(single, [&](uint64_t) {
+            configClear();
+            for (uint32_t i = 0; i < imageEntries; ++i) {
+                int entry[3];
+                std::memcpy(entry, &image[loadImageHeader + i * INT_ENTRY_SIZE], INT_ENTRY_SIZE);
+                failures += configWriteInt(entry[1], entry[2]);
+            }
+        });
+        size_t expectedSize = expected.size() * sizeof(uint32_t);
+        failures += configFlush(expected.data(), expectedSize);
+
+        BenchResult bulk = makeResult("bulkLoad", "int", entries, 0, -1);
+        measure(bulk, [&](uint64_t) {
+            configClear();
+            failures += processConfigBuffer(image.data(), image.size());
+        });
+        size_t checkSize = check.size() * sizeof(uint32_t);
+        failures += configFlush(check.data(), checkSize);
+        if (checkSize != expectedSize || std::memcmp(check.data(), expected.data(), checkSize) != 0) {
+            failures++;
+        }
+
+        // Counts past the end of the image load what is there and fail
+        uint32_t corrupt = 0xFFFFFFFFU;
+        std::memcpy(image.data(), &corrupt, sizeof(corrupt));
+        configClear();
+        if (processConfigBuffer(image.data(), image.size()) != 1 || configArrayMap.intCount != entries) {
+            failures++;
+        }
+
+        std::printf("{\"bench\":\"bulkLoad\",\"order\":\"%s\",\"entries\":%u,\"image_entries\":%u,"
+                    "\"single_ns_per_load\":%.1f,\"bulk_ns_per_load\":%.1f,\"bulk_ns_per_entry\":%.1f,"
+                    "\"speedup\":%.1f,\"status\":\"%s\"}\n",
+                    loadOrderNames[order], entries, imageEntries, single.nsPerOp, bulk.nsPerOp,
+                    bulk.nsPerOp / imageEntries, single.nsPerOp / bulk.nsPerOp, failures ? "error" : "ok");
+    }
+    std::fflush(stdout);
+}
+
+#define SERIAL_LINK_BPS       921600U      // Service tool UART
+#define SERIAL_TURNAROUND_NS  1000000U     // USB serial adapter latency per request
+
+static const char* const serialCommandNames[] = {"", "get", "set", "resolve", "dump"};
+
+struct SerialCheck {
+    int expectId;
+    int failures;
+};
+
+// Entries written by populate(entries, 0) come back in ID order
+static bool serialCheckEntry(const StoreEntryView& e, void* context) {
+    SerialCheck* check = static_cast<SerialCheck*>(context);
+    check->failures += e.type != TYPE_INT || e.id != check->expectId || e.value != e.id * 3;
+    check->expectId++;
+    return true;
+}
+
+// Read, write or resolve every entry of the store through the protocol,
+// one entry per request or as many as fit. Returns the number of failures.
+static int serialPass(const SerialTransport& link, SerialCommand command, uint32_t entries,
+                      bool batched, uint8_t* frame) {
+    static uint8_t sequence;
+    char name[MAX_STRING_LENGTH];
+    SerialCheck check = {0, 0};
+    SerialWriter writer;
+    size_t length;
+
+    if (command == SERIAL_CMD_DUMP) {
+        int next = 0;
+        do {
+            serialBegin(&writer, frame, SERIAL_FRAME_SIZE, command, ++sequence, SERIAL_STORE_CONFIG);
+            serialAddId(&writer, next);
+            if (serialTransact(&link, frame, serialEnd(&writer), SERIAL_FRAME_SIZE, &length) != 0 ||
+                serialDecodeEntries(frame, length, serialCheckEntry, &check) < 0) {
+                return 1;
+            }
+        } while (serialDumpMore(frame, &next));
+        return check.failures + (check.expectId != (int)entries);
+    }
+
+    for (uint32_t first = 0; first < entries;) {
+        serialBegin(&writer, frame, SERIAL_FRAME_SIZE, command, ++sequence, SERIAL_STORE_CONFIG);
+        uint32_t last = batched ? (command == SERIAL_CMD_GET ? first + SERIAL_GET_MAX_INTS : entries) : first + 1;
+        for (uint32_t id = first; id < entries && id < last; ++id) {
+            int full;
+            if (command == SERIAL_CMD_GET) {
+                full = serialAddId(&writer, (int)id);
+            } else if (command == SERIAL_CMD_SET) {
+                full = serialAddInt(&writer, (int)id, (int)id * 3);
+            } else {
+                makeName(name, (int)id);
+                full = serialAddName(&writer, name);
+            }
+            if (full) {
+                break;
+            }
+        }
+        if (serialTransact(&link, frame, serialEnd(&writer), SERIAL_FRAME_SIZE, &length) != 0) {
+            return 1;
+        }
+
+        // The device may answer fewer than were asked; ask again for the rest
+        size_t answered = serialResultCount(frame);
+        if (answered == 0) {
+            return 1;
+        }
+        if (command == SERIAL_CMD_GET) {
+            check.expectId = (int)first;
+            check.failures += serialDecodeEntries(frame, length, serialCheckEntry, &check) != (int)answered;
+        } else {
+            for (size_t i = 0; i < answered; ++i) {
+                int expected = command == SERIAL_CMD_SET ? 0 : (int)(first + i);
+                check.failures += serialResult(frame, i) != expected;
+            }
+        }
+        first += (uint32_t)answered;
+    }
+    return check.failures;
+}
+
+// Service tool access to every entry over the loopback: one entry per
+// request against batched requests. host_values_per_s is what the protocol
+// code sustains in process, link_values_per_s what the modelled UART does.
+static void benchSerial(uint32_t entries) {
+    static SerialLoopback loopback;
+    static uint8_t frame[SERIAL_FRAME_SIZE];
+    static const SerialCommand commands[] = {SERIAL_CMD_GET, SERIAL_CMD_SET, SERIAL_CMD_RESOLVE, SERIAL_CMD_DUMP};
+
+    if (!selected("serialProtocol")) {
+        return;
+    }
+    populate(entries, 0);
+    serialLoopbackInit(&loopback, SERIAL_LINK_BPS, SERIAL_TURNAROUND_NS);
+    SerialTransport link = serialLoopbackClient(&loopback);
+
+    for (SerialCommand command : commands) {
+        for (int batched = 0; batched <= 1; ++batched) {
+            if (command == SERIAL_CMD_DUMP && !batched) {
+                continue; // A dump always fills the frame
+            }
+            BenchResult r = makeResult("serialProtocol", "", entries, 0, -1);
+            int failures = 0;
+            serialLoopbackResetStats(&loopback);
+            measure(r, [&](uint64_t) { failures += serialPass(link, command, entries, batched, frame); });
+
+            double linkNsPerPass = (double)loopback.linkNs / r.ops;
+            std::printf("{\"bench\":\"serialProtocol\",\"op\":\"%s\",\"mode\":\"%s\",\"entries\":%u,"
+                        "\"frames_per_pass\":%.1f,\"wire_bytes_per_pass\":%.0f,\"ns_per_value\":%.1f,"
+                        "\"host_values_per_s\":%.0f,\"link_bps\":%u,\"link_ms_per_pass\":%.2f,"
+                        "\"link_values_per_s\":%.0f,\"status\":\"%s\"}\n",
+                        serialCommandNames[command], batched ? "batched" : "single", entries,
+                        (double)loopback.frames / r.ops, (double)loopback.bytes / r.ops,
+                        r.nsPerOp / entries, entries * 1e9 / r.nsPerOp, SERIAL_LINK_BPS,
+                        linkNsPerPass / 1e6, entries * 1e9 / linkNsPerPass, failures ? "error" : "ok");
+            std::fflush(stdout);
+        }
+    }
+}
+
+int bench_main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            minRunNs = 2e6;
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            benchFilter = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: bench [--quick] [--filter <name>]\n");
+            return 1;
+        }
+    }
+
+    if (flashSim_open(nullptr) != 0) {
+        std::fprintf(stderr, "bench: cannot create simulated flash\n");
+        return 1;
+    }
+    // Keep wear out of the way of long runs; latency is still accounted
+    flashSim_setEndurance(0xFFFFFFFFU);
+    storageResetStats();
+
+    for (uint32_t entries : entryCounts) {
+        if (entries > MAX_INT_ENTRIES || entries > MAX_STRING_ENTRIES) {
+            continue; // Store compiled too small for this sweep point
+        }
+        benchLookups(entries);
+        benchSerial(entries);
+        benchBulkLoad(entries);
+        benchStore(entries, 0);
+        for (uint32_t strLen : stringLengths) {
+            benchStore(entries, strLen);
+        }
+    }
+    benchWear(50);
+    benchHistory(50);
+    benchSchema();
+    benchMigrate();
+    benchBind(50);
+    benchBind(500);
+    benchFwImage();
+    benchBootValidate();
+    benchCalLut();
+    benchFs();
+    benchQwbuf();
+    benchLog();
+    benchBankContention(50);
+
+    StorageStats stats;
+    storageGetStats(&stats);
+    std::printf("{\"stats\":{\"gets\":%u,\"misses\":%u,\"updates\":%u,\"commits\":%u,"
+                "\"skipped_commits\":%u,\"pages_erased\":%u,\"quadwords_programmed\":%u,"
+                "\"verify_failures\":%u,\"flash_config_max_ns\":%u,\"load_config_max_ns\":%u}}\n",
+                stats.gets, stats.misses, stats.updates, stats.commits, stats.skippedCommits,
+                stats.pagesErased, stats.quadwordsProgrammed, stats.verifyFailures,
+                stats.flashConfig.maxCycles, stats.loadConfig.maxCycles);
+
+    configClear();
+    flashSim_close();
+    return 0;
+}
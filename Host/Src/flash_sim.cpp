@@ -0,0 +1,546 @@
+/*
+ * flash_sim.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "flash_sim.h"
+#include "main.h"
+#include "debug.h"
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//-----------------------------------------------------------------------------
+//
+// Local Definitions
+//
+//-----------------------------------------------------------------------------
+
+#define QUADWORD_COUNT (FLASH_SIZE / FLASH_SIM_QUADWORD)
+
+//-----------------------------------------------------------------------------
+//
+// Local Datatypes
+//
+//-----------------------------------------------------------------------------
+
+struct FlashSimDevice {
+    uint8_t* image;
+    int fd;
+    bool locked;
+    uint32_t error;                                // HAL_FLASH_GetError flags
+    uint8_t programmed[QUADWORD_COUNT / 8];        // Quadwords written since erase
+    uint32_t eraseCount[2][FLASH_PAGE_NB];
+    uint32_t eraseNs;
+    uint32_t programNs;
+    bool realTime;
+    uint32_t endurance;
+    FlashSimFault fault;
+    uint32_t faultCountdown;
+    bool erasePending;                             // HAL_FLASHEx_Erase_IT in progress
+    uint32_t pendingBank;
+    uint32_t pendingPage;
+    uint64_t pendingDoneNs;
+    uint32_t codeBank = FLASH_BANK_1;              // 0: no code fetched from flash
+    bool ramExecution;                             // Inside a RAM flash routine
+    FlashSimStats stats;
+};
+
+// Each thread drives the device bound to it, the default one until
+// flashSim_bind says otherwise
+static FlashSimDevice simDevice = {};
+static thread_local FlashSimDevice* sim = &simDevice;
+
+//-----------------------------------------------------------------------------
+//
+// Local Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+// Erased flash shared by every anonymous device, created on first use; -1
+// if memfd is unavailable. Devices map it copy on write, so a page costs
+// memory only once it is erased or programmed.
+static int simErasedImage(void)
+{
+    static const int fd = [] {
+        int f = memfd_create("flash_sim_erased", MFD_CLOEXEC);
+        if (f < 0 || ftruncate(f, FLASH_SIZE) != 0) {
+            if (f >= 0) {
+                close(f);
+            }
+            return -1;
+        }
+        void* p = mmap(nullptr, FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, f, 0);
+        if (p == MAP_FAILED) {
+            close(f);
+            return -1;
+        }
+        std::memset(p, FLASH_SIM_ERASED_BYTE, FLASH_SIZE);
+        munmap(p, FLASH_SIZE);
+        return f;
+    }();
+    return fd;
+}
+
+static void simAdvance(uint64_t ns)
+{
+    sim->stats.timeNs += ns;
+    if (sim->realTime) {
+        auto until = std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+        while (std::chrono::steady_clock::now() < until) {
+        }
+    }
+}
+
+// Account a flash operation of ns on bank against the code fetching from it
+static void simBankBusy(uint32_t bank, uint64_t ns)
+{
+    if (bank != sim->codeBank) {
+        sim->stats.concurrentNs += ns;
+    } else if (sim->ramExecution) {
+        sim->stats.ramOnlyNs += ns;
+    } else {
+        sim->stats.stallNs += ns;
+        sim->stats.maxStallNs = ns > sim->stats.maxStallNs ? ns : sim->stats.maxStallNs;
+    }
+}
+
+// Returns true when an armed fault of this type fires on this operation
+static bool simFaultFires(FlashSimFault fault)
+{
+    if (sim->fault != fault) {
+        return false;
+    }
+    if (--sim->faultCountdown != 0) {
+        return false;
+    }
+    sim->fault = FLASH_SIM_FAULT_NONE;
+    sim->stats.faultsInjected++;
+    return true;
+}
+
+static bool simIsProgrammed(uint32_t qw)
+{
+    return (sim->programmed[qw / 8] >> (qw % 8)) & 1U;
+}
+
+static void simSetProgrammed(uint32_t qw, bool programmed)
+{
+    if (programmed) {
+        sim->programmed[qw / 8] |= (uint8_t)(1U << (qw % 8));
+    } else {
+        sim->programmed[qw / 8] &= (uint8_t)~(1U << (qw % 8));
+    }
+}
+
+// Erase without accounting time, shared by the blocking and _IT paths
+static int simEraseContents(uint32_t bank, uint32_t page)
+{
+    uint32_t offset = (bank - 1) * FLASH_BANK_SIZE + page * FLASH_PAGE_SIZE;
+
+    if (simFaultFires(FLASH_SIM_FAULT_ERASE) ||
+        sim->eraseCount[bank - 1][page] >= sim->endurance) {
+        sim->error |= FLASH_FLAG_OPERR;
+        return 1;
+    }
+
+    std::memset(sim->image + offset, FLASH_SIM_ERASED_BYTE, FLASH_PAGE_SIZE);
+    for (uint32_t qw = 0; qw < FLASH_PAGE_SIZE / FLASH_SIM_QUADWORD; ++qw) {
+        simSetProgrammed(offset / FLASH_SIM_QUADWORD + qw, false);
+    }
+    sim->eraseCount[bank - 1][page]++;
+    sim->stats.pagesErased++;
+    return 0;
+}
+
+static int simErasePage(uint32_t bank, uint32_t page)
+{
+    simAdvance(sim->eraseNs);
+    simBankBusy(bank, sim->eraseNs);
+    return simEraseContents(bank, page);
+}
+
+// Finish a background erase and deliver its completion callback
+static void simCompleteErase(void)
+{
+    sim->erasePending = false;
+    if (simEraseContents(sim->pendingBank, sim->pendingPage) != 0) {
+        HAL_FLASH_OperationErrorCallback(sim->pendingPage);
+    } else {
+        HAL_FLASH_EndOfOperationCallback(sim->pendingPage);
+    }
+}
+
+// Operations queue behind a background erase, as the controller is busy
+static void simWaitIdle(void)
+{
+    if (sim->erasePending) {
+        if (sim->stats.timeNs < sim->pendingDoneNs) {
+            simAdvance(sim->pendingDoneNs - sim->stats.timeNs);
+        }
+        simCompleteErase();
+    }
+}
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+int flashSim_open(const char* imagePath)
+{
+    flashSim_close();
+
+    size_t existing = 0;
+    bool erased = false;           // Mapped onto the erased image, nothing to fill
+    void* map;
+    if (imagePath) {
+        sim->fd = open(imagePath, O_RDWR | O_CREAT, 0644);
+        if (sim->fd < 0) {
+            return 1;
+        }
+        struct stat st;
+        if (fstat(sim->fd, &st) != 0 || ftruncate(sim->fd, FLASH_SIZE) != 0) {
+            close(sim->fd);
+            sim->fd = -1;
+            return 1;
+        }
+        existing = (size_t) st.st_size < FLASH_SIZE ? (size_t) st.st_size : FLASH_SIZE;
+        map = mmap(nullptr, FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, sim->fd, 0);
+    } else {
+        sim->fd = -1;
+        int erasedFd = simErasedImage();
+        if (erasedFd >= 0) {
+            map = mmap(nullptr, FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE, erasedFd, 0);
+            erased = true;
+        } else {
+            map = mmap(nullptr, FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        }
+    }
+    if (map == MAP_FAILED) {
+        if (sim->fd >= 0) {
+            close(sim->fd);
+            sim->fd = -1;
+        }
+        return 1;
+    }
+    sim->image = static_cast<uint8_t*>(map);
+
+    // Newly created space reads as erased. Existing content has no record of
+    // what was programmed, so any quadword that is not all 0xFF counts as written.
+    if (!erased) {
+        std::memset(sim->image + existing, FLASH_SIM_ERASED_BYTE, FLASH_SIZE - existing);
+    }
+    std::memset(sim->programmed, 0, sizeof(sim->programmed));
+    for (uint32_t qw = 0; qw < existing / FLASH_SIM_QUADWORD; ++qw) {
+        const uint8_t* p = sim->image + qw * FLASH_SIM_QUADWORD;
+        for (uint32_t i = 0; i < FLASH_SIM_QUADWORD; ++i) {
+            if (p[i] != FLASH_SIM_ERASED_BYTE) {
+                simSetProgrammed(qw, true);
+                break;
+            }
+        }
+    }
+
+    sim->locked = true;
+    sim->error = 0;
+    if (sim->eraseNs == 0 && sim->programNs == 0) {
+        sim->eraseNs = FLASH_SIM_ERASE_NS;
+        sim->programNs = FLASH_SIM_PROGRAM_NS;
+    }
+    if (sim->endurance == 0) {
+        sim->endurance = FLASH_SIM_ENDURANCE;
+    }
+    std::memset(sim->eraseCount, 0, sizeof(sim->eraseCount));
+    flashSim_resetStats();
+    return 0;
+}
+
+void flashSim_close(void)
+{
+    if (sim->image) {
+        if (sim->fd >= 0) {
+            msync(sim->image, FLASH_SIZE, MS_SYNC);
+        }
+        sim->erasePending = false;
+        munmap(sim->image, FLASH_SIZE);
+        sim->image = nullptr;
+    }
+    if (sim->fd >= 0) {
+        close(sim->fd);
+    }
+    sim->fd = -1;
+}
+
+FlashSimDevice* flashSim_create(void)
+{
+    FlashSimDevice* device = new FlashSimDevice();
+    device->fd = -1;
+    FlashSimDevice* previous = flashSim_bind(device);
+    int result = flashSim_open(nullptr);
+    flashSim_bind(previous);
+    if (result != 0) {
+        delete device;
+        return nullptr;
+    }
+    return device;
+}
+
+void flashSim_destroy(FlashSimDevice* device)
+{
+    if (!device || device == &simDevice) {
+        return;
+    }
+    FlashSimDevice* previous = flashSim_bind(device);
+    flashSim_close();
+    flashSim_bind(previous == device ? nullptr : previous);
+    delete device;
+}
+
+FlashSimDevice* flashSim_bind(FlashSimDevice* device)
+{
+    FlashSimDevice* previous = sim == &simDevice ? nullptr : sim;
+    sim = device ? device : &simDevice;
+    return previous;
+}
+
+void flashSim_setTiming(uint32_t eraseNs, uint32_t programNs, bool realTime)
+{
+    sim->eraseNs = eraseNs;
+    sim->programNs = programNs;
+    sim->realTime = realTime;
+}
+
+void flashSim_setEndurance(uint32_t cycles)
+{
+    sim->endurance = cycles;
+}
+
+void flashSim_advance(uint64_t ns)
+{
+    simAdvance(ns);
+    if (sim->erasePending && sim->stats.timeNs >= sim->pendingDoneNs) {
+        simCompleteErase();
+    }
+}
+
+void flashSim_setCodeBank(uint32_t bank)
+{
+    sim->codeBank = bank;
+}
+
+void flashSim_injectFault(FlashSimFault fault, uint32_t afterOps)
+{
+    sim->fault = fault;
+    sim->faultCountdown = afterOps ? afterOps : 1;
+}
+
+uint32_t flashSim_getEraseCount(uint32_t bank, uint32_t page)
+{
+    if (bank < FLASH_BANK_1 || bank > FLASH_BANK_2 || page >= FLASH_PAGE_NB) {
+        return 0;
+    }
+    return sim->eraseCount[bank - 1][page];
+}
+
+void flashSim_getStats(FlashSimStats* stats)
+{
+    *stats = sim->stats;
+}
+
+void flashSim_resetStats(void)
+{
+    std::memset(&sim->stats, 0, sizeof(sim->stats));
+}
+
+//-----------------------------------------------------------------------------
+//
+// HAL Shim
+//
+//-----------------------------------------------------------------------------
+
+extern "C" {
+
+__IO uint8_t* flashSim_map(uint32_t addr)
+{
+    if (!sim->image || addr < FLASH_BASE || addr >= FLASH_BASE + FLASH_SIZE) {
+        Error_Handler(); // Equivalent of a bus fault on target
+    }
+    return sim->image + (addr - FLASH_BASE);
+}
+
+uint32_t flashSim_codeBank(void)
+{
+    return sim->codeBank;
+}
+
+void flashSim_ramExecution(int running)
+{
+    sim->ramExecution = running != 0;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+    simWaitIdle();
+    sim->stats.unlocks++;
+    if (simFaultFires(FLASH_SIM_FAULT_UNLOCK)) {
+        return HAL_ERROR;
+    }
+    sim->locked = false;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+    simWaitIdle();
+    sim->locked = true;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError)
+{
+    *PageError = 0xFFFFFFFFU;
+    simWaitIdle();
+    if (!sim->image || sim->locked) {
+        sim->error |= FLASH_FLAG_WRPERR;
+        return HAL_ERROR;
+    }
+
+    for (uint32_t bank = FLASH_BANK_1; bank <= FLASH_BANK_2; ++bank) {
+        if (!(pEraseInit->Banks & bank)) {
+            continue;
+        }
+        uint32_t first = 0;
+        uint32_t count = FLASH_PAGE_NB;
+        if (pEraseInit->TypeErase == FLASH_TYPEERASE_PAGES) {
+            first = pEraseInit->Page;
+            count = pEraseInit->NbPages;
+        }
+        if (first + count > FLASH_PAGE_NB) {
+            sim->error |= FLASH_FLAG_OPERR;
+            return HAL_ERROR;
+        }
+        for (uint32_t page = first; page < first + count; ++page) {
+            if (simErasePage(bank, page) != 0) {
+                *PageError = page;
+                return HAL_ERROR;
+            }
+        }
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase_IT(FLASH_EraseInitTypeDef *pEraseInit)
+{
+    simWaitIdle();
+    if (!sim->image || sim->locked) {
+        sim->error |= FLASH_FLAG_WRPERR;
+        return HAL_ERROR;
+    }
+    // Single page erases only; that is all the writers need
+    if (pEraseInit->TypeErase != FLASH_TYPEERASE_PAGES || pEraseInit->NbPages != 1 ||
+        (pEraseInit->Banks != FLASH_BANK_1 && pEraseInit->Banks != FLASH_BANK_2) ||
+        pEraseInit->Page >= FLASH_PAGE_NB) {
+        sim->error |= FLASH_FLAG_OPERR;
+        return HAL_ERROR;
+    }
+
+    sim->erasePending = true;
+    sim->pendingBank = pEraseInit->Banks;
+    sim->pendingPage = pEraseInit->Page;
+    sim->pendingDoneNs = sim->stats.timeNs + sim->eraseNs;
+    simBankBusy(sim->pendingBank, sim->eraseNs);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef FLASH_WaitForLastOperation(uint32_t Timeout)
+{
+    (void)Timeout;
+    simWaitIdle();
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uintptr_t DataAddress)
+{
+    simWaitIdle();
+    if (!sim->image || sim->locked || TypeProgram != FLASH_TYPEPROGRAM_QUADWORD ||
+        Address < FLASH_BASE || Address + FLASH_SIM_QUADWORD > FLASH_BASE + FLASH_SIZE ||
+        (Address % FLASH_SIM_QUADWORD) != 0) {
+        sim->error |= FLASH_FLAG_WRPERR;
+        sim->stats.programErrors++;
+        return HAL_ERROR;
+    }
+
+    uint32_t offset = Address - FLASH_BASE;
+    uint32_t qw = offset / FLASH_SIM_QUADWORD;
+
+    // ECC is computed per quadword, so it can only be written once per erase
+    if (simIsProgrammed(qw)) {
+        sim->error |= FLASH_FLAG_PROGERR;
+        sim->stats.programErrors++;
+        return HAL_ERROR;
+    }
+
+    simAdvance(sim->programNs);
+    simBankBusy(offset / FLASH_BANK_SIZE + 1, sim->programNs);
+    if (simFaultFires(FLASH_SIM_FAULT_PROGRAM)) {
+        sim->error |= FLASH_FLAG_PROGERR;
+        return HAL_ERROR;
+    }
+
+    // Programming can only clear bits
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(DataAddress);
+    for (uint32_t i = 0; i < FLASH_SIM_QUADWORD; ++i) {
+        sim->image[offset + i] &= src[i];
+    }
+    if (simFaultFires(FLASH_SIM_FAULT_BITFLIP)) {
+        // Lose the lowest bit that should have stayed set
+        for (uint32_t i = 0; i < FLASH_SIM_QUADWORD; ++i) {
+            uint8_t b = sim->image[offset + i];
+            if (b) {
+                sim->image[offset + i] = (uint8_t)(b & (b - 1));
+                break;
+            }
+        }
+    }
+    simSetProgrammed(qw, true);
+    sim->stats.quadwordsProgrammed++;
+    return HAL_OK;
+}
+
+uint32_t HAL_FLASH_GetError(void)
+{
+    return sim->error;
+}
+
+//-----------------------------------------------------------------------------
+//
+// Platform Glue
+//
+//-----------------------------------------------------------------------------
+
+void Error_Handler(void)
+{
+    std::fprintf(stderr, "Error_Handler: unrecoverable flash error (0x%08x)\n",
+                 (unsigned) sim->error);
+    std::abort();
+}
+
+void debug_msg(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    std::vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+}
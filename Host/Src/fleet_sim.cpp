@@ -0,0 +1,407 @@
+/*
+ * fleet_sim.cpp
+ *
+ *  Fleet simulator: thousands of virtual devices, each with its own
+ *  simulated flash, driven through provisioning, a firmware update and a
+ *  verifying reboot by a pool of worker threads. A device keeps only its
+ *  flash between phases; like a real one it boots into empty RAM, so a
+ *  worker loads its own store contexts from the device's partitions for
+ *  every job and any worker can pick up any device.
+ *
+ *  Output is JSON lines: one per phase with the per-device CPU time and
+ *  simulated flash time, and one with the memory cost of a device.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "host_tools.h"
+#include "flash_sim.h"
+#include "config.h"
+#include "config_history.h"
+#include "firmware.h"
+#include "flashFile.h"
+#include "flash_fs.h"
+#include "flash_partition.h"
+#include "flash_digest.h"
+#include "fw_image.h"
+#include "storage_stats.h"
+#include "util.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+//
+// Local Definitions
+//
+//-----------------------------------------------------------------------------
+
+// IDs of the provisioned entries, clear of the bench and schema IDs
+#define FLEET_ID_SERIAL     7000   // Config string
+#define FLEET_ID_SITE       7001   // Config string
+#define FLEET_ID_REGION     7002   // Config int
+#define FLEET_ID_INTERVAL   7003   // Config int, changed by the update
+#define FLEET_ID_VERSION    7100   // Firmware int
+#define FLEET_ID_IMAGE_CRC  7101   // Firmware int
+
+#define FLEET_VERSION_FACTORY 1
+#define FLEET_VERSION_UPDATE  2
+#define FLEET_LOG_FILE        "fleet.log"
+
+//-----------------------------------------------------------------------------
+//
+// Local Datatypes
+//
+//-----------------------------------------------------------------------------
+
+enum FleetPhase {
+    FLEET_PROVISION,               // Factory config, firmware and image
+    FLEET_UPDATE,                  // Differential image and store update
+    FLEET_VERIFY,                  // Reboot and check everything
+    FLEET_PHASE_COUNT
+};
+
+struct FleetDevice {
+    FlashSimDevice* flash;
+    uint32_t serial;
+    bool failed;
+    uint64_t cpuNs[FLEET_PHASE_COUNT];     // Thread CPU time of the job
+    uint64_t flashNs[FLEET_PHASE_COUNT];   // Simulated flash time of the job
+};
+
+// RAM state of a booted device, owned by a worker and reused job after job
+struct FleetWorker {
+    StoreContext config;
+    StoreContext firmware;
+    FsVolume volume;
+};
+
+struct Fleet {
+    std::vector<FleetDevice> devices;
+    std::vector<uint8_t> factoryImage;
+    std::vector<uint8_t> updateImage;
+    FwImageRegion region;
+    std::atomic<size_t> next;
+};
+
+//-----------------------------------------------------------------------------
+//
+// Local Functions
+//
+//-----------------------------------------------------------------------------
+
+static uint32_t lcg(uint32_t& seed) {
+    seed = seed * 1664525U + 1013904223U;
+    return seed >> 8;
+}
+
+static uint64_t threadCpuNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Resident set of the process in KB, 0 if unknown
+static uint64_t residentKb(void) {
+    FILE* file = std::fopen("/proc/self/status", "r");
+    if (!file) {
+        return 0;
+    }
+    char line[128];
+    uint64_t kb = 0;
+    while (std::fgets(line, sizeof(line), file)) {
+        if (std::strncmp(line, "VmRSS:", 6) == 0) {
+            kb = std::strtoull(line + 6, nullptr, 10);
+            break;
+        }
+    }
+    std::fclose(file);
+    return kb;
+}
+
+static int expectedInterval(const FleetDevice& device, bool updated) {
+    return updated ? 60 + (int)(device.serial % 7) : 300;
+}
+
+static int imageCrc(const std::vector<uint8_t>& image) {
+    return (int)util_crc32(0, image.data(), (uint32_t)image.size());
+}
+
+// Start the worker's RAM from scratch, as a reset would
+static void boot(FleetWorker* worker) {
+    configClear_r(&worker->config);
+    firmwareClear_r(&worker->firmware);
+    std::memset(&worker->volume, 0, sizeof(worker->volume));
+    flash_partitionForget();
+}
+
+static int streamImage(const Fleet& fleet, const std::vector<uint8_t>& image, bool differential) {
+    const uint32_t chunk = 256;
+    int failures = differential ? fwImageBeginDifferential(&fleet.region, (uint32_t)image.size())
+                                : fwImageBegin(&fleet.region, (uint32_t)image.size());
+    for (uint32_t offset = 0; failures == 0 && offset < image.size(); offset += chunk) {
+        uint32_t n = std::min<uint32_t>(chunk, (uint32_t)image.size() - offset);
+        failures += fwImageWrite(image.data() + offset, n);
+    }
+    return failures + fwImageFinish();
+}
+
+static int appendLog(FleetWorker* worker, const char* text) {
+    int fd = fileOpen_r(&worker->volume, FLEET_LOG_FILE);
+    if (fd < 0) {
+        return 1;
+    }
+    int failures = flash_fsSeek_r(&worker->volume, fd, 0, FLASH_FS_SEEK_END) < 0;
+    failures += flash_fsWrite_r(&worker->volume, fd, text, (uint32_t)std::strlen(text)) < 0;
+    return failures + (fileClose_r(&worker->volume, fd) != 0);
+}
+
+static int provision(const Fleet& fleet, FleetWorker* worker, const FleetDevice& device) {
+    char text[MAX_STRING_LENGTH];
+    int failures = 0;
+
+    std::snprintf(text, sizeof(text), "SN%08u", device.serial);
+    failures += configWriteString_r(&worker->config, FLEET_ID_SERIAL, text);
+    failures += configWriteString_r(&worker->config, FLEET_ID_SITE, "line-3");
+    failures += configWriteInt_r(&worker->config, FLEET_ID_REGION, (int)(device.serial % 16));
+    failures += configWriteInt_r(&worker->config, FLEET_ID_INTERVAL, expectedInterval(device, false));
+    failures += configHistoryCommit_r(&worker->config, FLASH_PARTITION_config);
+
+    failures += streamImage(fleet, fleet.factoryImage, false);
+    failures += firmwareWriteInt_r(&worker->firmware, FLEET_ID_VERSION, FLEET_VERSION_FACTORY);
+    failures += firmwareWriteInt_r(&worker->firmware, FLEET_ID_IMAGE_CRC,
+                                   imageCrc(fleet.factoryImage));
+    failures += flashFirmwarePartition_r(&worker->firmware, FLASH_PARTITION_firmware);
+
+    std::snprintf(text, sizeof(text), "provisioned %s\n", configGetString_r(&worker->config, FLEET_ID_SERIAL));
+    return failures + appendLog(worker, text);
+}
+
+static int update(const Fleet& fleet, FleetWorker* worker, const FleetDevice& device) {
+    int failures = configHistoryLoad_r(&worker->config, FLASH_PARTITION_config, CONFIG_HISTORY_NEWEST);
+    failures += loadFirmwarePartition_r(&worker->firmware, FLASH_PARTITION_firmware);
+    if (failures != 0 || firmwareGetInt_r(&worker->firmware, FLEET_ID_VERSION) != FLEET_VERSION_FACTORY) {
+        return 1;
+    }
+
+    failures += streamImage(fleet, fleet.updateImage, true);
+    failures += firmwareUpdateInt_r(&worker->firmware, FLEET_ID_VERSION, FLEET_VERSION_UPDATE);
+    failures += firmwareUpdateInt_r(&worker->firmware, FLEET_ID_IMAGE_CRC,
+                                    imageCrc(fleet.updateImage));
+    failures += flashFirmwarePartition_r(&worker->firmware, FLASH_PARTITION_firmware);
+    failures += configUpdateInt_r(&worker->config, FLEET_ID_INTERVAL, expectedInterval(device, true));
+    failures += configHistoryCommit_r(&worker->config, FLASH_PARTITION_config);
+    return failures + appendLog(worker, "updated\n");
+}
+
+static int verify(const Fleet& fleet, FleetWorker* worker, const FleetDevice& device) {
+    char expected[MAX_STRING_LENGTH];
+    int failures = configHistoryLoad_r(&worker->config, FLASH_PARTITION_config, CONFIG_HISTORY_NEWEST);
+    failures += loadFirmwarePartition_r(&worker->firmware, FLASH_PARTITION_firmware);
+    if (failures != 0) {
+        return 1;
+    }
+
+    std::snprintf(expected, sizeof(expected), "SN%08u", device.serial);
+    failures += std::strcmp(configGetString_r(&worker->config, FLEET_ID_SERIAL), expected) != 0;
+    failures += configGetInt_r(&worker->config, FLEET_ID_INTERVAL) != expectedInterval(device, true);
+    failures += firmwareGetInt_r(&worker->firmware, FLEET_ID_VERSION) != FLEET_VERSION_UPDATE;
+
+    const std::vector<uint8_t>& image = fleet.updateImage;
+    const uint8_t* flash = (const uint8_t*)FLASH_MAP(fleet.region.address);
+    failures += std::memcmp(flash, image.data(), image.size()) != 0;
+    failures += firmwareGetInt_r(&worker->firmware, FLEET_ID_IMAGE_CRC) != imageCrc(image);
+    FlashDigestReport report;
+    failures += flash_digestValidate(FLASH_DIGEST_FULL, 0, &report) != 0;
+
+    int fd = fileOpen_r(&worker->volume, FLEET_LOG_FILE);
+    char log[64] = {};
+    failures += fd < 0;
+    if (fd >= 0) {
+        failures += flash_fsRead_r(&worker->volume, fd, log, sizeof(log) - 1) < 0;
+        failures += std::strstr(log, expected) == nullptr || std::strstr(log, "updated") == nullptr;
+        failures += fileClose_r(&worker->volume, fd) != 0;
+    }
+    return failures;
+}
+
+// Take devices off the shared counter until the fleet is done
+static void workerRun(Fleet* fleet, FleetPhase phase) {
+    FleetWorker* worker = new FleetWorker();
+
+    for (size_t i = fleet->next.fetch_add(1); i < fleet->devices.size(); i = fleet->next.fetch_add(1)) {
+        FleetDevice& device = fleet->devices[i];
+        if (device.failed) {
+            continue;
+        }
+        uint64_t cpuStart = threadCpuNs();
+        FlashSimStats before, after;
+        flashSim_bind(device.flash);
+        flashSim_getStats(&before);
+        boot(worker);
+
+        int failures = 0;
+        switch (phase) {
+        case FLEET_PROVISION: failures = provision(*fleet, worker, device); break;
+        case FLEET_UPDATE:    failures = update(*fleet, worker, device); break;
+        default:              failures = verify(*fleet, worker, device); break;
+        }
+
+        flashSim_getStats(&after);
+        flashSim_bind(nullptr);
+        device.failed = failures != 0;
+        device.flashNs[phase] = after.timeNs - before.timeNs;
+        device.cpuNs[phase] = threadCpuNs() - cpuStart;
+    }
+    delete worker;
+}
+
+static double percentile(std::vector<uint64_t>& values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t k = (size_t)(p * (double)(values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return (double)values[k];
+}
+
+static void runPhase(Fleet* fleet, FleetPhase phase, uint32_t threads) {
+    static const char* const names[FLEET_PHASE_COUNT] = {"provision", "update", "verify"};
+
+    fleet->next = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (uint32_t t = 0; t < threads; ++t) {
+        pool.emplace_back(workerRun, fleet, phase);
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<uint64_t> cpu, flash;
+    uint32_t failed = 0;
+    for (const FleetDevice& device : fleet->devices) {
+        failed += device.failed;
+        cpu.push_back(device.cpuNs[phase]);
+        flash.push_back(device.flashNs[phase]);
+    }
+    size_t n = fleet->devices.size();
+    uint64_t cpuTotal = 0, flashTotal = 0;
+    for (size_t i = 0; i < n; ++i) {
+        cpuTotal += cpu[i];
+        flashTotal += flash[i];
+    }
+    std::printf("{\"fleet\":\"%s\",\"devices\":%zu,\"threads\":%u,\"failed\":%u,\"wall_ms\":%.1f,"
+                "\"devices_per_s\":%.0f,\"cpu_us_mean\":%.1f,\"cpu_us_p50\":%.1f,\"cpu_us_p99\":%.1f,"
+                "\"flash_ms_mean\":%.2f,\"flash_ms_p99\":%.2f}\n",
+                names[phase], n, threads, failed, wallMs, n / (wallMs / 1000.0),
+                cpuTotal / 1e3 / n, percentile(cpu, 0.50) / 1e3, percentile(cpu, 0.99) / 1e3,
+                flashTotal / 1e6 / n, percentile(flash, 0.99) / 1e6);
+}
+
+// The storage modules keep their working state per thread only when built
+// with STORAGE_THREAD_LOCAL=thread_local (defs.h)
+static bool storageIsThreadLocal(void) {
+    const void* here = &storageCounters;
+    const void* there = nullptr;
+    std::thread([&there] { there = &storageCounters; }).join();
+    return here != there;
+}
+
+static int usage(void) {
+    std::fprintf(stderr, "usage: fleet [--devices <n>] [--threads <n>] [--image-kb <n>]\n");
+    return 1;
+}
+
+//-----------------------------------------------------------------------------
+//
+// Tool Entry Point
+//
+//-----------------------------------------------------------------------------
+
+int fleet_main(int argc, char** argv) {
+    uint32_t deviceCount = 1000;
+    uint32_t threads = std::max(1U, std::thread::hardware_concurrency());
+    uint32_t imageKb = 32;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--devices") == 0 && i + 1 < argc) {
+            deviceCount = (uint32_t)std::strtoul(argv[++i], nullptr, 0);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = (uint32_t)std::strtoul(argv[++i], nullptr, 0);
+        } else if (std::strcmp(argv[i], "--image-kb") == 0 && i + 1 < argc) {
+            imageKb = (uint32_t)std::strtoul(argv[++i], nullptr, 0);
+        } else {
+            return usage();
+        }
+    }
+    const FlashPartition& staging = flash_partition(FLASH_PARTITION_fwimage);
+    if (deviceCount == 0 || threads == 0 || imageKb == 0 || imageKb * 1024 > staging.size) {
+        return usage();
+    }
+    if (threads > 1 && !storageIsThreadLocal()) {
+        std::fprintf(stderr, "fleet: storage state is not thread local, running on one thread\n");
+        threads = 1;
+    }
+
+    // One factory image; the update patches a few spots of it, as a minor
+    // release would
+    Fleet fleet;
+    fleet.region = {staging.address, staging.size};
+    fleet.factoryImage.resize(imageKb * 1024 - 100);
+    uint32_t seed = 11;
+    for (uint8_t& b : fleet.factoryImage) {
+        b = (uint8_t)lcg(seed);
+    }
+    fleet.updateImage = fleet.factoryImage;
+    for (size_t offset = 0x100; offset + 64 <= fleet.updateImage.size(); offset += 5 * FLASH_PAGE_SIZE) {
+        for (size_t i = 0; i < 64; ++i) {
+            fleet.updateImage[offset + i] ^= 0x5A;
+        }
+    }
+
+    uint64_t baseKb = residentKb();
+    fleet.devices.resize(deviceCount);
+    for (uint32_t i = 0; i < deviceCount; ++i) {
+        FleetDevice& device = fleet.devices[i];
+        device = {};
+        device.flash = flashSim_create();
+        device.serial = 100000 + i;
+        if (!device.flash) {
+            std::fprintf(stderr, "fleet: cannot create device %u\n", i);
+            for (uint32_t k = 0; k < i; ++k) {
+                flashSim_destroy(fleet.devices[k].flash);
+            }
+            return 1;
+        }
+    }
+    uint64_t createdKb = residentKb();
+
+    int result = 0;
+    for (int phase = 0; phase < FLEET_PHASE_COUNT; ++phase) {
+        runPhase(&fleet, (FleetPhase)phase, threads);
+    }
+    uint64_t finalKb = residentKb();
+    for (const FleetDevice& device : fleet.devices) {
+        result |= device.failed;
+    }
+
+    std::printf("{\"fleet\":\"memory\",\"devices\":%u,\"threads\":%u,\"created_kb_per_device\":%.1f,"
+                "\"rss_kb_per_device\":%.1f,\"flash_kb_per_device\":%u,\"worker_context_bytes\":%zu}\n",
+                deviceCount, threads, (double)(createdKb - baseKb) / deviceCount,
+                (double)(finalKb - baseKb) / deviceCount, (unsigned)(FLASH_SIZE / 1024),
+                sizeof(FleetWorker));
+
+    for (FleetDevice& device : fleet.devices) {
+        flashSim_destroy(device.flash);
+    }
+    return result;
+}
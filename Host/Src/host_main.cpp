@@ -0,0 +1,73 @@
+/*
+ * host_main.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "host_tools.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+struct HostTool {
+    const char* name;
+    int (*entry)(int argc, char** argv);
+    const char* help;
+};
+
+static const HostTool hostTools[] = {
+    {"bench", bench_main, "storage stack microbenchmarks, JSON lines on stdout"},
+    {"tracedump", tracedump_main, "decode the flash trace ring from a RAM snapshot"},
+    {"logdump", logdump_main, "decode the storage diagnostics log from a RAM snapshot"},
+    {"imagebuild", imagebuild_main, "build config/firmware images from a device manifest"},
+    {"inspect", inspect_main, "decode and diff stored images and flash dumps"},
+    {"fleet", fleet_main, "provision and update many simulated devices across threads"},
+};
+
+static std::atomic<uint64_t> allocationCount(0);
+
+uint64_t host_allocations() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+// Count every heap allocation so tools can report allocations per operation
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+static void usage(const char* prog) {
+    std::fprintf(stderr, "usage: %s <tool> [options]\n", prog);
+    for (const HostTool& tool : hostTools) {
+        std::fprintf(stderr, "  %-12s %s\n", tool.name, tool.help);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    for (const HostTool& tool : hostTools) {
+        if (std::strcmp(argv[1], tool.name) == 0) {
+            return tool.entry(argc - 1, argv + 1);
+        }
+    }
+    usage(argv[0]);
+    return 1;
+}
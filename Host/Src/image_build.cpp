@@ -0,0 +1,495 @@
+/*
+ * image_build.cpp
+ *
+ *  Offline image builder for provisioning. Each manifest row describes one
+ *  device; its entries are written with configWrite/firmwareWrite and
+ *  serialized with configFlush/firmwareFlush, so the files are exactly what
+ *  flashConfig/flashFirmware would program. Rows are spread over worker
+ *  processes (the stores are process-wide state); every worker streams the
+ *  manifest and writes each image as soon as it is built.
+ *
+ *  Manifest, CSV with a header row or JSON lines with one flat object per
+ *  device. Columns/keys are "device" and entry specs [config.|firmware.]name:id:type
+ *  with type i (integer) or s (string):
+ *      device,serial:1:i,label:2:s,firmware.build:7:i
+ *      unit0001,1001,"Line A",42
+ *      {"device":"unit0002","serial:1:i":1002,"label:2:s":"Line B"}
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "host_tools.h"
+#include "image_manifest.h"
+#include "flash_sim.h"
+#include "flash_program.h"
+#include "config.h"
+#include "firmware.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct ImageRow {
+    std::string device;
+    std::vector<std::pair<int, std::string>> values;   // Field index, text
+};
+
+struct ImageBuildStats {
+    uint64_t devices;
+    uint64_t images;
+    uint64_t bytes;
+    uint64_t failed;
+};
+
+struct ImageBuildOptions {
+    const char* manifest;
+    const char* outDir;
+    bool verify;
+};
+
+//-----------------------------------------------------------------------------
+// Manifest parsing
+//-----------------------------------------------------------------------------
+
+// "[config.|firmware.]name:id:type"
+bool imageParseFieldSpec(const std::string& spec, ImageField& field) {
+    size_t typeSep = spec.rfind(':');
+    size_t idSep = typeSep == std::string::npos ? std::string::npos : spec.rfind(':', typeSep - 1);
+    if (idSep == std::string::npos || typeSep != spec.size() - 2) {
+        return false;
+    }
+    std::string name = spec.substr(0, idSep);
+    field.firmware = false;
+    if (name.compare(0, 9, "firmware.") == 0) {
+        field.firmware = true;
+        name.erase(0, 9);
+    } else if (name.compare(0, 7, "config.") == 0) {
+        name.erase(0, 7);
+    }
+    char* end;
+    std::string id = spec.substr(idSep + 1, typeSep - idSep - 1);
+    field.id = (int)std::strtol(id.c_str(), &end, 10);
+    field.type = spec.back();
+    field.name = name;
+    field.spec = spec;
+    return !name.empty() && name.size() < MAX_STRING_LENGTH && !id.empty() && *end == '\0' &&
+           field.id >= 0 && (field.type == 'i' || field.type == 's');
+}
+
+// Split a CSV line; quoted fields may contain commas and "" for a quote
+static bool splitCsv(const char* line, std::vector<std::string>& out) {
+    out.clear();
+    std::string cell;
+    bool quoted = false;
+    for (const char* p = line; ; ++p) {
+        char c = *p;
+        if (quoted) {
+            if (c == '\0') {
+                return false;
+            }
+            if (c == '"' && p[1] == '"') {
+                cell += '"';
+                ++p;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                cell += c;
+            }
+        } else if (c == '"' && cell.empty()) {
+            quoted = true;
+        } else if (c == ',' || c == '\0' || c == '\n' || c == '\r') {
+            out.push_back(cell);
+            cell.clear();
+            if (c != ',') {
+                return true;
+            }
+        } else {
+            cell += c;
+        }
+    }
+}
+
+static void skipSpace(const char*& p) {
+    while (*p == ' ' || *p == '\t') {
+        ++p;
+    }
+}
+
+static bool parseJsonString(const char*& p, std::string& out) {
+    out.clear();
+    if (*p++ != '"') {
+        return false;
+    }
+    while (*p && *p != '"') {
+        char c = *p++;
+        if (c == '\\') {
+            c = *p++;
+            if (c == 'n') {
+                c = '\n';
+            } else if (c == 't') {
+                c = '\t';
+            } else if (c != '"' && c != '\\' && c != '/') {
+                return false; // \u escapes are not needed for identifiers
+            }
+        }
+        out += c;
+    }
+    return *p++ == '"';
+}
+
+// One flat object: string keys, string or integer values
+static bool splitJson(const char* line, std::vector<std::pair<std::string, std::string>>& out) {
+    const char* p = line;
+    std::string key, value;
+    out.clear();
+    skipSpace(p);
+    if (*p++ != '{') {
+        return false;
+    }
+    skipSpace(p);
+    while (*p != '}') {
+        if (!parseJsonString(p, key)) {
+            return false;
+        }
+        skipSpace(p);
+        if (*p++ != ':') {
+            return false;
+        }
+        skipSpace(p);
+        if (*p == '"') {
+            if (!parseJsonString(p, value)) {
+                return false;
+            }
+        } else {
+            const char* start = p;
+            while (*p == '-' || (*p >= '0' && *p <= '9')) {
+                ++p;
+            }
+            if (p == start) {
+                return false;
+            }
+            value.assign(start, p);
+        }
+        out.emplace_back(key, value);
+        skipSpace(p);
+        if (*p == ',') {
+            ++p;
+            skipSpace(p);
+        } else if (*p != '}') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Index of the field for a column/key, added on first use
+static int findField(std::vector<ImageField>& fields, const std::string& spec) {
+    for (size_t i = 0; i < fields.size(); ++i) {
+        if (fields[i].spec == spec) {
+            return (int)i;
+        }
+    }
+    ImageField field;
+    if (!imageParseFieldSpec(spec, field)) {
+        return -1;
+    }
+    fields.push_back(field);
+    return (int)fields.size() - 1;
+}
+
+//-----------------------------------------------------------------------------
+// Image building, reusing the device serializer
+//-----------------------------------------------------------------------------
+
+static bool writeFile(const std::string& path, const void* data, size_t size) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = std::fwrite(data, 1, size, f) == size;
+    return std::fclose(f) == 0 && ok;
+}
+
+// Program the image into the simulator, load it back with loadConfig /
+// loadFirmware and check it serializes to the same bytes
+static bool verifyImage(bool firmware, uint32_t* image, size_t imageSize,
+                        const uint32_t* serialized, size_t size) {
+    uint32_t address = flash_partition(FLASH_PARTITION_user).address;
+    uint32_t again[FLASH_PAGE_SIZE / sizeof(uint32_t)];
+    size_t againSize = sizeof(again);
+
+    if (flash_pageEraseWriteVerify(image, imageSize, address) != 0) {
+        return false;
+    }
+    if (firmware) {
+        firmwareClear();
+        if (loadFirmware(address) != 0 || firmwareFlush(again, againSize) != 0) {
+            return false;
+        }
+    } else {
+        configClear();
+        if (loadConfig(address) != 0 || configFlush(again, againSize) != 0) {
+            return false;
+        }
+    }
+    return againSize == size && std::memcmp(again, serialized, size) == 0;
+}
+
+static bool buildImage(const ImageBuildOptions& options, const std::vector<ImageField>& fields,
+                       const ImageRow& row, bool firmware, ImageBuildStats& stats) {
+    uint32_t buffer[FLASH_PAGE_SIZE / sizeof(uint32_t)];
+    size_t size = sizeof(buffer);
+    bool any = false;
+
+    firmware ? firmwareClear() : configClear();
+    for (const auto& value : row.values) {
+        const ImageField& field = fields[value.first];
+        if (field.firmware != firmware) {
+            continue;
+        }
+        any = true;
+
+        // Read each entry back, the store drops entries beyond its capacity
+        const char* text = value.second.c_str();
+        bool stored;
+        if (field.type == 'i') {
+            char* end;
+            int n = (int)std::strtol(text, &end, 10);
+            stored = *text && *end == '\0' &&
+                     (firmware ? firmwareWrite(field.name.c_str(), field.id, 'i', &n)
+                               : configWrite(field.name.c_str(), field.id, 'i', &n)) == 0 &&
+                     (firmware ? firmwareGetInt(field.id) : configGetInt(field.id)) == n;
+        } else {
+            const char* readBack;
+            stored = value.second.size() < MAX_STRING_LENGTH &&
+                     (firmware ? firmwareWrite(field.name.c_str(), field.id, 's', text)
+                               : configWrite(field.name.c_str(), field.id, 's', text)) == 0 &&
+                     (readBack = firmware ? firmwareGetString(field.id) : configGetString(field.id)) &&
+                     std::strcmp(readBack, text) == 0;
+        }
+        if (!stored) {
+            std::fprintf(stderr, "imagebuild: %s: cannot store %s = \"%s\"\n",
+                         row.device.c_str(), field.name.c_str(), text);
+            return false;
+        }
+    }
+    if (!any) {
+        return true; // Nothing of this kind for the device
+    }
+
+    if ((firmware ? firmwareFlush(buffer, size) : configFlush(buffer, size)) != 0) {
+        std::fprintf(stderr, "imagebuild: %s: store does not fit in a page\n", row.device.c_str());
+        return false;
+    }
+    uint32_t* image;
+    size_t imageSize;
+    if (fileEncodeImage(buffer, size, image, imageSize) != 0) {
+        return false;
+    }
+    std::string path = std::string(options.outDir) + "/" + row.device +
+                       (firmware ? ".firmware.bin" : ".config.bin");
+    if (!writeFile(path, image, imageSize)) {
+        std::fprintf(stderr, "imagebuild: cannot write %s\n", path.c_str());
+        return false;
+    }
+    if (options.verify && !verifyImage(firmware, image, imageSize, buffer, size)) {
+        std::fprintf(stderr, "imagebuild: %s: image does not load back\n", path.c_str());
+        return false;
+    }
+    stats.images++;
+    stats.bytes += imageSize;
+    return true;
+}
+
+static bool validDevice(const std::string& device) {
+    return !device.empty() && device.find('/') == std::string::npos && device != "." && device != "..";
+}
+
+//-----------------------------------------------------------------------------
+// Worker: stream the manifest, build the rows assigned to it
+//-----------------------------------------------------------------------------
+
+static void runWorker(const ImageBuildOptions& options, uint32_t worker, uint32_t workers,
+                      ImageBuildStats& stats) {
+    FILE* in = std::fopen(options.manifest, "r");
+    if (!in || flashSim_open(nullptr) != 0) {
+        std::fprintf(stderr, "imagebuild: cannot open %s\n", options.manifest);
+        stats.failed++;
+        if (in) {
+            std::fclose(in);
+        }
+        return;
+    }
+    flashSim_setEndurance(0xFFFFFFFFU);
+
+    std::vector<ImageField> fields;
+    std::vector<int> columns;                   // CSV column to field, -1 = device
+    std::vector<std::string> cells;
+    std::vector<std::pair<std::string, std::string>> pairs;
+    ImageRow row;
+    char* line = nullptr;
+    size_t lineCapacity = 0;
+    uint64_t lineNumber = 0;
+    uint64_t rowIndex = 0;
+    bool csv = false;
+    bool first = true;
+
+    while (getline(&line, &lineCapacity, in) > 0) {
+        lineNumber++;
+        const char* p = line;
+        skipSpace(p);
+        if (*p == '\n' || *p == '\r' || *p == '\0' || *p == '#') {
+            continue;
+        }
+
+        // First line decides the format; the CSV header is parsed by every worker
+        if (first && *p != '{') {
+            first = false;
+            csv = true;
+            bool ok = splitCsv(p, cells);
+            for (size_t i = 0; ok && i < cells.size(); ++i) {
+                columns.push_back(cells[i] == "device" ? -1 : findField(fields, cells[i]));
+                ok = cells[i] == "device" || columns.back() >= 0;
+            }
+            if (!ok || columns.empty() || columns[0] != -1) {
+                std::fprintf(stderr, "imagebuild: bad header, expected device,name:id:type,...\n");
+                stats.failed++;
+                break;
+            }
+            continue;
+        }
+        first = false;
+        if (rowIndex++ % workers != worker) {
+            continue;
+        }
+
+        stats.devices++;
+        row.device.clear();
+        row.values.clear();
+        bool ok;
+        if (csv) {
+            ok = splitCsv(p, cells) && cells.size() == columns.size();
+            for (size_t i = 0; ok && i < cells.size(); ++i) {
+                if (columns[i] < 0) {
+                    row.device = cells[i];
+                } else if (!cells[i].empty()) {
+                    row.values.emplace_back(columns[i], cells[i]); // Empty cell: no entry
+                }
+            }
+        } else {
+            ok = splitJson(p, pairs);
+            for (size_t i = 0; ok && i < pairs.size(); ++i) {
+                if (pairs[i].first == "device") {
+                    row.device = pairs[i].second;
+                } else {
+                    int field = findField(fields, pairs[i].first);
+                    ok = field >= 0;
+                    row.values.emplace_back(field, pairs[i].second);
+                }
+            }
+        }
+        if (!ok || !validDevice(row.device)) {
+            std::fprintf(stderr, "imagebuild: %s:%llu: malformed row\n", options.manifest,
+                         (unsigned long long)lineNumber);
+            stats.failed++;
+            continue;
+        }
+        if (!buildImage(options, fields, row, false, stats) ||
+            !buildImage(options, fields, row, true, stats)) {
+            stats.failed++;
+        }
+    }
+
+    std::free(line);
+    std::fclose(in);
+    flashSim_close();
+}
+
+static int usage(void) {
+    std::fprintf(stderr, "usage: imagebuild <manifest.csv|manifest.jsonl> <outdir> [--jobs N] "
+                         "[--compress] [--verify]\n");
+    return 1;
+}
+
+int imagebuild_main(int argc, char** argv) {
+    ImageBuildOptions options = {nullptr, nullptr, false};
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = std::strtol(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--compress") == 0) {
+            fileSetCompression(true);
+        } else if (std::strcmp(argv[i], "--verify") == 0) {
+            options.verify = true;
+        } else if (argv[i][0] == '-') {
+            return usage();
+        } else if (!options.manifest) {
+            options.manifest = argv[i];
+        } else if (!options.outDir) {
+            options.outDir = argv[i];
+        } else {
+            return usage();
+        }
+    }
+    if (!options.manifest || !options.outDir || jobs < 1) {
+        return usage();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<pid_t> pids;
+    std::vector<int> pipes;
+    ImageBuildStats total = {};
+
+    // Workers report their counts through a pipe when done
+    for (long w = 0; w < jobs; ++w) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            total.failed++;
+            break;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            ImageBuildStats stats = {};
+            runWorker(options, (uint32_t)w, (uint32_t)jobs, stats);
+            ssize_t n = write(fds[1], &stats, sizeof(stats));
+            _exit(n == (ssize_t)sizeof(stats) ? 0 : 1);
+        }
+        close(fds[1]);
+        if (pid < 0) {
+            close(fds[0]);
+            total.failed++;
+            break;
+        }
+        pids.push_back(pid);
+        pipes.push_back(fds[0]);
+    }
+
+    for (size_t w = 0; w < pids.size(); ++w) {
+        ImageBuildStats stats = {};
+        int status = 0;
+        if (read(pipes[w], &stats, sizeof(stats)) != (ssize_t)sizeof(stats)) {
+            stats.failed++;
+        }
+        close(pipes[w]);
+        waitpid(pids[w], &status, 0);
+        total.devices += stats.devices;
+        total.images += stats.images;
+        total.bytes += stats.bytes;
+        total.failed += stats.failed;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("{\"tool\":\"imagebuild\",\"workers\":%zu,\"devices\":%llu,\"images\":%llu,"
+                "\"bytes\":%llu,\"failed\":%llu,\"seconds\":%.3f,\"images_per_s\":%.0f}\n",
+                pids.size(), (unsigned long long)total.devices, (unsigned long long)total.images,
+                (unsigned long long)total.bytes, (unsigned long long)total.failed, seconds,
+                seconds > 0 ? total.images / seconds : 0.0);
+    return total.failed ? 1 : 0;
+}
@@ -0,0 +1,483 @@
+/*
+ * image_inspect.cpp
+ *
+ *  Inspector for stored images and flash dumps. Files are mapped rather
+ *  than read. A file of up to one page is a single image (as written by
+ *  imagebuild or pulled from a page); anything larger is a dump scanned
+ *  page by page for images and wear-leveled commits. Images are checked
+ *  for a sane configFlush layout and then loaded with processConfigBuffer
+ *  (processFirmwareBuffer with --firmware), so the entries shown are those
+ *  the device would load.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "host_tools.h"
+#include "image_manifest.h"
+#include "flash_program.h"
+#include "flash_wear.h"
+#include "config.h"
+#include "firmware.h"
+#include "InitArrayMap.h"
+#include "flash_partition.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define INSPECT_HEADER_SIZE  (2 * sizeof(uint32_t))   // Int and string counts
+
+struct InspectEntry {
+    int type;                  // TYPE_INT / TYPE_STRING
+    int id;
+    int value;
+    std::string text;
+};
+
+struct InspectImage {
+    uint64_t offset;           // Within the file
+    const char* container;     // "image" or "wear"
+    const char* partition;     // Partition of a full dump page, else nullptr
+    const char* format;        // "raw", "lz" or "headered"
+    uint32_t sequence;         // Wear commits only
+    uint32_t storedSize;
+    uint32_t rawSize;
+    uint32_t ints;
+    uint32_t strings;
+    const char* status;        // "ok" or the first problem found
+    std::vector<InspectEntry> entries;
+};
+
+struct InspectOptions {
+    bool firmware;
+    bool summary;
+    std::map<int, std::string> names;
+};
+
+//-----------------------------------------------------------------------------
+// Decoding
+//-----------------------------------------------------------------------------
+
+static bool allErased(const uint8_t* p, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        if (p[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Check the serialized layout before handing it to processConfigBuffer,
+// which only stops at the first entry that does not fit, so the report can
+// name what is wrong. Returns nullptr when the layout is sane.
+static const char* checkLayout(const uint8_t* data, size_t size, uint32_t& ints,
+                               uint32_t& strings, uint32_t& used) {
+    if (size < INSPECT_HEADER_SIZE) {
+        return "truncated";
+    }
+    std::memcpy(&ints, data, sizeof(ints));
+    std::memcpy(&strings, data + sizeof(ints), sizeof(strings));
+    uint64_t required = INSPECT_HEADER_SIZE + (uint64_t)ints * INT_ENTRY_SIZE +
+                        (uint64_t)strings * (2 * sizeof(int) + STRING_ENTRY_SIZE);
+    if (required > size) {
+        return "bad-counts";
+    }
+    used = (uint32_t)required;
+
+    const uint8_t* p = data + INSPECT_HEADER_SIZE;
+    for (uint32_t i = 0; i < ints + strings; ++i) {
+        int type;
+        std::memcpy(&type, p, sizeof(type));
+        if (type != (i < ints ? TYPE_INT : TYPE_STRING)) {
+            return "bad-type";
+        }
+        if (i >= ints && !std::memchr(p + 2 * sizeof(int), '\0', MAX_STRING_LENGTH)) {
+            return "bad-string";
+        }
+        p += i < ints ? INT_ENTRY_SIZE : 2 * sizeof(int) + STRING_ENTRY_SIZE;
+    }
+    return nullptr;
+}
+
+// Load through the device code and copy the entries out of the store
+static void loadEntries(const InspectOptions& options, const uint8_t* data, size_t size,
+                        InspectImage& image) {
+    InitArrayMap& store = options.firmware ? firmwareArrayMap : configArrayMap;
+    if (options.firmware) {
+        firmwareClear();
+        processFirmwareBuffer(data, size);
+    } else {
+        configClear();
+        processConfigBuffer(data, size);
+    }
+
+    // In ID order, ints before strings of the same ID
+    for (const StoreEntryView& e : options.firmware ? firmwareRange(INT_MIN, INT_MAX)
+                                                    : configRange(INT_MIN, INT_MAX)) {
+        image.entries.push_back({e.type, e.id, e.value,
+                                 e.type == TYPE_STRING ? std::string(e.text, e.length) : ""});
+    }
+    if ((store.intCount < image.ints && store.intCount >= MAX_INT_ENTRIES) ||
+        (store.stringCount < image.strings && store.stringCount >= MAX_STRING_ENTRIES)) {
+        image.status = "store-full"; // More entries than this build's store holds
+    }
+}
+
+// Decode the image at data; available bounds it (end of page or file)
+static bool decodeImage(const InspectOptions& options, const uint8_t* data, size_t available,
+                        InspectImage& image) {
+    static uint8_t expanded[FLASH_PAGE_SIZE]; // Store of any build, not just this one
+    const uint8_t* serialized = data;
+    size_t size = available;
+    uint32_t magic = 0;
+
+    std::memcpy(&magic, data, available < sizeof(magic) ? available : sizeof(magic));
+    image.format = "raw";
+    image.status = "ok";
+    if (magic == FILE_IMAGE_MAGIC && available >= sizeof(FileImageHeader)) {
+        FileImageHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        image.format = header.method == FILE_IMAGE_METHOD_LZ ? "lz" : "headered";
+        image.storedSize = sizeof(header) + header.storedSize;
+        image.rawSize = header.rawSize;
+        size = sizeof(expanded);
+        if (fileDecodeBuffer(data, (uint32_t)available, expanded, size) != 0) {
+            image.status = "bad-image";
+            return true; // Recognised, but cannot be trusted
+        }
+        serialized = expanded;
+    }
+
+    uint32_t used = 0;
+    const char* problem = checkLayout(serialized, size, image.ints, image.strings, used);
+    if (problem) {
+        image.status = problem;
+        return serialized != data; // A raw page that does not parse is not an image
+    }
+    if (serialized == data) {
+        image.storedSize = used;
+        image.rawSize = used;
+    }
+    loadEntries(options, serialized, used, image);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Files
+//-----------------------------------------------------------------------------
+
+struct MappedFile {
+    const uint8_t* data;
+    size_t size;
+};
+
+static bool mapFile(const char* path, MappedFile& file) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    file.data = nullptr;
+    file.size = 0;
+    if (fd < 0) {
+        return false;
+    }
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    file.size = (size_t)st.st_size;
+    if (file.size) {
+        void* map = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        file.data = map == MAP_FAILED ? nullptr : (const uint8_t*)map;
+    }
+    close(fd);
+    return file.size == 0 || file.data;
+}
+
+static void unmapFile(MappedFile& file) {
+    if (file.data) {
+        munmap(const_cast<uint8_t*>(file.data), file.size);
+    }
+}
+
+// Find every image in a mapped file; erased and unrecognised pages are counted
+static void scanFile(const InspectOptions& options, const MappedFile& file,
+                     std::vector<InspectImage>& images, uint32_t& erased, uint32_t& unknown) {
+    size_t step = file.size > FLASH_PAGE_SIZE ? FLASH_PAGE_SIZE : file.size;
+    erased = 0;
+    unknown = 0;
+
+    for (size_t offset = 0; offset < file.size; offset += step) {
+        const uint8_t* page = file.data + offset;
+        size_t available = file.size - offset < step ? file.size - offset : step;
+        InspectImage image = {};
+        image.offset = offset;
+        image.container = "image";
+        if (file.size == FLASH_SIZE) {
+            FlashPartitionId id = flash_partitionOf(FLASH_BASE + (uint32_t)offset);
+            image.partition = id < FLASH_PARTITION_COUNT ? flash_partition(id).name : "unpartitioned";
+        }
+
+        if (allErased(page, available)) {
+            erased++;
+            continue;
+        }
+        uint32_t sequence, length;
+        int wear = available == FLASH_PAGE_SIZE ? flash_wearCheckPage(page, &sequence, &length) : 1;
+        if (wear != 1) {
+            image.container = "wear";
+            image.sequence = sequence;
+            if (wear == 2) {
+                image.format = "raw";
+                image.status = "bad-commit";
+                image.storedSize = length;
+                images.push_back(image);
+                continue;
+            }
+            decodeImage(options, page + FLASH_WEAR_HEADER_SIZE, length, image);
+            images.push_back(image);
+        } else if (decodeImage(options, page, available, image)) {
+            images.push_back(image);
+        } else {
+            unknown++;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Output
+//-----------------------------------------------------------------------------
+
+static void printEntry(const InspectOptions& options, char mark, const InspectEntry& e) {
+    auto name = options.names.find(e.type == TYPE_INT ? e.id : ~e.id);
+    const char* label = name == options.names.end() ? "" : name->second.c_str();
+    if (e.type == TYPE_INT) {
+        std::printf("%c int    id %-6d = %-24d %s\n", mark, e.id, e.value, label);
+    } else {
+        std::printf("%c string id %-6d = \"%s\"%*s %s\n", mark, e.id, e.text.c_str(),
+                    e.text.size() < 22 ? (int)(22 - e.text.size()) : 0, "", label);
+    }
+}
+
+static void printImage(const InspectOptions& options, const char* path, const InspectImage& image) {
+    std::printf("%s @0x%05llx %s %s", path, (unsigned long long)image.offset,
+                image.container, image.format);
+    if (image.partition) {
+        std::printf(" in %s", image.partition);
+    }
+    if (image.container[0] == 'w') {
+        std::printf(" seq %u", image.sequence);
+    }
+    std::printf(" stored %u raw %u ints %u strings %u %s\n", image.storedSize, image.rawSize,
+                image.ints, image.strings, image.status);
+    if (!options.summary) {
+        for (const InspectEntry& e : image.entries) {
+            printEntry(options, ' ', e);
+        }
+    }
+}
+
+static int inspectPath(const InspectOptions& options, const char* path, uint64_t& images,
+                       uint64_t& bytes) {
+    MappedFile file;
+    if (!mapFile(path, file)) {
+        std::fprintf(stderr, "inspect: cannot map %s\n", path);
+        return 1;
+    }
+    std::vector<InspectImage> found;
+    uint32_t erased, unknown;
+    scanFile(options, file, found, erased, unknown);
+    for (const InspectImage& image : found) {
+        printImage(options, path, image);
+    }
+    if (found.empty() && file.size <= FLASH_PAGE_SIZE) {
+        std::printf("%s: %s\n", path, erased ? "erased" : "no image");
+    }
+    if (file.size > FLASH_PAGE_SIZE && !options.summary) {
+        std::printf("%s: %zu bytes, %zu images, %u erased pages, %u other pages\n",
+                    path, file.size, found.size(), erased, unknown);
+    }
+    images += found.size();
+    bytes += file.size;
+    unmapFile(file);
+
+    int bad = found.empty() && file.size <= FLASH_PAGE_SIZE;
+    for (const InspectImage& image : found) {
+        bad |= std::strcmp(image.status, "ok") != 0;
+    }
+    return bad;
+}
+
+// The image to diff in a file: the newest valid wear commit, else the first image
+static bool pickImage(const InspectOptions& options, const char* path, InspectImage& image) {
+    MappedFile file;
+    std::vector<InspectImage> found;
+    uint32_t erased, unknown;
+    if (!mapFile(path, file)) {
+        std::fprintf(stderr, "inspect: cannot map %s\n", path);
+        return false;
+    }
+    scanFile(options, file, found, erased, unknown);
+    unmapFile(file);
+
+    const InspectImage* best = nullptr;
+    for (const InspectImage& candidate : found) {
+        if (std::strcmp(candidate.status, "ok") != 0) {
+            continue;
+        }
+        bool wear = candidate.container[0] == 'w';
+        if (!best || (wear && (best->container[0] != 'w' ||
+                               (int32_t)(candidate.sequence - best->sequence) > 0))) {
+            best = &candidate;
+        }
+    }
+    if (!best) {
+        std::fprintf(stderr, "inspect: no valid image in %s\n", path);
+        return false;
+    }
+    image = *best;
+    return true;
+}
+
+// Order of configRange/firmwareRange
+static bool entryLess(const InspectEntry& a, const InspectEntry& b) {
+    return a.id != b.id ? a.id < b.id : a.type < b.type;
+}
+
+static int diffImages(const InspectOptions& options, const char* pathA, const char* pathB) {
+    InspectImage a, b;
+    if (!pickImage(options, pathA, a) || !pickImage(options, pathB, b)) {
+        return 2;
+    }
+
+    uint32_t added = 0, removed = 0, changed = 0, same = 0;
+    size_t i = 0, j = 0;
+    while (i < a.entries.size() || j < b.entries.size()) {
+        if (j == b.entries.size() || (i < a.entries.size() && entryLess(a.entries[i], b.entries[j]))) {
+            printEntry(options, '-', a.entries[i++]);
+            removed++;
+        } else if (i == a.entries.size() || entryLess(b.entries[j], a.entries[i])) {
+            printEntry(options, '+', b.entries[j++]);
+            added++;
+        } else {
+            const InspectEntry& x = a.entries[i++];
+            const InspectEntry& y = b.entries[j++];
+            if (x.value != y.value || x.text != y.text) {
+                printEntry(options, '-', x);
+                printEntry(options, '+', y);
+                changed++;
+            } else {
+                same++;
+            }
+        }
+    }
+    std::printf("%u changed, %u added, %u removed, %u same\n", changed, added, removed, same);
+    return changed || added || removed ? 1 : 0;
+}
+
+// Names come from an imagebuild manifest header or any comma separated specs
+static bool loadNames(const char* path, InspectOptions& options) {
+    FILE* f = std::fopen(path, "r");
+    char line[4096];
+    if (!f) {
+        return false;
+    }
+    while (std::fgets(line, sizeof(line), f)) {
+        for (char* token = std::strtok(line, ",\r\n"); token; token = std::strtok(nullptr, ",\r\n")) {
+            ImageField field;
+            if (imageParseFieldSpec(token, field) && field.firmware == options.firmware) {
+                options.names[field.type == 'i' ? field.id : ~field.id] = field.name;
+            }
+        }
+    }
+    std::fclose(f);
+    return true;
+}
+
+static int usage(void) {
+    std::fprintf(stderr,
+                 "usage: inspect [--firmware] [--summary] [--names specs.csv] <file|dir>...\n"
+                 "       inspect [--firmware] [--names specs.csv] --diff <a> <b>\n");
+    return 2;
+}
+
+int inspect_main(int argc, char** argv) {
+    InspectOptions options;
+    std::vector<const char*> inputs;
+    const char* namesPath = nullptr;
+    bool diff = false;
+
+    options.firmware = false;
+    options.summary = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--firmware") == 0) {
+            options.firmware = true;
+        } else if (std::strcmp(argv[i], "--summary") == 0) {
+            options.summary = true;
+        } else if (std::strcmp(argv[i], "--diff") == 0) {
+            diff = true;
+        } else if (std::strcmp(argv[i], "--names") == 0 && i + 1 < argc) {
+            namesPath = argv[++i];
+        } else if (argv[i][0] == '-') {
+            return usage();
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (namesPath && !loadNames(namesPath, options)) {
+        std::fprintf(stderr, "inspect: cannot read %s\n", namesPath);
+        return 2;
+    }
+    if (diff) {
+        return inputs.size() == 2 ? diffImages(options, inputs[0], inputs[1]) : usage();
+    }
+    if (inputs.empty()) {
+        return usage();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t files = 0, images = 0, bytes = 0;
+    int bad = 0;
+    for (const char* input : inputs) {
+        struct stat st;
+        if (stat(input, &st) == 0 && S_ISDIR(st.st_mode)) {
+            // One summary line per image for directories of dumps
+            std::vector<std::string> names;
+            DIR* dir = opendir(input);
+            for (struct dirent* d = dir ? readdir(dir) : nullptr; d; d = readdir(dir)) {
+                if (d->d_name[0] != '.') {
+                    names.push_back(std::string(input) + "/" + d->d_name);
+                }
+            }
+            if (dir) {
+                closedir(dir);
+            }
+            std::sort(names.begin(), names.end());
+            bool summary = options.summary;
+            options.summary = true;
+            for (const std::string& name : names) {
+                bad |= inspectPath(options, name.c_str(), images, bytes);
+                files++;
+            }
+            options.summary = summary;
+        } else {
+            bad |= inspectPath(options, input, images, bytes);
+            files++;
+        }
+    }
+
+    if (files > 1) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::fprintf(stderr, "inspect: %llu files, %llu images, %.1f MB in %.3f s\n",
+                     (unsigned long long)files, (unsigned long long)images, bytes / 1e6, seconds);
+    }
+    return bad;
+}
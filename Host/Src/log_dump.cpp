@@ -0,0 +1,213 @@
+/*
+ * log_dump.cpp
+ *
+ *  Decoder for the flash_log ring. Takes a raw RAM snapshot (e.g. a
+ *  debugger dump of SRAM), finds the ring by its magic and prints the
+ *  recorded messages, oldest first, formatted with the FLASH_LOG_MESSAGES
+ *  formats this tool was built with. --capture produces such a snapshot on
+ *  the host by running store commits against the simulator.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "host_tools.h"
+#include "flash_sim.h"
+#include "flash_log.h"
+#include "flash_program.h"
+#include "config.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define LOG_HEADER_WORDS 5         // magic, mask, head, cyclesPerSecond, tableId
+#define LOG_MAX_ENTRIES  65536U    // Sanity bound when validating a candidate
+
+struct LogView {
+    uint32_t mask;
+    uint32_t head;
+    uint32_t cyclesPerSecond;
+    uint32_t tableId;
+    const uint8_t* entries;
+};
+
+static uint32_t readWord(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Locate the ring in a snapshot. The layout only uses 32-bit fields, so it
+// is the same for target and host builds.
+static int findLog(const std::vector<uint8_t>& image, LogView* view) {
+    size_t headerSize = LOG_HEADER_WORDS * sizeof(uint32_t);
+
+    for (size_t offset = 0; offset + headerSize <= image.size(); offset += sizeof(uint32_t)) {
+        const uint8_t* p = image.data() + offset;
+        if (readWord(p) != FLASH_LOG_MAGIC) {
+            continue;
+        }
+        uint32_t mask = readWord(p + 4);
+        if (mask >= LOG_MAX_ENTRIES || (mask & (mask + 1)) != 0 ||
+            offset + headerSize + (mask + 1) * sizeof(FlashLogEntry) > image.size()) {
+            continue;
+        }
+        view->mask = mask;
+        view->head = readWord(p + 8);
+        view->cyclesPerSecond = readWord(p + 12);
+        view->tableId = readWord(p + 16);
+        view->entries = p + headerSize;
+        return 0;
+    }
+    return 1;
+}
+
+static double toMicroseconds(uint32_t cycles, uint32_t cyclesPerSecond) {
+    return cyclesPerSecond ? cycles * 1e6 / cyclesPerSecond : cycles;
+}
+
+static void printMessages(const LogView& view) {
+    uint32_t capacity = view.mask + 1;
+    uint32_t count = view.head < capacity ? view.head : capacity;
+    uint32_t first = view.head - count;
+    uint32_t startCycles = 0;
+    uint32_t lastCycles = 0;
+
+    if (view.tableId != flashLogTableId()) {
+        std::printf("# message table 0x%08x differs from this decoder's 0x%08x, text may be wrong\n",
+                    view.tableId, flashLogTableId());
+    }
+    std::printf("# %u messages recorded, %u kept, timestamps in %s\n", view.head, count,
+                view.cyclesPerSecond ? "us" : "cycles (unit unknown)");
+    std::printf("# %10s %12s %10s  message\n", "seq", "time", "delta");
+
+    for (uint32_t seq = first; seq != view.head; ++seq) {
+        const uint8_t* entry = view.entries + (seq & view.mask) * sizeof(FlashLogEntry);
+        uint32_t timestamp = readWord(entry);
+        uint32_t args[FLASH_LOG_ARGS];
+        for (uint32_t i = 0; i < FLASH_LOG_ARGS; ++i) {
+            args[i] = readWord(entry + 4 + i * sizeof(uint32_t));
+        }
+        uint32_t word = readWord(entry + 4 + FLASH_LOG_ARGS * sizeof(uint32_t));
+        uint32_t id = word & 0xFFFFU;
+
+        if (seq == first) {
+            startCycles = timestamp;
+            lastCycles = timestamp;
+        }
+        std::printf("  %10u %12.3f %10.3f  ", seq,
+                    toMicroseconds(timestamp - startCycles, view.cyclesPerSecond),
+                    toMicroseconds(timestamp - lastCycles, view.cyclesPerSecond));
+        lastCycles = timestamp;
+
+        if ((word >> 16) != (seq & 0xFFFFU)) {
+            std::printf("(being written)\n");
+        } else if (id == FLASH_LOG_NONE || id >= FLASH_LOG_COUNT) {
+            std::printf("unknown message %u: 0x%08x 0x%08x 0x%08x 0x%08x\n", id, args[0], args[1],
+                        args[2], args[3]);
+        } else {
+            // Formats only take 32-bit conversions; unused arguments are ignored
+            std::printf(flashLogFormats[id], args[0], args[1], args[2], args[3]);
+            std::printf("\n");
+        }
+    }
+}
+
+// Run a few commits on the simulator and save the ring as a snapshot
+static int capture(const char* path, uint32_t commits, FlashSimFault fault) {
+    if (flashSim_open(nullptr) != 0) {
+        std::fprintf(stderr, "logdump: cannot create simulated flash\n");
+        return 1;
+    }
+    flash_logClear();
+    configClear();
+    configWriteInt(1, 0);
+    configWriteString(2, "log");
+    for (uint32_t i = 0; i < commits; ++i) {
+        if (fault != FLASH_SIM_FAULT_NONE && i + 1 == commits) {
+            flashSim_injectFault(fault, 1);
+        }
+        configWriteInt(1, (int)i + 1);
+        flashConfigPartition(FLASH_PARTITION_user);
+    }
+    loadConfigPartition(FLASH_PARTITION_user);
+    configClear();
+    flashSim_close();
+
+    FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        std::perror(path);
+        return 1;
+    }
+    size_t written = std::fwrite(&flashLog, sizeof(flashLog), 1, file);
+    std::fclose(file);
+    return written == 1 ? 0 : 1;
+}
+
+static int usage() {
+    std::fprintf(stderr, "usage: logdump <ram-snapshot.bin>\n"
+                         "       logdump --capture <out.bin> [--commits N] [--fault erase|unlock|bitflip]\n");
+    return 1;
+}
+
+int logdump_main(int argc, char** argv) {
+    const char* capturePath = nullptr;
+    const char* snapshotPath = nullptr;
+    uint32_t commits = 2;
+    FlashSimFault fault = FLASH_SIM_FAULT_NONE;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capturePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--commits") == 0 && i + 1 < argc) {
+            commits = (uint32_t)std::strtoul(argv[++i], nullptr, 0);
+        } else if (std::strcmp(argv[i], "--fault") == 0 && i + 1 < argc) {
+            ++i;
+            if (std::strcmp(argv[i], "erase") == 0) {
+                fault = FLASH_SIM_FAULT_ERASE;
+            } else if (std::strcmp(argv[i], "unlock") == 0) {
+                fault = FLASH_SIM_FAULT_UNLOCK;
+            } else if (std::strcmp(argv[i], "bitflip") == 0) {
+                fault = FLASH_SIM_FAULT_BITFLIP;
+            } else {
+                return usage();
+            }
+        } else if (argv[i][0] != '-' && !snapshotPath) {
+            snapshotPath = argv[i];
+        } else {
+            return usage();
+        }
+    }
+
+    if (capturePath) {
+        if (capture(capturePath, commits, fault) != 0) {
+            return 1;
+        }
+        snapshotPath = capturePath;
+    }
+    if (!snapshotPath) {
+        return usage();
+    }
+
+    FILE* file = std::fopen(snapshotPath, "rb");
+    if (!file) {
+        std::perror(snapshotPath);
+        return 1;
+    }
+    std::vector<uint8_t> image;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        image.insert(image.end(), chunk, chunk + n);
+    }
+    std::fclose(file);
+
+    LogView view;
+    if (findLog(image, &view) != 0) {
+        std::fprintf(stderr, "logdump: no log ring found in %s\n", snapshotPath);
+        return 1;
+    }
+    printMessages(view);
+    return 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * serial_loopback.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "serial_loopback.h"
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+//
+// Local Functions
+//
+//-----------------------------------------------------------------------------
+
+// Put a frame on the wire, accounting its transmission time
+static int wireSend(SerialLoopback* loopback, const uint8_t* frame, size_t size) {
+    if (size == 0 || size > sizeof(loopback->wire) || loopback->wireSize != 0) {
+        return 1;
+    }
+    std::memcpy(loopback->wire, frame, size);
+    loopback->wireSize = size;
+    loopback->bytes += size;
+    if (loopback->linkBps) {
+        loopback->linkNs += (uint64_t)size * SERIAL_LOOPBACK_BITS_PER_BYTE * 1000000000ULL / loopback->linkBps;
+    }
+    return 0;
+}
+
+static int wireReceive(SerialLoopback* loopback, uint8_t* frame, size_t capacity, size_t* size) {
+    if (loopback->wireSize == 0 || loopback->wireSize > capacity) {
+        return 1;
+    }
+    std::memcpy(frame, loopback->wire, loopback->wireSize);
+    *size = loopback->wireSize;
+    loopback->wireSize = 0;
+    return 0;
+}
+
+static int deviceSend(void* context, const uint8_t* frame, size_t size) {
+    return wireSend(static_cast<SerialLoopback*>(context), frame, size);
+}
+
+static int deviceReceive(void* context, uint8_t* frame, size_t capacity, size_t* size) {
+    return wireReceive(static_cast<SerialLoopback*>(context), frame, capacity, size);
+}
+
+// The device answers as soon as the request is on the wire
+static int clientSend(void* context, const uint8_t* frame, size_t size) {
+    SerialLoopback* loopback = static_cast<SerialLoopback*>(context);
+    if (wireSend(loopback, frame, size) != 0) {
+        return 1;
+    }
+    loopback->linkNs += loopback->turnaroundNs;
+    loopback->frames++;
+    return serialPoll(&loopback->device, loopback->deviceFrame, sizeof(loopback->deviceFrame));
+}
+
+static int clientReceive(void* context, uint8_t* frame, size_t capacity, size_t* size) {
+    return wireReceive(static_cast<SerialLoopback*>(context), frame, capacity, size);
+}
+
+//-----------------------------------------------------------------------------
+//
+// Interface Function Definitions
+//
+//-----------------------------------------------------------------------------
+
+void serialLoopbackInit(SerialLoopback* loopback, uint32_t linkBps, uint32_t turnaroundNs) {
+    loopback->wireSize = 0;
+    loopback->linkBps = linkBps;
+    loopback->turnaroundNs = turnaroundNs;
+    loopback->device = {deviceSend, deviceReceive, loopback};
+    serialLoopbackResetStats(loopback);
+}
+
+SerialTransport serialLoopbackClient(SerialLoopback* loopback) {
+    return {clientSend, clientReceive, loopback};
+}
+
+void serialLoopbackResetStats(SerialLoopback* loopback) {
+    loopback->linkNs = 0;
+    loopback->frames = 0;
+    loopback->bytes = 0;
+}
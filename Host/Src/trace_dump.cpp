@@ -0,0 +1,247 @@
+/*
+ * trace_dump.cpp
+ *
+ *  Decoder for the flash trace ring. Takes a raw RAM snapshot (e.g. a
+ *  debugger dump of SRAM), finds the ring by its magic and prints the
+ *  recorded flash timeline, oldest event first. --capture produces such a
+ *  snapshot on the host by running store commits against the simulator.
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: bem012
+ */
+
+#include "host_tools.h"
+#include "flash_sim.h"
+#include "flash_trace.h"
+#include "flash_program.h"
+#include "config.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define TRACE_HEADER_WORDS 4       // magic, mask, head, cyclesPerSecond
+#define TRACE_MAX_EVENTS   65536U  // Sanity bound when validating a candidate
+
+struct TraceView {
+    uint32_t mask;
+    uint32_t head;
+    uint32_t cyclesPerSecond;
+    const uint8_t* events;
+};
+
+static uint32_t readWord(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Locate the ring in a snapshot. The layout only uses 32-bit fields, so it
+// is the same for target and host builds.
+static int findTrace(const std::vector<uint8_t>& image, TraceView* view) {
+    size_t headerSize = TRACE_HEADER_WORDS * sizeof(uint32_t);
+
+    for (size_t offset = 0; offset + headerSize <= image.size(); offset += sizeof(uint32_t)) {
+        const uint8_t* p = image.data() + offset;
+        if (readWord(p) != FLASH_TRACE_MAGIC) {
+            continue;
+        }
+        uint32_t mask = readWord(p + 4);
+        if (mask >= TRACE_MAX_EVENTS || (mask & (mask + 1)) != 0 ||
+            offset + headerSize + (mask + 1) * sizeof(FlashTraceEvent) > image.size()) {
+            continue;
+        }
+        view->mask = mask;
+        view->head = readWord(p + 8);
+        view->cyclesPerSecond = readWord(p + 12);
+        view->events = p + headerSize;
+        return 0;
+    }
+    return 1;
+}
+
+static const char* opName(uint32_t op) {
+    switch (op) {
+    case FLASH_TRACE_OP_FLASH_CONFIG:   return "flashConfig";
+    case FLASH_TRACE_OP_LOAD_CONFIG:    return "loadConfig";
+    case FLASH_TRACE_OP_FLASH_FIRMWARE: return "flashFirmware";
+    case FLASH_TRACE_OP_LOAD_FIRMWARE:  return "loadFirmware";
+    case FLASH_TRACE_OP_FW_IMAGE:       return "fwImage";
+    default:                            return "?";
+    }
+}
+
+static const char* statusName(uint32_t status) {
+    static const char* names[] = {"HAL_OK", "HAL_ERROR", "HAL_BUSY", "HAL_TIMEOUT"};
+    return status < 4 ? names[status] : "?";
+}
+
+static double toMicroseconds(uint32_t cycles, uint32_t cyclesPerSecond) {
+    return cyclesPerSecond ? cycles * 1e6 / cyclesPerSecond : cycles;
+}
+
+static void printTimeline(const TraceView& view) {
+    uint32_t capacity = view.mask + 1;
+    uint32_t count = view.head < capacity ? view.head : capacity;
+    uint32_t first = view.head - count;
+    uint32_t beginCycles[FLASH_TRACE_OP_COUNT] = {};
+    bool begun[FLASH_TRACE_OP_COUNT] = {};
+    uint32_t startCycles = 0;
+    uint32_t lastCycles = 0;
+
+    std::printf("# %u events recorded, %u kept, timestamps in %s\n", view.head, count,
+                view.cyclesPerSecond ? "us" : "cycles (unit unknown)");
+    std::printf("# %10s %12s %10s  event\n", "seq", "time", "delta");
+
+    for (uint32_t seq = first; seq != view.head; ++seq) {
+        const uint8_t* event = view.events + (seq & view.mask) * sizeof(FlashTraceEvent);
+        uint32_t timestamp = readWord(event);
+        uint32_t word = readWord(event + 4);
+        uint32_t type = word & 0xFFU;
+        uint32_t arg = word >> 8;
+        bool failed = (arg & FLASH_TRACE_ERROR) != 0;
+        uint32_t value = arg & ~FLASH_TRACE_ERROR;
+
+        if (seq == first) {
+            startCycles = timestamp;
+            lastCycles = timestamp;
+        }
+        std::printf("  %10u %12.3f %10.3f  ", seq,
+                    toMicroseconds(timestamp - startCycles, view.cyclesPerSecond),
+                    toMicroseconds(timestamp - lastCycles, view.cyclesPerSecond));
+        lastCycles = timestamp;
+
+        switch (type) {
+        case FLASH_TRACE_UNLOCK:
+            std::printf("unlock   %s\n", statusName(value));
+            break;
+        case FLASH_TRACE_LOCK:
+            std::printf("lock     %s\n", statusName(value));
+            break;
+        case FLASH_TRACE_ERASE:
+            std::printf("erase    bank %u page %u%s\n", value >> 8, value & 0xFFU, failed ? " FAILED" : "");
+            break;
+        case FLASH_TRACE_PROGRAM:
+            std::printf("program  0x%08x%s\n", (unsigned)(FLASH_BASE + value * FLASH_QUADWORD_SIZE), failed ? " FAILED" : "");
+            break;
+        case FLASH_TRACE_VERIFY:
+            std::printf("verify   %s\n", failed ? "MISMATCH" : "ok");
+            break;
+        case FLASH_TRACE_STORE_BEGIN:
+            std::printf("begin    %s\n", opName(value));
+            if (value < FLASH_TRACE_OP_COUNT) {
+                beginCycles[value] = timestamp;
+                begun[value] = true;
+            }
+            break;
+        case FLASH_TRACE_STORE_END:
+            std::printf("end      %s %s", opName(value), failed ? "FAILED" : "ok");
+            if (value < FLASH_TRACE_OP_COUNT && begun[value]) {
+                std::printf(" (%.3f us)", toMicroseconds(timestamp - beginCycles[value], view.cyclesPerSecond));
+            }
+            std::printf("\n");
+            break;
+        default:
+            std::printf("unknown  type %u arg 0x%06x\n", type, arg);
+            break;
+        }
+    }
+}
+
+// Run a few commits on the simulator and save the ring as a snapshot
+static int capture(const char* path, uint32_t commits, FlashSimFault fault) {
+    if (flashSim_open(nullptr) != 0) {
+        std::fprintf(stderr, "tracedump: cannot create simulated flash\n");
+        return 1;
+    }
+    flash_traceClear();
+    configClear();
+    configWriteInt(1, 0);
+    configWriteString(2, "trace");
+    for (uint32_t i = 0; i < commits; ++i) {
+        if (fault != FLASH_SIM_FAULT_NONE && i + 1 == commits) {
+            flashSim_injectFault(fault, 1);
+        }
+        configWriteInt(1, (int)i + 1);
+        flashConfigPartition(FLASH_PARTITION_user);
+    }
+    loadConfigPartition(FLASH_PARTITION_user);
+    configClear();
+    flashSim_close();
+
+    FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        std::perror(path);
+        return 1;
+    }
+    size_t written = std::fwrite(&flashTrace, sizeof(flashTrace), 1, file);
+    std::fclose(file);
+    return written == 1 ? 0 : 1;
+}
+
+static int usage() {
+    std::fprintf(stderr, "usage: tracedump <ram-snapshot.bin>\n"
+                         "       tracedump --capture <out.bin> [--commits N] [--fault erase|unlock|bitflip]\n");
+    return 1;
+}
+
+int tracedump_main(int argc, char** argv) {
+    const char* capturePath = nullptr;
+    const char* snapshotPath = nullptr;
+    uint32_t commits = 2;
+    FlashSimFault fault = FLASH_SIM_FAULT_NONE;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capturePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--commits") == 0 && i + 1 < argc) {
+            commits = (uint32_t)std::strtoul(argv[++i], nullptr, 0);
+        } else if (std::strcmp(argv[i], "--fault") == 0 && i + 1 < argc) {
+            ++i;
+            if (std::strcmp(argv[i], "erase") == 0) {
+                fault = FLASH_SIM_FAULT_ERASE;
+            } else if (std::strcmp(argv[i], "unlock") == 0) {
+                fault = FLASH_SIM_FAULT_UNLOCK;
+            } else if (std::strcmp(argv[i], "bitflip") == 0) {
+                fault = FLASH_SIM_FAULT_BITFLIP;
+            } else {
+                return usage();
+            }
+        } else if (argv[i][0] != '-' && !snapshotPath) {
+            snapshotPath = argv[i];
+        } else {
+            return usage();
+        }
+    }
+
+    if (capturePath) {
+        if (capture(capturePath, commits, fault) != 0) {
+            return 1;
+        }
+        snapshotPath = capturePath;
+    }
+    if (!snapshotPath) {
+        return usage();
+    }
+
+    FILE* file = std::fopen(snapshotPath, "rb");
+    if (!file) {
+        std::perror(snapshotPath);
+        return 1;
+    }
+    std::vector<uint8_t> image;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        image.insert(image.end(), chunk, chunk + n);
+    }
+    std::fclose(file);
+
+    TraceView view;
+    if (findTrace(image, &view) != 0) {
+        std::fprintf(stderr, "tracedump: no trace ring found in %s\n", snapshotPath);
+        return 1;
+    }
+    printTimeline(view);
+    return 0;
+}